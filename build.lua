@@ -50,6 +50,7 @@ local modules = {
 	forth        = { is_exe=true, srcs={"forth/forth.c"}, deps={"common", "tb"}, flags="-I libCuik/include" },
 	--   TB unittests
 	tests        = { is_exe=true, srcs={"tb/tests/cg_test.c"}, deps={"tb", "common"} },
+	test         = { is_exe=true, srcs={"tb/unittests/tb_unittests.c"}, deps={"tb", "common"} },
 
 	-- external dependencies
 	mimalloc = { srcs={"mimalloc/src/static.c"} }
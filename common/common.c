@@ -157,6 +157,7 @@ void tb_arena_restore(TB_Arena* arena, TB_ArenaSavepoint sp) {
         c = next;
     }
 
+    sp.top->next = NULL;
     arena->top = sp.top;
     arena->watermark = sp.watermark;
     arena->high_point = &sp.top->data[arena->chunk_size - sizeof(TB_ArenaChunk)];
@@ -179,7 +180,9 @@ void tb_arena_clear(TB_Arena* arena) {
     arena->base = arena->top = c;
 
     // remove extra chunks
+    TB_ArenaChunk* first = c;
     c = c->next;
+    first->next = NULL;
     while (c != NULL) {
         TB_ArenaChunk* next = c->next;
         cuik__vfree(c, arena->chunk_size);
@@ -240,7 +243,10 @@ void futex_wait(Futex* addr, Futex val) {
         int ret = futex(addr, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, val, NULL, NULL, 0);
 
         if (ret == -1) {
-            if (errno != EAGAIN) {
+            // EAGAIN means the value changed before we could sleep
+            if (errno == EAGAIN) {
+                return;
+            } else if (errno != EINTR) {
                 __builtin_trap();
             }
         } else if (ret == 0) {
@@ -284,7 +290,7 @@ void futex_signal(Futex* addr) {
     }
 }
 
-void _tpool_broadcast(Futex* addr) {
+void futex_broadcast(Futex* addr) {
     for (;;) {
         int ret = __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO | ULF_WAKE_ALL, addr, 0);
         if (ret >= 0) {
@@ -80,6 +80,7 @@ void  cuik_init_terminal(void);
 
 void  tls_init(void);
 void  tls_reset(void);
+void  tls_free(void);
 void* tls_push(size_t size);
 void* tls_pop(size_t size);
 void* tls_save(void);
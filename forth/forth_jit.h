@@ -195,7 +195,7 @@ static JIT_Trampoline jit__get_trampoline(size_t arity, size_t outs) {
 
         // JIT & export
         TB_Passes* p = tb_pass_enter(f, tb_function_get_arena(f));
-        tb_pass_codegen(p, false);
+        tb_pass_codegen(p, TB_REGALLOC_LINEAR_SCAN, false);
         tb_pass_exit(p);
 
         // we can throw away the function IR now
@@ -722,7 +722,7 @@ static void jit__compile_blob(VM_Thread* env, Word* w, const char* name) {
         // tb_function_print(f, tb_default_print_callback, stdout);
 
         // compile
-        TB_FunctionOutput* out = tb_pass_codegen(p, false);
+        TB_FunctionOutput* out = tb_pass_codegen(p, TB_REGALLOC_LINEAR_SCAN, false);
         // tb_output_print_asm(out, stdout);
     }
     tb_pass_exit(p);
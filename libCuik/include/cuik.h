@@ -26,8 +26,8 @@ typedef struct Cuik_IThreadpool {
     //   arg_size from Cuik is always going to be less than 64bytes
     void (*submit)(void* user_data, Cuik_TaskFn fn, size_t arg_size, void* arg);
 
-    // tries to work one job before returning (can also not work at all)
-    void (*work_one_job)(void* user_data);
+    // tries to work one job before returning, false if there was nothing to do
+    bool (*work_one_job)(void* user_data);
 } Cuik_IThreadpool;
 
 // for doing calls on the interfaces
@@ -480,6 +480,8 @@ typedef enum {
     STMT_FLAGS_HAS_IR_BACKING = 1,
     STMT_FLAGS_IS_EXPORTED    = 2,
     STMT_FLAGS_IS_RESOLVING   = 4,
+    // used by the parser when it's only parsing reachable functions
+    STMT_FLAGS_IS_REACHED     = 8,
 } StmtFlags;
 
 struct Stmt {
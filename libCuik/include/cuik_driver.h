@@ -32,6 +32,10 @@ struct Cuik_DriverArgs {
     int threads, opt_level;
     const char* output_name;
     const char* entrypoint;
+    const char* token_cache;
+
+    // if non-NULL, every cc step shares the headers it's loaded through this
+    Cuik_FileCache* file_cache;
 
     void* diag_userdata;
     Cuik_DiagCallback diag_callback;
@@ -55,12 +59,15 @@ struct Cuik_DriverArgs {
     bool time            : 1;
     bool verbose         : 1;
     bool syntax_only     : 1;
+    bool lazy            : 1;
+    bool pipeline        : 1;
     bool test_preproc    : 1;
     bool debug_info      : 1;
     bool preprocess      : 1;
     bool think           : 1;
     bool based           : 1;
     bool preserve_ast    : 1;
+    bool diag_sarif      : 1;
 };
 
 typedef struct Cuik_Arg Cuik_Arg;
@@ -97,6 +104,10 @@ CUIK_API bool cuik_driver_compile(Cuik_IThreadpool* restrict thread_pool, Cuik_D
 CUIK_API Cuik_CPP* cuik_driver_preprocess_str(String source, const Cuik_DriverArgs* args, bool should_finalize);
 CUIK_API Cuik_CPP* cuik_driver_preprocess_cstr(const char* source, const Cuik_DriverArgs* args, bool should_finalize);
 
+// the preprocessor keeps running on another thread, view can be parsed in the meantime
+// (see cuikpp_run_async). cuikpp_join has to be called before using the Cuik_CPP.
+CUIK_API Cuik_CPP* cuik_driver_preprocess_async(const char* filepath, const Cuik_DriverArgs* args, TokenStream* view);
+
 #ifdef CUIK_USE_TB
 CUIK_API void cuik_apply_tb_toolchain_libs(TB_Linker* l);
 #endif
@@ -25,6 +25,19 @@ CUIK_API bool cuikfs_read(Cuik_File* file, void* data, size_t count);
 
 CUIK_API bool cuikfs_canonicalize(Cuik_Path* out, const char* path, bool case_insensitive);
 
+// maps the entire file as copy-on-write, so writes to the view never make it back
+// to the file. returns NULL if it failed.
+CUIK_API void* cuikfs_map(const char* path, size_t* out_length);
+CUIK_API void cuikfs_unmap(void* ptr, size_t length);
+
+// same as cuikfs_map but guarantees at least pad zeroed bytes after the contents, the
+// result can be released with cuik__vfree(ptr, length + pad). returns NULL if it failed
+// or if the platform can't map files like this (the caller should just read the file).
+CUIK_API void* cuikfs_map_padded(const char* path, size_t pad, size_t* out_length);
+
+// returns false if the directory doesn't exist and couldn't be made
+CUIK_API bool cuikfs_make_dir(const char* path);
+
 #endif // CUIK_FS_H
 
 #ifdef CUIK_FS_IMPL
@@ -38,6 +51,10 @@ CUIK_API bool cuikfs_canonicalize(Cuik_Path* out, const char* path, bool case_in
 #elif defined(__linux__)
 #include <dirent.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #else
 #error "cuik_fs: unsupported on this platform (for now?)"
 #endif
@@ -191,4 +208,106 @@ bool cuikfs_read(Cuik_File* file, void* data, size_t count) {
     return read(file->id, data, count) == count;
     #endif
 }
+void* cuikfs_map(const char* path, size_t* out_length) {
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    // the view keeps the mapping alive, we don't need the handles
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, 0);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+
+    void* ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+
+    *out_length = file_size.QuadPart;
+    return ptr;
+    #else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat file_stats;
+    if (fstat(fd, &file_stats) == -1 || file_stats.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* ptr = mmap(NULL, file_stats.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+
+    *out_length = file_stats.st_size;
+    return ptr;
+    #endif
+}
+
+void* cuikfs_map_padded(const char* path, size_t pad, size_t* out_length) {
+    #ifdef _WIN32
+    // views can't be placed in front of other pages and they can't be freed with
+    // VirtualFree either.
+    return NULL;
+    #else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat file_stats;
+    if (fstat(fd, &file_stats) == -1 || file_stats.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // reserve zeroed pages for the whole thing and place the file over the front of it,
+    // the kernel zero-fills the rest of the last file page and anything past that is
+    // still the reservation.
+    size_t length = file_stats.st_size;
+    char* ptr = mmap(NULL, length + pad, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    if (mmap(ptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(ptr, length + pad);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+    *out_length = length;
+    return ptr;
+    #endif
+}
+
+void cuikfs_unmap(void* ptr, size_t length) {
+    #ifdef _WIN32
+    UnmapViewOfFile(ptr);
+    #else
+    munmap(ptr, length);
+    #endif
+}
+
+bool cuikfs_make_dir(const char* path) {
+    #ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+    #else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+    #endif
+}
 #endif // CUIK_FS_IMPL
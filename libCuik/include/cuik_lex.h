@@ -22,6 +22,7 @@ enum {
 };
 
 typedef struct Cuik_CPP Cuik_CPP;
+typedef struct Cuik_FileCache Cuik_FileCache;
 typedef struct Cuik_Target Cuik_Target;
 typedef struct Cuik_Parser Cuik_Parser;
 typedef struct Cuik_Diagnostics Cuik_Diagnostics;
@@ -87,6 +88,10 @@ typedef struct SourceRange {
 typedef struct {
     const char* filename;
     bool is_system;
+    // content lives in a token cache mapping rather than a virtual memory block
+    bool is_cached;
+    // content belongs to a Cuik_FileCache
+    bool is_shared;
 
     int depth;
     SourceLoc include_site;
@@ -103,7 +108,10 @@ typedef struct {
 
     // a DynArray(uint32_t) sorted to make it possible to binary search
     //   [line] = file_pos
-    uint32_t* line_map;
+    //
+    // it's built the first time someone resolves a location in the file, only
+    // the first chunk of a big file holds it.
+    _Atomic(uint32_t*) line_map;
 } Cuik_FileEntry;
 
 typedef struct Token {
@@ -133,9 +141,40 @@ typedef struct TokenArray {
     size_t current;
 } TokenArray;
 
+// the token's text is in the file it's located in, TokenTable.file_text[file ID] + pos
+#define TOKEN_TEXT_IN_FILE UINT32_MAX
+
+typedef struct TokenText {
+    // into TokenTable.text_data (or TOKEN_TEXT_IN_FILE)
+    uint32_t offset, length;
+} TokenText;
+
+// The preprocessor's output, it's a struct of arrays since the parser mostly compares
+// types and there's no reason to drag the locations & contents through the cache for
+// that, a token costs 16 bytes. Most tokens come straight out of a file so their text
+// is found through their location, only the ones the preprocessor made up or moved
+// (macro expansions, pastes, stringizing) are copied into text_data (NUL terminated).
+typedef struct TokenTable {
+    // count includes the NULL token at the end once the preprocessor is done
+    size_t current, count, capacity;
+
+    // type & flags, laid out like the first word of Token
+    uint32_t* bits;
+    SourceLoc* locations;
+    TokenText* text;
+
+    size_t text_size, text_capacity;
+    unsigned char* text_data;
+
+    // parallel to TokenStream.files, it's here so the parser's snapshot of the
+    // table doesn't race with the preprocessor adding files.
+    size_t file_count, file_capacity;
+    const unsigned char** file_text;
+} TokenTable;
+
 typedef struct TokenStream {
     const char* filepath;
-    TokenArray list;
+    TokenTable list;
 
     Cuik_Diagnostics* diag;
 
@@ -148,6 +187,10 @@ typedef struct TokenStream {
 
     // DynArray(Cuik_FileEntry)
     Cuik_FileEntry* files;
+
+    // non-NULL while the preprocessor is still producing this stream
+    // on another thread (see cuikpp_run_async)
+    struct Cuik_TokenPipe* pipe;
 } TokenStream;
 
 typedef struct ResolvedSourceLoc {
@@ -219,8 +262,35 @@ typedef struct {
     void* fs_data;
     Cuikpp_LocateFile locate;
     Cuikpp_GetFile fs;
+
+    // if non-NULL, lexed headers are cached into this directory
+    const char* cache_dir;
+
+    // if non-NULL, headers are loaded through this so they're only read and
+    // lexed once between all the preprocessors which share it.
+    Cuik_FileCache* file_cache;
 } Cuik_CPPDesc;
 
+// Headers are mostly the same between translation units in a build, preprocessors
+// can share one of these so each header only gets read, canonicalized and lexed once.
+// It's thread-safe but it needs to outlive every token stream which was made with it,
+// all the preprocessors using it should also use the same file system callbacks.
+CUIK_API Cuik_FileCache* cuikpp_file_cache_create(void);
+CUIK_API void cuikpp_file_cache_destroy(Cuik_FileCache* cache);
+
+// Long running compiles (the --server) keep one cache between builds, when a file
+// changes on disk it's dropped with this and the next #include of it reloads it.
+// path is the canonical path, the same as what cuikpp_file_cache_for_each hands out.
+// None of the preprocessors using the cache can be running at the time, returns
+// false if the file wasn't in the cache.
+CUIK_API bool cuikpp_file_cache_invalidate(Cuik_FileCache* cache, const char* path);
+// Call this between builds, the first #include of each file afterwards compares it
+// against the disk so changes which happened before anyone could watch the file
+// aren't missed. Same rules as cuikpp_file_cache_invalidate.
+CUIK_API void cuikpp_file_cache_next_build(Cuik_FileCache* cache);
+// calls fn with the canonical path of every loaded file
+CUIK_API void cuikpp_file_cache_for_each(Cuik_FileCache* cache, void* user_data, void (*fn)(void* user_data, const char* path));
+
 // Initialize preprocessor, allocates memory which needs to be freed via cuikpp_free
 CUIK_API Cuik_CPP* cuikpp_make(const Cuik_CPPDesc* restrict desc);
 
@@ -237,7 +307,7 @@ CUIK_API void cuikpp_finalize(Cuik_CPP* ctx);
 CUIK_API TokenStream* cuikpp_get_token_stream(Cuik_CPP* ctx);
 CUIK_API void cuiklex_free_tokens(TokenStream* tokens);
 
-CUIK_API Token* cuikpp_get_tokens(TokenStream* restrict s);
+CUIK_API Token cuikpp_get_token(TokenStream* restrict s, size_t i);
 CUIK_API size_t cuikpp_get_token_count(TokenStream* restrict s);
 
 CUIK_API Cuik_FileEntry* cuikpp_get_files(TokenStream* restrict s);
@@ -273,7 +343,8 @@ static bool cuiklex_is_macro_loc(SourceLoc loc) {
     return loc.raw & SourceLoc_IsMacro;
 }
 
-// simplifies whitespace for the lexer
+// replaces \t \v \f with spaces, the lexer handles them itself so this is only
+// useful if you want to look at the text without them.
 CUIK_API void cuiklex_canonicalize(size_t length, char* data);
 
 CUIK_API bool cuikpp_locate_file(void* user_data, const Cuik_Path* restrict input, Cuik_Path* output, bool case_insensitive);
@@ -282,6 +353,12 @@ CUIK_API bool cuikpp_default_fs(void* user_data, const Cuik_Path* restrict input
 // Returns entire preprocessor on input state
 CUIK_API Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx);
 
+// Runs the preprocessor on another thread, view is filled with a stream which can be
+// read by one other thread while the tokens are being produced (reading ahead of the
+// preprocessor blocks). Nothing else can touch the Cuik_CPP until cuikpp_join.
+CUIK_API void cuikpp_run_async(Cuik_CPP* restrict ctx, TokenStream* view);
+CUIK_API Cuikpp_Status cuikpp_join(Cuik_CPP* restrict ctx);
+
 // is the source location in the source file (none of the includes)
 CUIK_API bool cuikpp_is_in_main_file(TokenStream* tokens, SourceLoc loc);
 
@@ -346,5 +423,17 @@ CUIK_API void diag_note(TokenStream* tokens, SourceRange loc, const char* fmt, .
 CUIK_API void diag_warn(TokenStream* tokens, SourceRange loc, const char* fmt, ...);
 CUIK_API void diag_err(TokenStream* tokens, SourceRange loc, const char* fmt, ...);
 
+// diagnostics are only recorded as they're reported, they get resolved and
+// rendered once they're dumped (which also clears them).
+typedef enum {
+    CUIKDG_TEXT,
+    // SARIF 2.1.0, the output is a single run object so the caller is expected
+    // to wrap the runs into a log: {"version":"2.1.0","runs":[...]}
+    CUIKDG_SARIF,
+} Cuik_DiagFormat;
+
+// returns a null terminated cuik_malloc'd string (cuik_free it), NULL if nothing was reported
+CUIK_API char* cuikdg_render(TokenStream* tokens, Cuik_DiagFormat format, size_t* out_length);
+
 CUIK_API void cuikdg_dump_to_file(TokenStream* tokens, FILE* out);
 CUIK_API void cuikdg_dump_to_stderr(TokenStream* tokens);
@@ -33,7 +33,19 @@ typedef struct Cuik_ParseResult {
     Cuik_ImportRequest* imports; // linked list of imported libs.
 } Cuik_ParseResult;
 
-CUIK_API Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cuik_Target* target, TB_Arena* restrict arena, bool only_code_index);
+typedef enum Cuik_ParseMode {
+    // parse every function body
+    CUIK_PARSE_FULL,
+    // only parse the function bodies which are reachable from the root symbols
+    // (non-static functions and globals), unused static and inline functions
+    // are skipped entirely (along with any errors they might have).
+    CUIK_PARSE_REACHABLE,
+    // only skim the top level, nothing past the declarations is parsed
+    CUIK_PARSE_CODE_INDEX,
+} Cuik_ParseMode;
+
+// if thread_pool is non-NULL, function bodies are parsed in parallel
+CUIK_API Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cuik_Target* target, TB_Arena* restrict arena, Cuik_IThreadpool* restrict thread_pool, Cuik_ParseMode mode);
 
 CUIK_API void cuik_tu_set_ordinal(TranslationUnit* restrict tu, int ordinal);
 CUIK_API int cuik_tu_get_ordinal(TranslationUnit* restrict tu);
@@ -19,6 +19,9 @@ enum {
 typedef struct {
     String value;
     SourceLoc loc;
+
+    // pre-lexed value, NULL if the value is empty
+    struct MacroBody* body;
 } MacroDef;
 
 struct Cuik_CPP {
@@ -30,6 +33,11 @@ struct Cuik_CPP {
     Cuikpp_GetFile fs;
     void* user_data;
 
+    // on-disk token cache for headers, NULL if disabled
+    const char* cache_dir;
+    // shared between preprocessors, NULL if disabled
+    Cuik_FileCache* file_cache;
+
     // used to store macro expansion results
     size_t the_shtuffs_size;
     unsigned char* the_shtuffs;
@@ -66,7 +74,9 @@ struct Cuik_CPP {
     int depth;
 
     struct {
-        size_t exp, len;
+        // len is the live entries, used also counts the deleted slots
+        size_t exp, len, used;
+        uint8_t* ctrl;  // [1 << exp]
         String* keys;   // [1 << exp]
         MacroDef* vals; // [1 << exp]
     } macros;
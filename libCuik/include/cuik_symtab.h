@@ -14,6 +14,10 @@ typedef struct Cuik_SymbolTable Cuik_SymbolTable;
 
 CUIK_API Cuik_SymbolTable* cuik_symtab_create(void* not_found);
 
+// makes a new table which has its own scopes but reads the parent's globals, as long
+// as the parent's globals aren't being modified this is safe to use on another thread.
+CUIK_API Cuik_SymbolTable* cuik_symtab_fork(Cuik_SymbolTable* parent);
+
 CUIK_API void cuik_scope_open(Cuik_SymbolTable* st);
 CUIK_API void cuik_scope_close(Cuik_SymbolTable* st);
 
@@ -43,49 +47,95 @@ CUIK_API void* cuik_symtab_global_at(Cuik_SymbolTable* st, size_t it);
 #include <arena.h>
 #include <hash_map.h>
 
-typedef struct { Cuik_Atom k; void* v; } Cuik_SymbolNamePair;
-
 typedef struct Cuik_Scope Cuik_Scope;
 struct Cuik_Scope {
     Cuik_Scope* last;
 
-    uint32_t start;     // always 0 for global scope. index to the first symbol
-    uint32_t watermark; // the restore point for the symbol's linear allocator.
+    uint32_t start;        // always 0 for global scope. index to the first symbol
+    TB_ArenaSavepoint sp;  // the restore point for the locals arena.
 };
 
-// simple hash table for the globals, every other scope is reverse
-// linear searched for now.
-enum { CUIK__MAX_LOCALS = 1<<14, CUIK__BUFFER_CAP = 1u<<20u };
+typedef struct {
+    Cuik_Atom k;
+    void* v;
+
+    // the previous local with the same name (+1), 0 if it's not shadowing anything
+    uint32_t shadows;
+} Cuik_SymbolLocal;
+
+// atom -> newest local with that name (+1). names stay in the index once their
+// locals are popped (as 0) so removals never leave holes in the probe chains.
+typedef struct {
+    Cuik_Atom k;
+    uint32_t local;
+} Cuik_LocalSlot;
+
+// simple hash table for the globals, the locals are a stack with a hash index
+// on the side which points at the innermost definition of each name.
+enum { CUIK__INDEX_INIT_EXP = 8 };
 struct Cuik_SymbolTable {
     NL_Map(Cuik_Atom, void*) globals;
 
     Cuik_Scope* top;
-    size_t watermark;
-    uint8_t* buffer;
     void* not_found;
 
+    // forked tables don't own the globals
+    bool is_fork;
+
     TB_Arena globals_arena;
+    TB_Arena locals_arena;
 
-    size_t local_count;
-    Cuik_SymbolNamePair locals[CUIK__MAX_LOCALS];
+    size_t local_count, local_cap;
+    Cuik_SymbolLocal* locals;
+
+    size_t index_exp, index_count;
+    Cuik_LocalSlot* index;
 };
 
+static void cuik_symtab__init_locals(Cuik_SymbolTable* st) {
+    tb_arena_create(&st->locals_arena, TB_ARENA_MEDIUM_CHUNK_SIZE);
+
+    st->local_count = 0;
+    st->local_cap = 256;
+    st->locals = cuik_malloc(st->local_cap * sizeof(Cuik_SymbolLocal));
+
+    st->index_exp = CUIK__INDEX_INIT_EXP;
+    st->index_count = 0;
+    st->index = cuik_calloc(1u << st->index_exp, sizeof(Cuik_LocalSlot));
+}
+
 Cuik_SymbolTable* cuik_symtab_create(void* not_found) {
     Cuik_SymbolTable* st = cuik_malloc(sizeof(Cuik_SymbolTable));
     nl_map_create(st->globals, 2048);
-    st->watermark = 0;
-    st->buffer = cuik_malloc(CUIK__BUFFER_CAP);
-    st->local_count = 0;
     st->top = NULL;
     st->not_found = not_found;
+    st->is_fork = false;
     tb_arena_create(&st->globals_arena, TB_ARENA_MEDIUM_CHUNK_SIZE);
+    cuik_symtab__init_locals(st);
+    return st;
+}
+
+Cuik_SymbolTable* cuik_symtab_fork(Cuik_SymbolTable* parent) {
+    assert(parent->top == NULL && "can only fork from the global scope");
+
+    Cuik_SymbolTable* st = cuik_malloc(sizeof(Cuik_SymbolTable));
+    st->globals = parent->globals;
+    st->top = NULL;
+    st->not_found = parent->not_found;
+    st->is_fork = true;
+    st->globals_arena = (TB_Arena){ 0 };
+    cuik_symtab__init_locals(st);
     return st;
 }
 
 void cuik_symtab_destroy(Cuik_SymbolTable* st) {
-    tb_arena_destroy(&st->globals_arena);
-    nl_map_free(st->globals);
-    cuik_free(st->buffer);
+    if (!st->is_fork) {
+        tb_arena_destroy(&st->globals_arena);
+        nl_map_free(st->globals);
+    }
+    cuik_free(st->locals);
+    cuik_free(st->index);
+    tb_arena_destroy(&st->locals_arena);
     cuik_free(st);
 }
 
@@ -93,7 +143,9 @@ void cuik_symtab_clear(Cuik_SymbolTable* st) {
     tb_arena_destroy(&st->globals_arena);
     nl_map_free(st->globals);
 
-    st->watermark = st->local_count = 0;
+    tb_arena_clear(&st->locals_arena);
+    memset(st->index, 0, (1u << st->index_exp) * sizeof(Cuik_LocalSlot));
+    st->local_count = st->index_count = 0;
     st->top = NULL;
 
     assert(0 && "TODO");
@@ -104,22 +156,48 @@ static void* cuik_symtab__alloc(Cuik_SymbolTable* st, size_t size, bool is_globa
         return tb_arena_alloc(&st->globals_arena, size);
     }
 
-    size_t align_mask = TB_ARENA_ALIGNMENT - 1;
-    assert(st->watermark + size + align_mask < CUIK__BUFFER_CAP);
+    return tb_arena_alloc(&st->locals_arena, size);
+}
 
-    void* ptr = &st->buffer[st->watermark];
-    st->watermark = (st->watermark + size + align_mask) & ~align_mask;
-    return ptr;
+// atoms are unique so we hash the pointer itself
+static Cuik_LocalSlot* cuik_symtab__slot(Cuik_LocalSlot* index, size_t exp, Cuik_Atom name) {
+    size_t mask = (1u << exp) - 1;
+    size_t i = ((uintptr_t) name * 11400714819323198485ull) >> (64 - exp);
+    while (index[i].k != NULL && index[i].k != name) {
+        i = (i + 1) & mask;
+    }
+    return &index[i];
+}
+
+static void cuik_symtab__grow_index(Cuik_SymbolTable* st) {
+    size_t old_cap = 1u << st->index_exp;
+    Cuik_LocalSlot* old = st->index;
+
+    // names which aren't bound anymore get dropped here
+    size_t live = 0;
+    for (size_t i = 0; i < old_cap; i++) {
+        live += old[i].local != 0;
+    }
+
+    st->index_exp += live * 2 >= old_cap;
+    st->index_count = live;
+    st->index = cuik_calloc(1u << st->index_exp, sizeof(Cuik_LocalSlot));
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].local != 0) {
+            *cuik_symtab__slot(st->index, st->index_exp, old[i].k) = old[i];
+        }
+    }
+    cuik_free(old);
 }
 
 void cuik_scope_open(Cuik_SymbolTable* st) {
-    // we wanna store a watermark before we alloc the scope
-    size_t wm = st->watermark;
+    // we wanna store a savepoint before we alloc the scope
+    TB_ArenaSavepoint sp = tb_arena_save(&st->locals_arena);
 
     // allocate scope
     Cuik_Scope* scope = cuik_symtab__alloc(st, sizeof(Cuik_Scope), false);
     scope->last = st->top;
-    scope->watermark = wm;
+    scope->sp = sp;
     scope->start = st->local_count;
     st->top = scope;
 }
@@ -127,30 +205,54 @@ void cuik_scope_open(Cuik_SymbolTable* st) {
 void cuik_scope_close(Cuik_SymbolTable* st) {
     assert(st->top != NULL && "can't pop the global scope");
 
+    // unlink the scope's locals, whatever they were shadowing becomes visible again.
+    // every local gets unlinked exactly once so this is constant time per symbol.
     Cuik_Scope* prev = st->top;
-    st->watermark = prev->watermark;
+    for (size_t i = st->local_count; i-- > prev->start;) {
+        Cuik_SymbolLocal* l = &st->locals[i];
+        cuik_symtab__slot(st->index, st->index_exp, l->k)->local = l->shadows;
+    }
+
+    tb_arena_restore(&st->locals_arena, prev->sp);
     st->local_count = prev->start;
     st->top = prev->last;
 }
 
 void* cuik_symtab_put(Cuik_SymbolTable* st, Cuik_Atom name, size_t size) {
+    assert((st->top != NULL || !st->is_fork) && "forked tables can't write to the globals");
     void* ptr = cuik_symtab__alloc(st, size, st->top == NULL);
 
     if (st->top == NULL) {
         // put into global scope
         nl_map_put(st->globals, name, ptr);
     } else {
-        st->locals[st->local_count++] = (Cuik_SymbolNamePair){ name, ptr };
+        if (st->local_count == st->local_cap) {
+            st->local_cap *= 2;
+            st->locals = cuik_realloc(st->locals, st->local_cap * sizeof(Cuik_SymbolLocal));
+        }
+
+        // keep the index under 3/4ths full
+        if ((st->index_count + 1) * 4 > (3u << st->index_exp)) {
+            cuik_symtab__grow_index(st);
+        }
+
+        Cuik_LocalSlot* slot = cuik_symtab__slot(st->index, st->index_exp, name);
+        if (slot->k == NULL) {
+            slot->k = name;
+            st->index_count += 1;
+        }
+
+        st->locals[st->local_count] = (Cuik_SymbolLocal){ name, ptr, slot->local };
+        slot->local = ++st->local_count;
     }
 
     return ptr;
 }
 
 void* cuik_symtab_lookup(Cuik_SymbolTable* st, Cuik_Atom name) {
-    for (size_t i = st->local_count; i--;) {
-        if (st->locals[i].k == name) {
-            return st->locals[i].v;
-        }
+    uint32_t local = cuik_symtab__slot(st->index, st->index_exp, name)->local;
+    if (local != 0) {
+        return st->locals[local - 1].v;
     }
 
     ptrdiff_t search = nl_map_get(st->globals, name);
@@ -158,11 +260,10 @@ void* cuik_symtab_lookup(Cuik_SymbolTable* st, Cuik_Atom name) {
 }
 
 void* cuik_symtab_lookup2(Cuik_SymbolTable* st, Cuik_Atom name, bool* in_scope) {
-    for (size_t i = st->local_count; i--;) {
-        if (st->locals[i].k == name) {
-            *in_scope = (st->top && st->top->start >= i);
-            return st->locals[i].v;
-        }
+    uint32_t local = cuik_symtab__slot(st->index, st->index_exp, name)->local;
+    if (local != 0) {
+        *in_scope = (st->top && local - 1 >= st->top->start);
+        return st->locals[local - 1].v;
     }
 
     ptrdiff_t search = nl_map_get(st->globals, name);
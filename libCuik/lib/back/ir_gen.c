@@ -131,6 +131,10 @@ TB_DebugType* cuik__as_tb_debug_type(TB_Module* mod, Cuik_Type* t) {
         result = tb_debug_create_array(mod, cuik__as_tb_debug_type(mod, cuik_canonical_type(t->array.of)), t->array.count);
         break;
 
+        case KIND_VECTOR:
+        result = tb_debug_create_vector(mod, cuik__as_tb_debug_type(mod, t->vector.base), t->vector.count);
+        break;
+
         case KIND_STRUCT:
         case KIND_UNION: {
             Member* kids = t->record.kids;
@@ -198,13 +202,27 @@ TB_DebugType* cuik__as_tb_debug_type(TB_Module* mod, Cuik_Type* t) {
     return result;
 }
 
+// vector arithmetic is done in terms of the element type
+static Cuik_Type* scalar_type(Cuik_Type* t) {
+    return t->kind == KIND_VECTOR ? t->vector.base : t;
+}
+
 static TB_Node* cast_reg(TB_Function* func, TB_Node* reg, const Cuik_Type* src, const Cuik_Type* dst) {
     if (dst->kind == KIND_VOID) {
         return reg;
     }
 
     // Cast into correct type
-    if (src->kind == KIND_ARRAY && dst->kind == KIND_BOOL) {
+    if (dst->kind == KIND_VECTOR) {
+        if (src->kind != KIND_VECTOR) {
+            // scalar -> vector is a splat
+            reg = cast_reg(func, reg, src, dst->vector.base);
+            reg = tb_inst_vbroadcast(func, ctype_to_tbtype(dst), reg);
+        } else if (reg->dt.raw != ctype_to_tbtype(dst).raw) {
+            // vector -> vector of the same size just reinterprets the bits
+            reg = tb_inst_bitcast(func, reg, ctype_to_tbtype(dst));
+        }
+    } else if (src->kind == KIND_ARRAY && dst->kind == KIND_BOOL) {
         reg = tb_inst_bool(func, true);
     } else if (src->kind != KIND_BOOL && dst->kind == KIND_BOOL) {
         TB_DataType dt = reg->dt;
@@ -655,7 +673,7 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
         }
         case EXPR_FLOAT32:
         case EXPR_FLOAT64: {
-            bool is_float32 = cuik_canonical_type(GET_CAST_TYPE())->kind == KIND_FLOAT;
+            bool is_float32 = scalar_type(cuik_canonical_type(GET_CAST_TYPE()))->kind == KIND_FLOAT;
 
             return (IRVal){
                 .value_type = RVALUE,
@@ -816,6 +834,31 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
             }
         }
         case EXPR_SUBSCRIPT: {
+            Cuik_Type* base_type = cuik_canonical_type(GET_ARG(0).type);
+            if (base_type->kind == KIND_VECTOR) {
+                IRVal* base = &GET_ARG(0);
+                IRVal* raw_index = &GET_ARG(1);
+
+                // constant lanes on rvalues don't need to touch memory
+                if (base->value_type != LVALUE && raw_index->value_type == RVALUE && raw_index->reg->type == TB_INTEGER_CONST) {
+                    uint64_t lane = TB_NODE_GET_EXTRA_T(raw_index->reg, TB_NodeInt)->value;
+                    if (lane < base_type->vector.count) {
+                        return (IRVal){
+                            .value_type = RVALUE,
+                            .reg = tb_inst_vextract(func, cvt2rval(tu, func, base), lane),
+                        };
+                    }
+                }
+
+                // any other lane access goes through memory like an array would
+                TB_Node* index = RVAL(1);
+                TB_Node* addr = cvt2lval(tu, func, base);
+                return (IRVal){
+                    .value_type = LVALUE,
+                    .reg = tb_inst_array_access(func, addr, index, base_type->vector.base->size),
+                };
+            }
+
             TB_Node* base  = RVAL(0);
             TB_Node* index = RVAL(1);
 
@@ -1113,7 +1156,7 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
         case EXPR_SHR: {
             TB_Node* l = RVAL(0);
             TB_Node* r = RVAL(1);
-            Cuik_Type* restrict type = cuik_canonical_type(GET_TYPE());
+            Cuik_Type* restrict type = scalar_type(cuik_canonical_type(GET_TYPE()));
 
             TB_Node* data;
             if (type->kind == KIND_FLOAT || type->kind == KIND_DOUBLE) {
@@ -1122,6 +1165,10 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
                     case EXPR_MINUS: data = tb_inst_fsub(func, l, r); break;
                     case EXPR_TIMES: data = tb_inst_fmul(func, l, r); break;
                     case EXPR_SLASH: data = tb_inst_fdiv(func, l, r); break;
+                    // only float vectors can get here (_mm_and_ps and friends)
+                    case EXPR_AND:   data = tb_inst_and(func, l, r);  break;
+                    case EXPR_OR:    data = tb_inst_or(func, l, r);   break;
+                    case EXPR_XOR:   data = tb_inst_xor(func, l, r);  break;
                     default: TODO();
                 }
             } else {
@@ -1384,6 +1431,7 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
                 TB_DataType dt = ctype_to_tbtype(type);
 
                 TB_Node* data = NULL;
+                Cuik_Type* elem_type = scalar_type(type);
                 if (type->kind == KIND_STRUCT || type->kind == KIND_UNION) {
                     if (e->op != EXPR_ASSIGN) abort();
 
@@ -1391,7 +1439,7 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
                     TB_Node* size_reg = tb_inst_uint(func, TB_TYPE_I64, type->size);
                     tb_inst_memcpy(func, lhs.reg, rhs.reg, size_reg, type->align);
                     data = rhs.reg;
-                } else if (type->kind == KIND_FLOAT || type->kind == KIND_DOUBLE) {
+                } else if (elem_type->kind == KIND_FLOAT || elem_type->kind == KIND_DOUBLE) {
                     TB_Node* r = cvt2rval(tu, func, &rhs);
 
                     switch (e->op) {
@@ -1400,6 +1448,9 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
                         case EXPR_MINUS_ASSIGN: data = tb_inst_fsub(func, l, r); break;
                         case EXPR_TIMES_ASSIGN: data = tb_inst_fmul(func, l, r); break;
                         case EXPR_SLASH_ASSIGN: data = tb_inst_fdiv(func, l, r); break;
+                        case EXPR_AND_ASSIGN:   data = tb_inst_and(func, l, r);  break;
+                        case EXPR_OR_ASSIGN:    data = tb_inst_or(func, l, r);   break;
+                        case EXPR_XOR_ASSIGN:   data = tb_inst_xor(func, l, r);  break;
                         default: assert(0 && "TODO");
                     }
 
@@ -1407,20 +1458,20 @@ static IRVal irgen_subexpr(TranslationUnit* tu, TB_Function* func, Cuik_Expr* _,
                     tb_inst_store(func, dt, lhs.reg, data, type->align, is_volatile);
                 } else {
                     TB_Node* r = cvt2rval(tu, func, &rhs);
-                    TB_ArithmeticBehavior ab = type->is_unsigned ? 0 : TB_ARITHMATIC_NSW;
+                    TB_ArithmeticBehavior ab = elem_type->is_unsigned ? 0 : TB_ARITHMATIC_NSW;
 
                     switch (e->op) {
-                        case EXPR_ASSIGN:         data = r;                                           break;
-                        case EXPR_PLUS_ASSIGN:    data = tb_inst_add(func, l, r, ab);                 break;
-                        case EXPR_MINUS_ASSIGN:   data = tb_inst_sub(func, l, r, ab);                 break;
-                        case EXPR_TIMES_ASSIGN:   data = tb_inst_mul(func, l, r, ab);                 break;
-                        case EXPR_SLASH_ASSIGN:   data = tb_inst_div(func, l, r, !type->is_unsigned); break;
-                        case EXPR_PERCENT_ASSIGN: data = tb_inst_mod(func, l, r, !type->is_unsigned); break;
-                        case EXPR_AND_ASSIGN:     data = tb_inst_and(func, l, r);                     break;
-                        case EXPR_OR_ASSIGN:      data = tb_inst_or(func, l, r);                      break;
-                        case EXPR_XOR_ASSIGN:     data = tb_inst_xor(func, l, r);                     break;
-                        case EXPR_SHL_ASSIGN:     data = tb_inst_shl(func, l, r, ab);                 break;
-                        case EXPR_SHR_ASSIGN:     data = type->is_unsigned ? tb_inst_shr(func, l, r) : tb_inst_sar(func, l, r); break;
+                        case EXPR_ASSIGN:         data = r;                                                break;
+                        case EXPR_PLUS_ASSIGN:    data = tb_inst_add(func, l, r, ab);                      break;
+                        case EXPR_MINUS_ASSIGN:   data = tb_inst_sub(func, l, r, ab);                      break;
+                        case EXPR_TIMES_ASSIGN:   data = tb_inst_mul(func, l, r, ab);                      break;
+                        case EXPR_SLASH_ASSIGN:   data = tb_inst_div(func, l, r, !elem_type->is_unsigned); break;
+                        case EXPR_PERCENT_ASSIGN: data = tb_inst_mod(func, l, r, !elem_type->is_unsigned); break;
+                        case EXPR_AND_ASSIGN:     data = tb_inst_and(func, l, r);                          break;
+                        case EXPR_OR_ASSIGN:      data = tb_inst_or(func, l, r);                           break;
+                        case EXPR_XOR_ASSIGN:     data = tb_inst_xor(func, l, r);                          break;
+                        case EXPR_SHL_ASSIGN:     data = tb_inst_shl(func, l, r, ab);                      break;
+                        case EXPR_SHR_ASSIGN:     data = elem_type->is_unsigned ? tb_inst_shr(func, l, r) : tb_inst_sar(func, l, r); break;
                         default: assert(0 && "TODO");
                     }
 
@@ -1979,6 +2030,16 @@ TB_Symbol* cuikcg_top_level(TranslationUnit* restrict tu, TB_Module* m, TB_Arena
         size_t param_count;
         parameter_map = tb_function_set_prototype_from_dbg(func, section, dbg_type, arena, &param_count);
 
+        // let the optimizer know about restrict params (the aggregate return pointer
+        // comes first if there's one)
+        TB_FunctionPrototype* proto = tb_function_get_prototype(func);
+        size_t param_base = proto->param_count - param_count;
+        for (size_t i = 0; i < param_count; i++) {
+            if (type->func.param_list[i].type.raw & CUIK_QUAL_RESTRICT) {
+                proto->params[param_base + i].is_restrict = true;
+            }
+        }
+
         if (cuik_canonical_type(type->func.return_type)->kind != KIND_VOID) {
             TB_DebugType* dbg_ret = tb_debug_func_returns(dbg_type)[0];
             func_return_rule = tb_get_passing_rule_from_dbg(tu->ir_mod, dbg_ret, true);
@@ -2134,7 +2195,15 @@ void cuikcg_allocate_ir(TranslationUnit* restrict tu, Cuik_IThreadpool* restrict
         }
     }
 
-    if (thread_pool) futex_wait_eq(&remaining, 0);
+    if (thread_pool) {
+        // help out while we wait, we might be a worker ourselves. when there's
+        // nothing to take we sleep until the last batch is done.
+        for (Futex cur; (cur = remaining) != 0;) {
+            if (!CUIK_CALL(thread_pool, work_one_job)) {
+                futex_wait(&remaining, cur);
+            }
+        }
+    }
 }
 
 void cuikcg_allocate_ir2(TranslationUnit* tu, TB_Module* m, bool debug) {
@@ -70,6 +70,9 @@ static TB_DataType ctype_to_tbtype(const Cuik_Type* t) {
         case KIND_UNION:
         return TB_TYPE_PTR;
 
+        case KIND_VECTOR:
+        return tb_vector_type(ctype_to_tbtype(t->vector.base), t->vector.count);
+
         default:
         abort(); // TODO
     }
@@ -28,9 +28,24 @@ static const char* report_names[]  = { NULL, "NOTE",     "WARN",     "ERROR"
 // From types.c, we should factor this out into a public cuik function
 size_t type_as_string(size_t max_len, char* buffer, Cuik_Type* type);
 
+static void diag_buffer_reserve(DiagBuffer* buf, size_t extra) {
+    if (buf->length + extra > buf->capacity) {
+        size_t cap = buf->capacity ? buf->capacity * 2 : 1024;
+        while (cap < buf->length + extra) cap *= 2;
+
+        buf->data = cuik_realloc(buf->data, cap);
+        buf->capacity = cap;
+    }
+}
+
+static void diag_buffer_append(DiagBuffer* buf, size_t len, const char* str) {
+    diag_buffer_reserve(buf, len);
+    memcpy(&buf->data[buf->length], str, len);
+    buf->length += len;
+}
+
 static char* sprintf_callback(const char* buf, void* user, int len) {
-    void* dst = tb_arena_unaligned_alloc(user, len);
-    memcpy(dst, buf, len);
+    diag_buffer_append(user, len, buf);
     return NULL;
 }
 
@@ -60,12 +75,12 @@ static const char* custom_diagnostic_format(uint32_t* out_length, char ch, VaLis
     }
 }
 
-static int sprintfcb(Cuik_Diagnostics* d, char const *fmt, ...) {
+static int sprintfcb(DiagBuffer* out, char const *fmt, ...) {
     static _Thread_local char tmp[STB_SPRINTF_MIN];
 
     va_list ap;
     va_start(ap, fmt);
-    int r = stbsp_vsprintfcb(sprintf_callback, &d->buffer, tmp, fmt, ap);
+    int r = stbsp_vsprintfcb(sprintf_callback, out, tmp, fmt, ap);
     va_end(ap);
     return r;
 }
@@ -79,44 +94,98 @@ Cuik_Diagnostics* cuikdg_make(Cuik_DiagCallback callback, void* userdata) {
     Cuik_Diagnostics* d = cuik_calloc(1, sizeof(Cuik_Diagnostics));
     d->callback = callback;
     d->userdata = userdata;
+    d->records = dyn_array_create(DiagRecord*, 16);
     tb_arena_create(&d->buffer, TB_ARENA_MEDIUM_CHUNK_SIZE);
     return d;
 }
 
 void cuikdg_free(Cuik_Diagnostics* diag) {
+    dyn_array_destroy(diag->records);
     tb_arena_destroy(&diag->buffer);
     cuik_free(diag);
 }
 
+Cuik_Diagnostics* cuikdg_fork(Cuik_Diagnostics* parent) {
+    Cuik_Diagnostics* d = cuik_calloc(1, sizeof(Cuik_Diagnostics));
+    d->callback = parent->callback;
+    d->userdata = parent->userdata;
+    d->parser = parent->parser;
+    d->records = dyn_array_create(DiagRecord*, 16);
+    tb_arena_create(&d->buffer, TB_ARENA_MEDIUM_CHUNK_SIZE);
+    return d;
+}
+
+// copies the record into d, the hint pointers are rebased onto the new copy
+static void push_record(Cuik_Diagnostics* d, const DiagRecord* src) {
+    DiagRecord* r = tb_arena_alloc(&d->buffer, src->size);
+    memcpy(r, src, src->size);
+    for (size_t i = 0; i < r->fixit_count; i++) {
+        r->fixits[i].hint = &r->text[src->fixits[i].hint - src->text];
+    }
+
+    dyn_array_put(d->records, r);
+}
+
+void cuikdg_join(Cuik_Diagnostics* parent, Cuik_Diagnostics* child) {
+    dyn_array_for(i, child->records) {
+        push_record(parent, child->records[i]);
+    }
+
+    atomic_fetch_add(&parent->error_tally, child->error_tally);
+    cuikdg_free(child);
+}
+
 Cuik_Parser* cuikdg_get_parser(Cuik_Diagnostics* diag) {
     return diag->parser;
 }
 
-CUIK_API void cuikdg_dump_to_stderr(TokenStream* tokens) {
-    cuikdg_dump_to_file(tokens, stderr);
-}
+// the records can't be bigger than an arena chunk, the few messages which
+// get that big are cut short.
+static void record(Cuik_Diagnostics* d, DiagType type, bool raw, SourceRange loc, size_t fixit_count, DiagFixit* fixits, size_t length, const char* text) {
+    size_t max_size = (d->buffer.chunk_size - sizeof(TB_ArenaChunk)) / 2;
 
-CUIK_API void cuikdg_dump_to_file(TokenStream* tokens, FILE* out) {
-    TB_Arena* arena = &tokens->diag->buffer;
+    size_t hints_size = 0;
+    for (size_t i = 0; i < fixit_count; i++) {
+        hints_size += strlen(fixits[i].hint) + 1;
+    }
 
-    TB_ArenaChunk* c = arena->base;
-    while (c->next) {
-        fwrite(c->data, arena->chunk_size, 1, out);
-        c = c->next;
+    if (sizeof(DiagRecord) + hints_size + length + 1 > max_size) {
+        length = max_size - (sizeof(DiagRecord) + hints_size + 1);
     }
 
-    fwrite(c->data, arena->watermark - c->data, 1, out);
+    size_t size = sizeof(DiagRecord) + length + 1 + hints_size;
+    DiagRecord* r = tb_arena_alloc(&d->buffer, size);
+    *r = (DiagRecord){
+        .type = type, .raw = raw, .fixit_count = fixit_count, .loc = loc, .size = size, .length = length
+    };
+
+    if (length > 0) {
+        memcpy(r->text, text, length);
+    }
+    r->text[length] = 0;
+
+    char* hint = &r->text[length + 1];
+    for (size_t i = 0; i < fixit_count; i++) {
+        size_t len = strlen(fixits[i].hint);
+        memcpy(hint, fixits[i].hint, len + 1);
+
+        r->fixits[i] = fixits[i];
+        r->fixits[i].hint = hint;
+        hint += len + 1;
+    }
+
+    dyn_array_put(d->records, r);
 }
 
 // we use the call stack so we can print in reverse order
-void print_include(TokenStream* tokens, SourceLoc loc) {
+static void print_include(DiagBuffer* out, TokenStream* tokens, SourceLoc loc) {
     ResolvedSourceLoc r = cuikpp_find_location(tokens, loc);
 
     if (r.file->include_site.raw != 0) {
-        print_include(tokens, r.file->include_site);
+        print_include(out, tokens, r.file->include_site);
     }
 
-    sprintfcb(tokens->diag, "Included from %s:%d\n", r.file->filename, r.line);
+    sprintfcb(out, "Included from %s:%d\n", r.file->filename, r.line);
 }
 
 // end goes after start
@@ -132,7 +201,7 @@ static ptrdiff_t source_range_difference(TokenStream* tokens, Cuik_FileLoc s, Cu
     }
 }
 
-static void print_line(TokenStream* tokens, ResolvedSourceLoc start, size_t tkn_len) {
+static void print_line(DiagBuffer* out, ResolvedSourceLoc start, size_t tkn_len) {
     const char* line_start = start.line_str;
     while (*line_start && isspace(*line_start)) line_start++;
     size_t dist_from_line_start = line_start - start.line_str;
@@ -142,22 +211,22 @@ static void print_line(TokenStream* tokens, ResolvedSourceLoc start, size_t tkn_
         const char* line_end = line_start;
         do { line_end++; } while (*line_end && *line_end != '\n');
 
-        sprintfcb(tokens->diag, "     |\n");
-        sprintfcb(tokens->diag, "%5d| %.*s\x1b[37m\n", start.line, (int)(line_end - line_start), line_start);
+        sprintfcb(out, "     |\n");
+        sprintfcb(out, "%5d| %.*s\x1b[37m\n", start.line, (int)(line_end - line_start), line_start);
     }
 
     // underline
     size_t start_pos = start.column > dist_from_line_start ? start.column - dist_from_line_start : 0;
-    sprintfcb(tokens->diag, "     | ");
-    for (size_t i = 0; i < start_pos; i++) sprintfcb(tokens->diag, " ");
-    sprintfcb(tokens->diag, "\x1b[32m");
-    sprintfcb(tokens->diag, "^");
-    for (size_t i = 1; i < tkn_len; i++) sprintfcb(tokens->diag, "~");
+    sprintfcb(out, "     | ");
+    for (size_t i = 0; i < start_pos; i++) sprintfcb(out, " ");
+    sprintfcb(out, "\x1b[32m");
+    sprintfcb(out, "^");
+    for (size_t i = 1; i < tkn_len; i++) sprintfcb(out, "~");
 
-    sprintfcb(tokens->diag, "\x1b[0m\n");
+    sprintfcb(out, "\x1b[0m\n");
 }
 
-static void print_line_with_backtrace(TokenStream* tokens, SourceLoc loc, SourceLoc end) {
+static void print_line_with_backtrace(DiagBuffer* out, TokenStream* tokens, SourceLoc loc, SourceLoc end) {
     // find the range of chars in this level
     Cuik_FileLoc l;
     size_t tkn_len;
@@ -186,40 +255,39 @@ static void print_line_with_backtrace(TokenStream* tokens, SourceLoc loc, Source
 
     if (m != NULL) {
         Cuik_FileEntry* next_file = cuikpp_find_file(tokens, m->call_site);
-        print_line_with_backtrace(tokens, m->call_site, offset_source_loc(m->call_site, m->name.length));
-        sprintfcb(tokens->diag, "     |\n");
+        print_line_with_backtrace(out, tokens, m->call_site, offset_source_loc(m->call_site, m->name.length));
+        sprintfcb(out, "     |\n");
         if (next_file->filename != l.file->filename) {
-            sprintfcb(tokens->diag, "  expanded from %s:\n", l.file->filename);
+            sprintfcb(out, "  expanded from %s:\n", l.file->filename);
         } else {
-            sprintfcb(tokens->diag, "  expanded from:\n");
+            sprintfcb(out, "  expanded from:\n");
         }
     }
 
-    print_line(tokens, cuikpp_find_location2(tokens, l), tkn_len);
+    print_line(out, cuikpp_find_location2(tokens, l), tkn_len);
 }
 
-static void diag(DiagType type, TokenStream* tokens, SourceRange loc, const char* fmt, va_list ap) {
-    Cuik_Diagnostics* d = tokens->diag;
-    assert(d != NULL);
-
-    size_t fixit_count = 0;
-    DiagFixit fixits[3];
-    while (*fmt == '#') {
-        assert(fixit_count < 3);
-        fixits[fixit_count++] = va_arg(ap, DiagFixit);
-        fmt += 1;
+// we wanna find the physical character
+static SourceLoc physical_loc(TokenStream* tokens, SourceLoc loc) {
+    for (MacroInvoke* m; (m = cuikpp_find_macro(tokens, loc)) != NULL;) {
+        loc = m->call_site;
     }
+    return loc;
+}
 
-    SourceLoc loc_start = loc.start;
-    // we wanna find the physical character
-    for (MacroInvoke* m; (m = cuikpp_find_macro(tokens, loc_start)) != NULL;) {
-        loc_start = m->call_site;
+static void render_text(DiagBuffer* out, TokenStream* tokens, DiagRecord* r) {
+    if (r->raw) {
+        diag_buffer_append(out, r->length, r->text);
+        return;
     }
 
+    DiagType type = r->type;
+    SourceLoc loc_start = physical_loc(tokens, r->loc.start);
+
     // print include stack
     ResolvedSourceLoc start = cuikpp_find_location(tokens, loc_start);
     if (start.file->include_site.raw != 0) {
-        print_include(tokens, start.file->include_site);
+        print_include(out, tokens, start.file->include_site);
     }
 
     // retrofitting the rust style into C
@@ -232,51 +300,161 @@ static void diag(DiagType type, TokenStream* tokens, SourceRange loc, const char
     //     |
     //    got:  int
     //    need: char*
-    char tmp[STB_SPRINTF_MIN];
     if (type == DIAG_ERR) {
-        sprintfcb(d, "%s%s\x1b[0m[0000]: ", report_colors[type], report_names[type]);
+        sprintfcb(out, "%s%s\x1b[0m[0000]: ", report_colors[type], report_names[type]);
     } else if (type == DIAG_NULL) {
-        sprintfcb(d, "     ");
+        sprintfcb(out, "     ");
     } else {
-        sprintfcb(d, "%s%s\x1b[0m: ", report_colors[type], report_names[type]);
+        sprintfcb(out, "%s%s\x1b[0m: ", report_colors[type], report_names[type]);
     }
-    stbsp_vsprintfcb(sprintf_callback, &d->buffer, tmp, fmt, ap);
+    diag_buffer_append(out, r->length, r->text);
 
     // location summary
     if (loc_start.raw != 0) {
-        sprintfcb(d, "\n   --> %s:%d:%d\n", start.file->filename, start.line, start.column + 1);
-
-        SourceLoc loc_end = loc.end;
-        // we wanna find the physical character
-        for (MacroInvoke* m; (m = cuikpp_find_macro(tokens, loc_end)) != NULL;) {
-            loc_end = m->call_site;
-        }
-
-        print_line_with_backtrace(tokens, loc.start, loc.end);
+        sprintfcb(out, "\n   --> %s:%d:%d\n", start.file->filename, start.line, start.column + 1);
+        print_line_with_backtrace(out, tokens, r->loc.start, r->loc.end);
     }
 
     // fixits
-    if (fixit_count > 0) {
+    if (r->fixit_count > 0) {
         const char* line_start = start.line_str;
         while (*line_start && isspace(*line_start)) line_start++;
         size_t dist_from_line_start = line_start - start.line_str;
 
-        for (size_t i = 0; i < fixit_count; i++) {
+        for (size_t i = 0; i < r->fixit_count; i++) {
             size_t start_pos = start.column > dist_from_line_start ? start.column - dist_from_line_start : 0;
-            start_pos += fixits[i].offset;
+            start_pos += r->fixits[i].offset;
+
+            sprintfcb(out, "     | \x1b[32m");
+            for (size_t j = 0; j < start_pos; j++) sprintfcb(out, " ");
+            sprintfcb(out, "%s\x1b[0m\n", r->fixits[i].hint);
+        }
+    }
 
-            sprintfcb(tokens->diag, "     | \x1b[32m");
-            for (size_t j = 0; j < start_pos; j++) sprintfcb(tokens->diag, " ");
-            sprintfcb(tokens->diag, "%s\x1b[0m\n", fixits[i].hint);
+    if (loc_start.raw != 0) {
+        sprintfcb(out, "     |\n");
+    } else {
+        diag_buffer_append(out, 1, "\n");
+    }
+}
+
+static void json_string(DiagBuffer* out, size_t length, const char* str) {
+    static const char hex[] = "0123456789abcdef";
+
+    diag_buffer_append(out, 1, "\"");
+    for (size_t i = 0; i < length; i++) {
+        unsigned char ch = str[i];
+        if (ch == '"' || ch == '\\') {
+            char esc[2] = { '\\', ch };
+            diag_buffer_append(out, 2, esc);
+        } else if (ch == '\n') {
+            diag_buffer_append(out, 2, "\\n");
+        } else if (ch < 0x20 || ch == 0x7F) {
+            char esc[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 15] };
+            diag_buffer_append(out, 6, esc);
+        } else {
+            diag_buffer_append(out, 1, (const char*) &ch);
         }
     }
+    diag_buffer_append(out, 1, "\"");
+}
+
+// one SARIF result per record
+static void render_sarif(DiagBuffer* out, TokenStream* tokens, DiagRecord* r) {
+    static const char* levels[] = { "none", "note", "warning", "error" };
 
+    sprintfcb(out, "{\"level\":\"%s\",\"message\":{\"text\":", r->raw ? "none" : levels[r->type]);
+    json_string(out, r->length, r->text);
+    sprintfcb(out, "}");
+
+    SourceLoc loc_start = r->raw ? (SourceLoc){ 0 } : physical_loc(tokens, r->loc.start);
     if (loc_start.raw != 0) {
-        sprintfcb(tokens->diag, "     |\n");
+        ResolvedSourceLoc start = cuikpp_find_location(tokens, loc_start);
+        ResolvedSourceLoc end = cuikpp_find_location(tokens, physical_loc(tokens, r->loc.end));
+
+        sprintfcb(out, ",\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":");
+        json_string(out, strlen(start.file->filename), start.file->filename);
+        sprintfcb(out, "},\"region\":{\"startLine\":%d,\"startColumn\":%d", start.line, start.column + 1);
+        if (end.file == start.file && end.line == start.line && end.column > start.column) {
+            sprintfcb(out, ",\"endColumn\":%d", end.column + 1);
+        }
+        sprintfcb(out, "}}}]");
+    }
+
+    sprintfcb(out, "}");
+}
+
+CUIK_API char* cuikdg_render(TokenStream* tokens, Cuik_DiagFormat format, size_t* out_length) {
+    Cuik_Diagnostics* d = tokens->diag;
+    if (dyn_array_length(d->records) == 0) {
+        *out_length = 0;
+        return NULL;
+    }
+
+    DiagBuffer out = { 0 };
+    if (format == CUIKDG_SARIF) {
+        sprintfcb(&out, "{\"tool\":{\"driver\":{\"name\":\"cuik\"}},\"results\":[");
+        dyn_array_for(i, d->records) {
+            if (i) diag_buffer_append(&out, 1, ",");
+            render_sarif(&out, tokens, d->records[i]);
+        }
+        sprintfcb(&out, "]}");
     } else {
-        *(char*)tb_arena_unaligned_alloc(&tokens->diag->buffer, 1) = '\n';
+        dyn_array_for(i, d->records) {
+            render_text(&out, tokens, d->records[i]);
+        }
     }
 
+    dyn_array_clear(d->records);
+    tb_arena_clear(&d->buffer);
+
+    // null terminated but it's not part of the length
+    diag_buffer_reserve(&out, 1);
+    out.data[out.length] = 0;
+
+    *out_length = out.length;
+    return out.data;
+}
+
+CUIK_API void cuikdg_dump_to_stderr(TokenStream* tokens) {
+    cuikdg_dump_to_file(tokens, stderr);
+}
+
+CUIK_API void cuikdg_dump_to_file(TokenStream* tokens, FILE* out) {
+    // a single write keeps the output from different threads from interleaving
+    size_t length;
+    char* text = cuikdg_render(tokens, CUIKDG_TEXT, &length);
+    if (text != NULL) {
+        fwrite(text, length, 1, out);
+        cuik_free(text);
+    }
+}
+
+static void diag(DiagType type, TokenStream* tokens, SourceRange loc, const char* fmt, va_list ap) {
+    Cuik_Diagnostics* d = tokens->diag;
+    assert(d != NULL);
+
+    // the preprocessor might still be running (and writing into the same buffer), once
+    // it's done we can record. if it failed the parser's errors are just noise.
+    if (tokens->pipe != NULL && !cuikpp_pipe_sync(tokens)) {
+        return;
+    }
+
+    size_t fixit_count = 0;
+    DiagFixit fixits[3];
+    while (*fmt == '#') {
+        assert(fixit_count < 3);
+        fixits[fixit_count++] = va_arg(ap, DiagFixit);
+        fmt += 1;
+    }
+
+    static _Thread_local DiagBuffer msg;
+    char tmp[STB_SPRINTF_MIN];
+
+    msg.length = 0;
+    stbsp_vsprintfcb(sprintf_callback, &msg, tmp, fmt, ap);
+    record(d, type, false, loc, fixit_count, fixits, msg.length, msg.data);
+
     if (d->callback) d->callback(d, d->userdata, type);
 
     if (type == DIAG_ERR) {
@@ -316,23 +494,34 @@ DiagWriter diag_writer(TokenStream* tokens) {
 }
 
 void diag_header(TokenStream* tokens, DiagType type, const char* fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    char tmp[STB_SPRINTF_MIN];
+    if (tokens->pipe != NULL) {
+        cuikpp_pipe_sync(tokens);
+    }
+
+    DiagBuffer out = { 0 };
     if (type == DIAG_ERR) {
-        sprintfcb(tokens->diag, "%s%s\x1b[0m[0000]: ", report_colors[type], report_names[type]);
+        sprintfcb(&out, "%s%s\x1b[0m[0000]: ", report_colors[type], report_names[type]);
     } else {
-        sprintfcb(tokens->diag, "%s%s\x1b[0m: ", report_colors[type], report_names[type]);
+        sprintfcb(&out, "%s%s\x1b[0m: ", report_colors[type], report_names[type]);
     }
-    stbsp_vsprintfcb(sprintf_callback, &tokens->diag->buffer, tmp, fmt, ap);
-    *(char*)tb_arena_unaligned_alloc(&tokens->diag->buffer, 1) = '\n';
+
+    va_list ap;
+    va_start(ap, fmt);
+    char tmp[STB_SPRINTF_MIN];
+    stbsp_vsprintfcb(sprintf_callback, &out, tmp, fmt, ap);
     va_end(ap);
+
+    diag_buffer_append(&out, 1, "\n");
+    record(tokens->diag, type, true, (SourceRange){ 0 }, 0, NULL, out.length, out.data);
+    cuik_free(out.data);
 }
 
 static void diag_writer_write_upto(DiagWriter* writer, size_t pos) {
     if (writer->cursor < pos) {
         int l = pos - writer->cursor;
-        memset(tb_arena_unaligned_alloc(&writer->tokens->diag->buffer, l), ' ', l);
+        diag_buffer_reserve(&writer->text, l);
+        memset(&writer->text.data[writer->text.length], ' ', l);
+        writer->text.length += l;
 
         //printf("%.*s", (int)(pos - writer->cursor), writer->line_start + writer->cursor);
         writer->cursor = pos;
@@ -340,7 +529,7 @@ static void diag_writer_write_upto(DiagWriter* writer, size_t pos) {
 }
 
 void diag_writer_highlight(DiagWriter* writer, SourceRange loc) {
-    TokenStream* tokens = writer->tokens;
+    DiagBuffer* out = &writer->text;
     ResolvedSourceLoc a = cuikpp_find_location(writer->tokens, loc.start);
     ResolvedSourceLoc b = cuikpp_find_location(writer->tokens, loc.end);
 
@@ -362,10 +551,10 @@ void diag_writer_highlight(DiagWriter* writer, SourceRange loc) {
         writer->line_end = line_end;
         writer->dist_from_line_start = dist_from_line_start;
 
-        sprintfcb(tokens->diag, "  --> %s:%d\n", a.file->filename, a.line);
-        sprintfcb(tokens->diag, "     |\n     | ");
-        sprintfcb(tokens->diag, "%.*s\n", (int) (line_end - line_start), line_start);
-        sprintfcb(tokens->diag, "     | ");
+        sprintfcb(out, "  --> %s:%d\n", a.file->filename, a.line);
+        sprintfcb(out, "     |\n     | ");
+        sprintfcb(out, "%.*s\n", (int) (line_end - line_start), line_start);
+        sprintfcb(out, "     | ");
     }
 
     assert(b.column >= a.column);
@@ -376,11 +565,11 @@ void diag_writer_highlight(DiagWriter* writer, SourceRange loc) {
     diag_writer_write_upto(writer, start_pos);
     //printf("\x1b[7m");
     //diag_writer_write_upto(writer, start_pos + tkn_len);
-    for (size_t i = 0; i < start_pos; i++) sprintfcb(tokens->diag, " ");
-    sprintfcb(tokens->diag, "\x1b[32m^");
-    for (size_t i = 1; i < tkn_len; i++) sprintfcb(tokens->diag, "~");
+    for (size_t i = 0; i < start_pos; i++) sprintfcb(out, " ");
+    sprintfcb(out, "\x1b[32m^");
+    for (size_t i = 1; i < tkn_len; i++) sprintfcb(out, "~");
     writer->cursor = start_pos + tkn_len;
-    sprintfcb(tokens->diag, "\x1b[0m");
+    sprintfcb(out, "\x1b[0m");
 }
 
 bool diag_writer_is_compatible(DiagWriter* writer, SourceRange loc) {
@@ -394,8 +583,12 @@ bool diag_writer_is_compatible(DiagWriter* writer, SourceRange loc) {
 
 void diag_writer_done(DiagWriter* writer) {
     if (writer->base.file != NULL) {
-        TokenStream* tokens = writer->tokens;
         diag_writer_write_upto(writer, writer->line_end - writer->line_start);
-        sprintfcb(tokens->diag, "\n");
+        sprintfcb(&writer->text, "\n");
+
+        record(writer->tokens->diag, DIAG_NULL, true, (SourceRange){ 0 }, 0, NULL, writer->text.length, writer->text.data);
     }
+
+    cuik_free(writer->text.data);
+    writer->text = (DiagBuffer){ 0 };
 }
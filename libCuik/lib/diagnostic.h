@@ -10,9 +10,33 @@ typedef struct DiagFixit {
     const char* hint;
 } DiagFixit;
 
+// growable text buffer, the renderer writes into these
+typedef struct {
+    size_t length, capacity;
+    char* data;
+} DiagBuffer;
+
+// diagnostics are recorded as they come in but locations, line previews and macro
+// backtraces aren't resolved until they're rendered. The message itself is formatted
+// right away since the arguments (types, temporary strings) don't outlive the call.
+typedef struct {
+    DiagType type;
+    // pre-rendered text from the diag_writer, printed as is
+    bool raw;
+    uint8_t fixit_count;
+
+    SourceRange loc;
+    // the hints are copied into the record, right after the message
+    DiagFixit fixits[3];
+
+    uint32_t size, length;
+    char text[];
+} DiagRecord;
+
 typedef struct {
     TokenStream* tokens;
     ResolvedSourceLoc base;
+    DiagBuffer text;
 
     const char* line_start;
     const char* line_end;
@@ -25,10 +49,11 @@ struct Cuik_Diagnostics {
     Cuik_DiagCallback callback;
     void* userdata;
 
+    // records are allocated out of the buffer and listed in the order they were
+    // reported so we can do ordered output.
     TB_Arena buffer;
+    DynArray(DiagRecord*) records;
 
-    // We write the text output to a buffer such that we
-    // can do ordered output.
     Cuik_Parser* parser;
 
     // Incremented atomically by the diagnostics engine
@@ -49,6 +74,11 @@ void cuikdg_tally_error(TokenStream* s);
 Cuik_Diagnostics* cuikdg_make(Cuik_DiagCallback callback, void* userdata);
 void cuikdg_free(Cuik_Diagnostics* diag);
 
+// parallel phases give each task a forked diagnostics buffer, joining appends
+// it back onto the parent so if we join in order the output stays deterministic.
+Cuik_Diagnostics* cuikdg_fork(Cuik_Diagnostics* parent);
+void cuikdg_join(Cuik_Diagnostics* parent, Cuik_Diagnostics* child);
+
 ////////////////////////////////
 // Complex diagnostic builder
 ////////////////////////////////
@@ -57,6 +57,9 @@ struct Cuik_BuildStep {
             TB_Arena arena;
             Cuik_CPP* cpp;
             TranslationUnit* tu;
+
+            // SARIF run for the TU's diagnostics, printed once the build is done
+            char* diags;
         } cc;
 
         struct {
@@ -92,6 +95,32 @@ static void step_done(Cuik_BuildStep* s) {
     }
 }
 
+// text diagnostics go out as soon as the TU is done with them (one write per TU so
+// threads don't interleave), with -diag-sarif they're held until the end of the build.
+static void dump_diagnostics(Cuik_BuildStep* s, const Cuik_DriverArgs* args, TokenStream* tokens) {
+    if (s == NULL || !args->diag_sarif) {
+        cuikdg_dump_to_file(tokens, stderr);
+        return;
+    }
+
+    assert(s->cc.diags == NULL);
+    size_t length;
+    s->cc.diags = cuikdg_render(tokens, CUIKDG_SARIF, &length);
+}
+
+static void print_sarif_runs(FILE* out, Cuik_BuildStep* s, bool* first) {
+    for (size_t i = 0; i < s->dep_count; i++) {
+        print_sarif_runs(out, s->deps[i], first);
+    }
+
+    if (s->tag == BUILD_STEP_CC && s->cc.diags != NULL) {
+        fprintf(out, "%s%s", *first ? "" : ",", s->cc.diags);
+        cuik_free(s->cc.diags);
+        s->cc.diags = NULL;
+        *first = false;
+    }
+}
+
 static bool has_file_ext(const char* path) {
     for (; *path; path++) {
         if (*path == '/')  return false;
@@ -136,6 +165,9 @@ static void sys_invoke(BuildStepInfo* info) {
 #ifdef CUIK_USE_TB
 static void irgen(Cuik_IThreadpool* restrict thread_pool, Cuik_DriverArgs* restrict args, CompilationUnit* restrict cu, TB_Module* mod);
 
+// callees at or below this many IR nodes get inlined at -O1 and up
+enum { INLINE_MAX_NODES = 48 };
+
 static bool do_delayed_compile(const Cuik_DriverArgs* args) {
     return args->opt_level > 0 || args->assembly || args->emit_ir || args->emit_dot;
 }
@@ -158,7 +190,9 @@ static void apply_func(TB_Function* f, void* arg) {
             tb_pass_print(p);
         } else {
             CUIK_TIMED_BLOCK("codegen") {
-                TB_FunctionOutput* out = tb_pass_codegen(p, print_asm);
+                // graph coloring is slower but it spills less in loops
+                TB_RegAlloc ra = args->opt_level >= 2 ? TB_REGALLOC_GRAPH_COLOR : TB_REGALLOC_LINEAR_SCAN;
+                TB_FunctionOutput* out = tb_pass_codegen(p, ra, print_asm);
                 if (print_asm) {
                     tb_output_print_asm(out, stdout);
                     printf("\n\n");
@@ -171,6 +205,8 @@ static void apply_func(TB_Function* f, void* arg) {
 }
 #endif
 
+static Cuik_CPP* preprocess_file(Cuik_BuildStep* s, const char* filepath, const Cuik_DriverArgs* args, bool should_finalize);
+
 static void cc_invoke(BuildStepInfo* restrict info) {
     Cuik_BuildStep* s = info->step;
     Cuik_DriverArgs* args = s->cc.args;
@@ -182,8 +218,19 @@ static void cc_invoke(BuildStepInfo* restrict info) {
 
     log_debug("BuildStep %p: cc_invoke %s", s, s->cc.source);
 
+    // the parser can start skimming while the preprocessor is still going, the
+    // view is its side of the stream.
+    TokenStream view;
+    bool pipelined = args->pipeline && !args->preprocess && !args->test_preproc;
+
     // dispose the preprocessor crap since we didn't need it
-    Cuik_CPP* cpp = s->cc.cpp = cuik_driver_preprocess(s->cc.source, args, true);
+    Cuik_CPP* cpp;
+    if (pipelined) {
+        cpp = s->cc.cpp = cuik_driver_preprocess_async(s->cc.source, args, &view);
+    } else {
+        cpp = s->cc.cpp = preprocess_file(s, s->cc.source, args, true);
+    }
+
     if (cpp == NULL) {
         step_error(s);
         goto done_no_cpp;
@@ -201,9 +248,18 @@ static void cc_invoke(BuildStepInfo* restrict info) {
     CUIK_TIMED_BLOCK_ARGS("parse", s->cc.source) {
         tb_arena_create(&s->cc.arena, TB_ARENA_LARGE_CHUNK_SIZE);
 
-        result = cuikparse_run(args->version, tokens, args->target, &s->cc.arena, false);
+        result = cuikparse_run(args->version, pipelined ? &view : tokens, args->target, &s->cc.arena, s->tp, args->lazy ? CUIK_PARSE_REACHABLE : CUIK_PARSE_FULL);
         s->cc.tu = result.tu;
 
+        if (pipelined) {
+            if (cuikpp_join(cpp) == CUIKPP_ERROR) {
+                step_error(s);
+                goto done;
+            }
+
+            cuikpp_finalize(cpp);
+        }
+
         if (result.error_count > 0) {
             step_error(s);
             goto done;
@@ -233,7 +289,7 @@ static void cc_invoke(BuildStepInfo* restrict info) {
         cuik_add_to_compilation_unit(cu, tu);
     }
 
-    if (cuiksema_run(tu, NULL) > 0) {
+    if (cuiksema_run(tu, s->tp) > 0) {
         step_error(s);
         goto done;
     }
@@ -249,9 +305,7 @@ static void cc_invoke(BuildStepInfo* restrict info) {
     }
 
     // we wanna display diagnostics before any of the backend stuff
-    mtx_lock(info->mutex);
-    cuikdg_dump_to_file(tokens, stderr);
-    mtx_unlock(info->mutex);
+    dump_diagnostics(s, args, tokens);
 
     #ifdef CUIK_USE_TB
     TB_Module* mod = cu->ir_mod;
@@ -276,6 +330,14 @@ static void cc_invoke(BuildStepInfo* restrict info) {
         }
 
         CUIK_TIMED_BLOCK("Backend") {
+            // the inliner needs every function's IR ready and nobody else touching
+            // it, so it goes before the parallel passes. inlining tends to leave
+            // static helpers without any callers so we prune after it.
+            if (args->opt_level >= 1) {
+                tb_module_inline(mod, INLINE_MAX_NODES);
+                tb_module_prune(mod);
+            }
+
             cuiksched_per_function(s->tp, args->threads, mod, args, apply_func);
         }
     } else {
@@ -304,7 +366,7 @@ static void cc_invoke(BuildStepInfo* restrict info) {
     goto done_no_cpp;
 
     // these are called for early exits
-    done: cuikdg_dump_to_file(tokens, stderr);
+    done: dump_diagnostics(s, args, tokens);
     done_no_cpp: step_done(s);
 }
 
@@ -629,6 +691,18 @@ bool cuik_step_run(Cuik_BuildStep* s, Cuik_IThreadpool* tp) {
     step_submit(s, tp, &m, false);
     mtx_destroy(&m);
 
+    // every step is done by now, the runs are printed in step order
+    Cuik_DriverArgs* args = s->tag == BUILD_STEP_LD ? s->ld.args : s->tag == BUILD_STEP_CC ? s->cc.args : NULL;
+    if (args != NULL && args->diag_sarif) {
+        bool first = true;
+        fprintf(stderr, "{\"version\":\"2.1.0\",\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\"runs\":[");
+        print_sarif_runs(stderr, s, &first);
+        if (first) {
+            fprintf(stderr, "{\"tool\":{\"driver\":{\"name\":\"cuik\"}},\"results\":[]}");
+        }
+        fprintf(stderr, "]}\n");
+    }
+
     return s->errors == 0;
 }
 
@@ -639,6 +713,8 @@ void cuik_step_free(Cuik_BuildStep* s) {
 
     if (s->tag == BUILD_STEP_SYS) {
         cuik_free(s->sys.data);
+    } else if (s->tag == BUILD_STEP_CC) {
+        cuik_free(s->cc.diags);
     }
 
     cuik_free(s);
@@ -652,11 +728,10 @@ void cuikpp_dump_tokens(TokenStream* s) {
     const char* last_file = NULL;
     int last_line = 0;
 
-    Token* tokens = cuikpp_get_tokens(s);
     size_t count = cuikpp_get_token_count(s);
-
     for (size_t i = 0; i < count; i++) {
-        Token* t = &tokens[i];
+        Token tok = cuikpp_get_token(s, i);
+        Token* t = &tok;
 
         ResolvedSourceLoc r = cuikpp_find_location(s, t->location);
         if (last_file != r.file->filename) {
@@ -706,7 +781,7 @@ void cuik_free_driver_args(Cuik_DriverArgs* args) {
     dyn_array_destroy(args->defines);
 }
 
-static bool run_cpp(Cuik_CPP* cpp, const Cuik_DriverArgs* args, bool should_finalize) {
+static void set_cpp_options(Cuik_CPP* cpp, const Cuik_DriverArgs* args) {
     CUIK_TIMED_BLOCK("set CPP options") {
         cuik_set_standard_defines(cpp, args);
 
@@ -730,10 +805,14 @@ static bool run_cpp(Cuik_CPP* cpp, const Cuik_DriverArgs* args, bool should_fina
             }
         }
     }
+}
+
+static bool run_cpp(Cuik_BuildStep* s, Cuik_CPP* cpp, const Cuik_DriverArgs* args, bool should_finalize) {
+    set_cpp_options(cpp, args);
 
     // run the preprocessor
     if (cuikpp_run(cpp) == CUIKPP_ERROR) {
-        cuikdg_dump_to_file(cuikpp_get_token_stream(cpp), stderr);
+        dump_diagnostics(s, args, cuikpp_get_token_stream(cpp));
         cuikpp_free(cpp);
         return false;
     }
@@ -745,7 +824,31 @@ static bool run_cpp(Cuik_CPP* cpp, const Cuik_DriverArgs* args, bool should_fina
     return true;
 }
 
+// the build steps pass themselves along so a failed preprocess can hold onto its diagnostics
+static Cuik_CPP* preprocess_file(Cuik_BuildStep* s, const char* filepath, const Cuik_DriverArgs* args, bool should_finalize) {
+    Cuik_CPP* cpp = NULL;
+    CUIK_TIMED_BLOCK("cuikpp_make") {
+        cpp = cuikpp_make(&(Cuik_CPPDesc){
+                .version       = args->version,
+                .case_insensitive = args->toolchain.case_insensitive,
+                .filepath      = filepath,
+                .locate        = cuikpp_locate_file,
+                .fs            = cuikpp_default_fs,
+                .diag_data     = args->diag_userdata,
+                .diag          = args->diag_callback,
+                .cache_dir     = args->token_cache,
+                .file_cache    = args->file_cache,
+            });
+    }
+
+    return run_cpp(s, cpp, args, should_finalize) ? cpp : NULL;
+}
+
 CUIK_API Cuik_CPP* cuik_driver_preprocess(const char* filepath, const Cuik_DriverArgs* args, bool should_finalize) {
+    return preprocess_file(NULL, filepath, args, should_finalize);
+}
+
+CUIK_API Cuik_CPP* cuik_driver_preprocess_async(const char* filepath, const Cuik_DriverArgs* args, TokenStream* view) {
     Cuik_CPP* cpp = NULL;
     CUIK_TIMED_BLOCK("cuikpp_make") {
         cpp = cuikpp_make(&(Cuik_CPPDesc){
@@ -756,10 +859,14 @@ CUIK_API Cuik_CPP* cuik_driver_preprocess(const char* filepath, const Cuik_Drive
                 .fs            = cuikpp_default_fs,
                 .diag_data     = args->diag_userdata,
                 .diag          = args->diag_callback,
+                .cache_dir     = args->token_cache,
+                .file_cache    = args->file_cache,
             });
     }
 
-    return run_cpp(cpp, args, should_finalize) ? cpp : NULL;
+    set_cpp_options(cpp, args);
+    cuikpp_run_async(cpp, view);
+    return cpp;
 }
 
 CUIK_API Cuik_CPP* cuik_driver_preprocess_str(String source, const Cuik_DriverArgs* args, bool should_finalize) {
@@ -773,10 +880,12 @@ CUIK_API Cuik_CPP* cuik_driver_preprocess_str(String source, const Cuik_DriverAr
                 .fs            = cuikpp_default_fs,
                 .diag_data     = args->diag_userdata,
                 .diag          = args->diag_callback,
+                .cache_dir     = args->token_cache,
+                .file_cache    = args->file_cache,
             });
     }
 
-    return run_cpp(cpp, args, should_finalize) ? cpp : NULL;
+    return run_cpp(NULL, cpp, args, should_finalize) ? cpp : NULL;
 }
 
 CUIK_API Cuik_CPP* cuik_driver_preprocess_cstr(const char* source, const Cuik_DriverArgs* args, bool should_finalize) {
@@ -790,13 +899,30 @@ CUIK_API Cuik_CPP* cuik_driver_preprocess_cstr(const char* source, const Cuik_Dr
                 .fs            = cuikpp_default_fs,
                 .diag_data     = args->diag_userdata,
                 .diag          = args->diag_callback,
+                .cache_dir     = args->token_cache,
+                .file_cache    = args->file_cache,
             });
     }
 
-    return run_cpp(cpp, args, should_finalize) ? cpp : NULL;
+    return run_cpp(NULL, cpp, args, should_finalize) ? cpp : NULL;
 }
 
 #ifdef CUIK_USE_TB
+static size_t good_batch_size(size_t n, size_t jobs) {
+    // we cap out at 8192 for the batch size but when there's less input
+    // we might pick something which can get some good division of labor.
+    //
+    // each thread is gonna get 4 batches so: job_count / (N * 4)
+    /*size_t batch_size = jobs / (n * 4);
+    if (batch_size < 128) return 100;
+    if (batch_size > 8192) return 8192;
+
+    // next power of two
+    return 1ull << (64ull - __builtin_clzll(batch_size - 1ull));*/
+
+    return 64;
+}
+
 typedef struct {
     TB_Module* mod;
     TranslationUnit* tu;
@@ -834,7 +960,7 @@ static void irgen_job(void* arg) {
         if (do_compiles_immediately && s != NULL && s->tag == TB_SYMBOL_FUNCTION) {
             CUIK_TIMED_BLOCK("codegen") {
                 TB_Passes* p = tb_pass_enter((TB_Function*) s, allocator);
-                tb_pass_codegen(p, false);
+                tb_pass_codegen(p, TB_REGALLOC_LINEAR_SCAN, false);
                 tb_pass_exit(p);
 
                 log_debug("%s: clearing IR arena %.1f KiB", name, tb_arena_current_size(allocator) / 1024.0f);
@@ -888,8 +1014,12 @@ static void irgen(Cuik_IThreadpool* restrict thread_pool, Cuik_DriverArgs* restr
             }
         }
 
-        // wait for the threads to finish
-        futex_wait_eq(&remaining, 0);
+        // wait for the threads to finish (and help them while we're at it)
+        for (Futex cur; (cur = remaining) != 0;) {
+            if (!CUIK_CALL(thread_pool, work_one_job)) {
+                futex_wait(&remaining, cur);
+            }
+        }
         #else
         fprintf(stderr, "Please compile with -DCUIK_ALLOW_THREADS if you wanna spin up threads");
         abort();
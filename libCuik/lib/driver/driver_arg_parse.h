@@ -271,6 +271,11 @@ CUIK_API bool cuik_args_to_driver(Cuik_DriverArgs* comp_args, Cuik_Arguments* re
         comp_args->entrypoint = entry->value;
     }
 
+    Cuik_Arg* token_cache = args->_[ARG_TOKCACHE];
+    if (token_cache) {
+        comp_args->token_cache = token_cache->value;
+    }
+
     Cuik_Arg* threads = args->_[ARG_THREADS];
     if (threads) {
         if (threads->value != arg_is_set) {
@@ -308,8 +313,11 @@ CUIK_API bool cuik_args_to_driver(Cuik_DriverArgs* comp_args, Cuik_Arguments* re
     TOGGLE(ARG_LIVE, live);
     TOGGLE(ARG_AST, ast);
     TOGGLE(ARG_SYNTAX, syntax_only);
+    TOGGLE(ARG_LAZY, lazy);
+    TOGGLE(ARG_PIPE, pipeline);
     TOGGLE(ARG_VERBOSE, verbose);
     TOGGLE(ARG_THINK, think);
+    TOGGLE(ARG_DIAGSARIF, diag_sarif);
     TOGGLE(ARG_BASED, based);
     TOGGLE(ARG_TIME, time);
     TOGGLE(ARG_DEBUG, debug_info);
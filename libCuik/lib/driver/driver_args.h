@@ -7,10 +7,13 @@ X(UNDEF,       "U",        true,  "undefines a macro before compiling")
 X(INCLUDE,     "I",        true,  "add directory to the include searches")
 X(PPTEST,      "Pp",       false, "test preprocessor")
 X(PP,          "P",        false, "print preprocessor output to stdout")
+X(TOKCACHE,    "token-cache", true, "cache lexed headers in the given directory")
 // parser
 X(LANG,        "lang",     true,  "choose the language (c11, c23, glsl)")
 X(AST,         "ast",      false, "print AST into stdout")
 X(SYNTAX,      "xe",       false, "type check only")
+X(LAZY,        "lazy",     false, "only parse functions reachable from exported symbols")
+X(PIPE,        "pipe",     false, "preprocess on another thread while the parser skims the top level")
 // optimizer
 X(OPTLVL,      "O",        true,  "no optimizations")
 // backend
@@ -32,6 +35,7 @@ X(TARGET,      "target",   true,  "change the target system and arch")
 X(THREADS,     "j",        true,  "enabled multithreaded compilation")
 X(TIME,        "T",        false, "profile the compile times")
 X(THINK,       "think",    false, "aids in thinking about serious problems")
+X(DIAGSARIF,   "diag-sarif", false, "print diagnostics as a SARIF log (JSON) once the build is done")
 // run
 X(RUN,         "r",        false, "JIT the executable (NOT READY)")
 #undef X
@@ -1,58 +1,77 @@
 #ifdef CUIK_USE_TB
+// functions are handed out bottom-up over the call graph, an SCC is only submitted
+// once every SCC it calls into is done so the callees' summaries are ready by the
+// time the caller gets optimized. independent SCCs still run in parallel.
 typedef struct {
+    Cuik_IThreadpool* thread_pool;
+    TB_CallGraph* cg;
+
+    // per SCC, how many callees are still being processed
+    _Atomic size_t* pending;
     Futex* remaining;
 
-    TB_Function* f;
+    size_t scc;
     void* arg;
-
     CuikSched_PerFunction func;
-} PerFunction;
-
-static void per_func_task(void* arg) {
-    PerFunction task = *((PerFunction*) arg);
-    task.func(task.f, task.arg);
+} PerSCC;
 
-    atomic_fetch_sub(task.remaining, 1);
-    futex_signal(task.remaining);
-}
+static void per_scc_task(void* arg) {
+    PerSCC task = *((PerSCC*) arg);
 
-static size_t good_batch_size(size_t n, size_t jobs) {
-    // we cap out at 8192 for the batch size but when there's less input
-    // we might pick something which can get some good division of labor.
-    //
-    // each thread is gonna get 4 batches so: job_count / (N * 4)
-    /*size_t batch_size = jobs / (n * 4);
-    if (batch_size < 128) return 100;
-    if (batch_size > 8192) return 8192;
+    TB_CallGraphSCC* scc = &task.cg->sccs[task.scc];
+    for (size_t i = 0; i < scc->func_count; i++) {
+        task.func(scc->funcs[i], task.arg);
+    }
 
-    // next power of two
-    return 1ull << (64ull - __builtin_clzll(batch_size - 1ull));*/
+    // wake up any callers we were the last dependency of
+    for (size_t i = 0; i < scc->caller_count; i++) {
+        size_t caller = scc->callers[i];
+        if (atomic_fetch_sub(&task.pending[caller], 1) == 1) {
+            task.scc = caller;
+            CUIK_CALL(task.thread_pool, submit, per_scc_task, sizeof(task), &task);
+        }
+    }
 
-    return 64;
+    futex_dec(task.remaining);
 }
 
 void cuiksched_per_function(Cuik_IThreadpool* restrict thread_pool, int num_threads, TB_Module* mod, void* arg, CuikSched_PerFunction func) {
-    TB_SymbolIter it = tb_symbol_iter(mod);
+    TB_CallGraph cg = tb_module_call_graph(mod);
     if (thread_pool != NULL) {
-        Futex remaining = 0;
-        size_t count = 0;
+        Futex remaining = cg.scc_count;
 
-        PerFunction task = { .remaining = &remaining, .arg = arg, .func = func };
+        _Atomic size_t* pending = cuik_malloc(cg.scc_count * sizeof(_Atomic size_t));
+        for (size_t i = 0; i < cg.scc_count; i++) {
+            pending[i] = cg.sccs[i].callee_count;
+        }
 
-        TB_Symbol* sym;
-        while (sym = tb_symbol_iter_next(&it), sym) if (sym->tag == TB_SYMBOL_FUNCTION) {
-            task.f = (TB_Function*) sym;
-            CUIK_CALL(thread_pool, submit, per_func_task, sizeof(task), &task);
-            count++;
+        PerSCC task = { .thread_pool = thread_pool, .cg = &cg, .pending = pending, .remaining = &remaining, .arg = arg, .func = func };
+        for (size_t i = 0; i < cg.scc_count; i++) {
+            if (cg.sccs[i].callee_count == 0) {
+                task.scc = i;
+                CUIK_CALL(thread_pool, submit, per_scc_task, sizeof(task), &task);
+            }
         }
 
-        futex_wait_eq(&remaining, count);
+        // we might be running on one of the workers so we help out before
+        // sleeping, otherwise the pool can starve itself. once there's nothing
+        // left to take the rest is already running and the last SCC wakes us.
+        for (Futex cur; (cur = remaining) != 0;) {
+            if (!CUIK_CALL(thread_pool, work_one_job)) {
+                futex_wait(&remaining, cur);
+            }
+        }
+
+        cuik_free((void*) pending);
     } else {
-        TB_Symbol* sym;
-        while (sym = tb_symbol_iter_next(&it), sym) if (sym->tag == TB_SYMBOL_FUNCTION) {
-            func((TB_Function*) sym, arg);
+        // the SCCs are already in bottom-up order
+        for (size_t i = 0; i < cg.scc_count; i++) {
+            TB_CallGraphSCC* scc = &cg.sccs[i];
+            for (size_t j = 0; j < scc->func_count; j++) {
+                func(scc->funcs[j], arg);
+            }
         }
     }
+    tb_call_graph_free(&cg);
 }
 #endif
-
@@ -1,42 +1,132 @@
 #include "cuik.h"
 #include "atoms.h"
+#include <stdatomic.h>
 
-enum { INTERNER_EXP = 24 };
+enum {
+    INTERNER_EXP = 24,
+    ATOM_CHUNK_SIZE = 4 * 1024 * 1024,
+};
 
-thread_local static TB_Arena atoms_arena;
-thread_local static Atom* interner;
+// atoms are compared by pointer so every thread needs to agree on them, there's
+// one table for the whole process and it's entirely lock-free: slots are filled
+// with a CAS and the strings are bump allocated out of shared chunks.
+//
+// each atom has its length and hash stored in front of it so probing doesn't
+// need to rehash or strlen anything.
+typedef struct {
+    uint32_t hash, length;
+} AtomHeader;
+
+typedef struct AtomChunk AtomChunk;
+struct AtomChunk {
+    AtomChunk* next;
+    size_t capacity;
+    _Atomic size_t used;
+    char data[];
+};
+
+static _Atomic(_Atomic(Atom)*) interner;
+static _Atomic(AtomChunk*) atom_chunks;
 
 void atoms_free(void) {
     CUIK_TIMED_BLOCK("free atoms") {
-        tb_arena_destroy(&atoms_arena);
-        cuik__vfree(interner, (1u << INTERNER_EXP) * sizeof(Atom));
-        interner = NULL;
+        _Atomic(Atom)* table = atomic_exchange(&interner, NULL);
+        if (table != NULL) {
+            cuik__vfree((void*) table, (1u << INTERNER_EXP) * sizeof(Atom));
+        }
+
+        AtomChunk* c = atomic_exchange(&atom_chunks, NULL);
+        while (c != NULL) {
+            AtomChunk* next = c->next;
+            cuik__vfree(c, sizeof(AtomChunk) + c->capacity);
+            c = next;
+        }
     }
 }
 
-Atom atoms_put(size_t len, const unsigned char* str) {
-    if (interner == NULL) {
-        CUIK_TIMED_BLOCK("alloc atoms") {
-            interner = cuik__valloc((1u << INTERNER_EXP) * sizeof(Atom));
-            tb_arena_create(&atoms_arena, TB_ARENA_MEDIUM_CHUNK_SIZE);
+static _Atomic(Atom)* atoms_get_table(void) {
+    _Atomic(Atom)* table = atomic_load_explicit(&interner, memory_order_acquire);
+    if (LIKELY(table != NULL)) {
+        return table;
+    }
+
+    CUIK_TIMED_BLOCK("alloc atoms") {
+        _Atomic(Atom)* new_table = cuik__valloc((1u << INTERNER_EXP) * sizeof(Atom));
+        if (atomic_compare_exchange_strong(&interner, &table, new_table)) {
+            table = new_table;
+        } else {
+            // someone else beat us to it, table now holds theirs
+            cuik__vfree((void*) new_table, (1u << INTERNER_EXP) * sizeof(Atom));
         }
     }
+    return table;
+}
+
+static void* atoms_alloc(size_t size) {
+    size = (size + 7) & ~7ull;
+
+    for (;;) {
+        AtomChunk* c = atomic_load_explicit(&atom_chunks, memory_order_acquire);
+        if (c != NULL) {
+            size_t pos = atomic_fetch_add_explicit(&c->used, size, memory_order_relaxed);
+            if (pos + size <= c->capacity) {
+                return &c->data[pos];
+            }
+        }
+
+        // out of space, try to put a new chunk in front
+        size_t cap = size > ATOM_CHUNK_SIZE ? size : ATOM_CHUNK_SIZE;
+        AtomChunk* new_chunk = cuik__valloc(sizeof(AtomChunk) + cap);
+        new_chunk->next = c;
+        new_chunk->capacity = cap;
+        new_chunk->used = size;
+
+        if (atomic_compare_exchange_strong(&atom_chunks, &c, new_chunk)) {
+            return new_chunk->data;
+        }
+
+        // someone else already replaced it, use theirs
+        cuik__vfree(new_chunk, sizeof(AtomChunk) + cap);
+    }
+}
+
+static bool atoms_match(Atom a, uint32_t hash, size_t len, const unsigned char* str) {
+    AtomHeader* header = &((AtomHeader*) a)[-1];
+    return header->hash == hash && header->length == len && memcmp(a, str, len) == 0;
+}
+
+Atom atoms_put(size_t len, const unsigned char* str) {
+    _Atomic(Atom)* table = atoms_get_table();
 
     uint32_t mask = (1 << INTERNER_EXP) - 1;
     uint32_t hash = tb__murmur3_32(str, len);
     size_t first = hash & mask, i = first;
 
+    Atom newstr = NULL;
     do {
         // linear probe
-        if (LIKELY(interner[i] == NULL)) {
-            Atom newstr = tb_arena_unaligned_alloc(&atoms_arena, len + 1);
-            memcpy(newstr, str, len);
-            newstr[len] = 0;
-
-            interner[i] = newstr;
-            return newstr;
-        } else if (len == strlen(interner[i]) && memcmp(str, interner[i], len) == 0) {
-            return interner[i];
+        Atom a = atomic_load_explicit(&table[i], memory_order_acquire);
+        if (a == NULL) {
+            if (newstr == NULL) {
+                AtomHeader* header = atoms_alloc(sizeof(AtomHeader) + len + 1);
+                header->hash = hash;
+                header->length = len;
+
+                newstr = (Atom) &header[1];
+                memcpy(newstr, str, len);
+                newstr[len] = 0;
+            }
+
+            if (atomic_compare_exchange_strong_explicit(&table[i], &a, newstr, memory_order_acq_rel, memory_order_acquire)) {
+                return newstr;
+            }
+
+            // someone filled the slot first, a is what they put there. if it's not
+            // our string we keep probing (newstr is just wasted space then).
+        }
+
+        if (atoms_match(a, hash, len, str)) {
+            return a;
         }
 
         i = (i + 1) & mask;
@@ -55,11 +145,11 @@ Atom atoms_putuc(const unsigned char* str) {
 }
 
 Atom atoms_eat_token(TokenStream* restrict s) {
-    Token* t = tokens_get(s);
-    if (t->type != TOKEN_IDENTIFIER) {
+    Token t = tokens_get(s);
+    if (t.type != TOKEN_IDENTIFIER) {
         return NULL;
     }
 
     tokens_next(s);
-    return atoms_put(t->content.length, t->content.data);
+    return atoms_put(t.content.length, t.content.data);
 }
@@ -17,11 +17,11 @@ static Cuik_Attribute* parse_attributes(Cuik_Parser* restrict parser, TokenStrea
 
             // TODO(NeGate): we'll only handle the identifier case with no :: for now
             tokens_next(s), tokens_next(s);
-            if (tokens_get(s)->type != TOKEN_IDENTIFIER) {
+            if (tokens_get(s).type != TOKEN_IDENTIFIER) {
                 diag_err(s, tokens_get_range(s), "expected an identifier");
             } else {
-                Token* t = tokens_get(s);
-                a->name = atoms_put(t->content.length, t->content.data);
+                Token t = tokens_get(s);
+                a->name = atoms_put(t.content.length, t.content.data);
                 tokens_next(s);
             }
             a->loc.end = tokens_get_location(s);
@@ -32,7 +32,7 @@ static Cuik_Attribute* parse_attributes(Cuik_Parser* restrict parser, TokenStrea
             tokens_next(s), tokens_next(s);
 
             last = a;
-        } else if (tokens_get(s)->type == TOKEN_KW_attribute) {
+        } else if (tokens_get(s).type == TOKEN_KW_attribute) {
             // TODO(NeGate): Correctly parse attributes instead of
             // ignoring them.
             tokens_next(s);
@@ -40,9 +40,9 @@ static Cuik_Attribute* parse_attributes(Cuik_Parser* restrict parser, TokenStrea
 
             int depth = 1;
             while (depth) {
-                if (tokens_get(s)->type == '(') {
+                if (tokens_get(s).type == '(') {
                     depth++;
-                } else if (tokens_get(s)->type == ')') {
+                } else if (tokens_get(s).type == ')') {
                     depth--;
                 }
 
@@ -55,7 +55,7 @@ static Cuik_Attribute* parse_attributes(Cuik_Parser* restrict parser, TokenStrea
 }
 
 static bool skip_over_declspec(TokenStream* restrict s) {
-    if (tokens_get(s)->type == TOKEN_KW_declspec || tokens_get(s)->type == TOKEN_KW_Pragma) {
+    if (tokens_get(s).type == TOKEN_KW_declspec || tokens_get(s).type == TOKEN_KW_Pragma) {
         tokens_next(s);
         expect_char(s, '(');
 
@@ -63,9 +63,9 @@ static bool skip_over_declspec(TokenStream* restrict s) {
         // ignoring them.
         int depth = 1;
         while (depth) {
-            if (tokens_get(s)->type == '(')
+            if (tokens_get(s).type == '(')
                 depth++;
-            else if (tokens_get(s)->type == ')')
+            else if (tokens_get(s).type == ')')
                 depth--;
 
             tokens_next(s);
@@ -79,7 +79,7 @@ static bool skip_over_declspec(TokenStream* restrict s) {
 
 static Cuik_QualType parse_ptr_qualifiers(TokenStream* restrict s, Cuik_QualType type) {
     for (;;) {
-        TknType t = tokens_get(s)->type;
+        TknType t = tokens_get(s).type;
         if (t == TOKEN_KW_Atomic) {
             type.raw |= CUIK_QUAL_ATOMIC;
             tokens_next(s);
@@ -103,9 +103,9 @@ static Cuik_QualType parse_ptr_qualifiers(TokenStream* restrict s, Cuik_QualType
 }
 
 static bool is_typename(Cuik_Parser* restrict parser, TokenStream* restrict s) {
-    Token* t = tokens_get(s);
+    Token t = tokens_get(s);
 
-    switch (t->type) {
+    switch (t.type) {
         case TOKEN_KW_void:
         case TOKEN_KW_char:
         case TOKEN_KW_short:
@@ -152,8 +152,8 @@ static bool is_typename(Cuik_Parser* restrict parser, TokenStream* restrict s) {
 
         case TOKEN_IDENTIFIER: {
             // good question...
-            Token* t = tokens_get(s);
-            Atom name = atoms_put(t->content.length, t->content.data);
+            Token t = tokens_get(s);
+            Atom name = atoms_put(t.content.length, t.content.data);
 
             Symbol* loc = find_symbol(parser, s);
             if (loc != NULL) {
@@ -190,16 +190,16 @@ static ptrdiff_t skip_expression_in_braces(TokenStream* s, char open, char close
     size_t current = s->list.current;
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
-            diag_err(s, get_token_range(t), "expression never terminated");
+        if (t.type == '\0') {
+            diag_err(s, get_token_range(&t), "expression never terminated");
             return -1;
-        } else if (t->type == open) {
+        } else if (t.type == open) {
             depth++;
-        } else if (t->type == close) {
+        } else if (t.type == close) {
             if (depth == 0) {
-                report_two_spots(REPORT_ERROR, s, open_brace, t->location, "unbalanced braces", "open", "close?", NULL);
+                report_two_spots(REPORT_ERROR, s, open_brace, t.location, "unbalanced braces", "open", "close?", NULL);
                 return -1;
             }
 
@@ -222,17 +222,17 @@ static ptrdiff_t skip_expression_in_list(TokenStream* restrict s, SourceRange er
 
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
+        if (t.type == '\0') {
             diag_err(s, error_loc, "Declaration was never closed");
 
             // restore the token stream
             s->list.current = current + 1;
             return -1;
-        } else if (t->type == '(') {
+        } else if (t.type == '(') {
             depth++;
-        } else if (t->type == ')') {
+        } else if (t.type == ')') {
             depth--;
 
             if (depth == 0) {
@@ -241,8 +241,8 @@ static ptrdiff_t skip_expression_in_list(TokenStream* restrict s, SourceRange er
                 s->list.current = current + 1;
                 return -1;
             }
-        } else if (t->type == ';' || t->type == ',') {
-            if (depth > 1 && t->type == ';') {
+        } else if (t.type == ';' || t.type == ',') {
+            if (depth > 1 && t.type == ';') {
                 diag_err(s, error_loc, "Declaration's expression has a weird semicolon");
                 return -1;
             } else if (depth == 1) {
@@ -265,26 +265,26 @@ static ptrdiff_t skip_expression_in_enum2(TokenStream* restrict s, ptrdiff_t* ou
 
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
-            diag_err(s, get_token_range(t), "Declaration was never closed");
+        if (t.type == '\0') {
+            diag_err(s, get_token_range(&t), "Declaration was never closed");
 
             // restore the token stream
             s->list.current = current + 1;
             return -1;
-        } else if (t->type == '(') {
+        } else if (t.type == '(') {
             depth++;
-        } else if (t->type == ')') {
+        } else if (t.type == ')') {
             depth--;
 
             if (depth == 0) {
-                diag_err(s, get_token_range(t), "Unbalanced parenthesis");
+                diag_err(s, get_token_range(&t), "Unbalanced parenthesis");
 
                 s->list.current = current + 1;
                 return -1;
             }
-        } else if (t->type == '}' || t->type == ',') {
+        } else if (t.type == '}' || t.type == ',') {
             if (depth == 1) {
                 depth--;
                 break;
@@ -304,20 +304,20 @@ static ptrdiff_t skip_brackets(TokenStream* restrict s, SourceRange error_loc, b
 
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
+        if (t.type == '\0') {
             diag_err(s, error_loc, "brackets ended in EOF");
 
             // restore the token stream
             s->list.current = current + 1;
             return -1;
-        } else if (t->type == '{') {
+        } else if (t.type == '{') {
             depth++;
-        } else if (t->type == ';' && depth == 1 && no_semicolons) {
+        } else if (t.type == ';' && depth == 1 && no_semicolons) {
             diag_err(s, tokens_get_range(s), "Spurious semicolon");
             return -1;
-        } else if (t->type == '}') {
+        } else if (t.type == '}') {
             if (depth == 0) {
                 diag_err(s, error_loc, "Unbalanced brackets");
                 return -1;
@@ -362,7 +362,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
 
     SourceRange loc = tokens_get_range(s);
     do {
-        TknType tkn_type = tokens_get(s)->type;
+        TknType tkn_type = tokens_get(s).type;
         switch (tkn_type) {
             // type-specifier:
             case TOKEN_KW_void:   counter += VOID;  break;
@@ -407,9 +407,9 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
 
                 int depth = 1;
                 while (depth) {
-                    if (tokens_get(s)->type == '(') {
+                    if (tokens_get(s).type == '(') {
                         depth++;
-                    } else if (tokens_get(s)->type == ')') {
+                    } else if (tokens_get(s).type == ')') {
                         depth--;
                     }
 
@@ -459,6 +459,12 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                     return CUIK_QUAL_TYPE_NULL;
                 }
 
+                // the backend only has XMM sized vectors right now
+                if (type->size * count != 16) {
+                    diag_err(s, loc, "_Vector types have to be 128 bits wide for now (got %" PRIiMAX " bits)", type->size * count * 8);
+                    return CUIK_QUAL_TYPE_NULL;
+                }
+
                 type = cuik__new_vector(&parser->types, cuik_uncanonical_type(type), count);
                 counter += OTHER;
 
@@ -469,7 +475,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
 
             case TOKEN_KW_Atomic: {
                 tokens_next(s);
-                if (tokens_get(s)->type == '(') {
+                if (tokens_get(s).type == '(') {
                     SourceLoc opening_loc = tokens_get_location(s);
                     tokens_next(s);
 
@@ -535,13 +541,13 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                 tokens_next(s);
 
                 Atom name = NULL;
-                if (tokens_get(s)->type == TOKEN_IDENTIFIER) {
-                    Token* t = tokens_get(s);
-                    name = atoms_put(t->content.length, t->content.data);
+                if (tokens_get(s).type == TOKEN_IDENTIFIER) {
+                    Token t = tokens_get(s);
+                    name = atoms_put(t.content.length, t.content.data);
                     tokens_next(s);
                 }
 
-                if (tokens_get(s)->type == '{') {
+                if (tokens_get(s).type == '{') {
                     tokens_next(s);
 
                     bool in_scope;
@@ -578,18 +584,18 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                     size_t count = 0;
                     EnumEntry* start = tls_save();
 
-                    while (tokens_get(s)->type != '}') {
+                    while (tokens_get(s).type != '}') {
                         // parse name
-                        Token* t = tokens_get(s);
-                        if (t->type != TOKEN_IDENTIFIER) {
+                        Token t = tokens_get(s);
+                        if (t.type != TOKEN_IDENTIFIER) {
                             diag_err(s, tokens_get_range(s), "expected identifier for enum name entry.");
                         }
 
-                        Atom name = atoms_put(t->content.length, t->content.data);
+                        Atom name = atoms_put(t.content.length, t.content.data);
                         tokens_next(s);
 
                         int lexer_pos = 0;
-                        if (tokens_get(s)->type == '=') {
+                        if (tokens_get(s).type == '=') {
                             tokens_next(s);
 
                             if (parser->is_in_global_scope) {
@@ -612,7 +618,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                         Symbol sym = {
                             .name = name,
                             .type = cuik_uncanonical_type(type),
-                            .loc = get_token_range(t),
+                            .loc = get_token_range(&t),
                             .storage_class = STORAGE_ENUM,
                             .enum_value = count
                         };
@@ -624,7 +630,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                         }
 
                         count += 1;
-                        if (tokens_get(s)->type == ',') {
+                        if (tokens_get(s).type == ',') {
                             tokens_next(s);
                             continue;
                         } else {
@@ -672,16 +678,16 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                 while (skip_over_declspec(s)) {}
 
                 Atom name = NULL;
-                if (tokens_get(s)->type == TOKEN_IDENTIFIER) {
+                if (tokens_get(s).type == TOKEN_IDENTIFIER) {
                     record_loc = tokens_get_range(s);
 
-                    Token* t = tokens_get(s);
-                    name = atoms_put(t->content.length, t->content.data);
+                    Token t = tokens_get(s);
+                    name = atoms_put(t.content.length, t.content.data);
 
                     tokens_next(s);
                 }
 
-                if (tokens_get(s)->type == '{') {
+                if (tokens_get(s).type == '{') {
                     tokens_next(s);
 
                     bool in_scope;
@@ -723,11 +729,11 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
 
                     size_t member_count = 0;
                     Member* members = tls_save();
-                    while (tokens_get(s)->type != '}') {
+                    while (tokens_get(s).type != '}') {
                         if (skip_over_declspec(s)) continue;
 
                         // skip any random semicolons
-                        if (tokens_get(s)->type == ';') {
+                        if (tokens_get(s).type == ';') {
                             tokens_next(s);
                             continue;
                         }
@@ -754,7 +760,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
 
                             // not all members have declarators for example
                             // char : 3; or struct { ... };
-                            if (tokens_get(s)->type != ';' && tokens_get(s)->type != ':') {
+                            if (tokens_get(s).type != ';' && tokens_get(s).type != ':') {
                                 decl = parse_declarator2(parser, s, member_base_type, false);
                                 member_type = decl.type;
                             } else {
@@ -771,7 +777,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                                 .name = decl.name
                             };
 
-                            if (tokens_get(s)->type == ':') {
+                            if (tokens_get(s).type == ':') {
                                 if (is_union) {
                                     diag_warn(s, decl.loc, "Bitfield... unions... huh?!");
                                 } else if (CUIK_QUAL_TYPE_HAS(member_type, CUIK_QUAL_ATOMIC)) {
@@ -785,10 +791,10 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                                 member->bit_width = parse_const_expr(parser, s);
                             }
 
-                            if (tokens_get(s)->type == ',') {
+                            if (tokens_get(s).type == ',') {
                                 tokens_next(s);
                                 continue;
-                            } else if (tokens_get(s)->type == ';') {
+                            } else if (tokens_get(s).type == ';') {
                                 break;
                             }
                         } while (true);
@@ -838,8 +844,8 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
             case TOKEN_IDENTIFIER: {
                 if (counter) goto done;
 
-                Token* t = tokens_get(s);
-                Atom name = atoms_put(t->content.length, t->content.data);
+                Token t = tokens_get(s);
+                Atom name = atoms_put(t.content.length, t.content.data);
 
                 Symbol* old_def = cuik_symtab_lookup(parser->symbols, name);
                 if (old_def != NULL) {
@@ -860,7 +866,7 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
                         type = type_alloc(&parser->types, true);
                         *type = (Cuik_Type){
                             .kind = KIND_PLACEHOLDER,
-                            .loc = get_token_range(t),
+                            .loc = get_token_range(&t),
                             .placeholder = { name },
                         };
 
@@ -946,8 +952,8 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
             break;
 
             default: {
-                Token* last = &s->list.tokens[s->list.current];
-                diag_err(s, (SourceRange){ loc.start, tokens_get_last_location(s) }, "unknown typename %!S", last->content);
+                Token last = tokens_get(s);
+                diag_err(s, (SourceRange){ loc.start, tokens_get_last_location(s) }, "unknown typename %!S", last.content);
                 tokens_next(s);
                 return CUIK_QUAL_TYPE_NULL;
             }
@@ -959,8 +965,8 @@ static Cuik_QualType parse_declspec2(Cuik_Parser* restrict parser, TokenStream*
     done:
     loc = (SourceRange){ loc.start, tokens_get_last_location(s) };
     if (type == 0) {
-        Token* last = &s->list.tokens[s->list.current];
-        diag_err(s, loc, "unknown typename %!S", last->content);
+        Token last = tokens_get(s);
+        diag_err(s, loc, "unknown typename %!S", last.content);
         tokens_next(s);
         return CUIK_QUAL_TYPE_NULL;
     }
@@ -998,15 +1004,15 @@ static Cuik_QualType parse_typename2(Cuik_Parser* restrict parser, TokenStream*
 }
 
 static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStream* restrict s, Cuik_QualType type) {
-    Token* t = tokens_get(s);
-    if (t->type == '(') {
+    Token t = tokens_get(s);
+    if (t.type == '(') {
         // function type
         // void foo(int x)
         //         ^^^^^^^
         SourceLoc opening_loc = tokens_get_location(s);
         tokens_next(s);
 
-        if (tokens_get(s)->type == TOKEN_KW_void && tokens_peek(s)->type == ')') {
+        if (tokens_get(s).type == TOKEN_KW_void && tokens_peek(s).type == ')') {
             // this is required pre-C23 to say no parameters (empty parens meant undefined)
             tokens_next(s);
             tokens_next(s);
@@ -1025,16 +1031,16 @@ static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStrea
             Param* params = tls_save();
             bool has_varargs = false;
 
-            while (tokens_get(s)->type && tokens_get(s)->type != ')') {
+            while (tokens_get(s).type && tokens_get(s).type != ')') {
                 if (param_count) {
-                    if (tokens_get(s)->type != ',') {
+                    if (tokens_get(s).type != ',') {
                         diag_err(s, tokens_get_range(s), "expected closing paren (or comma) after declaration name");
                     } else {
                         tokens_next(s);
                     }
                 }
 
-                if (tokens_get(s)->type == TOKEN_TRIPLE_DOT) {
+                if (tokens_get(s).type == TOKEN_TRIPLE_DOT) {
                     tokens_next(s);
                     has_varargs = true;
                     break;
@@ -1091,7 +1097,7 @@ static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStrea
 
             type = cuik_uncanonical_type(t);
         }
-    } else if (t->type == '[') {
+    } else if (t.type == '[') {
         // array
         // int bar[8 * 8]
         //        ^^^^^^^
@@ -1101,9 +1107,9 @@ static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStrea
         Cuik_Type* t = NULL;
         if (parser->is_in_global_scope) {
             size_t current = 0;
-            if (tokens_get(s)->type == ']') {
+            if (tokens_get(s).type == ']') {
                 tokens_next(s);
-            } else if (tokens_get(s)->type == '*') {
+            } else if (tokens_get(s).type == '*') {
                 tokens_next(s);
                 expect_char(s, ']');
             } else {
@@ -1124,10 +1130,10 @@ static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStrea
                 tokens_next(s);
 
                 long long count;
-                if (tokens_get(s)->type == ']') {
+                if (tokens_get(s).type == ']') {
                     count = 0;
                     tokens_next(s);
-                } else if (tokens_get(s)->type == '*') {
+                } else if (tokens_get(s).type == '*') {
                     count = 0;
                     tokens_next(s);
                     expect_char(s, ']');
@@ -1138,7 +1144,7 @@ static Cuik_QualType parse_type_suffix2(Cuik_Parser* restrict parser, TokenStrea
 
                 tls_push(sizeof(size_t));
                 counts[depth++] = count;
-            } while (!tokens_eof(s) && tokens_get(s)->type == '[');
+            } while (!tokens_eof(s) && tokens_get(s).type == '[');
 
             t = cuik_canonical_type(type);
             size_t expected_size = t->size;
@@ -1173,10 +1179,10 @@ static Decl parse_declarator_glsl(Cuik_Parser* restrict parser, TokenStream* res
     SourceLoc start_loc = tokens_get_location(s);
 
     Atom name = NULL;
-    Token* t = tokens_get(s);
-    if (!is_abstract && t->type == TOKEN_IDENTIFIER) {
+    Token t = tokens_get(s);
+    if (!is_abstract && t.type == TOKEN_IDENTIFIER) {
         // simple name
-        name = atoms_put(t->content.length, t->content.data);
+        name = atoms_put(t.content.length, t.content.data);
         tokens_next(s);
     }
 
@@ -1199,7 +1205,7 @@ static Decl parse_declarator2(Cuik_Parser* restrict parser, TokenStream* restric
     for (;;) {
         type = parse_ptr_qualifiers(s, type);
 
-        if (tokens_get(s)->type == '*') {
+        if (tokens_get(s).type == '*') {
             tokens_next(s);
 
             type = cuik_uncanonical_type(cuik__new_pointer(&parser->types, type));
@@ -1221,15 +1227,15 @@ static Decl parse_declarator2(Cuik_Parser* restrict parser, TokenStream* restric
     //   direct-declarator ( parameter-type-list )
     //   direct-declarator ( identifier-listOPT )
     Atom name = NULL;
-    Token* t = tokens_get(s);
+    Token t = tokens_get(s);
 
     // non-negative if there's a nested declarator
     ptrdiff_t nested_start = -1, nested_end = -1;
-    if (!is_abstract && t->type == TOKEN_IDENTIFIER) {
+    if (!is_abstract && t.type == TOKEN_IDENTIFIER) {
         // simple name
-        name = atoms_put(t->content.length, t->content.data);
+        name = atoms_put(t.content.length, t.content.data);
         tokens_next(s);
-    } else if (t->type == '(') {
+    } else if (t.type == '(') {
         // int (*name)(void);
         //     ^^^^^^^
         //     S     E
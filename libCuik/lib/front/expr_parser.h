@@ -122,7 +122,7 @@ static InitNode* append_to_init_list(TokenStream* restrict s, InitNode* parent,
 static InitNode* parse_initializer_member2(Cuik_Parser* parser, TokenStream* restrict s) {
     InitNode *current = NULL, *head = NULL;
     for (;;) {
-        if (tokens_get(s)->type == '[')  {
+        if (tokens_get(s).type == '[')  {
             SourceLoc loc = tokens_get_location(s);
             tokens_next(s);
 
@@ -134,7 +134,7 @@ static InitNode* parse_initializer_member2(Cuik_Parser* parser, TokenStream* res
 
             // GNU-extension: array range initializer
             intmax_t count = 1;
-            if (tokens_get(s)->type == TOKEN_TRIPLE_DOT) {
+            if (tokens_get(s).type == TOKEN_TRIPLE_DOT) {
                 tokens_next(s);
 
                 count = parse_const_expr(parser, s) - start;
@@ -158,12 +158,12 @@ static InitNode* parse_initializer_member2(Cuik_Parser* parser, TokenStream* res
             continue;
         }
 
-        if (tokens_get(s)->type == '.') {
+        if (tokens_get(s).type == '.') {
             tokens_next(s);
             SourceLoc loc = tokens_get_location(s);
 
-            Token* t = tokens_get(s);
-            Atom name = atoms_put(t->content.length, t->content.data);
+            Token t = tokens_get(s);
+            Atom name = atoms_put(t.content.length, t.content.data);
             tokens_next(s);
 
             if (current == NULL) {
@@ -191,18 +191,18 @@ static InitNode* parse_initializer_member2(Cuik_Parser* parser, TokenStream* res
     // it can either be a normal expression
     // or a nested designated initializer
     SourceLoc loc = tokens_get_location(s);
-    if (tokens_get(s)->type == '{') {
+    if (tokens_get(s).type == '{') {
         tokens_next(s);
 
         // don't expect one the first time
         bool expect_comma = false;
         InitNode* tail = current->kid;
-        while (!tokens_eof(s) && tokens_get(s)->type != '}') {
+        while (!tokens_eof(s) && tokens_get(s).type != '}') {
             if (expect_comma) {
                 if (!expect_char(s, ',')) tokens_next(s);
 
                 // we allow for trailing commas like ballers do
-                if (tokens_get(s)->type == '}') break;
+                if (tokens_get(s).type == '}') break;
             } else expect_comma = true;
 
             // attach to our linked list
@@ -229,10 +229,10 @@ static void parse_initializer2(Cuik_Parser* parser, TokenStream* restrict s, Cui
 
     // don't expect one the first time
     bool expect_comma = false;
-    while (!tokens_eof(s) && tokens_get(s)->type != '}') {
+    while (!tokens_eof(s) && tokens_get(s).type != '}') {
         tail = append_to_init_list(s, root, tail, parse_initializer_member2(parser, s));
 
-        if (tokens_get(s)->type == ',') {
+        if (tokens_get(s).type == ',') {
             tokens_next(s);
             continue;
         } else {
@@ -252,10 +252,10 @@ static void parse_string_literal(Cuik_Parser* parser, TokenStream* restrict s, S
     size_t saved_lexer_pos = s->list.current;
     size_t total_len = 0;
     while (!tokens_eof(s)) {
-        Token* t = tokens_get(s);
-        if (t->type == TOKEN_STRING_DOUBLE_QUOTE || t->type == TOKEN_STRING_WIDE_DOUBLE_QUOTE) {
-            total_len += t->content.length - 2;
-        } else if (string_equals_cstr(&t->content, "__func__")) {
+        Token t = tokens_get(s);
+        if (t.type == TOKEN_STRING_DOUBLE_QUOTE || t.type == TOKEN_STRING_WIDE_DOUBLE_QUOTE) {
+            total_len += t.content.length - 2;
+        } else if (string_equals_cstr(&t.content, "__func__")) {
             if (cuik__sema_function_stmt) total_len += strlen(cuik__sema_function_stmt->decl.name);
             else total_len += 3; // "???"
         } else {
@@ -273,11 +273,11 @@ static void parse_string_literal(Cuik_Parser* parser, TokenStream* restrict s, S
     // Fill up the buffer
     s->list.current = saved_lexer_pos;
     while (!tokens_eof(s)) {
-        Token* t = tokens_get(s);
-        if (t->type == TOKEN_STRING_DOUBLE_QUOTE || t->type == TOKEN_STRING_WIDE_DOUBLE_QUOTE) {
-            memcpy(&buffer[curr], t->content.data + 1, t->content.length - 2);
-            curr += t->content.length - 2;
-        } else if (string_equals_cstr(&t->content, "__func__")) {
+        Token t = tokens_get(s);
+        if (t.type == TOKEN_STRING_DOUBLE_QUOTE || t.type == TOKEN_STRING_WIDE_DOUBLE_QUOTE) {
+            memcpy(&buffer[curr], t.content.data + 1, t.content.length - 2);
+            curr += t.content.length - 2;
+        } else if (string_equals_cstr(&t.content, "__func__")) {
             if (cuik__sema_function_stmt) {
                 size_t len = strlen(cuik__sema_function_stmt->decl.name);
                 memcpy(&buffer[curr], cuik__sema_function_stmt->decl.name, len);
@@ -306,9 +306,9 @@ static void parse_string_literal(Cuik_Parser* parser, TokenStream* restrict s, S
 //   ( expression )
 //   generic-selection
 static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
-    Token* t = tokens_get(s);
+    Token t = tokens_get(s);
 
-    if (t->type == '(') {
+    if (t.type == '(') {
         SourceLoc start_loc = tokens_get_location(s);
         tokens_next(s);
 
@@ -325,9 +325,9 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
     Subexpr* e = NULL;
     SourceLoc start_loc = tokens_get_location(s);
 
-    switch (t->type) {
+    switch (t.type) {
         case TOKEN_IDENTIFIER: {
-            if (string_equals_cstr(&t->content, "__va_arg")) {
+            if (string_equals_cstr(&t.content, "__va_arg")) {
                 tokens_next(s);
 
                 expect_char(s, '(');
@@ -344,7 +344,7 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
                     .va_arg_ = { type },
                 };
                 break;
-            } else if (!parser->is_in_global_scope && string_equals_cstr(&t->content, "__func__")) {
+            } else if (!parser->is_in_global_scope && string_equals_cstr(&t.content, "__func__")) {
                 tokens_next(s);
                 Atom name = cuik__sema_function_stmt->decl.name;
 
@@ -359,8 +359,8 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
 
             e = push_expr(parser);
 
-            Token* t = tokens_get(s);
-            Atom name = atoms_put(t->content.length, t->content.data);
+            Token t = tokens_get(s);
+            Atom name = atoms_put(t.content.length, t.content.data);
 
             Symbol* sym = NULL;
             ptrdiff_t builtin_search = nl_map_get_cstr(parser->target->builtin_func_map, name);
@@ -412,14 +412,14 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
         }
 
         case TOKEN_FLOAT: {
-            Token* t = tokens_get(s);
-            bool is_float32 = t->content.data[t->content.length - 1] == 'f';
+            Token t = tokens_get(s);
+            bool is_float32 = t.content.data[t.content.length - 1] == 'f';
 
             char* end;
-            double f = strtod((const char*) t->content.data, &end);
-            if (end != (const char*) &t->content.data[t->content.length]) {
+            double f = strtod((const char*) t.content.data, &end);
+            if (end != (const char*) &t.content.data[t.content.length]) {
                 if (*end != 'l' && *end != 'L' && *end != 'f' && *end != 'd' && *end != 'F' && *end != 'D') {
-                    diag_err(s, get_token_range(t), "invalid float literal");
+                    diag_err(s, get_token_range(&t), "invalid float literal");
                 }
             }
 
@@ -432,9 +432,9 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
         }
 
         case TOKEN_INTEGER: {
-            Token* t = tokens_get(s);
+            Token t = tokens_get(s);
             Cuik_IntSuffix suffix;
-            uint64_t i = parse_int(t->content.length, (const char*) t->content.data, &suffix);
+            uint64_t i = parse_int(t.content.length, (const char*) t.content.data, &suffix);
 
             e = push_expr(parser);
             *e = (Subexpr){
@@ -446,17 +446,17 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
 
         case TOKEN_STRING_SINGLE_QUOTE:
         case TOKEN_STRING_WIDE_SINGLE_QUOTE: {
-            Token* t = tokens_get(s);
+            Token t = tokens_get(s);
 
             int ch = 0;
-            ptrdiff_t distance = parse_char(t->content.length - 2, (const char*) &t->content.data[1], &ch);
+            ptrdiff_t distance = parse_char(t.content.length - 2, (const char*) &t.content.data[1], &ch);
             if (distance < 0) {
-                diag_err(s, get_token_range(t), "invalid character literal");
+                diag_err(s, get_token_range(&t), "invalid character literal");
             }
 
             e = push_expr(parser);
             *e = (Subexpr){
-                .op = t->type == TOKEN_STRING_SINGLE_QUOTE ? EXPR_CHAR : EXPR_WCHAR,
+                .op = t.type == TOKEN_STRING_SINGLE_QUOTE ? EXPR_CHAR : EXPR_WCHAR,
                 .char_lit = ch,
             };
             break;
@@ -468,7 +468,7 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
             SourceLoc opening_loc = tokens_get_location(s);
             expect_char(s, '(');
 
-            String content = tokens_get(s)->content;
+            String content = tokens_get(s).content;
             tokens_next(s);
 
             Cuik_QualType char_type = cuik_uncanonical_type(&parser->target->signed_ints[CUIK_BUILTIN_CHAR]);
@@ -487,7 +487,7 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
 
         case TOKEN_STRING_DOUBLE_QUOTE:
         case TOKEN_STRING_WIDE_DOUBLE_QUOTE: {
-            bool is_wide = (tokens_get(s)->type == TOKEN_STRING_WIDE_DOUBLE_QUOTE);
+            bool is_wide = (tokens_get(s).type == TOKEN_STRING_WIDE_DOUBLE_QUOTE);
 
             e = push_expr(parser);
             *e = (Subexpr){
@@ -517,8 +517,8 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
             C11GenericEntry* entries = tls_save();
 
             SourceRange default_loc = { 0 };
-            while (!tokens_eof(s) && tokens_get(s)->type != ')') {
-                if (tokens_get(s)->type == TOKEN_KW_default) {
+            while (!tokens_eof(s) && tokens_get(s).type != ')') {
+                if (tokens_get(s).type == TOKEN_KW_default) {
                     if (default_loc.start.raw != 0) {
                         diag_err(s, tokens_get_range(s), "multiple default cases on _Generic");
                         diag_note(s, default_loc, "see here");
@@ -552,7 +552,7 @@ static void parse_primary_expr(Cuik_Parser* parser, TokenStream* restrict s) {
                 }
 
                 // exit if it's not a comma
-                if (tokens_get(s)->type != ',') break;
+                if (tokens_get(s).type != ',') break;
                 tokens_next(s);
             }
 
@@ -591,7 +591,7 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
     //   '(' type-name ')' '{' initializer-list '}'
     //   '(' type-name ')' '{' initializer-list ',' '}'
     size_t fallback = s->list.current;
-    if (tokens_get(s)->type == '(') {
+    if (tokens_get(s).type == '(') {
         tokens_next(s);
 
         assert(!parser->is_in_global_scope && "cannot resolve is_typename in global scope");
@@ -603,10 +603,10 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
         Cuik_QualType type = parse_typename2(parser, s);
         expect_closing_paren(s, start_loc);
 
-        if (tokens_get(s)->type != '{') {
+        if (tokens_get(s).type != '{') {
             if (in_sizeof) {
                 // HACKY but it does get us to the 'sizeof' as opposed to the paren
-                start_loc = s->list.tokens[s->list.current - 4].location;
+                start_loc = s->list.locations[s->list.current - 4];
 
                 // resolve as sizeof (T)
                 SourceLoc end_loc = tokens_get_last_location(s);
@@ -643,7 +643,7 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
                 .constructor = { type },
             };
 
-            if (tokens_get(s)->type != '(') {
+            if (tokens_get(s).type != '(') {
                 diag_err(s, e->loc, "Expected parenthesis after constructor name");
             }
         } else {
@@ -655,7 +655,7 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
     // it'll restart and take a shot at matching another
     // piece of the expression.
     try_again: {
-        if (tokens_get(s)->type == '[') {
+        if (tokens_get(s).type == '[') {
             tokens_next(s);
             parse_expr(parser, s);
             expect_char(s, ']');
@@ -673,14 +673,14 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
         }
 
         // Pointer member access
-        if (tokens_get(s)->type == TOKEN_ARROW) {
+        if (tokens_get(s).type == TOKEN_ARROW) {
             tokens_next(s);
-            if (tokens_get(s)->type != TOKEN_IDENTIFIER) {
+            if (tokens_get(s).type != TOKEN_IDENTIFIER) {
                 diag_err(s, tokens_get_range(s), "Expected identifier after member access a.b");
             }
 
-            Token* t = tokens_get(s);
-            Atom name = atoms_put(t->content.length, t->content.data);
+            Token t = tokens_get(s);
+            Atom name = atoms_put(t.content.length, t.content.data);
             tokens_next(s);
 
             SourceLoc end_loc = tokens_get_last_location(s);
@@ -697,14 +697,14 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
         }
 
         // Member access
-        if (tokens_get(s)->type == '.') {
+        if (tokens_get(s).type == '.') {
             tokens_next(s);
-            if (tokens_get(s)->type != TOKEN_IDENTIFIER) {
+            if (tokens_get(s).type != TOKEN_IDENTIFIER) {
                 diag_err(s, tokens_get_range(s), "Expected identifier after member access a.b");
             }
 
-            Token* t = tokens_get(s);
-            Atom name = atoms_put(t->content.length, t->content.data);
+            Token t = tokens_get(s);
+            Atom name = atoms_put(t.content.length, t.content.data);
             tokens_next(s);
 
             SourceLoc end_loc = tokens_get_last_location(s);
@@ -721,14 +721,14 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
         }
 
         // Function call
-        if (tokens_get(s)->type == '(') {
+        if (tokens_get(s).type == '(') {
             SourceLoc open_loc = tokens_get_location(s);
             tokens_next(s);
 
             int param_count = 0;
-            while (!tokens_eof(s) && tokens_get(s)->type != ')') {
+            while (!tokens_eof(s) && tokens_get(s).type != ')') {
                 if (param_count) {
-                    if (tokens_get(s)->type != ',') {
+                    if (tokens_get(s).type != ',') {
                         break;
                     }
 
@@ -750,8 +750,8 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
             goto try_again;
         }
 
-        if (tokens_get(s)->type == TOKEN_INCREMENT || tokens_get(s)->type == TOKEN_DECREMENT) {
-            bool is_inc = tokens_get(s)->type == TOKEN_INCREMENT;
+        if (tokens_get(s).type == TOKEN_INCREMENT || tokens_get(s).type == TOKEN_DECREMENT) {
+            bool is_inc = tokens_get(s).type == TOKEN_INCREMENT;
             tokens_next(s);
             SourceLoc end_loc = tokens_get_last_location(s);
 
@@ -783,7 +783,7 @@ static void parse_postfix(Cuik_Parser* restrict parser, TokenStream* restrict s,
 //     & * + - ~ !
 static void parse_unary(Cuik_Parser* restrict parser, TokenStream* restrict s, bool in_sizeof) {
     SourceLoc start_loc = tokens_get_location(s);
-    TknType tkn = tokens_get(s)->type;
+    TknType tkn = tokens_get(s).type;
 
     if (tkn == TOKEN_KW_Alignof) {
         tokens_next(s);
@@ -843,7 +843,7 @@ static void parse_cast(Cuik_Parser* restrict parser, TokenStream* restrict s, bo
     SourceLoc start_loc = tokens_get_location(s);
 
     size_t fallback = s->list.current;
-    if (tokens_get(s)->type == '(') {
+    if (tokens_get(s).type == '(') {
         tokens_next(s);
 
         assert(!parser->is_in_global_scope && "cannot resolve is_typename in global scope");
@@ -856,7 +856,7 @@ static void parse_cast(Cuik_Parser* restrict parser, TokenStream* restrict s, bo
         Cuik_QualType type = parse_typename2(parser, s);
         expect_closing_paren(s, start_loc);
 
-        if (tokens_get(s)->type == '{') {
+        if (tokens_get(s).type == '{') {
             if (in_sizeof) {
                 // resolve as sizeof (T)
                 SourceLoc end_loc = tokens_get_last_location(s);
@@ -896,7 +896,7 @@ static void parse_binop(Cuik_Parser* restrict parser, TokenStream* restrict s, i
     parse_cast(parser, s, false);
 
     ExprInfo binop;
-    while (binop = get_binop(tokens_get(s)->type), binop.prec != 0 && binop.prec >= min_prec) {
+    while (binop = get_binop(tokens_get(s).type), binop.prec != 0 && binop.prec >= min_prec) {
         tokens_next(s);
 
         if (binop.op == EXPR_LOGICAL_AND || binop.op == EXPR_LOGICAL_OR) {
@@ -971,7 +971,7 @@ static void parse_ternary(Cuik_Parser* restrict parser, TokenStream* restrict s)
     SourceLoc start_loc = tokens_get_location(s);
     parse_binop(parser, s, 0);
 
-    if (tokens_get(s)->type == '?') {
+    if (tokens_get(s).type == '?') {
         tokens_next(s);
 
         // ternaries are weird because we need to convert the left and right sides
@@ -1010,7 +1010,7 @@ static void parse_assignment(Cuik_Parser* restrict parser, TokenStream* restrict
     parse_ternary(parser, s);
 
     ExprOp op = EXPR_NONE;
-    switch (tokens_get(s)->type) {
+    switch (tokens_get(s).type) {
         case TOKEN_ASSIGN:            op = EXPR_ASSIGN;          break;
         case TOKEN_PLUS_EQUAL:        op = EXPR_PLUS_ASSIGN;     break;
         case TOKEN_MINUS_EQUAL:       op = EXPR_MINUS_ASSIGN;    break;
@@ -1040,11 +1040,11 @@ static void parse_assignment(Cuik_Parser* restrict parser, TokenStream* restrict
 }
 
 static void parse_pragma_expr(Cuik_Parser* restrict parser, TokenStream* restrict s) {
-    if (tokens_get(s)->type == TOKEN_KW_Pragma) {
+    if (tokens_get(s).type == TOKEN_KW_Pragma) {
         tokens_next(s);
 
         if (expect_char(s, '(')) {
-            if (tokens_get(s)->type != TOKEN_STRING_DOUBLE_QUOTE) {
+            if (tokens_get(s).type != TOKEN_STRING_DOUBLE_QUOTE) {
                 diag_err(s, tokens_get_range(s), "pragma declaration expects string literal");
             }
             tokens_next(s);
@@ -1060,7 +1060,7 @@ static void parse_expr(Cuik_Parser* restrict parser, TokenStream* restrict s) {
     SourceLoc start_loc = tokens_get_location(s);
     parse_assignment(parser, s);
 
-    while (tokens_get(s)->type == TOKEN_COMMA) {
+    while (tokens_get(s).type == TOKEN_COMMA) {
         ExprOp op = EXPR_COMMA;
         tokens_next(s);
 
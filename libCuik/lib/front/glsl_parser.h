@@ -13,7 +13,7 @@ static Cuik_GlslQuals* parse_glsl_qualifiers(Cuik_Parser* restrict parser, Token
     Cuik_GlslQuals* glsl = TB_ARENA_ALLOC(parser->arena, Cuik_GlslQuals);
 
     for (;;) {
-        TknType tkn_type = tokens_get(s)->type;
+        TknType tkn_type = tokens_get(s).type;
         switch (tkn_type) {
             // storage_qualifier
             case TOKEN_KW_in:      tokens_next(s); glsl->storage = CUIK_GLSL_STORAGE_IN; break;
@@ -46,15 +46,15 @@ static Cuik_GlslQuals* parse_glsl_qualifiers(Cuik_Parser* restrict parser, Token
                 SourceLoc opening_loc = tokens_get_location(s);
                 if (!expect_char(s, '(')) goto done;
 
-                while (!tokens_eof(s) && tokens_get(s)->type != ')') {
+                while (!tokens_eof(s) && tokens_get(s).type != ')') {
                     SourceLoc start = tokens_get_location(s);
 
-                    Token* t = tokens_get(s);
-                    Atom key = atoms_put(t->content.length, t->content.data);
+                    Token t = tokens_get(s);
+                    Atom key = atoms_put(t.content.length, t.content.data);
                     tokens_next(s);
 
                     intmax_t value = -1;
-                    if (tokens_get(s)->type == '=') {
+                    if (tokens_get(s).type == '=') {
                         tokens_next(s);
                         value = parse_const_expr(parser, s);
                     }
@@ -72,7 +72,7 @@ static Cuik_GlslQuals* parse_glsl_qualifiers(Cuik_Parser* restrict parser, Token
                         diag_err(s, r, "layout '%s' does not match any options. https://www.khronos.org/opengl/wiki/Layout_Qualifier_(GLSL)", key);
                     }
 
-                    if (tokens_get(s)->type == ',') {
+                    if (tokens_get(s).type == ',') {
                         tokens_next(s);
                         continue;
                     } else {
@@ -96,10 +96,10 @@ static Cuik_Type* parse_glsl_type(Cuik_Parser* restrict parser, TokenStream* res
     Cuik_Type* int_type  = (Cuik_Type*) &parser->target->signed_ints[CUIK_BUILTIN_INT];
     Cuik_Type* uint_type = (Cuik_Type*) &parser->target->unsigned_ints[CUIK_BUILTIN_INT];
 
-    Token* t = tokens_get(s);
+    Token t = tokens_get(s);
     tokens_next(s);
 
-    switch (t->type) {
+    switch (t.type) {
         case TOKEN_KW_void:   return &cuik__builtin_void;
         case TOKEN_KW_Bool:   return &cuik__builtin_bool;
         case TOKEN_KW_uint:   return uint_type;
@@ -128,7 +128,7 @@ static Cuik_Type* parse_glsl_type(Cuik_Parser* restrict parser, TokenStream* res
         case TOKEN_KW_ivec4: return cuik__new_vector2(&parser->types, int_type, 4);
 
         default:
-        diag_err(s, get_token_range(t), "unknown type name. https://www.khronos.org/opengl/wiki/Data_Type_(GLSL)", t->content);
+        diag_err(s, get_token_range(&t), "unknown type name. https://www.khronos.org/opengl/wiki/Data_Type_(GLSL)", t.content);
         return NULL;
     }
 }
@@ -152,7 +152,7 @@ static ParseResult parse_decl_glsl(Cuik_Parser* restrict parser, TokenStream* re
     }
 
     bool is_function = false;
-    while (!tokens_eof(s) && tokens_get(s)->type != ';') {
+    while (!tokens_eof(s) && tokens_get(s).type != ';') {
         Decl decl = parse_declarator_glsl(parser, s, type, false);
 
         // Convert into statement
@@ -196,7 +196,7 @@ static ParseResult parse_decl_glsl(Cuik_Parser* restrict parser, TokenStream* re
 
             // it's a function
             ptrdiff_t expr_start, expr_end;
-            if (tokens_get(s)->type == '{') {
+            if (tokens_get(s).type == '{') {
                 if (cuik_canonical_type(decl.type)->kind != KIND_FUNC) {
                     diag_err(s, decl.loc, "cannot add function body to non-function declaration");
                 }
@@ -204,7 +204,7 @@ static ParseResult parse_decl_glsl(Cuik_Parser* restrict parser, TokenStream* re
                 n->op = STMT_FUNC_DECL;
                 expr_start = skip_brackets(s, decl.loc, false, &expr_end);
                 if (expr_start < 0) {
-                    s->list.current = dyn_array_length(s->list.tokens) - 1;
+                    s->list.current = tokens_length(s) - 1;
                     return PARSE_WIT_ERRORS;
                 }
 
@@ -224,7 +224,7 @@ static ParseResult parse_decl_glsl(Cuik_Parser* restrict parser, TokenStream* re
         if (is_function) {
             // function body
             break;
-        } else if (tokens_get(s)->type == ',') {
+        } else if (tokens_get(s).type == ',') {
             tokens_next(s);
             continue;
         } else {
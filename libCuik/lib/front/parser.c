@@ -7,6 +7,7 @@
 //   - ugly ass code
 #include "parser.h"
 #include "../targets/targets.h"
+#include <futex.h>
 
 // winnt.h loves including garbage
 #undef VOID
@@ -86,16 +87,16 @@ static size_t skip_expression_in_parens(TokenStream* restrict s, TknType* out_te
 
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
+        if (t.type == '\0') {
             *out_terminator = '\0';
             break;
-        } else if (t->type == '(') {
+        } else if (t.type == '(') {
             depth++;
-        } else if (t->type == ')') {
+        } else if (t.type == ')') {
             depth--;
-        } else if (t->type == ',' && depth == 1) {
+        } else if (t.type == ',' && depth == 1) {
             *out_terminator = ',';
             depth--;
         }
@@ -119,17 +120,17 @@ static size_t skip_expression_in_enum(TokenStream* restrict s, TknType* out_term
 
     int depth = 1;
     while (depth) {
-        Token* t = tokens_get(s);
+        Token t = tokens_get(s);
 
-        if (t->type == '\0') {
+        if (t.type == '\0') {
             *out_terminator = '\0';
             break;
-        } else if (t->type == '{') {
+        } else if (t.type == '{') {
             depth++;
-        } else if (t->type == '}' && depth == 1) {
+        } else if (t.type == '}' && depth == 1) {
             *out_terminator = '}';
             break;
-        } else if (t->type == ',' && depth == 1) {
+        } else if (t.type == ',' && depth == 1) {
             break;
         }
 
@@ -225,8 +226,8 @@ static bool expect_char(TokenStream* restrict s, char ch) {
 
         diag_err(s, tokens_get_range(s), "expected '%c', got end-of-file", ch);
         return false;
-    } else if (tokens_get(s)->type != ch) {
-        diag_err(s, tokens_get_range(s), "expected '%c', got '%!S'", ch, tokens_get(s)->content);
+    } else if (tokens_get(s).type != ch) {
+        diag_err(s, tokens_get_range(s), "expected '%c', got '%!S'", ch, tokens_get(s).content);
         return false;
     } else {
         tokens_next(s);
@@ -425,6 +426,15 @@ void cuik_destroy_translation_unit(TranslationUnit* restrict tu) {
     if (!tu->is_free) {
         tu->is_free = true;
         dyn_array_destroy(tu->top_level_stmts);
+        free_type_table(&tu->types);
+
+        if (tu->task_arenas != NULL) {
+            dyn_array_for(i, tu->task_arenas) {
+                tb_arena_destroy(tu->task_arenas[i]);
+                cuik_free(tu->task_arenas[i]);
+            }
+            dyn_array_destroy(tu->task_arenas);
+        }
     }
 
     if (tu->parent == NULL) {
@@ -449,8 +459,8 @@ size_t cuik_num_of_top_level_stmts(TranslationUnit* restrict tu) {
 }
 
 static Symbol* find_symbol(Cuik_Parser* parser, TokenStream* restrict s) {
-    Token* t = tokens_get(s);
-    return cuik_symtab_lookup(parser->symbols, atoms_put(t->content.length, t->content.data));
+    Token t = tokens_get(s);
+    return cuik_symtab_lookup(parser->symbols, atoms_put(t.content.length, t.content.data));
 }
 
 ////////////////////////////////
@@ -464,7 +474,7 @@ static _Noreturn void generic_error(TranslationUnit* tu, TokenStream* restrict s
 }
 
 static bool expect_closing_paren(TokenStream* restrict s, SourceLoc opening) {
-    if (tokens_get(s)->type != ')') {
+    if (tokens_get(s).type != ')') {
         SourceRange loc = tokens_get_range(s);
 
         DiagFixit fixit = { loc, 0, ")" };
@@ -477,7 +487,7 @@ static bool expect_closing_paren(TokenStream* restrict s, SourceLoc opening) {
 }
 
 static bool expect_with_reason(TokenStream* restrict s, char ch, const char* reason) {
-    if (tokens_get(s)->type != ch) {
+    if (tokens_get(s).type != ch) {
         SourceLoc loc = tokens_get_last_location(s);
 
         char fix[2] = { ch, '\0' };
@@ -78,6 +78,10 @@ typedef struct Cuik_TypeTable {
     Cuik_Target* target;
     TB_Arena* arena;
     DynArray(Cuik_Type*) tracked;
+
+    // hash-consed pointer & array types, every copy of the table (the parallel
+    // parse and sema tasks) shares it so it's filled in lock-free.
+    _Atomic(Cuik_Type*)* interned;
 } Cuik_TypeTable;
 
 struct TranslationUnit {
@@ -113,6 +117,10 @@ struct TranslationUnit {
     // DynArray(Stmt*)
     Stmt** top_level_stmts;
 
+    // DynArray(TB_Arena*), when the parser or type checker run in parallel
+    // each task allocates from its own arena rather than the main one.
+    TB_Arena** task_arenas;
+
     mtx_t diag_mutex;
     NL_Strmap(Diag_UnresolvedSymbol*) unresolved_symbols;
 
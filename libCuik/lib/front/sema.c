@@ -255,6 +255,9 @@ static int compute_initializer_bounds(Cuik_Type* type) {
         case KIND_ARRAY:
         return type->array.count;
 
+        case KIND_VECTOR:
+        return type->vector.count;
+
         default:
         return 1;
     }
@@ -345,12 +348,12 @@ static int walk_initializer_layer(TranslationUnit* tu, Cuik_Type* parent, int ba
         relative_offset = search.offset;
         *cursor = search.next_index;
     } else if (node->mode == INIT_ARRAY) {
-        if (parent->kind != KIND_ARRAY) {
+        if (parent->kind != KIND_ARRAY && parent->kind != KIND_VECTOR) {
             diag_err(&tu->tokens, node->loc, "cannot apply array initializer to non-array %!T", parent);
             return 0;
         }
 
-        type = cuik_canonical_type(parent->array.of);
+        type = parent->kind == KIND_VECTOR ? parent->vector.base : cuik_canonical_type(parent->array.of);
         relative_offset = node->start * type->size;
         *cursor = node->start + node->count;
     } else {
@@ -379,6 +382,10 @@ static int walk_initializer_layer(TranslationUnit* tu, Cuik_Type* parent, int ba
         } else if (parent->kind == KIND_ARRAY) {
             type = cuik_canonical_type(parent->array.of);
             relative_offset = (*cursor - 1) * type->size;
+        } else if (parent->kind == KIND_VECTOR) {
+            // vectors are filled lane by lane like arrays
+            type = parent->vector.base;
+            relative_offset = (*cursor - 1) * type->size;
         } else {
             type = parent;
         }
@@ -480,7 +487,7 @@ static int walk_initializer_layer(TranslationUnit* tu, Cuik_Type* parent, int ba
                 walk_initializer_layer(tu, type, pos, member_count, n, &kid_cursor, &kid_max_cursor);
                 n = n->next;
             }
-        } else if (type->kind == KIND_ARRAY) {
+        } else if (type->kind == KIND_ARRAY || type->kind == KIND_VECTOR) {
             int array_count = compute_initializer_bounds(type);
             for (int i = 0; i < node_count; i++) {
                 assert(n != NULL);
@@ -884,6 +891,13 @@ Cuik_QualType cuik__sema_expr_OLD(TranslationUnit* tu, Expr* restrict e) {
                 SWAP(Expr*, e->subscript.base, e->subscript.index);
             }
 
+            if (base->kind == KIND_VECTOR) {
+                // vector subscripts pick a lane
+                e->subscript.base->cast_type = cuik_uncanonical_type(base);
+                e->subscript.index->cast_type = cuik_uncanonical_type(&tu->target->signed_ints[CUIK_BUILTIN_LLONG]);
+                return (e->type = cuik_uncanonical_type(base->vector.base));
+            }
+
             if (base->kind == KIND_ARRAY) {
                 base = cuik__new_pointer(&tu->types, base->array.of);
             }
@@ -1073,6 +1087,66 @@ static Cuik_Type* sema_builtin(TranslationUnit* tu, Cuik_Expr* restrict _, const
     return ret_type;
 }
 
+// the lane indices get baked into the shuffle so they have to be literals
+static bool sema_shufflevector(TranslationUnit* tu, Cuik_Expr* restrict _, Subexpr* restrict e, Cuik_Type* vec, int arg_count, size_t* args) {
+    if (vec->kind != KIND_VECTOR) {
+        diag_err(&tu->tokens, GET_EXPR(1).loc, "__builtin_shufflevector expects vectors (got %!T)", vec);
+        return false;
+    }
+
+    int lanes = vec->vector.count;
+    if (arg_count - 3 != lanes) {
+        diag_err(&tu->tokens, e->loc, "__builtin_shufflevector can't change the lane count (expected %d indices, got %d)", lanes, arg_count - 3);
+        return false;
+    }
+
+    for (int i = 3; i < arg_count; i++) {
+        Subexpr* arg = &GET_EXPR(i);
+        if (arg->op != EXPR_INT) {
+            diag_err(&tu->tokens, arg->loc, "__builtin_shufflevector indices must be integer constants");
+            return false;
+        }
+
+        if (arg->int_lit.lit >= 2*lanes) {
+            diag_err(&tu->tokens, arg->loc, "__builtin_shufflevector index is out of range (%llu, expected less than %d)", (unsigned long long) arg->int_lit.lit, 2*lanes);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// SSE doesn't have integer division and the float ops don't do bit twiddling
+static bool sema_vector_binop(TranslationUnit* tu, Subexpr* restrict e, Cuik_Type* vec) {
+    Cuik_Type* base = vec->vector.base;
+    ExprOp op = e->op;
+    switch (op) {
+        case EXPR_PLUS_ASSIGN:    op = EXPR_PLUS;    break;
+        case EXPR_MINUS_ASSIGN:   op = EXPR_MINUS;   break;
+        case EXPR_TIMES_ASSIGN:   op = EXPR_TIMES;   break;
+        case EXPR_SLASH_ASSIGN:   op = EXPR_SLASH;   break;
+        case EXPR_PERCENT_ASSIGN: op = EXPR_PERCENT; break;
+        case EXPR_AND_ASSIGN:     op = EXPR_AND;     break;
+        case EXPR_OR_ASSIGN:      op = EXPR_OR;      break;
+        case EXPR_XOR_ASSIGN:     op = EXPR_XOR;     break;
+        case EXPR_SHL_ASSIGN:     op = EXPR_SHL;     break;
+        case EXPR_SHR_ASSIGN:     op = EXPR_SHR;     break;
+        default: break;
+    }
+
+    if (cuik_type_is_float(base)) {
+        if (op == EXPR_PERCENT || op == EXPR_SHL || op == EXPR_SHR) {
+            diag_err(&tu->tokens, e->loc, "cannot apply shifts or modulo to floating point vector %!T", vec);
+            return false;
+        }
+    } else if (op == EXPR_SLASH || op == EXPR_PERCENT) {
+        diag_err(&tu->tokens, e->loc, "integer vector division isn't supported yet (%!T)", vec);
+        return false;
+    }
+
+    return true;
+}
+
 Cuik_QualType cuik__sema_subexpr(TranslationUnit* tu, Cuik_Expr* restrict _, Subexpr* restrict e, int arity, size_t* args) {
     switch (e->op) {
         case EXPR_INT: {
@@ -1294,6 +1368,12 @@ Cuik_QualType cuik__sema_subexpr(TranslationUnit* tu, Cuik_Expr* restrict _, Sub
                     tu, _, tu->target->builtin_func_map[search].v, arg_count + 1, args
                 );
 
+                if (ty != NULL && strcmp(name, "__builtin_shufflevector") == 0) {
+                    if (!sema_shufflevector(tu, _, e, ty, arg_count + 1, args)) {
+                        return CUIK_QUAL_TYPE_NULL;
+                    }
+                }
+
                 return cuik_uncanonical_type(ty);
             } else if (target->op == EXPR_CONSTRUCTOR) {
                 Cuik_Type* vector_base = func_type->kind == KIND_VECTOR ? func_type->vector.base  : func_type;
@@ -1580,6 +1660,13 @@ Cuik_QualType cuik__sema_subexpr(TranslationUnit* tu, Cuik_Expr* restrict _, Sub
                 SWAP(size_t, args[0], args[1]);
             }
 
+            if (base->kind == KIND_VECTOR) {
+                // vector subscripts pick a lane
+                SET_CAST(0, GET_TYPE(0));
+                SET_CAST(1, cuik_uncanonical_type(&tu->target->ptrdiff_type));
+                return cuik_uncanonical_type(base->vector.base);
+            }
+
             if (base->kind == KIND_ARRAY) {
                 base = cuik__new_pointer(&tu->types, base->array.of);
             }
@@ -1655,6 +1742,10 @@ Cuik_QualType cuik__sema_subexpr(TranslationUnit* tu, Cuik_Expr* restrict _, Sub
                         diag_err(&tu->tokens, e->loc, "cannot apply binary operator to %!T and %!T", lhs, rhs);
                     }
 
+                    if (!sema_vector_binop(tu, e, lhs)) {
+                        return CUIK_QUAL_TYPE_NULL;
+                    }
+
                     Cuik_QualType type = cuik_uncanonical_type(lhs);
                     SET_CAST(0, type);
                     SET_CAST(1, type);
@@ -1732,6 +1823,11 @@ Cuik_QualType cuik__sema_subexpr(TranslationUnit* tu, Cuik_Expr* restrict _, Sub
 
             SET_CAST(0, lhs);
 
+            Cuik_Type* lhs_type = cuik_canonical_type(lhs);
+            if (e->op != EXPR_ASSIGN && lhs_type->kind == KIND_VECTOR && !sema_vector_binop(tu, e, lhs_type)) {
+                return CUIK_QUAL_TYPE_NULL;
+            }
+
             if (e->op == EXPR_PLUS_ASSIGN && cuik_type_is_pointer(cuik_canonical_type(lhs))) {
                 // pointer arithmatic
                 SET_CAST(1, cuik_uncanonical_type(&tu->target->ptrdiff_type));
@@ -2122,6 +2218,111 @@ static void sema_mark_decl(TranslationUnit* tu, Stmt* restrict s) {
     }
 }
 
+// type checking is handed out in batches of about this many function bodies
+enum { SEMA_FUNCS_PER_BATCH = 32 };
+
+typedef struct {
+    // shallow copy of the real TU, it just has its own arena and diagnostics
+    TranslationUnit tu;
+    TB_Arena arena;
+
+    size_t start, end;
+    bool* presolved;
+
+    Futex* remaining;
+} SemaTask;
+
+static void sema_task(void* arg) {
+    SemaTask* task = *((SemaTask**) arg);
+
+    for (size_t i = task->start; i < task->end; i++) {
+        if (!task->presolved[i]) {
+            sema_top_level(&task->tu, task->tu.top_level_stmts[i]);
+        }
+    }
+
+    futex_dec(task->remaining);
+}
+
+static bool sema_needs_body(Stmt* s) {
+    return s->op == STMT_FUNC_DECL && s->decl.attrs.is_used;
+}
+
+static void sema_parallel(TranslationUnit* restrict tu, Cuik_IThreadpool* restrict thread_pool, size_t count) {
+    // split into contiguous batches so we can join the diagnostics back in source order
+    DynArray(SemaTask*) tasks = dyn_array_create(SemaTask*, 16);
+    bool* presolved = cuik_calloc(count, sizeof(bool));
+    Futex remaining = 0;
+
+    size_t start = 0, bodies_in_batch = 0;
+    for (size_t i = 0; i < count; i++) {
+        bodies_in_batch += sema_needs_body(tu->top_level_stmts[i]);
+        if (bodies_in_batch >= SEMA_FUNCS_PER_BATCH || i + 1 == count) {
+            SemaTask* task = cuik_malloc(sizeof(SemaTask));
+            *task = (SemaTask){
+                .tu = *tu,
+                .start = start,
+                .end = i + 1,
+                .presolved = presolved,
+                .remaining = &remaining,
+            };
+
+            tb_arena_create(&task->arena, TB_ARENA_MEDIUM_CHUNK_SIZE);
+            task->tu.arena = task->tu.types.arena = &task->arena;
+            task->tu.tokens.diag = cuikdg_fork(tu->tokens.diag);
+            dyn_array_put(tasks, task);
+
+            start = i + 1, bodies_in_batch = 0;
+        }
+    }
+
+    // function bodies will resolve incomplete global arrays on demand, that's
+    // a write to a shared declaration so we'll get those out of the way first.
+    dyn_array_for(i, tasks) {
+        SemaTask* task = tasks[i];
+        for (size_t j = task->start; j < task->end; j++) {
+            Stmt* s = tu->top_level_stmts[j];
+            if (s->op == STMT_FUNC_DECL || !s->decl.attrs.is_used) continue;
+
+            Cuik_Type* type = cuik_canonical_type(s->decl.type);
+            if (type->kind == KIND_ARRAY && type->size == 0) {
+                sema_top_level(&task->tu, s);
+                presolved[j] = true;
+            }
+        }
+    }
+
+    remaining = dyn_array_length(tasks);
+    dyn_array_for(i, tasks) {
+        CUIK_CALL(thread_pool, submit, sema_task, sizeof(SemaTask*), &tasks[i]);
+    }
+
+    // help out while we wait (we might be running on a pool thread) and
+    // sleep once the rest of the tasks are all taken.
+    for (Futex cur; (cur = remaining) != 0;) {
+        if (!CUIK_CALL(thread_pool, work_one_job)) {
+            futex_wait(&remaining, cur);
+        }
+    }
+
+    if (tu->task_arenas == NULL) {
+        tu->task_arenas = dyn_array_create(TB_Arena*, dyn_array_length(tasks));
+    }
+
+    dyn_array_for(i, tasks) {
+        SemaTask* task = tasks[i];
+        cuikdg_join(tu->tokens.diag, task->tu.tokens.diag);
+
+        // types made during type checking live in here
+        TB_Arena* arena = cuik_malloc(sizeof(TB_Arena));
+        *arena = task->arena;
+        dyn_array_put(tu->task_arenas, arena);
+        cuik_free(task);
+    }
+    dyn_array_destroy(tasks);
+    cuik_free(presolved);
+}
+
 int cuiksema_run(TranslationUnit* restrict tu, Cuik_IThreadpool* restrict thread_pool) {
     size_t count = dyn_array_length(tu->top_level_stmts);
 
@@ -2150,10 +2351,18 @@ int cuiksema_run(TranslationUnit* restrict tu, Cuik_IThreadpool* restrict thread
     }
 
     // go through all top level statements and type check
-    // NOTE(NeGate): we can multithread this... it's not helpful tho
     CUIK_TIMED_BLOCK("sema: type check") {
+        size_t body_count = 0;
         for (size_t i = 0; i < count; i++) {
-            sema_top_level(tu, tu->top_level_stmts[i]);
+            body_count += sema_needs_body(tu->top_level_stmts[i]);
+        }
+
+        if (thread_pool != NULL && body_count > SEMA_FUNCS_PER_BATCH) {
+            sema_parallel(tu, thread_pool, count);
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                sema_top_level(tu, tu->top_level_stmts[i]);
+            }
         }
     }
 
@@ -14,7 +14,7 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
 
     if (parse_pragma(parser, s) != 0) {
         return true;
-    } else if (tokens_get(s)->type == ';') {
+    } else if (tokens_get(s).type == ';') {
         tokens_next(s);
         return true;
     } else if (is_typename(parser, s)) {
@@ -39,7 +39,7 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
             type = cuik_uncanonical_type(parser->default_int);
         }
 
-        while (!tokens_eof(s) && tokens_get(s)->type != ';') {
+        while (!tokens_eof(s) && tokens_get(s).type != ';') {
             Decl decl = is_glsl
                 ? parse_declarator_glsl(parser, s, type, false)
                 : parse_declarator2(parser, s, type, false);
@@ -72,7 +72,7 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
             }
 
             Cuik_Expr* e = NULL;
-            if (tokens_get(s)->type == '=') {
+            if (tokens_get(s).type == '=') {
                 if (n->decl.attrs.is_inline) {
                     diag_err(s, decl.loc, "non-function declarations cannot be inline");
                 }
@@ -84,7 +84,7 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
                     diag_err(s, decl.loc, "typedef cannot have initial expression");
                 }
 
-                if (tokens_get(s)->type == '{') {
+                if (tokens_get(s).type == '{') {
                     parse_initializer2(parser, s, CUIK_QUAL_TYPE_NULL);
                 } else {
                     parse_assignment(parser, s);
@@ -93,7 +93,7 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
             }
             n->decl.initial = e;
 
-            if (tokens_get(s)->type == ',') {
+            if (tokens_get(s).type == ',') {
                 tokens_next(s);
                 continue;
             } else {
@@ -119,11 +119,11 @@ static bool parse_decl_or_expr2(Cuik_Parser* parser, TokenStream* restrict s, si
 
         if (start_tkn == s->list.current) {
             tokens_next(s);
-        } else if (tokens_get(s)->type != ';' && start_tkn+1 == s->list.current) {
+        } else if (tokens_get(s).type != ';' && start_tkn+1 == s->list.current) {
             diag_err(s, loc, "unknown typename");
 
             // error recovery, skip until ;
-            while (!tokens_eof(s) && tokens_get(s)->type != ';') tokens_next(s);
+            while (!tokens_eof(s) && tokens_get(s).type != ';') tokens_next(s);
             return PARSE_WIT_ERRORS;
         } else if (!expect_with_reason(s, ';', "expression")) {
             return PARSE_WIT_ERRORS;
@@ -140,8 +140,8 @@ static void parse_compound_stmt2(Cuik_Parser* parser, TokenStream* restrict s, S
         size_t kid_count = 0;
         Stmt** kids = tls_save();
 
-        while (tokens_get(s)->type != '}') {
-            if (tokens_get(s)->type == ';') {
+        while (tokens_get(s).type != '}') {
+            if (tokens_get(s).type == ';') {
                 tokens_next(s);
             } else {
                 Stmt* stmt = parse_stmt2(parser, s);
@@ -175,7 +175,7 @@ static ParseResult parse_stmt_or_expr2(Cuik_Parser* parser, TokenStream* restric
     if (p != 0) {
         *out_result = NULL;
         return p;
-    } else if (tokens_get(s)->type == ';') {
+    } else if (tokens_get(s).type == ';') {
         tokens_next(s);
         *out_result = NULL;
         return PARSE_SUCCESS;
@@ -212,24 +212,24 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
     // _Static_assert doesn't produce a statement, handle these first.
     // label declarations only produce a new statement if they haven't been used yet.
     SourceLoc start = tokens_get_location(s);
-    while (tokens_get(s)->type == TOKEN_KW_Static_assert) {
+    while (tokens_get(s).type == TOKEN_KW_Static_assert) {
         tokens_next(s);
         expect_char(s, '(');
 
         intmax_t condition = parse_const_expr(parser, s);
         SourceLoc end = tokens_get_last_location(s);
 
-        if (tokens_get(s)->type == ',') {
+        if (tokens_get(s).type == ',') {
             tokens_next(s);
 
-            Token* t = tokens_get(s);
-            if (t->type != TOKEN_STRING_DOUBLE_QUOTE) {
-                diag_err(s, get_token_range(t), "static assertion expects string literal");
+            Token t = tokens_get(s);
+            if (t.type != TOKEN_STRING_DOUBLE_QUOTE) {
+                diag_err(s, get_token_range(&t), "static assertion expects string literal");
             }
             tokens_next(s);
 
             if (condition == 0) {
-                diag_err(s, (SourceRange){ start, end }, "static assertion failed! %.*s", (int) t->content.length, t->content.data);
+                diag_err(s, (SourceRange){ start, end }, "static assertion failed! %.*s", (int) t.content.length, t.content.data);
             }
         } else {
             if (condition == 0) {
@@ -243,7 +243,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
 
     Stmt* n = NULL;
     SourceLoc loc_start = tokens_get_location(s);
-    TknType peek = tokens_get(s)->type;
+    TknType peek = tokens_get(s).type;
     if (peek == '{') {
         tokens_next(s);
 
@@ -254,7 +254,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
         tokens_next(s);
 
         Cuik_Expr* e = NULL;
-        if (tokens_get(s)->type != ';') {
+        if (tokens_get(s).type != ';') {
             e = parse_expr2(parser, s);
         }
 
@@ -283,7 +283,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
             }
 
             Stmt* next = NULL;
-            if (tokens_get(s)->type == TOKEN_KW_else) {
+            if (tokens_get(s).type == TOKEN_KW_else) {
                 tokens_next(s);
 
                 LOCAL_SCOPE {
@@ -330,7 +330,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
 
         intmax_t key = parse_const_expr(parser, s);
         intmax_t key_max = key;
-        if (tokens_get(s)->type == TOKEN_TRIPLE_DOT) {
+        if (tokens_get(s).type == TOKEN_TRIPLE_DOT) {
             // GNU extension, case ranges
             tokens_next(s);
             key_max = parse_const_expr(parser, s);
@@ -446,7 +446,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
 
             // it's either nothing, a declaration, or an expression
             Stmt* first = NULL;
-            if (tokens_get(s)->type == ';') {
+            if (tokens_get(s).type == ';') {
                 /* nothing */
                 tokens_next(s);
             } else {
@@ -470,7 +470,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
             }
 
             Cuik_Expr* cond = NULL;
-            if (tokens_get(s)->type == ';') {
+            if (tokens_get(s).type == ';') {
                 /* nothing */
                 tokens_next(s);
             } else {
@@ -479,7 +479,7 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
             }
 
             Cuik_Expr* next = NULL;
-            if (tokens_get(s)->type == ')') {
+            if (tokens_get(s).type == ')') {
                 /* nothing */
                 tokens_next(s);
             } else {
@@ -528,10 +528,10 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
                 current_continuable = old_continuable;
             }
 
-            if (tokens_get(s)->type != TOKEN_KW_while) {
-                Token* t = tokens_get(s);
+            if (tokens_get(s).type != TOKEN_KW_while) {
+                Token t = tokens_get(s);
 
-                diag_err(s, get_token_range(t), "expected 'while' got '%.*s'", (int)t->content.length, t->content.data);
+                diag_err(s, get_token_range(&t), "expected 'while' got '%.*s'", (int)t.content.length, t.content.data);
             }
             tokens_next(s);
 
@@ -556,14 +556,14 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
         tokens_next(s);
 
         // read label name
-        Token* t = tokens_get(s);
-        SourceRange loc = get_token_range(t);
-        if (t->type != TOKEN_IDENTIFIER) {
+        Token t = tokens_get(s);
+        SourceRange loc = get_token_range(&t);
+        if (t.type != TOKEN_IDENTIFIER) {
             diag_err(s, loc, "expected identifier for goto target name");
             return n;
         }
 
-        Atom name = atoms_put(t->content.length, t->content.data);
+        Atom name = atoms_put(t.content.length, t.content.data);
 
         // skip to the semicolon
         tokens_next(s);
@@ -595,11 +595,11 @@ static Stmt* parse_stmt2(Cuik_Parser* parser, TokenStream* restrict s) {
         };
 
         expect_with_reason(s, ';', "goto");
-    } else if (peek == TOKEN_IDENTIFIER && tokens_peek(s)->type == TOKEN_COLON) {
+    } else if (peek == TOKEN_IDENTIFIER && tokens_peek(s).type == TOKEN_COLON) {
         // label amirite
         // IDENTIFIER COLON STMT
-        Token* t = tokens_get(s);
-        Atom name = atoms_put(t->content.length, t->content.data);
+        Token t = tokens_get(s);
+        Atom name = atoms_put(t.content.length, t.content.data);
 
         ptrdiff_t search = nl_map_get_cstr(labels, name);
         if (search >= 0) {
@@ -1,22 +1,22 @@
 static ParseResult parse_pragma(Cuik_Parser* restrict parser, TokenStream* restrict s) {
-    if (tokens_get(s)->type != TOKEN_KW_Pragma) {
+    if (tokens_get(s).type != TOKEN_KW_Pragma) {
         return NO_PARSE;
     }
 
     tokens_next(s);
     if (!expect_char(s, '(')) return PARSE_WIT_ERRORS;
 
-    if (tokens_get(s)->type != TOKEN_STRING_DOUBLE_QUOTE) {
+    if (tokens_get(s).type != TOKEN_STRING_DOUBLE_QUOTE) {
         diag_err(s, tokens_get_range(s), "pragma declaration expects string literal");
         return PARSE_WIT_ERRORS;
     }
 
     // Slap it into a proper C string so we don't accidentally
     // walk off the end and go random places
-    size_t len = (tokens_get(s)->content.length) - 1;
+    size_t len = (tokens_get(s).content.length) - 1;
     unsigned char* out = tls_push(len);
     {
-        const char* in = (const char*) tokens_get(s)->content.data;
+        const char* in = (const char*) tokens_get(s).content.data;
 
         size_t out_i = 0, in_i = 1;
         while (in_i < len) {
@@ -94,7 +94,7 @@ static ParseResult parse_pragma(Cuik_Parser* restrict parser, TokenStream* restr
 }
 
 static ParseResult parse_static_assert(Cuik_Parser* restrict parser, TokenStream* restrict s) {
-    if (tokens_get(s)->type != TOKEN_KW_Static_assert) {
+    if (tokens_get(s).type != TOKEN_KW_Static_assert) {
         return NO_PARSE;
     }
 
@@ -106,12 +106,12 @@ static ParseResult parse_static_assert(Cuik_Parser* restrict parser, TokenStream
     dyn_array_put(parser->static_assertions, current);
 
     tokens_prev(s);
-    if (tokens_get(s)->type == ',') {
+    if (tokens_get(s).type == ',') {
         tokens_next(s);
 
-        Token* t = tokens_get(s);
-        if (t->type != TOKEN_STRING_DOUBLE_QUOTE) {
-            diag_err(s, get_token_range(t), "expected string literal");
+        Token t = tokens_get(s);
+        if (t.type != TOKEN_STRING_DOUBLE_QUOTE) {
+            diag_err(s, get_token_range(&t), "expected string literal");
         }
         tokens_next(s);
     } else {
@@ -153,7 +153,7 @@ static ParseResult parse_decl(Cuik_Parser* restrict parser, TokenStream* restric
     // init-declarator:
     //   declarator ('=' initializer)?
     bool has_semicolon = true;
-    while (!tokens_eof(s) && tokens_get(s)->type != ';') {
+    while (!tokens_eof(s) && tokens_get(s).type != ';') {
         size_t start_decl_token = s->list.current;
         Decl decl = parse_declarator2(parser, s, type, false);
 
@@ -211,7 +211,7 @@ static ParseResult parse_decl(Cuik_Parser* restrict parser, TokenStream* restric
             if (decl.name != NULL) {
                 // declaration endings
                 ptrdiff_t expr_start, expr_end;
-                if (tokens_get(s)->type == '=') {
+                if (tokens_get(s).type == '=') {
                     // initializer:
                     //   assignment-expression
                     //   '{' initializer-list '}'
@@ -226,13 +226,13 @@ static ParseResult parse_decl(Cuik_Parser* restrict parser, TokenStream* restric
                     }
                     n->decl.attrs.is_root = !attr.is_extern && !attr.is_static;
 
-                    if (tokens_get(s)->type == '{') {
+                    if (tokens_get(s).type == '{') {
                         expr_start = skip_brackets(s, decl.loc, true, &expr_end);
                     } else {
                         expr_start = skip_expression_in_list(s, decl.loc, &expr_end);
                     }
                     has_body = true;
-                } else if (tokens_get(s)->type == '{') {
+                } else if (tokens_get(s).type == '{') {
                     if (cuik_canonical_type(decl.type)->kind != KIND_FUNC) {
                         diag_err(s, decl.loc, "cannot add function body to non-function declaration");
                     }
@@ -241,7 +241,7 @@ static ParseResult parse_decl(Cuik_Parser* restrict parser, TokenStream* restric
                     n->decl.attrs.is_root = attr.is_tls || !(attr.is_static || attr.is_inline);
                     expr_start = skip_brackets(s, decl.loc, false, &expr_end);
                     if (expr_start < 0) {
-                        s->list.current = dyn_array_length(s->list.tokens) - 1;
+                        s->list.current = tokens_length(s) - 1;
                         return PARSE_WIT_ERRORS;
                     }
 
@@ -349,7 +349,7 @@ static ParseResult parse_decl(Cuik_Parser* restrict parser, TokenStream* restric
         if (!has_semicolon) {
             // function body
             break;
-        } else if (tokens_get(s)->type == ',') {
+        } else if (tokens_get(s).type == ',') {
             tokens_next(s);
             continue;
         } else {
@@ -417,7 +417,219 @@ static Cuik_Entrypoint check_for_entry(Cuik_Parser* parser) {
     return CUIK_ENTRYPOINT_MAIN;
 }
 
-Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cuik_Target* target, TB_Arena* restrict arena, bool only_code_index) {
+// function bodies are handed out in batches of about this many tokens, small
+// functions are cheap enough that we don't want a job for each one.
+enum { PARSE_FUNC_MUNCH_SIZE = 16384 };
+
+typedef struct {
+    Cuik_Parser parser;
+    TB_Arena arena;
+
+    size_t count;
+    Symbol** syms;
+
+    Futex* remaining;
+} ParseFuncTask;
+
+static int compare_func_pos(const void* a, const void* b) {
+    const Symbol* sym_a = *(const Symbol**) a;
+    const Symbol* sym_b = *(const Symbol**) b;
+    return (sym_a->token_start > sym_b->token_start) - (sym_a->token_start < sym_b->token_start);
+}
+
+static void parse_func_body(Cuik_Parser* restrict parser, TokenStream* restrict tokens, Symbol* sym) {
+    // Spin up a mini parser here
+    tokens->list.current = sym->token_start;
+
+    // intitialize use list
+    symbol_chain_start = NULL;
+
+    // Some sanity checks in case a local symbol is acting funny.
+    cuik_scope_open(parser->symbols), cuik_scope_open(parser->tags);
+    parse_function(parser, tokens, sym->stmt);
+    cuik_scope_close(parser->symbols), cuik_scope_close(parser->tags);
+
+    // finalize use list
+    sym->stmt->decl.first_symbol = symbol_chain_start;
+}
+
+static void parse_func_task(void* arg) {
+    ParseFuncTask* task = *((ParseFuncTask**) arg);
+    tls_init();
+
+    TokenStream tokens = task->parser.tokens;
+    for (size_t i = 0; i < task->count; i++) {
+        parse_func_body(&task->parser, &tokens, task->syms[i]);
+    }
+
+    futex_dec(task->remaining);
+}
+
+// funcs should be sorted by position, if we've got a thread pool they'll be split
+// into batches and parsed in parallel.
+static void parse_func_bodies(Cuik_Parser* restrict parser, Cuik_IThreadpool* restrict thread_pool, size_t func_count, Symbol** funcs) {
+    if (thread_pool != NULL && func_count > 1) {
+        // split the functions into batches of roughly equal token counts
+        DynArray(ParseFuncTask*) tasks = dyn_array_create(ParseFuncTask*, 16);
+        Futex remaining = 0;
+
+        size_t start = 0, tokens_in_batch = 0;
+        for (size_t i = 0; i < func_count; i++) {
+            tokens_in_batch += funcs[i]->token_end - funcs[i]->token_start;
+            if (tokens_in_batch >= PARSE_FUNC_MUNCH_SIZE || i + 1 == func_count) {
+                ParseFuncTask* task = cuik_malloc(sizeof(ParseFuncTask));
+                *task = (ParseFuncTask){
+                    .parser = *parser,
+                    .count = (i + 1) - start,
+                    .syms = &funcs[start],
+                    .remaining = &remaining,
+                };
+
+                // everything the task writes into goes somewhere private, we'll
+                // stitch it back together once they're all done.
+                tb_arena_create(&task->arena, TB_ARENA_MEDIUM_CHUNK_SIZE);
+                task->parser.arena = task->parser.types.arena = &task->arena;
+                task->parser.symbols = cuik_symtab_fork(parser->symbols);
+                task->parser.tags = cuik_symtab_fork(parser->tags);
+                task->parser.top_level_stmts = dyn_array_create(Stmt*, 16);
+                task->parser.unresolved_symbols = NULL;
+                task->parser.expr = NULL;
+                task->parser.tokens.diag = cuikdg_fork(parser->tokens.diag);
+                task->parser.tokens.diag->parser = &task->parser;
+                dyn_array_put(tasks, task);
+
+                start = i + 1, tokens_in_batch = 0;
+            }
+        }
+
+        remaining = dyn_array_length(tasks);
+        dyn_array_for(i, tasks) {
+            CUIK_CALL(thread_pool, submit, parse_func_task, sizeof(ParseFuncTask*), &tasks[i]);
+        }
+
+        // help out while we wait (we might be running on a pool thread) and
+        // sleep once the rest of the batches are all taken.
+        for (Futex cur; (cur = remaining) != 0;) {
+            if (!CUIK_CALL(thread_pool, work_one_job)) {
+                futex_wait(&remaining, cur);
+            }
+        }
+
+        // join in the same order we split so the diagnostics come out
+        // just like they would in a single-threaded run.
+        if (parser->tu->task_arenas == NULL) {
+            parser->tu->task_arenas = dyn_array_create(TB_Arena*, dyn_array_length(tasks));
+        }
+        dyn_array_for(i, tasks) {
+            ParseFuncTask* task = tasks[i];
+            cuikdg_join(parser->tokens.diag, task->parser.tokens.diag);
+
+            nl_map_for_str(j, task->parser.unresolved_symbols) {
+                Diag_UnresolvedSymbol* loc = task->parser.unresolved_symbols[j].v;
+
+                ptrdiff_t search = nl_map_get_cstr(parser->unresolved_symbols, loc->name);
+                if (search < 0) {
+                    nl_map_puti_cstr(parser->unresolved_symbols, loc->name, search);
+                    parser->unresolved_symbols[search].v = loc;
+                } else {
+                    Diag_UnresolvedSymbol* old = parser->unresolved_symbols[search].v;
+                    while (old->next != NULL) old = old->next;
+
+                    old->next = loc;
+                }
+            }
+            nl_map_free(task->parser.unresolved_symbols);
+
+            dyn_array_for(j, task->parser.top_level_stmts) {
+                dyn_array_put(parser->top_level_stmts, task->parser.top_level_stmts[j]);
+            }
+            dyn_array_destroy(task->parser.top_level_stmts);
+
+            cuik_symtab_destroy(task->parser.symbols);
+            cuik_symtab_destroy(task->parser.tags);
+
+            // the AST lives in here so the TU needs to hold onto it
+            TB_Arena* arena = cuik_malloc(sizeof(TB_Arena));
+            *arena = task->arena;
+            dyn_array_put(parser->tu->task_arenas, arena);
+            cuik_free(task);
+        }
+        dyn_array_destroy(tasks);
+    } else {
+        TokenStream tokens = parser->tokens;
+        for (size_t i = 0; i < func_count; i++) {
+            parse_func_body(parser, &tokens, funcs[i]);
+        }
+    }
+}
+
+static void reach_decl(DynArray(Stmt*)* stack, Stmt* s) {
+    if ((s->flags & STMT_FLAGS_IS_REACHED) == 0) {
+        s->flags |= STMT_FLAGS_IS_REACHED;
+        dyn_array_put(*stack, s);
+    }
+}
+
+static void reach_uses(DynArray(Stmt*)* stack, Cuik_Expr* e) {
+    for (; e != NULL; e = e->next_in_chain) {
+        for (ptrdiff_t i = e->first_symbol; i >= 0; i = e->exprs[i].sym.next_symbol) {
+            reach_decl(stack, e->exprs[i].sym.stmt);
+        }
+    }
+}
+
+// walks the same use lists as sema_mark_decl except function bodies are only parsed
+// once something reachable refers to them, we do this in waves so that each one can
+// still be parsed in parallel. funcs is all the functions with bodies, it's reused
+// to hold the waves.
+static void parse_reachable_funcs(Cuik_Parser* restrict parser, Cuik_IThreadpool* restrict thread_pool, DynArray(Symbol*) funcs) {
+    // we need the symbols to find the bodies
+    NL_Map(Stmt*, Symbol*) bodies = NULL;
+    nl_map_create(bodies, dyn_array_length(funcs));
+    dyn_array_for(i, funcs) {
+        nl_map_put(bodies, funcs[i]->stmt, funcs[i]);
+    }
+    dyn_array_clear(funcs);
+
+    DynArray(Stmt*) stack = dyn_array_create(Stmt*, 256);
+    dyn_array_for(i, parser->top_level_stmts) {
+        Stmt* s = parser->top_level_stmts[i];
+        if (s->decl.attrs.is_root) {
+            reach_decl(&stack, s);
+        }
+    }
+
+    for (;;) {
+        while (dyn_array_length(stack) > 0) {
+            Stmt* s = dyn_array_pop(stack);
+            ptrdiff_t search = nl_map_get(bodies, s);
+            if (search >= 0) {
+                dyn_array_put(funcs, bodies[search].v);
+            } else {
+                // globals had their initializers parsed back in phase 2
+                reach_uses(&stack, s->decl.first_symbol);
+            }
+        }
+
+        size_t wave_count = dyn_array_length(funcs);
+        if (wave_count == 0) {
+            break;
+        }
+
+        qsort(funcs, wave_count, sizeof(Symbol*), compare_func_pos);
+        parse_func_bodies(parser, thread_pool, wave_count, funcs);
+
+        dyn_array_for(i, funcs) {
+            reach_uses(&stack, funcs[i]->stmt->decl.first_symbol);
+        }
+        dyn_array_clear(funcs);
+    }
+
+    dyn_array_destroy(stack);
+    nl_map_free(bodies);
+}
+
+Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cuik_Target* target, TB_Arena* restrict arena, Cuik_IThreadpool* restrict thread_pool, Cuik_ParseMode mode) {
     assert(s != NULL);
 
     tls_init();
@@ -458,7 +670,7 @@ Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cu
     CUIK_TIMED_BLOCK("phase 1") {
         while (!tokens_eof(s)) {
             // skip any top level "null" statements
-            while (tokens_get(s)->type == ';') tokens_next(s);
+            while (tokens_get(s).type == ';') tokens_next(s);
 
             if (parse_pragma(&parser, s) != 0) continue;
             if (parse_static_assert(&parser, s) != 0) continue;
@@ -478,6 +690,16 @@ Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cu
         }
 
         parser.is_in_global_scope = false;
+
+        // everything past this point wants the whole stream (the preprocessor
+        // might've already failed in which case we report that instead)
+        if (s->pipe != NULL && !cuikpp_pipe_sync(s)) {
+            cuikdg_tally_error(s);
+        }
+
+        if (parser.tokens.pipe != NULL) {
+            cuikpp_pipe_sync(&parser.tokens);
+        }
     }
     THROW_IF_ERROR();
 
@@ -497,7 +719,7 @@ Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cu
 
     parser.tu->entrypoint_status = check_for_entry(&parser);
 
-    if (only_code_index) {
+    if (mode == CUIK_PARSE_CODE_INDEX) {
         return (Cuik_ParseResult){ .tu = parser.tu, .imports = parser.import_libs };
     }
 
@@ -534,7 +756,7 @@ Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cu
                 // intitialize use list
                 symbol_chain_start = NULL;
 
-                if (tokens_get(&mini_lex)->type == '{') {
+                if (tokens_get(&mini_lex).type == '{') {
                     parse_initializer2(&parser, &mini_lex, CUIK_QUAL_TYPE_NULL);
                 } else {
                     parse_assignment(&parser, &mini_lex);
@@ -576,34 +798,36 @@ Cuik_ParseResult cuikparse_run(Cuik_Version version, TokenStream* restrict s, Cu
         Cuik_Atom va_arg_gp = atoms_putc("__va_arg_gp");
         Cuik_Atom va_arg_mem = atoms_putc("__va_arg_mem");
 
-        // TODO(NeGate): remember this code is stuff that can be made multithreaded, if we
-        // care we can add that back in.
-        TokenStream tokens = *s;
+        DynArray(Symbol*) funcs = dyn_array_create(Symbol*, 256);
         CUIK_SYMTAB_FOR_GLOBALS(i, parser.symbols) {
             Symbol* sym = cuik_symtab_global_at(parser.symbols, i);
 
             // don't worry about normal globals, those have been taken care of...
             if (sym->token_start != 0 && (sym->storage_class == STORAGE_STATIC_FUNC || sym->storage_class == STORAGE_FUNC)) {
-                // Spin up a mini parser here
-                tokens.list.current = sym->token_start;
-
-                // intitialize use list
-                symbol_chain_start = NULL;
-
                 Cuik_Atom name = sym->stmt->decl.name;
                 if (name == va_arg_fp) parser.tu->sysv_abi.va_arg_fp = sym->stmt;
                 else if (name == va_arg_gp) parser.tu->sysv_abi.va_arg_gp = sym->stmt;
                 else if (name == va_arg_mem) parser.tu->sysv_abi.va_arg_mem = sym->stmt;
 
-                // Some sanity checks in case a local symbol is acting funny.
-                cuik_scope_open(parser.symbols), cuik_scope_open(parser.tags);
-                parse_function(&parser, &tokens, sym->stmt);
-                cuik_scope_close(parser.symbols), cuik_scope_close(parser.tags);
-
-                // finalize use list
-                sym->stmt->decl.first_symbol = symbol_chain_start;
+                dyn_array_put(funcs, sym);
             }
         }
+
+        if (mode == CUIK_PARSE_REACHABLE) {
+            parse_reachable_funcs(&parser, thread_pool, funcs);
+        } else {
+            // the globals table is ordered by the atom pointers which aren't stable
+            // run to run, sorting by position keeps the diagnostics in source order
+            // (and lets neighbouring functions share a batch).
+            size_t func_count = dyn_array_length(funcs);
+            qsort(funcs, func_count, sizeof(Symbol*), compare_func_pos);
+
+            parse_func_bodies(&parser, thread_pool, func_count, funcs);
+        }
+        dyn_array_destroy(funcs);
+
+        // local function declarations might've been appended
+        parser.tu->top_level_stmts = parser.top_level_stmts;
     }
     cuik_symtab_destroy(parser.symbols);
     cuik_symtab_destroy(parser.tags);
@@ -7,13 +7,27 @@ Cuik_Type cuik__builtin_bool = { KIND_BOOL,  1, 1, CUIK_TYPE_FLAG_COMPLETE };
 Cuik_Type cuik__builtin_float  = { KIND_FLOAT,  4, 4, CUIK_TYPE_FLAG_COMPLETE };
 Cuik_Type cuik__builtin_double = { KIND_DOUBLE, 8, 8, CUIK_TYPE_FLAG_COMPLETE };
 
+enum {
+    TYPE_INTERN_EXP = 16,
+    // if we can't find a slot in this many probes it's not worth interning
+    TYPE_INTERN_PROBES = 32,
+};
+
 Cuik_TypeTable init_type_table(Cuik_Target* target) {
     Cuik_TypeTable t = { 0 };
     t.target = target;
     t.tracked = dyn_array_create(Cuik_Type*, 1024);
+    t.interned = cuik__valloc((1u << TYPE_INTERN_EXP) * sizeof(Cuik_Type*));
     return t;
 }
 
+void free_type_table(Cuik_TypeTable* types) {
+    if (types->interned != NULL) {
+        cuik__vfree((void*) types->interned, (1u << TYPE_INTERN_EXP) * sizeof(Cuik_Type*));
+        types->interned = NULL;
+    }
+}
+
 // if track is false, it's not type checked later (because it's complete)
 static Cuik_Type* type_alloc(Cuik_TypeTable* types, bool track) {
     Cuik_Type* t = tb_arena_alloc(types->arena, sizeof(Cuik_Type));
@@ -46,6 +60,51 @@ static Cuik_Type* type_clone(Cuik_TypeTable* types, Cuik_Type* src, Atom new_nam
     return cloned;
 }
 
+static bool type_intern_match(Cuik_Type* t, Cuik_TypeKind kind, Cuik_QualType base, int count) {
+    if (t->kind != kind) {
+        return false;
+    } else if (kind == KIND_PTR) {
+        return t->ptr_to.raw == base.raw;
+    } else {
+        return t->array.of.raw == base.raw && t->array.count == count;
+    }
+}
+
+// derived types are immutable once they're complete so identical ones can share a pointer,
+// that makes most type_equal calls a pointer compare and stops sema from piling up copies
+// of the same pointer types. new_type is what we'd use if there's no match, it's freed
+// if we lose. If the table is too crowded we just don't intern it, nothing depends on
+// the sharing for correctness.
+static Cuik_Type* type_intern(Cuik_TypeTable* types, Cuik_Type* new_type, Cuik_TypeKind kind, Cuik_QualType base, int count) {
+    if (types->interned == NULL) {
+        return new_type;
+    }
+
+    uint64_t h = ((uint64_t) base.raw ^ ((uint64_t) count << 40) ^ kind) * 11400714819323198485ull;
+    uint32_t mask = (1u << TYPE_INTERN_EXP) - 1;
+    uint32_t i = h >> (64 - TYPE_INTERN_EXP);
+
+    for (size_t probe = 0; probe < TYPE_INTERN_PROBES; probe++) {
+        Cuik_Type* t = atomic_load_explicit(&types->interned[i], memory_order_acquire);
+        if (t == NULL) {
+            if (atomic_compare_exchange_strong_explicit(&types->interned[i], &t, new_type, memory_order_acq_rel, memory_order_acquire)) {
+                return new_type;
+            }
+
+            // someone filled the slot first, t is what they put there
+        }
+
+        if (type_intern_match(t, kind, base, count)) {
+            tb_arena_free(types->arena, new_type, sizeof(Cuik_Type));
+            return t;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return new_type;
+}
+
 Cuik_Type* cuik__new_pointer(Cuik_TypeTable* types, Cuik_QualType base) {
     // TODO(NeGate): this code depends on pointers being 8bytes, plz stop doing that
     Cuik_Type* t = type_alloc(types, false);
@@ -56,12 +115,17 @@ Cuik_Type* cuik__new_pointer(Cuik_TypeTable* types, Cuik_QualType base) {
         .flags = CUIK_TYPE_FLAG_COMPLETE,
         .ptr_to = base,
     };
-    return t;
+    return type_intern(types, t, KIND_PTR, base, 0);
 }
 
 Cuik_Type* cuik__new_array(Cuik_TypeTable* types, Cuik_QualType base, int count) {
     Cuik_Type* canon = cuik_canonical_type(base);
-    Cuik_Type* t = type_alloc(types, true);
+
+    // arrays of incomplete types get laid out later (and placeholder arrays get their
+    // count later) so they need to be their own objects.
+    bool intern = count != 0 && CUIK_TYPE_IS_COMPLETE(canon) && canon->size != 0;
+
+    Cuik_Type* t = type_alloc(types, !intern);
     if (count == 0) {
         // these zero-sized arrays don't actually care about incomplete element types
         *t = (Cuik_Type){
@@ -91,7 +155,7 @@ Cuik_Type* cuik__new_array(Cuik_TypeTable* types, Cuik_QualType base, int count)
         .array.of = base,
         .array.count = count,
     };
-    return t;
+    return intern ? type_intern(types, t, KIND_ARRAY, base, count) : t;
 }
 
 Cuik_Type* cuik__new_vector(Cuik_TypeTable* types, Cuik_QualType base, int count) {
@@ -398,7 +462,13 @@ size_t type_as_string(size_t max_len, char* buffer, Cuik_Type* type) {
                 case KIND_INT:    i += snprintf(&buffer[i], max_len - i, "%cvec%d", base->is_unsigned ? 'u' : 'i', type->vector.count); break;
                 case KIND_FLOAT:  i += snprintf(&buffer[i], max_len - i, "vec%d",   type->vector.count); break;
                 case KIND_DOUBLE: i += snprintf(&buffer[i], max_len - i, "dvec%d",  type->vector.count); break;
-                default: assert(0 && "TODO");
+                default: {
+                    // no GLSL-style name for these, just spell out the declaration
+                    i += cstr_copy(max_len - i, &buffer[i], "_Vector(");
+                    i += type_as_string(max_len - i, &buffer[i], base);
+                    i += snprintf(&buffer[i], max_len - i, ", %d)", type->vector.count);
+                    break;
+                }
             }
             break;
         }
@@ -14,6 +14,7 @@
 #include <setjmp.h>
 #include <sys/stat.h>
 #include <futex.h>
+#include <stdatomic.h>
 
 #if USE_INTRIN
 #include <x86intrin.h>
@@ -52,7 +53,9 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
 
 static Cuik_Path* alloc_path(Cuik_CPP* restrict ctx, const char* filepath);
 static Cuik_Path* alloc_directory_path(Cuik_CPP* restrict ctx, const char* filepath);
-static void compute_line_map(TokenStream* s, bool is_system, int depth, SourceLoc include_site, const char* filename, char* data, size_t length);
+static uint32_t* compute_line_map(const char* data, size_t length);
+static void tokens_push(TokenStream* restrict s, const Token* t);
+static void push_file_entry(TokenStream* s, bool is_system, bool is_cached, bool is_shared, int depth, SourceLoc include_site, const char* filename, char* data, size_t length, uint32_t* line_map);
 
 enum {
     MAX_CPP_STACK_DEPTH = 1024,
@@ -66,6 +69,9 @@ typedef struct CPPStackSlot {
     SourceLoc loc; // location of the #include
     TokenArray tokens;
 
+    // non-NULL if the file was loaded through the Cuik_FileCache
+    struct SharedFile* shared_file;
+
     // https://gcc.gnu.org/onlinedocs/cppinternals/Guard-Macros.html
     struct CPPIncludeGuard {
         enum {
@@ -85,6 +91,10 @@ typedef struct CPPStackSlot {
 typedef struct {
     String content;
     SourceRange loc;
+
+    // same tokens as the content, locations are offsets into it
+    size_t token_count;
+    Token* tokens;
 } MacroArg;
 
 typedef struct {
@@ -165,8 +175,89 @@ static TokenArray convert_to_token_list(Cuik_CPP* restrict c, uint32_t file_id,
     return list;
 }
 
+#include "cpp_pipe.h"
+
 static String get_token_as_string(TokenStream* restrict in) {
-    return tokens_get(in)->content;
+    return tokens_get(in).content;
+}
+
+static void token_table_reserve(TokenStream* restrict s, size_t count, size_t text_size) {
+    TokenTable* restrict l = &s->list;
+    if (count > l->capacity) {
+        l->capacity  = count;
+        l->bits      = pipe_realloc(s->pipe, l->bits,      l->count * sizeof(uint32_t),  count * sizeof(uint32_t));
+        l->locations = pipe_realloc(s->pipe, l->locations, l->count * sizeof(SourceLoc), count * sizeof(SourceLoc));
+        l->text      = pipe_realloc(s->pipe, l->text,      l->count * sizeof(TokenText), count * sizeof(TokenText));
+    }
+
+    // the lexer might read 16 bytes past the end of a token (pragmas get re-lexed)
+    if (text_size + 16 > l->text_capacity) {
+        l->text_capacity = text_size + 16;
+        l->text_data = pipe_realloc(s->pipe, l->text_data, l->text_size, l->text_capacity);
+    }
+}
+
+// every entry in TokenStream.files gets one of these, NULL if there's no text
+static void token_table_push_file(TokenStream* restrict s, const char* data) {
+    TokenTable* restrict l = &s->list;
+    if (l->file_count >= l->file_capacity) {
+        size_t cap = l->file_capacity ? l->file_capacity * 2 : 256;
+        l->file_text = pipe_realloc(s->pipe, l->file_text, l->file_count * sizeof(char*), cap * sizeof(char*));
+        l->file_capacity = cap;
+    }
+    l->file_text[l->file_count++] = (const unsigned char*) data;
+}
+
+static void token_table_free(TokenTable* restrict l) {
+    cuik_free(l->bits);
+    cuik_free(l->locations);
+    cuik_free(l->text);
+    cuik_free(l->text_data);
+    cuik_free(l->file_text);
+    *l = (TokenTable){ 0 };
+}
+
+// if the token's text is still where its location says it is then we don't need a copy
+static bool token_text_in_file(TokenTable* restrict l, const Token* t) {
+    uint32_t raw = t->location.raw;
+    if (raw & SourceLoc_IsMacro || (raw >> SourceLoc_FilePosBits) >= l->file_count || l->file_text[raw >> SourceLoc_FilePosBits] == NULL) {
+        return false;
+    }
+
+    uint32_t pos = raw & ((1u << SourceLoc_FilePosBits) - 1);
+    return &l->file_text[raw >> SourceLoc_FilePosBits][pos] == t->content.data;
+}
+
+// appends a token to the output stream, its content gets copied unless it's in a file
+static void tokens_push(TokenStream* restrict s, const Token* t) {
+    TokenTable* restrict l = &s->list;
+    size_t len = t->content.length;
+    bool in_file = token_text_in_file(l, t);
+    size_t text_len = in_file ? 0 : len + 1;
+    if (UNLIKELY(l->count >= l->capacity || l->text_size + text_len + 16 > l->text_capacity)) {
+        size_t cap = l->count < l->capacity ? l->capacity : l->capacity ? l->capacity * 2 : 4096;
+        token_table_reserve(s, cap, (l->text_size + text_len) * 2);
+    }
+
+    size_t i = l->count++;
+    memcpy(&l->bits[i], t, sizeof(uint32_t));
+    l->locations[i] = t->location;
+
+    if (in_file) {
+        l->text[i] = (TokenText){ TOKEN_TEXT_IN_FILE, len };
+    } else {
+        assert(l->text_size + len < UINT32_MAX && "token contents too big");
+        l->text[i] = (TokenText){ l->text_size, len };
+        if (len) {
+            memcpy(&l->text_data[l->text_size], t->content.data, len);
+        }
+        l->text_data[l->text_size + len] = 0;
+        l->text_size += len + 1;
+    }
+
+    if (UNLIKELY(s->pipe != NULL) && l->count >= s->pipe->publish_at) {
+        pipe_publish(s->pipe, l, false);
+    }
 }
 
 static LocateResult locate_file(Cuik_CPP* ctx, bool search_lib_first, const Cuik_Path* restrict dir, const char* og_path, Cuik_Path* restrict canonical) {
@@ -219,6 +310,8 @@ static const char MAGIC_EMPTY_STRING[] = "";
 #include "cpp_symtab.h"
 #include "cpp_expand.h"
 #include "cpp_fs.h"
+#include "cpp_cache.h"
+#include "cpp_file_cache.h"
 #include "cpp_expr.h"
 #include "cpp_directive.h"
 #include "cpp_iters.h"
@@ -248,16 +341,14 @@ Cuik_CPP* cuikpp_make(const Cuik_CPPDesc* desc) {
         .locate    = desc->locate,
         .fs        = desc->fs,
         .user_data = desc->fs_data,
+        .cache_dir = desc->cache_dir,
+        .file_cache = desc->file_cache,
         .case_insensitive = desc->case_insensitive,
 
         .stack = cuik__valloc(MAX_CPP_STACK_DEPTH * sizeof(CPPStackSlot)),
-        .macros = {
-            .exp = 24,
-            .keys = cuik__valloc((1u << 24) * sizeof(String)),
-            .vals = cuik__valloc((1u << 24) * sizeof(MacroDef)),
-        },
         .the_shtuffs = cuik__valloc(THE_SHTUFFS_SIZE),
     };
+    macro_table_alloc(ctx, MACRO_TABLE_INIT_EXP);
 
     // initialize dynamic arrays
     ctx->system_include_dirs = dyn_array_create(char*, 64);
@@ -272,6 +363,7 @@ Cuik_CPP* cuikpp_make(const Cuik_CPPDesc* desc) {
 
     // FileID 0 is the builtin macro file or the NULL file depending on who you ask
     dyn_array_put(ctx->tokens.files, (Cuik_FileEntry){ .filename = "<builtin>", .content_length = (1u << SourceLoc_FilePosBits) - 1u });
+    token_table_push_file(&ctx->tokens, NULL);
     tls_init();
 
     {
@@ -292,31 +384,48 @@ size_t cuikpp_get_file_count(TokenStream* restrict s) {
     return dyn_array_length(s->files) - 1;
 }
 
-Token* cuikpp_get_tokens(TokenStream* restrict s) {
-    return &s->list.tokens[0];
+Token cuikpp_get_token(TokenStream* restrict s, size_t i) {
+    return tokens_at(s, i);
 }
 
 size_t cuikpp_get_token_count(TokenStream* restrict s) {
     // don't tell them about the EOF token :P
-    return dyn_array_length(s->list.tokens) - 1;
+    return s->list.count - 1;
+}
+
+// the chunks of a big file are pushed back to back after the root
+static size_t file_total_length(TokenStream* tokens, Cuik_FileEntry* root) {
+    Cuik_FileEntry* last = root;
+    Cuik_FileEntry* end = &tokens->files[dyn_array_length(tokens->files)];
+    while (last + 1 < end && last[1].file_pos_bias != 0) {
+        last += 1;
+    }
+
+    return last->file_pos_bias + last->content_length;
 }
 
 void cuiklex_free_tokens(TokenStream* tokens) {
     dyn_array_for(i, tokens->files) {
-        // only free the root line_map, all the others are offsets of this one
+        // only free the root line_map, all the others are offsets of this one. shared
+        // file contents belong to the Cuik_FileCache.
         if (tokens->files[i].file_pos_bias == 0) {
-            dyn_array_destroy(tokens->files[i].line_map);
+            uint32_t* line_map = tokens->files[i].line_map;
+            dyn_array_destroy(line_map);
+        }
 
+        if (tokens->files[i].file_pos_bias == 0 && !tokens->files[i].is_shared) {
             // TODO(NeGate): we theoretically can allocate file buffers which
             // aren't in virtual memory but we'll assume not for now
-            if (tokens->files[i].content != NULL) {
-                cuik__vfree(tokens->files[i].content, tokens->files[i].content_length + 16);
+            if (tokens->files[i].is_cached) {
+                token_cache_unmap(tokens->files[i].content);
+            } else if (tokens->files[i].content != NULL) {
+                cuik__vfree(tokens->files[i].content, file_total_length(tokens, &tokens->files[i]) + 16);
             }
         }
     }
 
     dyn_array_destroy(tokens->files);
-    dyn_array_destroy(tokens->list.tokens);
+    token_table_free(&tokens->list);
     dyn_array_destroy(tokens->invokes);
     cuikdg_free(tokens->diag);
 }
@@ -334,10 +443,10 @@ void cuikpp_finalize(Cuik_CPP* ctx) {
     #endif
 
     CUIK_TIMED_BLOCK("cuikpp_finalize") {
-        cuik__vfree(ctx->macros.keys, (1u << ctx->macros.exp) * sizeof(String));
-        cuik__vfree(ctx->macros.vals, (1u << ctx->macros.exp) * sizeof(MacroDef));
+        macro_table_free(ctx);
         cuik__vfree(ctx->stack, MAX_CPP_STACK_DEPTH * sizeof(CPPStackSlot));
 
+        ctx->macros.ctrl = NULL;
         ctx->macros.keys = NULL;
         ctx->macros.vals = NULL;
         ctx->stack = NULL;
@@ -357,9 +466,28 @@ void cuikpp_free(Cuik_CPP* ctx) {
     cuik_free(ctx);
 }
 
+// most compiles never resolve a location (no diagnostics, no debug info) so the line
+// maps are built on first use, several threads might race to do it but only one wins.
+static uint32_t* get_line_map(TokenStream* tokens, Cuik_FileEntry* file) {
+    Cuik_FileEntry* root = file - (file->file_pos_bias >> SourceLoc_FilePosBits);
+    uint32_t* line_map = atomic_load_explicit(&root->line_map, memory_order_acquire);
+    if (line_map != NULL || root->content == NULL) {
+        return line_map;
+    }
+
+    uint32_t* new_map = compute_line_map(root->content, file_total_length(tokens, root));
+    if (atomic_compare_exchange_strong(&root->line_map, &line_map, new_map)) {
+        return new_map;
+    }
+
+    dyn_array_destroy(new_map);
+    return line_map;
+}
+
 // we can infer the column and line from doing a binary search on the TokenStream's line map
-static ResolvedSourceLoc find_location(Cuik_FileEntry* file, uint32_t file_pos) {
-    if (file->line_map == NULL) {
+static ResolvedSourceLoc find_location(TokenStream* tokens, Cuik_FileEntry* file, uint32_t file_pos) {
+    uint32_t* line_map = get_line_map(tokens, file);
+    if (line_map == NULL) {
         return (ResolvedSourceLoc){
             .file = file,
             .line_str = "",
@@ -370,17 +498,17 @@ static ResolvedSourceLoc find_location(Cuik_FileEntry* file, uint32_t file_pos)
     file_pos += file->file_pos_bias;
 
     size_t left = 0;
-    size_t right = dyn_array_length(file->line_map);
+    size_t right = dyn_array_length(line_map);
     while (left < right) {
         size_t middle = (left + right) / 2;
-        if (file->line_map[middle] > file_pos) {
+        if (line_map[middle] > file_pos) {
             right = middle;
         } else {
             left = middle + 1;
         }
     }
 
-    uint32_t l = file->line_map[right - 1];
+    uint32_t l = line_map[right - 1];
     assert(file_pos >= l);
 
     // NOTE(NeGate): it's possible that l is lesser than file->file_pos_bias in the
@@ -442,7 +570,7 @@ SourceLoc cuikpp_get_physical_location(TokenStream* tokens, SourceLoc loc) {
 }
 
 ResolvedSourceLoc cuikpp_find_location2(TokenStream* tokens, Cuik_FileLoc loc) {
-    return find_location(loc.file, loc.pos);
+    return find_location(tokens, loc.file, loc.pos);
 }
 
 ResolvedSourceLoc cuikpp_find_location(TokenStream* tokens, SourceLoc loc) {
@@ -452,49 +580,44 @@ ResolvedSourceLoc cuikpp_find_location(TokenStream* tokens, SourceLoc loc) {
     }
 
     Cuik_FileLoc fl = cuikpp_find_location_in_bytes(tokens, loc);
-    return find_location(fl.file, fl.pos);
+    return find_location(tokens, fl.file, fl.pos);
 }
 
-static void compute_line_map(TokenStream* s, bool is_system, int depth, SourceLoc include_site, const char* filename, char* data, size_t length) {
+// [0] is the first line, every newline starts another one after it
+static uint32_t* compute_line_map(const char* data, size_t length) {
     DynArray(uint32_t) line_map = dyn_array_create(uint32_t, (length / 20) + 32);
-
-    #if 1
-    // !USE_INTRIN
     dyn_array_put(line_map, 0);
 
-    for (size_t i = 0; i < length;) {
-        while (i < length && data[i] != '\n') i += 1;
-
-        i += 1;
-        dyn_array_put(line_map, i);
-    }
-    #else
-    // TODO(NeGate): make non-x64 SIMD variants
-    for (size_t i = 0; i < length; i += 16) {
-        while (i < length) {
-            __m128i bytes = _mm_load_si128((__m128i*) &data[i]);
-            unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
-            int len = __builtin_ffs(~mask));
-
-            if (len) {
-                i += len;
-                break;
-            } else {
-                i += 16;
-            }
+    size_t i = 0;
+    #if USE_INTRIN && CUIK__IS_X64
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((__m128i*) &data[i]);
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+        while (mask) {
+            dyn_array_put(line_map, i + __builtin_ctz(mask) + 1);
+            mask &= mask - 1;
         }
-
-        dyn_array_put(line_map, i);
     }
     #endif
 
+    for (; i < length; i++) {
+        if (data[i] == '\n') {
+            dyn_array_put(line_map, i + 1);
+        }
+    }
+
+    return line_map;
+}
+
+static void push_file_entry(TokenStream* s, bool is_system, bool is_cached, bool is_shared, int depth, SourceLoc include_site, const char* filename, char* data, size_t length, uint32_t* line_map) {
     // files bigger than the SourceLoc_FilePosBits allows will be fit into multiple sequencial files
     size_t i = 0, single_file_limit = (1u << SourceLoc_FilePosBits);
     do {
         size_t chunk_end = i + single_file_limit;
         if (chunk_end > length) chunk_end = length;
 
-        dyn_array_put(s->files, (Cuik_FileEntry){ filename, is_system, depth, include_site, i, chunk_end - i, &data[i], line_map });
+        dyn_array_put(s->files, (Cuik_FileEntry){ filename, is_system, is_cached, is_shared, depth, include_site, i, chunk_end - i, &data[i], line_map });
+        token_table_push_file(s, &data[i]);
         i += single_file_limit;
     } while (i < length);
 }
@@ -546,7 +669,7 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
     CUIK_TIMED_BLOCK("convert to tokens") {
         slot->tokens = convert_to_token_list(ctx, dyn_array_length(ctx->tokens.files), main_file.length, main_file.data);
     }
-    compute_line_map(&ctx->tokens, false, 0, (SourceLoc){ 0 }, slot->filepath->data, main_file.data, main_file.length);
+    push_file_entry(&ctx->tokens, false, false, false, 0, (SourceLoc){ 0 }, slot->filepath->data, main_file.data, main_file.length, NULL);
 
     // continue along to the actual preprocessing now
     #ifdef CPP_DBG
@@ -562,7 +685,7 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
     // estimate a good final token count, if we get this right we'll zip past without resizes
     size_t expected = dyn_array_length(slot->tokens.tokens);
     if (expected < 4096) expected = 4096;
-    s->list.tokens = dyn_array_create(Token, expected);
+    token_table_reserve(s, expected, expected * 8);
 
     for (;;) yield: {
         slot = &ctx->stack[ctx->stack_ptr - 1];
@@ -586,12 +709,12 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
                     if (!is_defined(ctx, first.content.data, first.content.length)) {
                         // FAST PATH
                         first.type = classify_ident(first.content.data, first.content.length, is_glsl);
-                        dyn_array_put(s->list.tokens, first);
+                        tokens_push(s, &first);
                     } else {
                         // SLOW PATH BECAUSE IT NEEDS TO SPAWN POSSIBLY METRIC SHIT LOADS
                         // OF TOKENS AND EXPAND WITH THE AVERAGE C PREPROCESSOR SPOOKIES
                         if (expand_builtin_idents(ctx, &first)) {
-                            dyn_array_put(s->list.tokens, first);
+                            tokens_push(s, &first);
                         } else {
                             in->current -= 1;
                             void* savepoint = tls_save();
@@ -605,7 +728,7 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
                                     t->type = classify_ident(t->content.data, t->content.length, is_glsl);
                                 }
 
-                                dyn_array_put(s->list.tokens, *t);
+                                tokens_push(s, t);
                             }
 
                             tls_restore(savepoint);
@@ -615,7 +738,7 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
                     // slow path
                     break;
                 } else {
-                    dyn_array_put(s->list.tokens, first);
+                    tokens_push(s, &first);
                 }
             }
 
@@ -685,6 +808,10 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
         if (slot->include_guard.status == INCLUDE_GUARD_EXPECTING_NOTHING) {
             // the file is practically pragma once
             nl_map_put_cstr(ctx->include_once, slot->filepath->data, 0);
+
+            if (slot->shared_file != NULL) {
+                file_cache_set_guard(ctx->file_cache, slot->shared_file, slot->include_guard.define);
+            }
         }
 
         // write out profile entry
@@ -698,7 +825,7 @@ Cuikpp_Status cuikpp_run(Cuik_CPP* restrict ctx) {
         // if this is the last file, just exit
         if (ctx->stack_ptr == 0) {
             // place last token
-            dyn_array_put(s->list.tokens, (Token){ 0 });
+            tokens_push(s, &(Token){ 0 });
 
             s->list.current = 0;
             return CUIKPP_DONE;
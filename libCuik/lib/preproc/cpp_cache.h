@@ -0,0 +1,241 @@
+// On-disk cache of lexed headers, the lexer's output only depends on the bytes of
+// the file so as long as the file hasn't changed (going off the mtime and size) we
+// can skip both reading and lexing it. Each header gets one cache file which is
+// mapped copy-on-write and is laid out like:
+//
+//   TokenCacheHeader
+//   text             [text_length + 16]  post-lexing, the lexer modifies it in place
+//   TokenCacheEntry  [token_count]
+//   char             [path_length + 1]   so we can catch hash collisions
+//
+// Line maps aren't stored, they're built lazily from the text if anyone asks.
+//
+// The include chain is validated one file at a time since every #include does its
+// own lookup, cache files are written to a temporary and renamed into place so
+// several compiles can share the cache directory.
+enum {
+    TOKEN_CACHE_MAGIC   = 0x4E4B5443, // "CTKN"
+    TOKEN_CACHE_VERSION = 3,
+};
+
+typedef struct {
+    uint32_t magic, version;
+    uint64_t mtime, file_size;
+    uint64_t total_size;
+
+    uint32_t token_count;
+    uint32_t text_length, path_length;
+    uint32_t pad;
+} TokenCacheHeader;
+
+typedef struct {
+    // the type and flags bits of the Token
+    uint32_t bits;
+    // byte offsets into the text
+    uint32_t pos, content;
+    uint32_t length;
+} TokenCacheEntry;
+
+_Static_assert(sizeof(TokenCacheHeader) % 16 == 0, "text should stay 16byte aligned");
+
+typedef struct {
+    // in nanoseconds (100ns ticks on windows), seconds aren't enough since
+    // a header can be saved twice within one and we'd never notice.
+    uint64_t mtime, file_size;
+} TokenCacheKey;
+
+static size_t token_cache_text_size(size_t text_length) {
+    return (text_length + 16 + 15) & ~15ull;
+}
+
+static bool token_cache_get_key(const char* filepath, TokenCacheKey* out_key) {
+    #ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attribs;
+    if (!GetFileAttributesExA(filepath, GetFileExInfoStandard, &attribs)) {
+        return false;
+    }
+
+    uint64_t mtime = ((uint64_t) attribs.ftLastWriteTime.dwHighDateTime << 32ull) | attribs.ftLastWriteTime.dwLowDateTime;
+    uint64_t size  = ((uint64_t) attribs.nFileSizeHigh << 32ull) | attribs.nFileSizeLow;
+    *out_key = (TokenCacheKey){ mtime, size };
+    #else
+    struct stat s;
+    if (stat(filepath, &s) != 0) {
+        return false;
+    }
+
+    #ifdef __APPLE__
+    uint64_t mtime = s.st_mtimespec.tv_sec*1000000000ull + s.st_mtimespec.tv_nsec;
+    #else
+    uint64_t mtime = s.st_mtim.tv_sec*1000000000ull + s.st_mtim.tv_nsec;
+    #endif
+
+    *out_key = (TokenCacheKey){ mtime, s.st_size };
+    #endif
+    return true;
+}
+
+static void token_cache_path(Cuik_CPP* restrict ctx, const char* filepath, Cuik_Path* out) {
+    uint32_t hash = tb__murmur3_32(filepath, strlen(filepath));
+
+    char name[16];
+    snprintf(name, sizeof(name), "%c%08x.tkn", CUIK_PATH_SLASH_SEP, hash);
+    cuik_path_append2(out, strlen(ctx->cache_dir), ctx->cache_dir, strlen(name), name);
+}
+
+// returns false on a cache miss, otherwise it fills in the file contents and token list
+static bool token_cache_load(Cuik_CPP* restrict ctx, const char* filepath, TokenCacheKey key, uint32_t file_id, Cuik_FileResult* out_file, TokenArray* out_tokens) {
+    Cuik_Path cache_path;
+    token_cache_path(ctx, filepath, &cache_path);
+
+    size_t size;
+    uint8_t* base = cuikfs_map(cache_path.data, &size);
+    if (base == NULL) {
+        return false;
+    }
+
+    TokenCacheHeader* header = (TokenCacheHeader*) base;
+    if (size < sizeof(TokenCacheHeader) ||
+        header->magic != TOKEN_CACHE_MAGIC ||
+        header->version != TOKEN_CACHE_VERSION ||
+        header->total_size != size ||
+        header->mtime != key.mtime ||
+        header->file_size != key.file_size) {
+        goto miss;
+    }
+
+    // the file might be truncated or written by something else, nothing past this
+    // point gets touched unless the sections add up to exactly the mapped size.
+    uint64_t expected_size = sizeof(TokenCacheHeader) + token_cache_text_size(header->text_length)
+        + (uint64_t) header->token_count * sizeof(TokenCacheEntry) + header->path_length + 1;
+    if (expected_size != size) {
+        goto miss;
+    }
+
+    char* text = (char*) &base[sizeof(TokenCacheHeader)];
+    TokenCacheEntry* entries = (TokenCacheEntry*) &text[token_cache_text_size(header->text_length)];
+    const char* path = (const char*) &entries[header->token_count];
+    if (header->path_length != strlen(filepath) || memcmp(path, filepath, header->path_length + 1) != 0) {
+        goto miss;
+    }
+
+    for (size_t i = 0; i < header->token_count; i++) {
+        uint64_t end = (uint64_t) entries[i].content + entries[i].length;
+        if (end > header->text_length || entries[i].pos > header->text_length) {
+            goto miss;
+        }
+    }
+
+    TokenArray list = { 0 };
+    list.tokens = dyn_array_create(Token, header->token_count + 1);
+    dyn_array_set_length(list.tokens, header->token_count);
+
+    for (size_t i = 0; i < header->token_count; i++) {
+        Token t;
+        memcpy(&t, &entries[i].bits, sizeof(uint32_t));
+        t.location = encode_file_loc(file_id, entries[i].pos);
+        t.content = (String){ entries[i].length, (const unsigned char*) &text[entries[i].content] };
+        list.tokens[i] = t;
+    }
+    dyn_array_put(list.tokens, (Token){ 0 });
+
+    *out_file = (Cuik_FileResult){ header->text_length, text };
+    *out_tokens = list;
+    return true;
+
+    miss:
+    cuikfs_unmap(base, size);
+    return false;
+}
+
+static void token_cache_save(Cuik_CPP* restrict ctx, const char* filepath, TokenCacheKey key, uint32_t file_id, Cuik_FileResult file, TokenArray* tokens) {
+    // the sentinel token at the end isn't stored
+    size_t token_count = dyn_array_length(tokens->tokens) - 1;
+    size_t path_length = strlen(filepath);
+
+    size_t text_size = token_cache_text_size(file.length);
+    size_t total_size = sizeof(TokenCacheHeader) + text_size + (token_count * sizeof(TokenCacheEntry)) + path_length + 1;
+    if (file.length >= UINT32_MAX || total_size >= UINT32_MAX) {
+        return;
+    }
+
+    uint8_t* buffer = cuik__valloc(total_size);
+    TokenCacheHeader* header = (TokenCacheHeader*) buffer;
+    *header = (TokenCacheHeader){
+        .magic = TOKEN_CACHE_MAGIC,
+        .version = TOKEN_CACHE_VERSION,
+        .mtime = key.mtime,
+        .file_size = key.file_size,
+        .total_size = total_size,
+        .token_count = token_count,
+        .text_length = file.length,
+        .path_length = path_length,
+    };
+
+    char* text = (char*) &buffer[sizeof(TokenCacheHeader)];
+    memcpy(text, file.data, file.length);
+
+    TokenCacheEntry* entries = (TokenCacheEntry*) &text[text_size];
+    for (size_t i = 0; i < token_count; i++) {
+        Token* t = &tokens->tokens[i];
+
+        // undo encode_file_loc, big files span several file IDs
+        uint32_t pos_mask = (1u << SourceLoc_FilePosBits) - 1;
+        uint32_t chunk = (t->location.raw >> SourceLoc_FilePosBits) - file_id;
+
+        // tokens are expected to point into the file, if one doesn't we can't cache it
+        const char* content = (const char*) t->content.data;
+        if (content < file.data || content + t->content.length > file.data + file.length) {
+            goto done;
+        }
+
+        memcpy(&entries[i].bits, t, sizeof(uint32_t));
+        entries[i].pos = (chunk << SourceLoc_FilePosBits) | (t->location.raw & pos_mask);
+        entries[i].content = content - file.data;
+        entries[i].length = t->content.length;
+    }
+
+    memcpy(&entries[token_count], filepath, path_length + 1);
+
+    if (!cuikfs_make_dir(ctx->cache_dir)) {
+        goto done;
+    }
+
+    Cuik_Path cache_path, tmp_path;
+    token_cache_path(ctx, filepath, &cache_path);
+
+    // other compiles might be writing the same entry, the rename makes sure
+    // nobody maps a half written file.
+    char suffix[40];
+    snprintf(suffix, sizeof(suffix), ".%llx.tmp", (unsigned long long) cuik_time_in_nanos() ^ (uintptr_t) &suffix);
+    cuik_path_append2(&tmp_path, cache_path.length, cache_path.data, strlen(suffix), suffix);
+
+    FILE* f = fopen(tmp_path.data, "wb");
+    if (f == NULL) {
+        goto done;
+    }
+
+    bool success = fwrite(buffer, total_size, 1, f) == 1;
+    success &= fclose(f) == 0;
+
+    if (success) {
+        #ifdef _WIN32
+        // rename won't replace an existing file on windows
+        remove(cache_path.data);
+        #endif
+
+        success = rename(tmp_path.data, cache_path.data) == 0;
+    }
+
+    if (!success) {
+        remove(tmp_path.data);
+    }
+
+    done:
+    cuik__vfree(buffer, total_size);
+}
+
+static void token_cache_unmap(char* text) {
+    TokenCacheHeader* header = (TokenCacheHeader*) (text - sizeof(TokenCacheHeader));
+    cuikfs_unmap(header, header->total_size);
+}
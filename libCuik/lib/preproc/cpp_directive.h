@@ -36,8 +36,8 @@ static DirectiveResult cpp__error(Cuik_CPP* restrict ctx, CPPStackSlot* restrict
 // passthrough all tokens raw
 static DirectiveResult cpp__version(Cuik_CPP* restrict ctx, CPPStackSlot* restrict slot, TokenArray* restrict in) {
     TokenStream* restrict s = &ctx->tokens;
-    dyn_array_put(s->list.tokens, in->tokens[in->current - 2]);
-    dyn_array_put(s->list.tokens, in->tokens[in->current - 1]);
+    tokens_push(s, &in->tokens[in->current - 2]);
+    tokens_push(s, &in->tokens[in->current - 1]);
 
     for (;;) {
         Token t = consume(in);
@@ -46,7 +46,7 @@ static DirectiveResult cpp__version(Cuik_CPP* restrict ctx, CPPStackSlot* restri
             return DIRECTIVE_SUCCESS;
         }
 
-        dyn_array_put(s->list.tokens, t);
+        tokens_push(s, &t);
     }
 }
 
@@ -77,13 +77,13 @@ static DirectiveResult cpp__pragma(Cuik_CPP* restrict ctx, CPPStackSlot* restric
         unsigned char* str = gimme_the_shtuffs(ctx, sizeof("_Pragma"));
         memcpy(str, "_Pragma", sizeof("_Pragma"));
         Token t = { TOKEN_KW_Pragma, false, false, loc, { 7, str } };
-        dyn_array_put(s->list.tokens, t);
+        tokens_push(s, &t);
 
         str = gimme_the_shtuffs(ctx, sizeof("("));
         str[0] = '(';
         str[1] = 0;
         t = (Token){ '(', false, false, loc, { 1, str } };
-        dyn_array_put(s->list.tokens, t);
+        tokens_push(s, &t);
 
         String payload = get_pp_tokens_until_newline(ctx, in);
 
@@ -105,14 +105,14 @@ static DirectiveResult cpp__pragma(Cuik_CPP* restrict ctx, CPPStackSlot* restric
             *curr++ = '\0';
 
             t = (Token){ TOKEN_STRING_DOUBLE_QUOTE, false, false, loc, { (curr - str) - 1, str } };
-            dyn_array_put(s->list.tokens, t);
+            tokens_push(s, &t);
         }
 
         str = gimme_the_shtuffs(ctx, sizeof(")"));
         str[0] = ')';
         str[1] = 0;
         t = (Token){ ')', false, false, loc, { 1, str } };
-        dyn_array_put(s->list.tokens, t);
+        tokens_push(s, &t);
     }
 
     return DIRECTIVE_SUCCESS;
@@ -198,6 +198,15 @@ static DirectiveResult cpp__include(Cuik_CPP* restrict ctx, CPPStackSlot* restri
         return DIRECTIVE_YIELD;
     }
 
+    // other translation units might've already loaded it
+    SharedFile* shared = NULL;
+    if (ctx->file_cache != NULL && !cuik_path_is_in(&canonical, "$cuik")) {
+        shared = file_cache_get(ctx, &canonical);
+        if (shared != NULL && file_cache_is_guarded(ctx, shared)) {
+            return DIRECTIVE_YIELD;
+        }
+    }
+
     Cuik_Path* alloced_filepath = alloc_path(ctx, canonical.data);
 
     // insert incomplete new stack slot
@@ -205,33 +214,52 @@ static DirectiveResult cpp__include(Cuik_CPP* restrict ctx, CPPStackSlot* restri
     *new_slot = (CPPStackSlot){
         .filepath = alloced_filepath,
         .directory = alloc_directory_path(ctx, canonical.data),
-        .loc = loc.start
+        .loc = loc.start,
+        .shared_file = shared,
     };
 
-    // read new file & lex
-    #if CUIK__CPP_STATS
-    uint64_t start_time = cuik_time_in_nanos();
-    #endif
+    // initialize the file & lexer in the stack new_slot
+    new_slot->include_guard = (struct CPPIncludeGuard){ 0 };
+    new_slot->file_id = dyn_array_length(ctx->tokens.files);
+
+    // if the header hasn't changed since we last cached it, we don't need to read or lex it
+    TokenCacheKey cache_key;
+    bool use_cache = shared == NULL && ctx->cache_dir != NULL && !cuik_path_is_in(&canonical, "$cuik") && token_cache_get_key(canonical.data, &cache_key);
 
     Cuik_FileResult next_file;
-    if (!ctx->fs(ctx->user_data, &canonical, &next_file, ctx->case_insensitive)) {
-        fprintf(stderr, "\x1b[31merror\x1b[0m: file doesn't exist.\n");
-        return DIRECTIVE_ERROR;
-    }
+    if (shared != NULL) {
+        new_slot->tokens = file_cache_copy_tokens(shared, new_slot->file_id);
+        push_file_entry(&ctx->tokens, l & LOCATE_SYSTEM, false, true, ctx->stack_ptr - 1, new_slot->loc, alloced_filepath->data, shared->file.data, shared->file.length, NULL);
+    } else if (use_cache && token_cache_load(ctx, alloced_filepath->data, cache_key, new_slot->file_id, &next_file, &new_slot->tokens)) {
+        push_file_entry(&ctx->tokens, l & LOCATE_SYSTEM, true, false, ctx->stack_ptr - 1, new_slot->loc, alloced_filepath->data, next_file.data, next_file.length, NULL);
+    } else {
+        // read new file & lex
+        #if CUIK__CPP_STATS
+        uint64_t start_time = cuik_time_in_nanos();
+        #endif
+
+        if (!ctx->fs(ctx->user_data, &canonical, &next_file, ctx->case_insensitive)) {
+            fprintf(stderr, "\x1b[31merror\x1b[0m: file doesn't exist.\n");
+            return DIRECTIVE_ERROR;
+        }
 
-    #if CUIK__CPP_STATS
-    ctx->total_io_time += (cuik_time_in_nanos() - start_time);
-    ctx->total_files_read += 1;
-    #endif
+        #if CUIK__CPP_STATS
+        ctx->total_io_time += (cuik_time_in_nanos() - start_time);
+        ctx->total_files_read += 1;
+        #endif
 
-    // initialize the file & lexer in the stack new_slot
-    new_slot->include_guard = (struct CPPIncludeGuard){ 0 };
-    // initialize the lexer in the stack slot & record file entry
-    new_slot->file_id = dyn_array_length(ctx->tokens.files);
-    CUIK_TIMED_BLOCK("convert to tokens") {
-        new_slot->tokens = convert_to_token_list(ctx, dyn_array_length(ctx->tokens.files), next_file.length, next_file.data);
+        CUIK_TIMED_BLOCK("convert to tokens") {
+            new_slot->tokens = convert_to_token_list(ctx, new_slot->file_id, next_file.length, next_file.data);
+        }
+
+        push_file_entry(&ctx->tokens, l & LOCATE_SYSTEM, false, false, ctx->stack_ptr - 1, new_slot->loc, alloced_filepath->data, next_file.data, next_file.length, NULL);
+
+        if (use_cache) {
+            CUIK_TIMED_BLOCK("save token cache") {
+                token_cache_save(ctx, alloced_filepath->data, cache_key, new_slot->file_id, next_file, &new_slot->tokens);
+            }
+        }
     }
-    compute_line_map(&ctx->tokens, l & LOCATE_SYSTEM, ctx->stack_ptr - 1, new_slot->loc, alloced_filepath->data, next_file.data, next_file.length);
 
     if (cuikperf_is_active()) {
         cuikperf_region_start("preprocess", filename);
@@ -265,6 +293,8 @@ static DirectiveResult cpp__define(Cuik_CPP* restrict ctx, CPPStackSlot* restric
     // if there's a parenthesis directly after the identifier
     // it's a macro function... yes this is an purposeful off-by-one
     // it's mostly ok tho
+    void* savepoint = tls_save();
+    MacroArgs params = { .keys = savepoint };
     if (key.content.data[key.content.length] == '(') {
         consume(in);
 
@@ -284,20 +314,37 @@ static DirectiveResult cpp__define(Cuik_CPP* restrict ctx, CPPStackSlot* restric
             if (t.type != TOKEN_TRIPLE_DOT && t.type != TOKEN_IDENTIFIER) {
                 SourceRange r = { t.location, get_end_location(&t) };
                 diag_err(&ctx->tokens, r, "expected identifier");
+                tls_restore(savepoint);
                 return DIRECTIVE_ERROR;
             } else {
                 arg_count++;
             }
+
+            // anything after the ... isn't a named parameter
+            if (t.type == TOKEN_TRIPLE_DOT) {
+                params.has_varargs = true;
+            } else if (!params.has_varargs) {
+                tls_push(sizeof(String));
+                params.keys[params.key_count++] = t.content;
+            }
         }
     }
 
     SourceLoc loc = peek(in).location;
+    size_t first = in->current;
     String value = get_pp_tokens_until_newline(ctx, in);
 
     // printf("%.*s -> %.*s\n", (int)key.content.length, key.content.data, (int)value.length, value.data);
 
+    // we've already got the value's tokens, no need to lex them again
+    MacroBody* body = NULL;
+    if (value.length > 0) {
+        body = macro_body_create(ctx, &params, in->current - first, &in->tokens[first], value.data);
+    }
+    tls_restore(savepoint);
+
     size_t i = insert_symtab(ctx, key.content.length, (const char*) key.content.data);
-    ctx->macros.vals[i] = (MacroDef){ value, loc };
+    ctx->macros.vals[i] = (MacroDef){ value, loc, body };
     return DIRECTIVE_SUCCESS;
 }
 
@@ -429,11 +476,11 @@ static DirectiveResult cpp__embed(Cuik_CPP* restrict ctx, CPPStackSlot* restrict
     // convert #embed path => _Embed(path)
     unsigned char* str = gimme_the_shtuffs_fill(ctx, "_Embed");
     Token t = (Token){ TOKEN_KW_Embed, false, false, loc.start, { 7, str } };
-    dyn_array_put(s->list.tokens, t);
+    tokens_push(s, &t);
 
     str = gimme_the_shtuffs_fill(ctx, "(");
     t = (Token){ '(', false, false, loc.start, { 1, str } };
-    dyn_array_put(s->list.tokens, t);
+    tokens_push(s, &t);
 
     Cuik_FileResult next_file;
     if (!ctx->fs(ctx->user_data, &canonical, &next_file, ctx->case_insensitive)) {
@@ -444,11 +491,11 @@ static DirectiveResult cpp__embed(Cuik_CPP* restrict ctx, CPPStackSlot* restrict
     t = (Token){ TOKEN_MAGIC_EMBED_STRING, false, false, loc.start };
     t.content.length = next_file.length;
     t.content.data = (const unsigned char*) next_file.data;
-    dyn_array_put(s->list.tokens, t);
+    tokens_push(s, &t);
 
     str = gimme_the_shtuffs_fill(ctx, ")");
     t = (Token){ ')', false, false, loc.start, { 1, str } };
-    dyn_array_put(s->list.tokens, t);
+    tokens_push(s, &t);
 
     return DIRECTIVE_SUCCESS;
 }
@@ -6,68 +6,37 @@ static void dump(TokenNode* head) {
     printf("\n");
 }
 
-static Token* get_last_token(TokenStream* restrict s) {
-    assert(dyn_array_length(s->list.tokens) > 0);
-    return &s->list.tokens[dyn_array_length(s->list.tokens) - 1];
-}
-
 static bool concat_token(Cuik_CPP* restrict c, String a, String b, Token* out_token) {
     return true;
 }
 
-// [https://www.sigbus.info/n1570#6.10p1] This just handles parsing the # define param list
-//
-// After '# define identifier':
-//   lparen identifier-list opt )
-//   lparen ... )
-//   lparen identifier-list , ... )
-//
-// identifier-list:
-//   identifier
-//   identifier-list , identifier
-static bool parse_params(Cuik_CPP* restrict c, MacroArgs* args, Lexer* restrict in) {
-    args->key_count = 0;
-    args->keys = tls_save();
-
-    Token t = lexer_read(in);
-    if (t.type != '(') {
-        fprintf(stderr, "error: expected '('\n");
-        return false;
+// the argument tokens are copied once all the values are found (the values array has to
+// stay contiguous in the TLS), their locations match where they are in the content string
+// so it's the same as if we had lexed it.
+static void arg_push_token(MacroArg* restrict arg, size_t* pos, Token t) {
+    if (t.type == TOKEN_STRING_WIDE_DOUBLE_QUOTE || t.type == TOKEN_STRING_WIDE_SINGLE_QUOTE) {
+        *pos += 1;
     }
 
-    for (;;) {
-        t = lexer_read(in);
-        if (t.type == 0) return false;
-        if (t.type == ')') break;
-
-        if (args->key_count) {
-            if (t.type != ',') {
-                fprintf(stderr, "error: expected comma\n");
-                return false;
-            }
-
-            t = lexer_read(in);
-        }
-
-        if (t.type == TOKEN_TRIPLE_DOT) {
-            args->has_varargs = true;
-            break;
-        } else if (t.type == TOKEN_IDENTIFIER) {
-            tls_push(sizeof(String));
-
-            args->keys[args->key_count++] = t.content;
-        } else {
-            fprintf(stderr, "error: expected identifier or triple-dot\n");
-            return false;
-        }
+    size_t offset = *pos;
+    *pos += t.content.length + 1;
+    if (t.type == 0) {
+        return;
     }
 
-    return true;
+    t.expanded = false;
+    t.hit_line = false;
+    t.location = encode_file_loc(0, offset);
+
+    Token* dst = tls_push(sizeof(Token));
+    *dst = t;
+    arg->token_count += 1;
 }
 
 static bool parse_args(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenArray* restrict in) {
     size_t value_count = 0;
     MacroArg* values = tls_save();
+    size_t start = in->current;
 
     int paren_depth = 0;
     for (;;) {
@@ -87,7 +56,7 @@ static bool parse_args(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenArra
         }
 
         // we're incrementally building up the string in the "the shtuffs"
-        size_t len = 0;
+        size_t len = 0, count = 0;
         unsigned char* str = gimme_the_shtuffs(c, 0);
         SourceRange loc = { .start = peek(in).location };
         while (!at_token_list_end(in)) {
@@ -121,6 +90,7 @@ static bool parse_args(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenArra
             memcpy(&str[len], src.data, src.length);
             str[len + src.length] = ' ';
             len += src.length + 1;
+            count += 1;
         }
         loc.end = get_token_range(&in->tokens[in->current - 1]).end;
 
@@ -131,13 +101,25 @@ static bool parse_args(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenArra
         }
 
         tls_push(sizeof(MacroArg));
-        values[value_count++] = (MacroArg){ .content = { len, str }, .loc = loc };
+        values[value_count++] = (MacroArg){ .content = { len, str }, .loc = loc, .token_count = count };
 
         if (t.type == ')' && paren_depth == 0) {
             break;
         }
     }
 
+    // arguments are separated by exactly one comma
+    for (size_t i = 0; i < value_count; i++) {
+        size_t count = values[i].token_count, pos = 0;
+        values[i].token_count = 0;
+        values[i].tokens = tls_save();
+
+        for (size_t j = 0; j < count; j++) {
+            arg_push_token(&values[i], &pos, in->tokens[start + j]);
+        }
+        start += count + 1;
+    }
+
     args->values = values;
     args->value_count = value_count;
     return true;
@@ -147,6 +129,7 @@ static bool parse_args(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenArra
 static TokenNode* parse_args2(Cuik_CPP* restrict c, MacroArgs* restrict args, TokenNode* restrict curr) {
     size_t value_count = 0;
     MacroArg* values = tls_save();
+    TokenNode* start = curr;
 
     int paren_depth = 0;
     TokenNode* prev = NULL;
@@ -163,7 +146,7 @@ static TokenNode* parse_args2(Cuik_CPP* restrict c, MacroArgs* restrict args, To
         }
 
         // we're incrementally building up the string in the "the shtuffs"
-        size_t len = 0;
+        size_t len = 0, count = 0;
         unsigned char* str = gimme_the_shtuffs(c, 0);
         SourceRange loc = { .start = t.location };
         while (curr != NULL) {
@@ -194,6 +177,7 @@ static TokenNode* parse_args2(Cuik_CPP* restrict c, MacroArgs* restrict args, To
             memcpy(&str[len], src.data, src.length);
             str[len + src.length] = ' ';
             len += src.length + 1;
+            count += 1;
 
             // advance
             prev = curr, curr = curr->next;
@@ -207,26 +191,28 @@ static TokenNode* parse_args2(Cuik_CPP* restrict c, MacroArgs* restrict args, To
         }
 
         tls_push(sizeof(MacroArg));
-        values[value_count++] = (MacroArg){ .content = { len, str }, .loc = loc };
+        values[value_count++] = (MacroArg){ .content = { len, str }, .loc = loc, .token_count = count };
 
         if (t.type == ')' && paren_depth == 0) {
             break;
         }
     }
 
-    args->values = values;
-    args->value_count = value_count;
-    return curr;
-}
+    for (size_t i = 0; i < value_count; i++) {
+        size_t count = values[i].token_count, pos = 0;
+        values[i].token_count = 0;
+        values[i].tokens = tls_save();
 
-static ptrdiff_t find_arg(MacroArgs* restrict args, String name) {
-    for (size_t i = 0; i < args->key_count; i++) {
-        if (string_equals(&args->keys[i], &name)) {
-            return i;
+        for (size_t j = 0; j < count; j++) {
+            arg_push_token(&values[i], &pos, start->t);
+            start = start->next;
         }
+        if (start) start = start->next;
     }
 
-    return -1;
+    args->values = values;
+    args->value_count = value_count;
+    return curr;
 }
 
 static void append_to_list(TokenList* l, Token* t) {
@@ -252,14 +238,29 @@ static SourceLoc macroify_loc(SourceLoc loc, uint32_t parent_macro) {
     }
 }
 
-static TokenList into_list(Cuik_CPP* restrict c, uint8_t* def_str, uint32_t macro_id) {
-    TokenList l = { def_str };
-    Lexer in = { 0, def_str, def_str };
+// the nodes are allocated together so subst can tell which of them are still
+// the body's tokens.
+static TokenList body_into_list(MacroBody* body, const uint8_t* start, uint32_t macro_id) {
+    TokenList l = { start };
+    if (body->token_count == 0) {
+        return l;
+    }
 
-    for (;;) {
-        Token t = lexer_read(&in);
-        if (t.type == 0 || t.hit_line) break;
+    TokenNode* nodes = tls_push(body->token_count * sizeof(TokenNode));
+    for (size_t i = 0; i < body->token_count; i++) {
+        nodes[i].next = i + 1 < body->token_count ? &nodes[i + 1] : NULL;
+        nodes[i].t = body->tokens[i];
+        nodes[i].t.location = macroify_loc(nodes[i].t.location, macro_id);
+    }
 
+    l.head = nodes, l.tail = &nodes[body->token_count - 1];
+    return l;
+}
+
+static TokenList arg_into_list(MacroArg* arg, uint32_t macro_id) {
+    TokenList l = { arg->content.data };
+    for (size_t i = 0; i < arg->token_count; i++) {
+        Token t = arg->tokens[i];
         t.location = macroify_loc(t.location, macro_id);
         append_to_list(&l, &t);
     }
@@ -267,6 +268,12 @@ static TokenList into_list(Cuik_CPP* restrict c, uint8_t* def_str, uint32_t macr
     return l;
 }
 
+// -1 if n isn't one of the body's tokens which names a parameter
+static ptrdiff_t body_param(MacroBody* body, TokenNode* nodes, TokenNode* n) {
+    size_t i = ((uintptr_t) n - (uintptr_t) nodes) / sizeof(TokenNode);
+    return (uintptr_t) n >= (uintptr_t) nodes && i < body->token_count ? body->param_refs[i] : -1;
+}
+
 static TokenList line_into_list(TokenArray* restrict in) {
     TokenList l = { 0 };
     for (;;) {
@@ -356,7 +363,7 @@ static TokenNode* get_previous_link(TokenNode* head, TokenNode* curr) {
 // parse function macros where def_lex is the lexer for the macro definition
 // TODO(NeGate): redo the error messages here
 #define NEXT_TOKEN() (curr = curr->next, curr->t)
-static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_start, MacroArgs* restrict args, uint32_t macro_id) {
+static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_start, MacroBody* body, MacroArgs* restrict args, uint32_t macro_id) {
     TokenNode *curr = head, *prev = NULL;
     while (curr != NULL) {
         Token t = curr->t;
@@ -377,7 +384,7 @@ static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_st
 
             // stringize arg
             t = curr->t;
-            ptrdiff_t arg_i = find_arg(args, t.content);
+            ptrdiff_t arg_i = body_param(body, head, curr);
             if (arg_i < 0) {
                 diag_err(&c->tokens, r, "cannot stringize unknown argument");
                 return false;
@@ -413,7 +420,7 @@ static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_st
 
             TokenNode* savepoint = curr;
             String b = NEXT_TOKEN().content;
-            ptrdiff_t b_i = find_arg(args, b);
+            ptrdiff_t b_i = body_param(body, head, curr);
             if (b_i >= 0) b = args->values[b_i].content;
 
             if (b.data[0] == '_' && string_equals_cstr(&b, "__VA_ARGS__")) {
@@ -508,18 +515,13 @@ static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_st
                             .def_site  = args->values[i].loc,
                         });
 
-                    String arg = args->values[i].content;
-                    if (arg.length == 0) continue;
-
-                    Lexer in = { 0, (uint8_t*) arg.data };
-                    in.current = in.start;
+                    MacroArg* arg = &args->values[i];
+                    if (arg->token_count == 0) continue;
 
                     TokenNode* before_arg = tail;
-                    for (;;) {
-                        Token t = lexer_read(&in);
-                        if (t.type == 0 || t.hit_line) break;
-
-                        t.location = encode_macro_loc(vaargs_macro, t.content.data - in.start);
+                    for (size_t j = 0; j < arg->token_count; j++) {
+                        Token t = arg->tokens[j];
+                        t.location = encode_macro_loc(vaargs_macro, t.location.raw);
 
                         if (tail == NULL) {
                             curr->t = t, curr->next = NULL, tail = curr;
@@ -549,16 +551,9 @@ static bool subst(Cuik_CPP* restrict c, TokenNode* head, const uint8_t* subst_st
                 curr = old_next;
                 continue;
             } else {
-                ptrdiff_t arg_i = find_arg(args, t.content);
+                ptrdiff_t arg_i = body_param(body, head, curr);
                 if (arg_i >= 0) {
-                    String substitution = args->values[arg_i].content;
-                    if (substitution.length == 0) {
-                        curr->t.type = 0;
-                        curr->t.content = (String){ 0 };
-                        goto done;
-                    }
-
-                    TokenList list = into_list(c, (uint8_t*) substitution.data, macro_id);
+                    TokenList list = arg_into_list(&args->values[arg_i], macro_id);
                     if (list.head == NULL) {
                         curr->t.type = 0;
                         curr->t.content = (String){ 0 };
@@ -654,6 +649,7 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
     size_t def_i;
     if (!t.expanded && find_define(c, &def_i, t.content.data, t.content.length)) {
         String def = c->macros.vals[def_i].value;
+        MacroBody* body = c->macros.vals[def_i].body;
         SourceLoc def_site = c->macros.vals[def_i].loc;
 
         // create macro invoke site
@@ -681,7 +677,7 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
             }
 
             // convert definition into token list
-            TokenList list = into_list(c, (uint8_t*) def.data, macro_id);
+            TokenList list = body_into_list(body, def.data, macro_id);
             if (list.head == NULL) {
                 if (head) {
                     head->t.type = 0;
@@ -710,7 +706,7 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
             MacroArgs arglist = { 0 };
             size_t hidden = hide_macro(c, def_i);
 
-            subst(c, list.head, list.start, &arglist, macro_id);
+            subst(c, list.head, list.start, body, &arglist, macro_id);
 
             #ifdef CPP_DBG
             if (dbgmod == 1) {
@@ -774,14 +770,15 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
                 }
 
                 // convert definition into token list
-                TokenList list = into_list(c, (uint8_t*) def.data, macro_id);
+                TokenList list = body_into_list(body, def.data, macro_id);
                 if (list.head == NULL) {
                     if (head) skip_nodes(head, end);
                     goto done;
                 }
 
-                Lexer args_lexer = { 0, (unsigned char*) args, (unsigned char*) args };
-                if (!parse_params(c, &arglist, &args_lexer)) goto done;
+                arglist.key_count = body->param_count;
+                arglist.keys = body->params;
+                arglist.has_varargs = body->has_varargs;
 
                 /*printf("FUNCTION MACRO: %.*s    %.*s\n\n", (int)t.content.length, t.content.data, (int)def.length, def.data);
                 for (size_t i = 0; i < arglist.key_count; i++) {
@@ -802,7 +799,7 @@ static TokenList expand_ident(Cuik_CPP* restrict c, TokenArray* in, TokenNode* h
                 #endif /* CPP_DBG */
 
                 // replace arguments and perform concats
-                subst(c, list.head, list.start, &arglist, macro_id);
+                subst(c, list.head, list.start, body, &arglist, macro_id);
 
                 #ifdef CPP_DBG
                 if (dbgmod == 1) {
@@ -0,0 +1,256 @@
+// Shared header cache, when several translation units get preprocessed at once they
+// tend to pull in the same system headers and there's no reason for each of them to
+// read, canonicalize and lex them separately. Entries are keyed by canonical path and
+// once loaded nobody writes to them (the lexer's in-place edits happen before we
+// publish it) so the text and line map can be referenced directly, each preprocessor
+// only copies the token list so it can rebase the locations onto its own file IDs.
+// The text is always our own copy, a token cache mapping could be replaced or
+// truncated under us and entries can live for as long as the server does.
+//
+// Every build (see cuikpp_file_cache_next_build) the first lookup of a file checks
+// its mtime and size against what we loaded, anything the server's watches missed
+// gets reloaded there.
+//
+// We also keep track of the include guard, once any translation unit has seen the
+// file completely wrapped in an #ifndef GUARD #define GUARD ... #endif, the others can
+// skip the #include without touching the file as long as GUARD is defined.
+typedef struct SharedFile {
+    // 0 while it's being loaded, 1 once it's ready, -1 if the load failed
+    // and -2 once it's been invalidated (the next lookup reloads it)
+    Futex state;
+    // the build it was last checked against the disk in
+    uint32_t build;
+    // the stat when it was loaded, no key means we can't revalidate it
+    bool has_key;
+    TokenCacheKey key;
+
+    Cuik_FileResult file;
+    // DynArray(Token) lexed as if it was file ID 0, ends with the EOF token
+    Token* tokens;
+
+    // points into the file's text, written once under the cache lock
+    _Atomic bool has_guard;
+    String guard;
+
+    char path[];
+} SharedFile;
+
+struct Cuik_FileCache {
+    mtx_t lock;
+    NL_Strmap(SharedFile*) files;
+
+    uint32_t build;
+};
+
+Cuik_FileCache* cuikpp_file_cache_create(void) {
+    Cuik_FileCache* cache = cuik_malloc(sizeof(Cuik_FileCache));
+    *cache = (Cuik_FileCache){ 0 };
+    mtx_init(&cache->lock, mtx_plain);
+    return cache;
+}
+
+static void file_cache_release(SharedFile* f) {
+    if (f->state > 0) {
+        dyn_array_destroy(f->tokens);
+        cuik__vfree(f->file.data, f->file.length + 16);
+    }
+}
+
+// the map's key points at f->path so the entry stays, it just gets emptied
+// and the next lookup reloads it.
+static void file_cache_reset(SharedFile* f) {
+    assert(f->state != 0 && "can't invalidate while the file is loading");
+    file_cache_release(f);
+
+    f->has_key = false;
+    f->file = (Cuik_FileResult){ 0 };
+    f->tokens = NULL;
+    f->has_guard = false;
+    f->guard = (String){ 0 };
+    f->state = -2;
+}
+
+void cuikpp_file_cache_destroy(Cuik_FileCache* cache) {
+    nl_map_for_str(i, cache->files) {
+        SharedFile* f = cache->files[i].v;
+        file_cache_release(f);
+        cuik_free(f);
+    }
+
+    nl_map_free(cache->files);
+    mtx_destroy(&cache->lock);
+    cuik_free(cache);
+}
+
+bool cuikpp_file_cache_invalidate(Cuik_FileCache* cache, const char* path) {
+    mtx_lock(&cache->lock);
+    ptrdiff_t search = nl_map_get_cstr(cache->files, path);
+    if (search >= 0) {
+        file_cache_reset(cache->files[search].v);
+    }
+    mtx_unlock(&cache->lock);
+    return search >= 0;
+}
+
+void cuikpp_file_cache_next_build(Cuik_FileCache* cache) {
+    mtx_lock(&cache->lock);
+    cache->build += 1;
+    mtx_unlock(&cache->lock);
+}
+
+void cuikpp_file_cache_for_each(Cuik_FileCache* cache, void* user_data, void (*fn)(void* user_data, const char* path)) {
+    mtx_lock(&cache->lock);
+    nl_map_for_str(i, cache->files) {
+        SharedFile* f = cache->files[i].v;
+        if (f->state > 0) {
+            fn(user_data, f->path);
+        }
+    }
+    mtx_unlock(&cache->lock);
+}
+
+// the file might've changed since it was loaded
+static bool file_cache_is_stale(SharedFile* f) {
+    TokenCacheKey key;
+    if (!f->has_key) {
+        return false;
+    }
+
+    return !token_cache_get_key(f->path, &key) || key.mtime != f->key.mtime || key.file_size != f->key.file_size;
+}
+
+static bool file_cache_load(Cuik_CPP* restrict ctx, const Cuik_Path* restrict canonical, SharedFile* f) {
+    // stat before reading, if it gets written in between we'll just reload it next time
+    f->has_key = token_cache_get_key(canonical->data, &f->key);
+
+    // the on-disk cache still works underneath, it'll just be shared now
+    bool use_cache = ctx->cache_dir != NULL && f->has_key;
+
+    TokenArray tokens;
+    Cuik_FileResult mapped;
+    if (use_cache && token_cache_load(ctx, canonical->data, f->key, 0, &mapped, &tokens)) {
+        // copy out of the mapping, the tokens get moved over with it
+        char* text = cuik__valloc(mapped.length + 16);
+        memcpy(text, mapped.data, mapped.length + 16);
+
+        size_t count = dyn_array_length(tokens.tokens);
+        for (size_t i = 0; i + 1 < count; i++) {
+            String* str = &tokens.tokens[i].content;
+            str->data = (const unsigned char*) &text[(const char*) str->data - mapped.data];
+        }
+
+        token_cache_unmap(mapped.data);
+        f->file = (Cuik_FileResult){ mapped.length, text };
+        f->tokens = tokens.tokens;
+        return true;
+    }
+
+    #if CUIK__CPP_STATS
+    uint64_t start_time = cuik_time_in_nanos();
+    #endif
+
+    if (!ctx->fs(ctx->user_data, canonical, &f->file, ctx->case_insensitive)) {
+        return false;
+    }
+
+    #if CUIK__CPP_STATS
+    ctx->total_io_time += (cuik_time_in_nanos() - start_time);
+    ctx->total_files_read += 1;
+    #endif
+
+    CUIK_TIMED_BLOCK("convert to tokens") {
+        tokens = convert_to_token_list(ctx, 0, f->file.length, f->file.data);
+    }
+
+    f->tokens = tokens.tokens;
+
+    if (use_cache) {
+        CUIK_TIMED_BLOCK("save token cache") {
+            token_cache_save(ctx, canonical->data, f->key, 0, f->file, &tokens);
+        }
+    }
+    return true;
+}
+
+// returns NULL if the file couldn't be loaded
+static SharedFile* file_cache_get(Cuik_CPP* restrict ctx, const Cuik_Path* restrict canonical) {
+    Cuik_FileCache* cache = ctx->file_cache;
+
+    mtx_lock(&cache->lock);
+    SharedFile* f;
+    ptrdiff_t search = nl_map_get_cstr(cache->files, canonical->data);
+    bool is_loader = search < 0;
+    if (is_loader) {
+        f = cuik_malloc(sizeof(SharedFile) + canonical->length + 1);
+        *f = (SharedFile){ .build = cache->build };
+        memcpy(f->path, canonical->data, canonical->length + 1);
+
+        nl_map_put_cstr(cache->files, f->path, f);
+    } else {
+        f = cache->files[search].v;
+
+        // first lookup this build, anything which changed on disk (or failed to
+        // load last time) gets another shot.
+        if (f->state != 0 && f->build != cache->build) {
+            f->build = cache->build;
+            if (f->state < 0 || file_cache_is_stale(f)) {
+                file_cache_reset(f);
+            }
+        }
+
+        // invalidated entries get reloaded by whoever sees them first
+        if (f->state == -2) {
+            f->state = 0;
+            is_loader = true;
+        }
+    }
+    mtx_unlock(&cache->lock);
+
+    if (is_loader) {
+        f->state = file_cache_load(ctx, canonical, f) ? 1 : -1;
+        futex_broadcast(&f->state);
+    } else {
+        // the loader isn't waiting on anything so we can just block
+        while (f->state == 0) {
+            futex_wait(&f->state, 0);
+        }
+    }
+
+    return f->state > 0 ? f : NULL;
+}
+
+static TokenArray file_cache_copy_tokens(SharedFile* f, uint32_t file_id) {
+    size_t count = dyn_array_length(f->tokens);
+
+    TokenArray list = { 0 };
+    list.tokens = dyn_array_create(Token, count);
+    dyn_array_set_length(list.tokens, count);
+
+    // big files span several file IDs but they're sequencial so a single bias works
+    uint32_t bias = file_id << SourceLoc_FilePosBits;
+    for (size_t i = 0; i + 1 < count; i++) {
+        list.tokens[i] = f->tokens[i];
+        list.tokens[i].location.raw += bias;
+    }
+    list.tokens[count - 1] = (Token){ 0 };
+    return list;
+}
+
+// if the file is entirely wrapped in an include guard that's already defined
+// then including it would do nothing.
+static bool file_cache_is_guarded(Cuik_CPP* restrict ctx, SharedFile* f) {
+    return atomic_load_explicit(&f->has_guard, memory_order_acquire) && is_defined(ctx, f->guard.data, f->guard.length);
+}
+
+static void file_cache_set_guard(Cuik_FileCache* cache, SharedFile* f, String guard) {
+    if (atomic_load_explicit(&f->has_guard, memory_order_acquire)) {
+        return;
+    }
+
+    mtx_lock(&cache->lock);
+    if (!f->has_guard) {
+        f->guard = guard;
+        atomic_store_explicit(&f->has_guard, true, memory_order_release);
+    }
+    mtx_unlock(&cache->lock);
+}
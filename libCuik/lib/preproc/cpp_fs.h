@@ -54,8 +54,6 @@ bool cuikpp_default_fs(void* user_data, const Cuik_Path* restrict input, Cuik_Fi
         char* buffer = cuik__valloc(source.length + 17);
         memcpy(buffer, source.data, source.length);
 
-        cuiklex_canonicalize(source.length, buffer);
-
         output->length = source.length;
         output->data = buffer;
         return true;
@@ -70,18 +68,26 @@ bool cuikpp_default_fs(void* user_data, const Cuik_Path* restrict input, Cuik_Fi
         Cuik_Path path;
         cuikfs_canonicalize(&path, input->data, case_insensitive);
 
+        // the lexer only writes into the text for backslash-newlines and UCNs, a copy-on-write
+        // mapping means most headers are never copied. The padding covers the lexer's 16 byte
+        // null terminator.
+        size_t length;
+        char* buffer = cuikfs_map_padded(path.data, 16, &length);
+        if (buffer != NULL) {
+            output->length = length;
+            output->data = buffer;
+            return true;
+        }
+
         // read entire file into virtual memory block
         Cuik_File* file = cuikfs_open(path.data, false);
         if (file == NULL) return false;
 
-        size_t length;
         if (!cuikfs_get_length(file, &length)) goto err;
 
-        char* buffer = cuik__valloc(length + 17);
+        buffer = cuik__valloc(length + 17);
         if (!cuikfs_read(file, buffer, length)) goto err;
 
-        cuiklex_canonicalize(length, buffer);
-
         output->length = length;
         output->data = buffer;
         cuikfs_close(file);
@@ -0,0 +1,166 @@
+// Lets the parser skim the token stream while the preprocessor is still producing it.
+// The TokenTable is append-only so rather than handing over chunks through a queue the
+// preprocessor publishes how far it's gotten every PIPE_CHUNK tokens, the parser reads
+// from its own snapshot of the table and only takes the lock once it's caught up to it.
+//
+// Growing the table can't free the old arrays because the parser might still be reading
+// them, they're retired instead and freed on cuikpp_join. Since the capacity doubles
+// that's at most as much memory as the final table.
+enum {
+    PIPE_CHUNK = 4096,
+};
+
+typedef struct Cuik_TokenPipe Cuik_TokenPipe;
+struct Cuik_TokenPipe {
+    // the preprocessor's own stream, the pipe functions ignore it
+    TokenStream* producer;
+    thrd_t thread;
+    bool has_thread;
+
+    // bumped on every publish, the parser sleeps on it
+    Futex epoch;
+    // only touched by the preprocessor
+    size_t publish_at;
+    // DynArray(void*) arrays the table has grown out of
+    void** retired;
+
+    // everything the parser is allowed to look at
+    mtx_t lock;
+    TokenTable published;
+    bool done;
+    Cuikpp_Status status;
+};
+
+static void* pipe_realloc(Cuik_TokenPipe* pipe, void* ptr, size_t old_size, size_t new_size) {
+    if (pipe == NULL) {
+        return cuik_realloc(ptr, new_size);
+    }
+
+    void* new_ptr = cuik_malloc(new_size);
+    if (ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size);
+        dyn_array_put(pipe->retired, ptr);
+    }
+    return new_ptr;
+}
+
+static void pipe_publish(Cuik_TokenPipe* pipe, TokenTable* l, bool done) {
+    mtx_lock(&pipe->lock);
+    pipe->published = *l;
+    pipe->done = done;
+    mtx_unlock(&pipe->lock);
+
+    pipe->publish_at = l->count + PIPE_CHUNK;
+    pipe->epoch += 1;
+    futex_broadcast(&pipe->epoch);
+}
+
+// pulls the latest snapshot into s, returns true if the preprocessor is done
+static bool pipe_refresh(Cuik_TokenPipe* pipe, TokenStream* s) {
+    mtx_lock(&pipe->lock);
+    size_t current = s->list.current;
+    s->list = pipe->published;
+    s->list.current = current;
+    bool done = pipe->done;
+    mtx_unlock(&pipe->lock);
+    return done;
+}
+
+void cuikpp_pipe_wait(TokenStream* s, size_t i) {
+    Cuik_TokenPipe* pipe = s->pipe;
+    if (s == pipe->producer) {
+        return;
+    }
+
+    for (;;) {
+        Futex epoch = pipe->epoch;
+        if (pipe_refresh(pipe, s) || i < s->list.count) {
+            return;
+        }
+
+        futex_wait(&pipe->epoch, epoch);
+    }
+}
+
+bool cuikpp_pipe_sync(TokenStream* s) {
+    Cuik_TokenPipe* pipe = s->pipe;
+    if (s == pipe->producer) {
+        return true;
+    }
+
+    for (;;) {
+        Futex epoch = pipe->epoch;
+        if (pipe_refresh(pipe, s)) {
+            break;
+        }
+
+        futex_wait(&pipe->epoch, epoch);
+    }
+
+    // the preprocessor doesn't touch its stream once it's done, we can
+    // pick up the finished files & macro invocations.
+    size_t current = s->list.current;
+    *s = *pipe->producer;
+    s->list.current = current;
+    s->pipe = NULL;
+    return pipe->status != CUIKPP_ERROR;
+}
+
+static void pipe_run(Cuik_CPP* ctx) {
+    Cuik_TokenPipe* pipe = ctx->tokens.pipe;
+
+    Cuikpp_Status status = cuikpp_run(ctx);
+    if (status == CUIKPP_ERROR) {
+        // the parser needs an end to stop at
+        tokens_push(&ctx->tokens, &(Token){ 0 });
+    }
+
+    pipe->status = status;
+    pipe_publish(pipe, &ctx->tokens.list, true);
+}
+
+static int pipe_thread(void* arg) {
+    tls_init();
+    pipe_run(arg);
+
+    tb_arena_destroy(&thread_arena);
+    tls_free();
+    return 0;
+}
+
+void cuikpp_run_async(Cuik_CPP* restrict ctx, TokenStream* view) {
+    Cuik_TokenPipe* pipe = cuik_malloc(sizeof(Cuik_TokenPipe));
+    *pipe = (Cuik_TokenPipe){ .producer = &ctx->tokens, .publish_at = PIPE_CHUNK };
+    mtx_init(&pipe->lock, mtx_plain);
+
+    ctx->tokens.pipe = pipe;
+    *view = ctx->tokens;
+
+    #ifdef CUIK_ALLOW_THREADS
+    if (thrd_create(&pipe->thread, pipe_thread, ctx) == thrd_success) {
+        pipe->has_thread = true;
+        return;
+    }
+    #endif
+
+    // no threads, the parser will just find it all done
+    pipe_run(ctx);
+}
+
+Cuikpp_Status cuikpp_join(Cuik_CPP* restrict ctx) {
+    Cuik_TokenPipe* pipe = ctx->tokens.pipe;
+    if (pipe->has_thread) {
+        thrd_join(pipe->thread, NULL);
+    }
+
+    dyn_array_for(i, pipe->retired) {
+        cuik_free(pipe->retired[i]);
+    }
+    dyn_array_destroy(pipe->retired);
+
+    Cuikpp_Status status = pipe->status;
+    ctx->tokens.pipe = NULL;
+    mtx_destroy(&pipe->lock);
+    cuik_free(pipe);
+    return status;
+}
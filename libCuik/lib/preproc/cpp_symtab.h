@@ -1,27 +1,265 @@
+// macro definitions are lexed once when they're defined, expanding them just copies
+// the tokens. the parameters are resolved up front too so substitution doesn't need
+// to compare strings.
+typedef struct MacroBody {
+    int param_count;
+    bool has_varargs;
+    String* params;
+
+    size_t token_count;
+    // locations are offsets into the value (what lexing it as file 0 would give)
+    Token* tokens;
+    // which parameter each token names, -1 if it's not one
+    int16_t* param_refs;
+} MacroBody;
+
+// [https://www.sigbus.info/n1570#6.10p1] This just handles parsing the # define param list
+//
+// After '# define identifier':
+//   lparen identifier-list opt )
+//   lparen ... )
+//   lparen identifier-list , ... )
+//
+// identifier-list:
+//   identifier
+//   identifier-list , identifier
+static bool parse_params(Cuik_CPP* restrict c, MacroArgs* args, Lexer* restrict in) {
+    args->key_count = 0;
+    args->keys = tls_save();
+
+    Token t = lexer_read(in);
+    if (t.type != '(') {
+        fprintf(stderr, "error: expected '('\n");
+        return false;
+    }
 
-static size_t insert_symtab(Cuik_CPP* ctx, size_t len, const char* key) {
-    uint32_t mask = (1u << ctx->macros.exp) - 1;
-    uint32_t hash = tb__murmur3_32((const unsigned char*) key, len);
-    for (size_t i = hash;;) {
-        // hash table lookup
-        uint32_t step = (hash >> (32 - ctx->macros.exp)) | 1;
-        i = (i + step) & mask;
-
-        String* k = &ctx->macros.keys[i];
-        if (k->length == 0 || k->length == MACRO_DEF_TOMBSTONE) {
-            // empty slot
-            if (ctx->macros.len > mask) {
-                printf("Symbol table: out of memory!\n");
-                abort();
+    for (;;) {
+        t = lexer_read(in);
+        if (t.type == 0) return false;
+        if (t.type == ')') break;
+
+        if (args->key_count) {
+            if (t.type != ',') {
+                fprintf(stderr, "error: expected comma\n");
+                return false;
+            }
+
+            t = lexer_read(in);
+        }
+
+        if (t.type == TOKEN_TRIPLE_DOT) {
+            args->has_varargs = true;
+            break;
+        } else if (t.type == TOKEN_IDENTIFIER) {
+            tls_push(sizeof(String));
+
+            args->keys[args->key_count++] = t.content;
+        } else {
+            fprintf(stderr, "error: expected identifier or triple-dot\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static MacroBody* macro_body_create(Cuik_CPP* ctx, MacroArgs* params, size_t token_count, const Token* tokens, const unsigned char* value) {
+    // the shtuffs aren't aligned
+    gimme_the_shtuffs(ctx, -ctx->the_shtuffs_size & 7);
+
+    MacroBody* body = gimme_the_shtuffs(ctx, sizeof(MacroBody));
+    body->param_count = params->key_count;
+    body->has_varargs = params->has_varargs;
+    body->token_count = token_count;
+
+    // everything but the last one is a multiple of 8 bytes
+    body->params     = gimme_the_shtuffs(ctx, params->key_count * sizeof(String));
+    body->tokens     = gimme_the_shtuffs(ctx, token_count * sizeof(Token));
+    body->param_refs = gimme_the_shtuffs(ctx, token_count * sizeof(int16_t));
+    if (params->key_count) {
+        memcpy(body->params, params->keys, params->key_count * sizeof(String));
+    }
+
+    for (size_t i = 0; i < token_count; i++) {
+        Token t = tokens[i];
+        t.expanded = false;
+        t.hit_line = false;
+        t.location = encode_file_loc(0, t.content.data - value);
+        body->tokens[i] = t;
+
+        body->param_refs[i] = -1;
+        if (t.type == TOKEN_IDENTIFIER) {
+            for (int j = 0; j < params->key_count; j++) {
+                if (string_equals(&params->keys[j], &t.content)) {
+                    body->param_refs[i] = j;
+                    break;
+                }
+            }
+        }
+    }
+
+    return body;
+}
+
+
+// Macro table, it's a swiss table: every slot has a control byte which is either EMPTY,
+// DELETED or the low 7 bits of the key's hash. Lookups scan a group of 16 control bytes
+// at once and only compare keys whose tag matches, the groups are probed triangularly
+// so every group gets visited once the table is a power of two. The keys and values
+// live in parallel arrays so the iterators can walk them directly, deleted (and hidden)
+// slots have a key length of MACRO_DEF_TOMBSTONE.
+enum {
+    MACRO_CTRL_EMPTY     = 0x80,
+    MACRO_CTRL_DELETED   = 0xFE,
+    MACRO_GROUP_SIZE     = 16,
+
+    MACRO_TABLE_INIT_EXP = 12,
+};
+
+static int macro_ctz(uint32_t x) {
+    #ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+    #else
+    return __builtin_ctz(x);
+    #endif
+}
+
+// bit i is set if ctrl[i] == tag
+static uint32_t macro_group_match(const uint8_t* ctrl, uint8_t tag) {
+    #if USE_INTRIN && CUIK__IS_X64
+    __m128i bytes = _mm_loadu_si128((const __m128i*) ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag)));
+    #else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < MACRO_GROUP_SIZE; i++) {
+        mask |= (uint32_t) (ctrl[i] == tag) << i;
+    }
+    return mask;
+    #endif
+}
+
+// bit i is set if ctrl[i] is EMPTY or DELETED (they're the only ones with the high bit)
+static uint32_t macro_group_free(const uint8_t* ctrl) {
+    #if USE_INTRIN && CUIK__IS_X64
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+    #else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < MACRO_GROUP_SIZE; i++) {
+        mask |= (uint32_t) (ctrl[i] >> 7) << i;
+    }
+    return mask;
+    #endif
+}
+
+static void macro_table_alloc(Cuik_CPP* ctx, size_t exp) {
+    size_t cap = 1u << exp;
+    ctx->macros.exp  = exp;
+    ctx->macros.len  = 0;
+    ctx->macros.used = 0;
+    ctx->macros.ctrl = cuik__valloc(cap);
+    ctx->macros.keys = cuik__valloc(cap * sizeof(String));
+    ctx->macros.vals = cuik__valloc(cap * sizeof(MacroDef));
+    memset(ctx->macros.ctrl, MACRO_CTRL_EMPTY, cap);
+}
+
+static void macro_table_free(Cuik_CPP* ctx) {
+    size_t cap = 1u << ctx->macros.exp;
+    cuik__vfree(ctx->macros.ctrl, cap);
+    cuik__vfree(ctx->macros.keys, cap * sizeof(String));
+    cuik__vfree(ctx->macros.vals, cap * sizeof(MacroDef));
+}
+
+// returns the slot holding the key or SIZE_MAX, if insert_at is non-NULL it's
+// filled with the first free slot along the probe sequence.
+static size_t macro_table_find(Cuik_CPP* restrict ctx, uint32_t hash, size_t length, const unsigned char* key, size_t* insert_at) {
+    const uint8_t* ctrl = ctx->macros.ctrl;
+    const String* keys = ctx->macros.keys;
+
+    uint8_t tag = hash & 0x7F;
+    size_t group_mask = ((1u << ctx->macros.exp) / MACRO_GROUP_SIZE) - 1;
+    size_t g = (hash >> 7) & group_mask;
+    for (size_t stride = 1; stride <= group_mask + 1; stride++) {
+        const uint8_t* group = &ctrl[g * MACRO_GROUP_SIZE];
+
+        uint32_t match = macro_group_match(group, tag);
+        while (match) {
+            size_t i = g * MACRO_GROUP_SIZE + macro_ctz(match);
+            if (keys[i].length == length && memcmp(key, keys[i].data, length) == 0) {
+                return i;
             }
+            match &= match - 1;
+        }
+
+        uint32_t free_slots = macro_group_free(group);
+        if (insert_at && *insert_at == SIZE_MAX && free_slots) {
+            *insert_at = g * MACRO_GROUP_SIZE + macro_ctz(free_slots);
+        }
+
+        // an empty slot ends the chain, deleted ones don't
+        if (macro_group_match(group, MACRO_CTRL_EMPTY)) {
+            break;
+        }
+        g = (g + stride) & group_mask;
+    }
+
+    return SIZE_MAX;
+}
 
-            ctx->macros.len++;
-            ctx->macros.keys[i] = (String){ len, (const unsigned char*) key };
-            return i;
-        } else if (len == k->length && memcmp(key, k->data, len) == 0) {
-            return i;
+// rebuilds the table without any of the deleted slots, it doubles in size if the
+// live entries would've still made it more than half full.
+static void macro_table_rehash(Cuik_CPP* ctx) {
+    size_t old_cap = 1u << ctx->macros.exp;
+    size_t new_exp = ctx->macros.exp + (ctx->macros.len * 2 >= old_cap);
+
+    uint8_t* old_ctrl = ctx->macros.ctrl;
+    String* old_keys = ctx->macros.keys;
+    MacroDef* old_vals = ctx->macros.vals;
+
+    CUIK_TIMED_BLOCK("rehash macros") {
+        macro_table_alloc(ctx, new_exp);
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old_ctrl[i] & 0x80) continue;
+
+            uint32_t hash = tb__murmur3_32(old_keys[i].data, old_keys[i].length);
+            size_t slot = SIZE_MAX;
+            macro_table_find(ctx, hash, old_keys[i].length, old_keys[i].data, &slot);
+
+            ctx->macros.ctrl[slot] = hash & 0x7F;
+            ctx->macros.keys[slot] = old_keys[i];
+            ctx->macros.vals[slot] = old_vals[i];
+            ctx->macros.len++, ctx->macros.used++;
         }
+
+        cuik__vfree(old_ctrl, old_cap);
+        cuik__vfree(old_keys, old_cap * sizeof(String));
+        cuik__vfree(old_vals, old_cap * sizeof(MacroDef));
+    }
+}
+
+static size_t insert_symtab(Cuik_CPP* ctx, size_t len, const char* key) {
+    uint32_t hash = tb__murmur3_32((const unsigned char*) key, len);
+    size_t slot = SIZE_MAX;
+    size_t i = macro_table_find(ctx, hash, len, (const unsigned char*) key, &slot);
+    if (i != SIZE_MAX) {
+        return i;
+    }
+
+    // keep it under 7/8ths full (deleted slots count since they lengthen the probes)
+    size_t cap = 1u << ctx->macros.exp;
+    if (ctx->macros.ctrl[slot] == MACRO_CTRL_EMPTY && (ctx->macros.used + 1) * 8 > cap * 7) {
+        macro_table_rehash(ctx);
+
+        slot = SIZE_MAX;
+        macro_table_find(ctx, hash, len, (const unsigned char*) key, &slot);
     }
+
+    ctx->macros.used += ctx->macros.ctrl[slot] == MACRO_CTRL_EMPTY;
+    ctx->macros.len++;
+    ctx->macros.ctrl[slot] = hash & 0x7F;
+    ctx->macros.keys[slot] = (String){ len, (const unsigned char*) key };
+    return slot;
 }
 
 void cuikpp_define_empty_cstr(Cuik_CPP* ctx, const char* key) {
@@ -76,8 +314,34 @@ void cuikpp_define(Cuik_CPP* ctx, size_t keylen, const char* key, size_t vallen,
         memset(newvalue + vallen, 0, rem);
     }
 
+    MacroBody* body = NULL;
+    if (vallen > 0) {
+        void* savepoint = tls_save();
+
+        MacroArgs params = { 0 };
+        if (*paren == '(') {
+            Lexer l = { 0, (unsigned char*) paren, (unsigned char*) paren };
+            parse_params(ctx, &params, &l);
+        }
+
+        size_t token_count = 0;
+        Token* tokens = tls_save();
+
+        Lexer l = { 0, (unsigned char*) newvalue, (unsigned char*) newvalue };
+        for (;;) {
+            Token t = lexer_read(&l);
+            if (t.type == 0 || t.hit_line) break;
+
+            tls_push(sizeof(Token));
+            tokens[token_count++] = t;
+        }
+
+        body = macro_body_create(ctx, &params, token_count, tokens, (const unsigned char*) newvalue);
+        tls_restore(savepoint);
+    }
+
     size_t i = insert_symtab(ctx, len, newkey);
-    ctx->macros.vals[i] = (MacroDef){ { vallen, (const unsigned char*) newvalue } };
+    ctx->macros.vals[i] = (MacroDef){ { vallen, (const unsigned char*) newvalue }, .body = body };
 }
 
 bool cuikpp_undef_cstr(Cuik_CPP* ctx, const char* key) {
@@ -85,26 +349,16 @@ bool cuikpp_undef_cstr(Cuik_CPP* ctx, const char* key) {
 }
 
 bool cuikpp_undef(Cuik_CPP* ctx, size_t keylen, const char* key) {
-    uint32_t mask = (1u << ctx->macros.exp) - 1;
     uint32_t hash = tb__murmur3_32(key, keylen);
-    for (size_t i = hash;;) {
-        // hash table lookup
-        uint32_t step = (hash >> (32 - ctx->macros.exp)) | 1;
-        i = (i + step) & mask;
-
-        String* k = &ctx->macros.keys[i];
-        if (k->length == MACRO_DEF_TOMBSTONE) {
-            continue;
-        } else if (k->length == 0) {
-            break;
-        } else if (keylen == k->length && memcmp(key, k->data, keylen) == 0) {
-            ctx->macros.len--;
-            ctx->macros.keys[i] = (String){ MACRO_DEF_TOMBSTONE, 0 };
-            return true;
-        }
+    size_t i = macro_table_find(ctx, hash, keylen, (const unsigned char*) key, NULL);
+    if (i == SIZE_MAX) {
+        return false;
     }
 
-    return false;
+    ctx->macros.len--;
+    ctx->macros.ctrl[i] = MACRO_CTRL_DELETED;
+    ctx->macros.keys[i] = (String){ MACRO_DEF_TOMBSTONE, 0 };
+    return true;
 }
 
 // 16byte based compare
@@ -139,22 +393,10 @@ static bool find_define(Cuik_CPP* restrict ctx, size_t* out_index, const unsigne
     uint64_t start_ns = cuik_time_in_nanos();
     #endif
 
-    bool found = false;
-    uint32_t mask = (1u << ctx->macros.exp) - 1;
-    uint32_t hash = tb__murmur3_32(start, length);
-    for (size_t i = hash;;) {
-        // hash table lookup
-        uint32_t step = (hash >> (32 - ctx->macros.exp)) | 1;
-        i = (i + step) & mask;
-
-        String* k = &ctx->macros.keys[i];
-        if (k->length == 0) {
-            break;
-        } else if (length == k->length && memcmp(start, k->data, length) == 0) {
-            *out_index = i;
-            found = true;
-            break;
-        }
+    size_t i = macro_table_find(ctx, tb__murmur3_32(start, length), length, start, NULL);
+    bool found = i != SIZE_MAX;
+    if (found) {
+        *out_index = i;
     }
 
     #if CUIK__CPP_STATS
@@ -131,7 +131,7 @@ static unsigned char* backslash_join(Lexer* restrict l, unsigned char* start, un
     // find token boundary to shift things correctly
     unsigned char* next_token_bound = current;
     for (unsigned char* s = current;; s++) {
-        if (s[0] == '\0' || s[0] == ' ' || s[0] == '\n') {
+        if (s[0] == '\0' || s[0] == ' ' || s[0] == '\t' || s[0] == '\v' || s[0] == '\f' || s[0] == '\n') {
             next_token_bound = s;
             break;
         } else if (s[0] == '\\' && s[1] == '\n') {
@@ -184,10 +184,10 @@ static Token lexer_read_inline(Lexer* restrict l) {
     // branchless space skip
     current += (*current == ' ');
 
-    // NOTE(NeGate): We canonicalized spaces \t \v
-    // in the preprocessor so we don't need to handle them
+    // NOTE(NeGate): the text isn't canonicalized anymore (it's usually a mapping
+    // of the file) so \t \v \f are whitespace here too
     static uint64_t early_out[4] = {
-        [0] = (1ull << ' ') | (1ull << '\r') | (1ull << '\n') | (1ull << '/'),
+        [0] = (1ull << ' ') | (1ull << '\t') | (1ull << '\v') | (1ull << '\f') | (1ull << '\r') | (1ull << '\n') | (1ull << '/'),
         [1] = (1ull << ('\\' - 64)),
     };
 
@@ -196,7 +196,10 @@ static Token lexer_read_inline(Lexer* restrict l) {
         // SIMD whitespace skip
         __m128i chars = _mm_loadu_si128((__m128i*) current);
         __m128i mask = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
-        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')));
+
+        // \t \n \v \f \r are all in [9, 13], (ch - 9) <= 4 unsigned
+        __m128i ctrl = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8(4)), ctrl));
 
         __m128i line = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n'));
         mask = _mm_or_si128(mask, line);
@@ -212,7 +215,7 @@ static Token lexer_read_inline(Lexer* restrict l) {
         }
         #else
         // skip whitespace
-        while (*current == ' ' || *current == '\t') { current++; }
+        while (*current == ' ' || *current == '\t' || *current == '\v' || *current == '\f') { current++; }
 
         if (*current == '\r' || *current == '\n') {
             current += (current[0] + current[1] == '\r' + '\n') ? 2 : 1;
@@ -115,6 +115,12 @@ ptrdiff_t parse_char(size_t len, const char* str, int* output);
 uint64_t parse_int(size_t len, const char* str, Cuik_IntSuffix* out_suffix);
 TknType classify_ident(const unsigned char* restrict str, size_t len, bool is_glsl);
 
+// parser's side of cuikpp_run_async: wait blocks until token i exists (or the
+// preprocessor is done), sync waits for the whole stream and turns s into a plain
+// copy of it. sync returns false if the preprocessor failed.
+void cuikpp_pipe_wait(TokenStream* s, size_t i);
+bool cuikpp_pipe_sync(TokenStream* s);
+
 static SourceLoc offset_source_loc(SourceLoc loc, uint32_t offset) {
     return (SourceLoc){ loc.raw + offset };
 }
@@ -136,8 +142,38 @@ static SourceLoc encode_macro_loc(uint32_t macro_id, uint32_t macro_offset) {
     return (SourceLoc){ SourceLoc_IsMacro | (macro_id << SourceLoc_MacroOffsetBits) | macro_offset };
 }
 
+// the parser doesn't look at the TokenTable directly, it gets its tokens unpacked
+// from these (they inline well enough that the unused fields don't get loaded).
+static Token tokens_at(TokenStream* restrict s, size_t i) {
+    TokenTable* restrict l = &s->list;
+    if (UNLIKELY(i >= l->count) && s->pipe != NULL) {
+        cuikpp_pipe_wait(s, i);
+    }
+
+    Token t;
+    memcpy(&t, &l->bits[i], sizeof(uint32_t));
+    t.location = l->locations[i];
+
+    TokenText text = l->text[i];
+    if (text.offset == TOKEN_TEXT_IN_FILE) {
+        uint32_t pos = t.location.raw & ((1u << SourceLoc_FilePosBits) - 1);
+        t.content = (String){ text.length, &l->file_text[t.location.raw >> SourceLoc_FilePosBits][pos] };
+    } else {
+        t.content = (String){ text.length, &l->text_data[text.offset] };
+    }
+    return t;
+}
+
+static size_t tokens_length(TokenStream* restrict s) {
+    if (s->pipe != NULL) {
+        cuikpp_pipe_sync(s);
+    }
+
+    return s->list.count;
+}
+
 static bool tokens_peek_double_token(TokenStream* restrict s, TknType tkn) {
-    return s->list.tokens[s->list.current].type == tkn && s->list.tokens[s->list.current + 1].type == tkn;
+    return tokens_at(s, s->list.current).type == tkn && tokens_at(s, s->list.current + 1).type == tkn;
 }
 
 static SourceRange get_token_range(Token* t) {
@@ -149,50 +185,55 @@ static SourceLoc get_end_location(Token* t) {
 }
 
 static SourceLoc tokens_get_last_location(TokenStream* restrict s) {
-    Token* t = &s->list.tokens[s->list.current - 1];
-    return (SourceLoc){ t->location.raw + t->content.length };
+    Token t = tokens_at(s, s->list.current - 1);
+    return (SourceLoc){ t.location.raw + t.content.length };
 }
 
 static SourceLoc tokens_get_location(TokenStream* restrict s) {
-    return s->list.tokens[s->list.current].location;
+    return tokens_at(s, s->list.current).location;
 }
 
 static SourceRange tokens_get_last_range(TokenStream* restrict s) {
-    Token* t = &s->list.tokens[s->list.current - 1];
-    return (SourceRange){ t->location, { t->location.raw + t->content.length } };
+    Token t = tokens_at(s, s->list.current - 1);
+    return get_token_range(&t);
 }
 
 static SourceRange tokens_get_range(TokenStream* restrict s) {
-    Token* t = &s->list.tokens[s->list.current];
-    return (SourceRange){ t->location, { t->location.raw + t->content.length } };
+    Token t = tokens_at(s, s->list.current);
+    return get_token_range(&t);
 }
 
 static bool tokens_hit_line(TokenStream* restrict s) {
-    return s->list.tokens[s->list.current].hit_line;
+    return tokens_at(s, s->list.current).hit_line;
 }
 
 static bool tokens_eof(TokenStream* restrict s) {
-    return s->list.current >= dyn_array_length(s->list.tokens) - 1;
-    // return s->list.tokens[s->list.current].type == 0;
+    // the count isn't final until the preprocessor is done
+    if (UNLIKELY(s->list.current + 1 >= s->list.count) && s->pipe != NULL) {
+        cuikpp_pipe_wait(s, s->list.current + 1);
+    }
+
+    return s->list.current >= s->list.count - 1;
 }
 
 static bool tokens_is(TokenStream* restrict s, TknType type) {
-    return s->list.tokens[s->list.current].type == type;
+    return tokens_at(s, s->list.current).type == type;
 }
 
 static bool tokens_match(TokenStream* restrict s, size_t len, const char* str) {
-    return string_equals(&s->list.tokens[s->list.current].content, &(String){ len, (const unsigned char*) str });
+    Token t = tokens_at(s, s->list.current);
+    return string_equals(&t.content, &(String){ len, (const unsigned char*) str });
 }
 
 // this is used by the parser to get the next token
-static Token* tokens_get(TokenStream* restrict s) {
-    return &s->list.tokens[s->list.current];
+static Token tokens_get(TokenStream* restrict s) {
+    return tokens_at(s, s->list.current);
 }
 
 // there should be a NULL token so as long as we can read [current]
 // we can read one ahead.
-static Token* tokens_peek(TokenStream* restrict s) {
-    return &s->list.tokens[s->list.current + 1];
+static Token tokens_peek(TokenStream* restrict s) {
+    return tokens_at(s, s->list.current + 1);
 }
 
 static void tokens_prev(TokenStream* restrict s) {
@@ -201,6 +242,6 @@ static void tokens_prev(TokenStream* restrict s) {
 }
 
 static void tokens_next(TokenStream* restrict s) {
-    assert(s->list.current < dyn_array_length(s->list.tokens));
+    assert(s->pipe != NULL || s->list.current < s->list.count);
     s->list.current += 1;
 }
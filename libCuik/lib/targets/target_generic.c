@@ -37,6 +37,7 @@ void target_generic_fill_builtin_table(BuiltinTable* builtins) {
 
     X(__builtin_unreachable, " v");
     X(__builtin_syscall, ". v");
+    X(__builtin_shufflevector, "TT. T");
 
     // cuik internal
     X(__c11_atomic_thread_fence,            "i v");
@@ -248,6 +249,28 @@ BuiltinResult target_generic_compile_builtin(TranslationUnit* tu, TB_Function* f
         TB_Node* result = tb_inst_syscall(func, TB_TYPE_I64, num, arg_count - 2, arg_regs);
         tls_restore(arg_regs);
 
+        return ZZZ(result);
+    } else if (strcmp(name, "__builtin_shufflevector") == 0) {
+        // sema already checked the vectors, the lane count and that the indices
+        // are in-range literals (see sema_shufflevector)
+        TB_Node* a = RVAL(1);
+        TB_Node* b = RVAL(2);
+        assert(a->dt.type == TB_VECTOR);
+
+        // the lane indices go across both vectors, a is [0, lanes) and b is [lanes, 2*lanes)
+        size_t count = arg_count - 3;
+        assert(count == TB_GET_VECTOR_LANES(a->dt));
+
+        uint8_t* indices = tls_push(count);
+        for (size_t i = 0; i < count; i++) {
+            TB_Node* n = RVAL(i + 3);
+            assert(n->type == TB_INTEGER_CONST);
+            indices[i] = TB_NODE_GET_EXTRA_T(n, TB_NodeInt)->value;
+        }
+
+        TB_Node* result = tb_inst_vshuffle(func, a, b, count, indices);
+        tls_restore(indices);
+
         return ZZZ(result);
     } else if (strcmp(name, "__assume") == 0) {
         TB_Node* cond = RVAL(1);
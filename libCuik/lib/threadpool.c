@@ -3,10 +3,9 @@
 #include <string.h>
 #include <threads.h>
 #include <stdatomic.h>
+#include <futex.h>
 
 #ifndef _WIN32
-#include <semaphore.h>
-
 #include <dirent.h>
 #include <errno.h>
 #include <unistd.h>
@@ -22,10 +21,9 @@ extern void spallperf__start_thread(void);
 extern void spallperf__stop_thread(void);
 #endif
 
-// 1 << QEXP is the size of the queue per pool
-#define QEXP 7
+// 1 << DEQUE_EXP is the initial size of each worker's deque, they grow on demand
+#define DEQUE_EXP 8
 
-typedef _Atomic uint32_t atomic_uint32_t;
 typedef void work_routine(void*);
 
 typedef struct {
@@ -33,72 +31,270 @@ typedef struct {
     char arg[56];
 } work_t;
 
-// Inspired by:
-//   https://github.com/skeeto/scratch/blob/master/misc/queue.c
+// circular buffer backing a deque, once we grow the old buffer is kept
+// around until the pool dies because a thief might still be reading it.
+typedef struct WorkArray WorkArray;
+struct WorkArray {
+    WorkArray* prev;
+    size_t mask;
+    work_t data[];
+};
+
+// Chase-Lev work stealing deque:
+//   https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+//
+// and the C11 atomics version of it:
+//   https://fzn.fr/readings/ppopp13.pdf
+//
+// the owner pushes & pops from the bottom while thieves take from the top.
+typedef struct {
+    _Atomic int64_t top;
+    char pad1[56];
+
+    _Atomic int64_t bottom;
+    _Atomic(WorkArray*) array;
+    char pad2[48];
+} WorkDeque;
+
+typedef struct threadpool_t threadpool_t;
+
 typedef struct {
+    threadpool_t* pool;
+    int index;
+
+    // xorshift state for picking victims
+    uint32_t rng;
+} Worker;
+
+struct threadpool_t {
     Cuik_IThreadpool super;
 
     atomic_bool running;
 
-    // this skeeto guy is kinda sick wit it
-    atomic_uint32_t queue;
-    atomic_uint32_t jobs_done;
+    // number of submitted jobs which haven't finished yet
+    _Atomic int64_t jobs_left;
+
+    // bumped on every submission, idle workers sleep on it
+    Futex epoch;
+    _Atomic int sleepers;
 
     int thread_count;
-    work_t* work;
     thrd_t* threads;
+    Worker* workers;
+    WorkDeque* deques;
+
+    // jobs submitted by threads outside of the pool end up
+    // here, it's a plain growable ring buffer under a lock.
+    struct {
+        mtx_t lock;
+        _Atomic size_t count;
+        size_t head, cap;
+        work_t* data;
+    } inject;
+};
+
+static thread_local Worker* tp_current_worker;
+
+static WorkArray* work_array_alloc(size_t cap, WorkArray* prev) {
+    WorkArray* a = cuik_malloc(sizeof(WorkArray) + cap * sizeof(work_t));
+    a->prev = prev;
+    a->mask = cap - 1;
+    return a;
+}
 
-    #ifdef _WIN32
-    HANDLE sem;
-    #else
-    sem_t sem;
-    #endif
-} threadpool_t;
+static void deque_init(WorkDeque* q) {
+    atomic_store_explicit(&q->top, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->array, work_array_alloc(1u << DEQUE_EXP, NULL), memory_order_relaxed);
+}
 
-static work_t* ask_for_work(threadpool_t* threadpool, uint32_t* save) {
-    uint32_t r = *save = threadpool->queue;
-    uint32_t mask = (1u << QEXP) - 1;
-    uint32_t head = r & mask;
-    uint32_t tail = (r >> 16) & mask;
+static void deque_free(WorkDeque* q) {
+    WorkArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    while (a != NULL) {
+        WorkArray* prev = a->prev;
+        cuik_free(a);
+        a = prev;
+    }
+}
+
+// only called by the owner
+static void deque_push(WorkDeque* q, const work_t* w) {
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+    WorkArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+
+    if (b - t > (int64_t) a->mask) {
+        // it don't fit... double the size
+        WorkArray* new_a = work_array_alloc((a->mask + 1) * 2, a);
+        for (int64_t i = t; i < b; i++) {
+            new_a->data[i & new_a->mask] = a->data[i & a->mask];
+        }
 
-    return head != tail ? &threadpool->work[tail] : NULL;
+        atomic_store_explicit(&q->array, new_a, memory_order_release);
+        a = new_a;
+    }
+
+    a->data[b & a->mask] = *w;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
 }
 
-static bool do_work(threadpool_t* threadpool) {
-    uint32_t save;
-    work_t* job = NULL;
-    work_t tmp;
-
-    do {
-        job = ask_for_work(threadpool, &save);
-        if (job == NULL) {
-            // take a nap if we ain't find shit
+// only called by the owner
+static bool deque_pop(WorkDeque* q, work_t* out) {
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    WorkArray* a = atomic_load_explicit(&q->array, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+    if (t > b) {
+        // empty
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *out = a->data[b & a->mask];
+    if (t == b) {
+        // last item, we race the thieves for it
+        bool won = atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+
+    return true;
+}
+
+// can be called by anyone
+static bool deque_steal(WorkDeque* q, work_t* out) {
+    int64_t t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+
+    if (t < b) {
+        WorkArray* a = atomic_load_explicit(&q->array, memory_order_acquire);
+        work_t tmp = a->data[t & a->mask];
+
+        // copy out before we commit
+        if (atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            *out = tmp;
             return true;
         }
+    }
 
-        // copy out before we commit
-        tmp = *job;
-    } while (!atomic_compare_exchange_strong(&threadpool->queue, &save, save + 0x10000));
+    return false;
+}
+
+static void inject_push(threadpool_t* threadpool, const work_t* w) {
+    mtx_lock(&threadpool->inject.lock);
+    size_t count = threadpool->inject.count;
+    if (count == threadpool->inject.cap) {
+        size_t old_cap = threadpool->inject.cap;
+        size_t new_cap = old_cap ? old_cap * 2 : 64;
+
+        // unroll the ring into the new buffer
+        work_t* new_data = cuik_malloc(new_cap * sizeof(work_t));
+        for (size_t i = 0; i < count; i++) {
+            new_data[i] = threadpool->inject.data[(threadpool->inject.head + i) & (old_cap - 1)];
+        }
+
+        cuik_free(threadpool->inject.data);
+        threadpool->inject.data = new_data;
+        threadpool->inject.head = 0;
+        threadpool->inject.cap = new_cap;
+    }
+
+    size_t i = (threadpool->inject.head + count) & (threadpool->inject.cap - 1);
+    threadpool->inject.data[i] = *w;
+    threadpool->inject.count = count + 1;
+    mtx_unlock(&threadpool->inject.lock);
+}
+
+static bool inject_pop(threadpool_t* threadpool, work_t* out) {
+    // cheap check so we don't hammer the lock when it's empty
+    if (atomic_load_explicit(&threadpool->inject.count, memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    bool found = false;
+    mtx_lock(&threadpool->inject.lock);
+    if (threadpool->inject.count > 0) {
+        *out = threadpool->inject.data[threadpool->inject.head];
+        threadpool->inject.head = (threadpool->inject.head + 1) & (threadpool->inject.cap - 1);
+        threadpool->inject.count -= 1;
+        found = true;
+    }
+    mtx_unlock(&threadpool->inject.lock);
+    return found;
+}
+
+static bool ask_for_work(threadpool_t* threadpool, work_t* out) {
+    Worker* me = tp_current_worker;
+    if (me != NULL && me->pool != threadpool) {
+        me = NULL;
+    }
+
+    // our own work is the hottest in cache
+    if (me != NULL && deque_pop(&threadpool->deques[me->index], out)) {
+        return true;
+    }
+
+    if (inject_pop(threadpool, out)) {
+        return true;
+    }
+
+    // go steal from the others starting at some random victim
+    int n = threadpool->thread_count;
+    int start = 0;
+    if (me != NULL) {
+        uint32_t x = me->rng;
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        me->rng = x;
+        start = x % n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int victim = (start + i) % n;
+        if (me != NULL && victim == me->index) continue;
+
+        if (deque_steal(&threadpool->deques[victim], out)) {
+            return true;
+        }
+    }
 
-    tmp.fn(tmp.arg);
-    threadpool->jobs_done -= 1;
+    return false;
+}
+
+static bool do_work(threadpool_t* threadpool) {
+    work_t job;
+    if (!ask_for_work(threadpool, &job)) {
+        // take a nap if we ain't find shit
+        return true;
+    }
+
+    job.fn(job.arg);
+    atomic_fetch_sub_explicit(&threadpool->jobs_left, 1, memory_order_release);
     return false;
 }
 
 static int thread_func(void* arg) {
-    threadpool_t* threadpool = arg;
+    Worker* me = arg;
+    threadpool_t* threadpool = me->pool;
+    tp_current_worker = me;
 
     #ifdef CUIK_USE_CUIK
     spallperf__start_thread();
     #endif
 
-    while (threadpool->running) {
+    while (atomic_load_explicit(&threadpool->running, memory_order_relaxed)) {
         if (do_work(threadpool)) {
-            #ifdef _WIN32
-            WaitForSingleObjectEx(threadpool->sem, -1, false); // wait for jobs
-            #else
-            sem_wait(&threadpool->sem);
-            #endif
+            // park on the epoch, anyone who submits after we've read it will
+            // have bumped it so the futex won't go to sleep on a stale value.
+            int64_t epoch = threadpool->epoch;
+            threadpool->sleepers += 1;
+            if (threadpool->running && do_work(threadpool)) {
+                futex_wait(&threadpool->epoch, epoch);
+            }
+            threadpool->sleepers -= 1;
         }
     }
 
@@ -112,46 +308,32 @@ static int thread_func(void* arg) {
 }
 
 void threadpool_submit(threadpool_t* threadpool, work_routine fn, size_t arg_size, void* arg) {
-    ptrdiff_t i = 0;
-    for (;;) {
-        // might wanna change the memory order on this atomic op
-        uint32_t r = threadpool->queue;
-
-        uint32_t mask = (1u << QEXP) - 1;
-        uint32_t head = r & mask;
-        uint32_t tail = (r >> 16) & mask;
-        uint32_t next = (head + 1u) & mask;
-        if (r & 0x8000) { // avoid overflow on commit
-            threadpool->queue &= ~0x8000;
-        }
-
-        // it don't fit...
-        if (next != tail) {
-            i = head;
-            break;
-        }
+    work_t w;
+    assert(arg_size <= sizeof(w.arg));
+    w.fn = fn;
+    memcpy(w.arg, arg, arg_size);
+
+    atomic_fetch_add_explicit(&threadpool->jobs_left, 1, memory_order_relaxed);
+
+    Worker* me = tp_current_worker;
+    if (me != NULL && me->pool == threadpool) {
+        deque_push(&threadpool->deques[me->index], &w);
+    } else {
+        inject_push(threadpool, &w);
     }
 
-    assert(arg_size <= sizeof(threadpool->work[i].arg));
-    threadpool->work[i].fn = fn;
-    memcpy(threadpool->work[i].arg, arg, arg_size);
-
-    threadpool->jobs_done += 1;
-    threadpool->queue += 1;
-
-    #ifdef _WIN32
-    ReleaseSemaphore(threadpool->sem, 1, 0);
-    #else
-    sem_post(&threadpool->sem);
-    #endif
+    threadpool->epoch += 1;
+    if (threadpool->sleepers > 0) {
+        futex_signal(&threadpool->epoch);
+    }
 }
 
-void threadpool_work_one_job(threadpool_t* threadpool) {
-    do_work(threadpool);
+bool threadpool_work_one_job(threadpool_t* threadpool) {
+    return !do_work(threadpool);
 }
 
 void threadpool_work_while_wait(threadpool_t* threadpool) {
-    while (threadpool->jobs_done > 0) {
+    while (threadpool->jobs_left > 0) {
         if (do_work(threadpool)) {
             thrd_yield();
         }
@@ -159,12 +341,38 @@ void threadpool_work_while_wait(threadpool_t* threadpool) {
 }
 
 void threadpool_wait(threadpool_t* threadpool) {
-    while (threadpool->jobs_done > 0) {
+    while (threadpool->jobs_left > 0) {
         thrd_yield();
     }
 }
 
+// stops the first started workers and frees everything, any jobs still
+// queued are dropped.
+static void threadpool_shutdown(threadpool_t* threadpool, int started) {
+    threadpool->running = false;
+
+    // wake everyone
+    threadpool->epoch += 1;
+    futex_broadcast(&threadpool->epoch);
+
+    for (int i = 0; i < started; i++) {
+        thrd_join(threadpool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < threadpool->thread_count; i++) {
+        deque_free(&threadpool->deques[i]);
+    }
+
+    mtx_destroy(&threadpool->inject.lock);
+    cuik_free(threadpool->inject.data);
+    cuik_free(threadpool->deques);
+    cuik_free(threadpool->workers);
+    cuik_free(threadpool->threads);
+    cuik_free(threadpool);
+}
+
 void threadpool_free(threadpool_t* threadpool) {
+    threadpool_shutdown(threadpool, threadpool->thread_count);
 }
 
 int threadpool_get_thread_count(threadpool_t* threadpool) {
@@ -175,8 +383,8 @@ static void threadpool__submit(void* user_data, Cuik_TaskFn fn, size_t arg_size,
     threadpool_submit(user_data, fn, arg_size, arg);
 }
 
-static void threadpool__work_one_job(void* user_data) {
-    threadpool_work_one_job(user_data);
+static bool threadpool__work_one_job(void* user_data) {
+    return threadpool_work_one_job(user_data);
 }
 
 Cuik_IThreadpool* cuik_threadpool_create(int worker_count) {
@@ -184,27 +392,25 @@ Cuik_IThreadpool* cuik_threadpool_create(int worker_count) {
         return NULL;
     }
 
-    size_t workqueue_size = 1u << QEXP;
     threadpool_t* tp = cuik_calloc(1, sizeof(threadpool_t));
     tp->super.submit = threadpool__submit;
     tp->super.work_one_job = threadpool__work_one_job;
-    tp->work = cuik_malloc(workqueue_size * sizeof(work_t));
     tp->threads = cuik_malloc(worker_count * sizeof(thrd_t));
+    tp->workers = cuik_malloc(worker_count * sizeof(Worker));
+    tp->deques = cuik_calloc(worker_count, sizeof(WorkDeque));
     tp->thread_count = worker_count;
     tp->running = true;
+    mtx_init(&tp->inject.lock, mtx_plain);
 
-    #if _WIN32
-    tp->sem = CreateSemaphoreExA(0, worker_count, worker_count, 0, 0, SEMAPHORE_ALL_ACCESS);
-    #else
-    if (sem_init(&tp->sem, 0 /* shared between threads */, worker_count) != 0) {
-        fprintf(stderr, "error: could not create semaphore!\n");
-        return NULL;
+    for (int i = 0; i < worker_count; i++) {
+        deque_init(&tp->deques[i]);
+        tp->workers[i] = (Worker){ tp, i, 2463534242u + i*0x9E3779B9u };
     }
-    #endif
 
     for (int i = 0; i < worker_count; i++) {
-        if (thrd_create(&tp->threads[i], thread_func, tp) != thrd_success) {
+        if (thrd_create(&tp->threads[i], thread_func, &tp->workers[i]) != thrd_success) {
             fprintf(stderr, "error: could not create worker threads!\n");
+            threadpool_shutdown(tp, i);
             return NULL;
         }
     }
@@ -213,35 +419,7 @@ Cuik_IThreadpool* cuik_threadpool_create(int worker_count) {
 }
 
 void cuik_threadpool_destroy(Cuik_IThreadpool* thread_pool) {
-    if (thread_pool == NULL) {
-        return;
+    if (thread_pool != NULL) {
+        threadpool_free((threadpool_t*) thread_pool);
     }
-
-    threadpool_t* tp = (threadpool_t*) thread_pool;
-    tp->running = false;
-
-    #ifdef _WIN32
-    ReleaseSemaphore(tp->sem, tp->thread_count, 0);
-    WaitForMultipleObjects(tp->thread_count, tp->threads, TRUE, INFINITE);
-
-    for (int i = 0; i < tp->thread_count; i++) {
-        thrd_join(tp->threads[i], NULL);
-    }
-    CloseHandle(tp->sem);
-    #else
-    // wake everyone
-    for (size_t i = 0; i < tp->thread_count; i++) {
-        sem_post(&tp->sem);
-    }
-
-    for (int i = 0; i < tp->thread_count; i++) {
-        thrd_join(tp->threads[i], NULL);
-    }
-
-    sem_destroy(&tp->sem);
-    #endif
-
-    cuik_free(tp->threads);
-    cuik_free(tp->work);
-    cuik_free(tp);
 }
@@ -28,6 +28,13 @@ void tls_reset(void) {
     temp_storage->used = 0;
 }
 
+void tls_free(void) {
+    if (temp_storage != NULL) {
+        cuik__vfree(temp_storage, TEMPORARY_STORAGE_SIZE);
+        temp_storage = NULL;
+    }
+}
+
 void* tls_push(size_t size) {
     if (sizeof(TemporaryStorage) + temp_storage->used + size >= TEMPORARY_STORAGE_SIZE) {
         printf("temporary storage: out of memory!\n");
@@ -94,6 +94,28 @@ static void test_diag(void) {
 }
 #endif
 
+// compiles and links the sources, returns the exit status
+static int compile(Cuik_DriverArgs* args, Cuik_IThreadpool* tp) {
+    size_t obj_count = dyn_array_length(args->sources);
+    Cuik_BuildStep** objs = cuik_malloc(obj_count * sizeof(Cuik_BuildStep*));
+    dyn_array_for(i, args->sources) {
+        objs[i] = cuik_driver_cc(args, args->sources[i]->data);
+    }
+
+    // link (if no codegen is performed this doesn't *really* do much)
+    int status = EXIT_SUCCESS;
+    Cuik_BuildStep* linked = cuik_driver_ld(args, obj_count, objs);
+    if (!cuik_step_run(linked, tp)) {
+        status = 1;
+    }
+
+    cuik_step_free(linked);
+    cuik_free(objs);
+    return status;
+}
+
+#include "server.h"
+
 int main(int argc, const char** argv) {
     #ifdef CUIK_USE_SPALL_AUTO
     spall_auto_init("perf.spall");
@@ -111,6 +133,8 @@ int main(int argc, const char** argv) {
         #endif
 
         if (strcmp(argv[1], "-bindgen") == 0) return run_bindgen(argc - 2, argv + 2);
+        if (strcmp(argv[1], "--server") == 0) return run_server(argc - 2, argv + 2);
+        if (strcmp(argv[1], "--connect") == 0) return run_client(argc - 2, argv + 2);
     }
 
     log_set_level(LOG_DEBUG);
@@ -195,21 +219,17 @@ int main(int argc, const char** argv) {
     }
     #endif
 
-    // compile source files
-    size_t obj_count = dyn_array_length(args.sources);
-    Cuik_BuildStep** objs = cuik_malloc(obj_count * sizeof(Cuik_BuildStep*));
-    dyn_array_for(i, args.sources) {
-        objs[i] = cuik_driver_cc(&args, args.sources[i]->data);
+    if (dyn_array_length(args.sources) > 1) {
+        // the translation units can share headers
+        args.file_cache = cuikpp_file_cache_create();
     }
 
-    // link (if no codegen is performed this doesn't *really* do much)
-    Cuik_BuildStep* linked = cuik_driver_ld(&args, obj_count, objs);
-    if (!cuik_step_run(linked, tp)) {
-        status = 1;
-    }
+    status = compile(&args, tp);
 
-    cuik_step_free(linked);
-    cuik_free(objs);
+    if (args.file_cache) {
+        cuikpp_file_cache_destroy(args.file_cache);
+        args.file_cache = NULL;
+    }
 
     #if CUIK_ALLOW_THREADS
     cuik_threadpool_destroy(tp);
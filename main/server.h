@@ -0,0 +1,433 @@
+// Compilation server, `cuik --server` keeps a process around and `cuik --connect` hands
+// it the same arguments you'd normally pass to cuik:
+//
+//   cuik --server [socket]
+//   cuik --connect <driver args>
+//
+// Headers are read and lexed once and stay in the shared file cache between builds
+// (along with the atoms, the thread pool and the per thread arenas), inotify tells us
+// when one of them changes so it can be dropped from the cache. Macros, ASTs and IR
+// are still per build since they depend on the arguments and the source file.
+//
+// The client sends its working directory and argument vector and passes its stdout
+// and stderr along over the socket so the build writes straight into them, the reply
+// is just the exit status. Requests are handled one at a time.
+//
+// The socket defaults to $CUIK_SOCKET, then $XDG_RUNTIME_DIR/cuik.sock and then
+// /tmp/cuik-<uid>.sock
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+enum {
+    SERVER_MAGIC = 0x4B495543, // "CUIK"
+    // no argument vector is anywhere near this big
+    SERVER_MAX_REQUEST = 1 << 20,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t argc;
+    // size of the payload which follows: the working directory and then the
+    // arguments, all null terminated.
+    uint32_t size;
+} ServerRequest;
+
+typedef struct {
+    Cuik_FileCache* file_cache;
+
+    int threads;
+    Cuik_IThreadpool* tp;
+
+    int inotify;
+    // indexed by watch descriptor, NULL if it's not in use
+    DynArray(char*) watches;
+} Server;
+
+static void server_socket_path(struct sockaddr_un* addr, const char* path) {
+    *addr = (struct sockaddr_un){ .sun_family = AF_UNIX };
+
+    const char* env;
+    if (path != NULL) {
+        snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", path);
+    } else if (env = getenv("CUIK_SOCKET"), env != NULL) {
+        snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", env);
+    } else if (env = getenv("XDG_RUNTIME_DIR"), env != NULL) {
+        snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/cuik.sock", env);
+    } else {
+        snprintf(addr->sun_path, sizeof(addr->sun_path), "/tmp/cuik-%d.sock", (int) getuid());
+    }
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* p = data;
+    while (size > 0) {
+        ssize_t r = write(fd, p, size);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+
+        p += r, size -= r;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size) {
+    char* p = data;
+    while (size > 0) {
+        ssize_t r = read(fd, p, size);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+
+        p += r, size -= r;
+    }
+    return true;
+}
+
+////////////////////////////////
+// Client
+////////////////////////////////
+int run_client(int argc, const char** argv) {
+    struct sockaddr_un addr;
+    server_socket_path(&addr, NULL);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "error: could not connect to cuik server at %s (%s)\n", addr.sun_path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char cwd[FILENAME_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        fprintf(stderr, "error: could not get working directory\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t size = strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+
+    if (size >= SERVER_MAX_REQUEST) {
+        fprintf(stderr, "error: argument list is too long for the cuik server\n");
+        return EXIT_FAILURE;
+    }
+
+    char* payload = cuik_malloc(size);
+    char* p = payload;
+    p = stpcpy(p, cwd) + 1;
+    for (int i = 0; i < argc; i++) {
+        p = stpcpy(p, argv[i]) + 1;
+    }
+
+    // the header carries our stdout and stderr
+    ServerRequest req = { SERVER_MAGIC, argc, size };
+    struct iovec iov = { &req, sizeof(req) };
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } ctrl = { 0 };
+
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctrl.buf, .msg_controllen = sizeof(ctrl.buf),
+    };
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), (int[]){ STDOUT_FILENO, STDERR_FILENO }, 2 * sizeof(int));
+
+    fflush(stdout);
+    fflush(stderr);
+
+    int32_t status = EXIT_FAILURE;
+    if (sendmsg(fd, &msg, 0) != sizeof(req) || !write_all(fd, payload, size) || !read_all(fd, &status, sizeof(status))) {
+        fprintf(stderr, "error: lost connection to the cuik server\n");
+        status = EXIT_FAILURE;
+    }
+
+    cuik_free(payload);
+    close(fd);
+    return status;
+}
+
+////////////////////////////////
+// Server
+////////////////////////////////
+static void server_watch(void* user_data, const char* path) {
+    Server* s = user_data;
+
+    // watching the same file again just hands back the same descriptor
+    int wd = inotify_add_watch(s->inotify, path, IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF);
+    if (wd < 0) {
+        return;
+    }
+
+    while (dyn_array_length(s->watches) <= (size_t) wd) {
+        dyn_array_put(s->watches, NULL);
+    }
+
+    if (s->watches[wd] == NULL) {
+        s->watches[wd] = cuik_strdup(path);
+    }
+}
+
+static void server_drop_watches(Server* s) {
+    dyn_array_for(i, s->watches) {
+        if (s->watches[i] != NULL) {
+            inotify_rm_watch(s->inotify, i);
+            cuik_free(s->watches[i]);
+            s->watches[i] = NULL;
+        }
+    }
+}
+
+// invalidates whatever changed since the last build
+static void server_poll_changes(Server* s) {
+    _Alignas(struct inotify_event) char buffer[4096];
+
+    ssize_t r;
+    while (r = read(s->inotify, buffer, sizeof(buffer)), r > 0) {
+        for (char* p = buffer; p < buffer + r;) {
+            struct inotify_event* ev = (struct inotify_event*) p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // we don't know what we missed so everything goes
+                server_drop_watches(s);
+                cuikpp_file_cache_destroy(s->file_cache);
+                s->file_cache = cuikpp_file_cache_create();
+                continue;
+            }
+
+            if (ev->wd < 0 || ev->wd >= dyn_array_length(s->watches) || s->watches[ev->wd] == NULL) {
+                continue;
+            }
+
+            cuikpp_file_cache_invalidate(s->file_cache, s->watches[ev->wd]);
+
+            // editors tend to save by renaming a new file over the old one, that watch
+            // is dead and the reload will make a new one.
+            if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                if (!(ev->mask & IN_IGNORED)) {
+                    inotify_rm_watch(s->inotify, ev->wd);
+                }
+
+                cuik_free(s->watches[ev->wd]);
+                s->watches[ev->wd] = NULL;
+            }
+        }
+    }
+}
+
+static int server_compile(Server* s, int argc, const char** argv) {
+    Cuik_DriverArgs args = {
+        .version   = CUIK_VERSION_C23,
+        .toolchain = cuik_toolchain_host(),
+
+        #ifdef CUIK_USE_TB
+        .flavor    = TB_FLAVOR_EXECUTABLE,
+        #endif
+    };
+
+    int status = EXIT_SUCCESS;
+    if (!cuik_parse_driver_args(&args, argc, argv)) {
+        goto done;
+    }
+
+    if (args.target == NULL) {
+        args.target = cuik_target_host();
+    }
+
+    if (dyn_array_length(args.sources) == 0) {
+        fprintf(stderr, "error: no input files!\n");
+        status = EXIT_FAILURE;
+        goto done;
+    }
+
+    // the pool only ever grows
+    #if CUIK_ALLOW_THREADS
+    if (args.threads > s->threads) {
+        cuik_threadpool_destroy(s->tp);
+        s->tp = cuik_threadpool_create(args.threads);
+        s->threads = args.threads;
+    }
+    #endif
+
+    args.file_cache = s->file_cache;
+    status = compile(&args, args.threads > 1 ? s->tp : NULL);
+    args.file_cache = NULL;
+
+    done:
+    cuik_toolchain_free(&args.toolchain);
+    if (args.target) cuik_free_target(args.target);
+    cuik_free_driver_args(&args);
+    return status;
+}
+
+static void server_handle(Server* s, int conn) {
+    ServerRequest req;
+    struct iovec iov = { &req, sizeof(req) };
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } ctrl;
+
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctrl.buf, .msg_controllen = sizeof(ctrl.buf),
+    };
+
+    ssize_t r = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        return;
+    }
+
+    int fds[2];
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    char* payload = NULL;
+    if (r != sizeof(req) || req.magic != SERVER_MAGIC || req.size == 0 || req.size >= SERVER_MAX_REQUEST) {
+        goto done;
+    }
+
+    payload = cuik_malloc(req.size + 1);
+    if (!read_all(conn, payload, req.size)) {
+        goto done;
+    }
+    payload[req.size] = 0;
+
+    // unpack the working directory and arguments
+    const char* cwd = payload;
+    const char** argv = cuik_malloc((req.argc + 1) * sizeof(const char*));
+    const char* p = payload + strlen(cwd) + 1;
+    int argc = 0;
+    for (; argc < req.argc && p < payload + req.size; argc++) {
+        argv[argc] = p;
+        p += strlen(p) + 1;
+    }
+    argv[argc] = NULL;
+
+    char old_cwd[FILENAME_MAX];
+    if (getcwd(old_cwd, sizeof(old_cwd)) == NULL || chdir(cwd) != 0) {
+        dprintf(fds[1], "error: cuik server could not enter %s\n", cwd);
+        cuik_free(argv);
+        goto done;
+    }
+
+    // files can change between being loaded and being watched, the
+    // cache double checks those on their first use this build.
+    server_poll_changes(s);
+    cuikpp_file_cache_next_build(s->file_cache);
+
+    // build output goes straight to the client
+    int old_out = dup(STDOUT_FILENO), old_err = dup(STDERR_FILENO);
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+
+    int32_t status = server_compile(s, argc, argv);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(old_out, STDOUT_FILENO);
+    dup2(old_err, STDERR_FILENO);
+    close(old_out);
+    close(old_err);
+
+    if (chdir(old_cwd) != 0) {
+        fprintf(stderr, "warning: cuik server could not go back to %s\n", old_cwd);
+    }
+
+    // anything the build loaded should be watched now
+    cuikpp_file_cache_for_each(s->file_cache, s, server_watch);
+
+    write_all(conn, &status, sizeof(status));
+    cuik_free(argv);
+
+    done:
+    cuik_free(payload);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int run_server(int argc, const char** argv) {
+    struct sockaddr_un addr;
+    server_socket_path(&addr, argc > 0 ? argv[0] : NULL);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "error: could not make socket (%s)\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // a dead server might've left the socket behind
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        fprintf(stderr, "error: could not listen on %s (%s)\n", addr.sun_path, strerror(errno));
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    // clients hanging up shouldn't take us with them
+    signal(SIGPIPE, SIG_IGN);
+
+    Server s = {
+        .file_cache = cuikpp_file_cache_create(),
+        .inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC),
+        .watches = dyn_array_create(char*, 64),
+    };
+
+    if (s.inotify < 0) {
+        fprintf(stderr, "error: could not start inotify (%s)\n", strerror(errno));
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    printf("cuik server listening on %s\n", addr.sun_path);
+    fflush(stdout);
+
+    for (;;) {
+        int conn = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+
+            fprintf(stderr, "error: accept failed (%s)\n", strerror(errno));
+            break;
+        }
+
+        server_handle(&s, conn);
+        close(conn);
+    }
+
+    server_drop_watches(&s);
+    dyn_array_destroy(s.watches);
+    close(s.inotify);
+    cuikpp_file_cache_destroy(s.file_cache);
+
+    #if CUIK_ALLOW_THREADS
+    cuik_threadpool_destroy(s.tp);
+    #endif
+
+    close(fd);
+    unlink(addr.sun_path);
+    return EXIT_FAILURE;
+}
+#else
+int run_client(int argc, const char** argv) {
+    fprintf(stderr, "error: --connect is only supported on Linux for now\n");
+    return EXIT_FAILURE;
+}
+
+int run_server(int argc, const char** argv) {
+    fprintf(stderr, "error: --server is only supported on Linux for now\n");
+    return EXIT_FAILURE;
+}
+#endif
@@ -168,6 +168,9 @@ typedef enum TB_DataTypeEnum {
     TB_CONT,
     // Tuples, these cannot be used in memory ops, just accessed via projections
     TB_TUPLE,
+    // SIMD vectors, the data packs the log2 of the lane count in the low 4 bits
+    // followed by the element's data and then a bit for float elements.
+    TB_VECTOR,
 } TB_DataTypeEnum;
 
 typedef enum TB_FloatFormat {
@@ -191,11 +194,13 @@ static_assert(sizeof(TB_DataType) == 2, "im expecting this to be a uint16_t");
 #define TB_IS_INTEGER_TYPE(x)  ((x).type == TB_INT)
 #define TB_IS_FLOAT_TYPE(x)    ((x).type == TB_FLOAT)
 #define TB_IS_POINTER_TYPE(x)  ((x).type == TB_PTR)
+#define TB_IS_VECTOR_TYPE(x)   ((x).type == TB_VECTOR)
 
 // accessors
 #define TB_GET_INT_BITWIDTH(x) ((x).data)
 #define TB_GET_FLOAT_FORMAT(x) ((x).data)
 #define TB_GET_PTR_ADDRSPACE(x) ((x).data)
+#define TB_GET_VECTOR_LANES(x) (1u << ((x).data & 15))
 
 ////////////////////////////////
 // ANNOTATIONS
@@ -413,6 +418,20 @@ typedef enum TB_NodeTypeEnum {
     // variadic
     TB_VA_START,
 
+    // Vectors
+    //   element-wise arithmetic uses the regular int and float ops with
+    //   a vector type, the same goes for plain loads and stores.
+    TB_VBROADCAST, // Data -> Vector
+    //   each output lane picks an index from the concatenation of a and b
+    TB_VSHUFFLE,   // (Vector, Vector) & Lanes -> Vector
+    TB_VEXTRACT,   // Vector & Int -> Data
+    TB_VINSERT,    // (Vector, Data) & Int -> Vector
+    //   the mask is an integer vector with the same lane count, lanes
+    //   with the sign bit set are accessed, the rest are zeroes on load
+    //   and left untouched on store.
+    TB_VMASKLOAD,  // (Control?, Memory, Ptr, Mask) -> Vector
+    TB_VMASKSTORE, // (Control, Memory, Ptr, Vector, Mask) -> Memory
+
     // x86 intrinsics
     TB_X86INTRIN_LDMXCSR,
     TB_X86INTRIN_STMXCSR,
@@ -568,6 +587,15 @@ typedef struct { // any integer binary operator
     TB_ArithmeticBehavior ab;
 } TB_NodeBinopInt;
 
+typedef struct { // TB_VSHUFFLE
+    int count;
+    uint8_t indices[];
+} TB_NodeShuffle;
+
+typedef struct { // TB_VEXTRACT, TB_VINSERT
+    int lane;
+} TB_NodeLane;
+
 typedef struct {
     TB_CharUnits align;
 } TB_NodeMemAccess;
@@ -712,6 +740,8 @@ typedef enum {
 #define TB_TYPE_INTN(N) TB_DataType{ { TB_INT,   (N) } }
 #define TB_TYPE_PTRN(N) TB_DataType{ { TB_PTR,   (N) } }
 
+#define TB_GET_VECTOR_ELEM(x) TB_DataType{ { (uint16_t) ((x).data >> 11 ? TB_FLOAT : TB_INT), (uint16_t) (((x).data >> 4) & 127) } }
+
 #else
 
 #define TB_TYPE_TUPLE   (TB_DataType){ { TB_TUPLE } }
@@ -730,6 +760,8 @@ typedef enum {
 #define TB_TYPE_INTN(N) (TB_DataType){ { TB_INT,   (N) } }
 #define TB_TYPE_PTRN(N) (TB_DataType){ { TB_PTR,   (N) } }
 
+#define TB_GET_VECTOR_ELEM(x) (TB_DataType){ { (x).data >> 11 ? TB_FLOAT : TB_INT, ((x).data >> 4) & 127 } }
+
 #endif
 
 typedef void (*TB_PrintCallback)(void* user_data, const char* fmt, ...);
@@ -947,6 +979,10 @@ typedef struct TB_PrototypeParam {
 
     // does not apply for returns
     const char* name;
+
+    // pointer param which doesn't alias anything the function can reach through other
+    // pointers (C's restrict), does not apply for returns.
+    bool is_restrict;
 } TB_PrototypeParam;
 
 struct TB_FunctionPrototype {
@@ -1024,6 +1060,7 @@ TB_API TB_DebugType* tb_debug_get_integer(TB_Module* m, bool is_signed, int bits
 TB_API TB_DebugType* tb_debug_get_float(TB_Module* m, TB_FloatFormat fmt);
 TB_API TB_DebugType* tb_debug_create_ptr(TB_Module* m, TB_DebugType* base);
 TB_API TB_DebugType* tb_debug_create_array(TB_Module* m, TB_DebugType* base, size_t count);
+TB_API TB_DebugType* tb_debug_create_vector(TB_Module* m, TB_DebugType* base, size_t count);
 TB_API TB_DebugType* tb_debug_create_alias(TB_Module* m, TB_DebugType* base, ptrdiff_t len, const char* tag);
 TB_API TB_DebugType* tb_debug_create_struct(TB_Module* m, ptrdiff_t len, const char* tag);
 TB_API TB_DebugType* tb_debug_create_union(TB_Module* m, ptrdiff_t len, const char* tag);
@@ -1052,6 +1089,10 @@ TB_API TB_Function* tb_symbol_as_function(TB_Symbol* s);
 TB_API TB_External* tb_symbol_as_external(TB_Symbol* s);
 TB_API TB_Global* tb_symbol_as_global(TB_Symbol* s);
 
+// removes the symbol from the module, it's up to you to make sure nothing
+// still refers to it.
+TB_API void tb_module_kill_symbol(TB_Module* m, TB_Symbol* sym);
+
 ////////////////////////////////
 // Function IR Generation
 ////////////////////////////////
@@ -1218,6 +1259,18 @@ TB_API TB_Node* tb_inst_va_start(TB_Function* f, TB_Node* a);
 TB_API TB_Node* tb_inst_cycle_counter(TB_Function* f);
 TB_API TB_Node* tb_inst_prefetch(TB_Function* f, TB_Node* addr, int level);
 
+// Vectors
+//   lanes must be a power of two, elements are ints or floats.
+TB_API TB_DataType tb_vector_type(TB_DataType elem, int lanes);
+
+TB_API TB_Node* tb_inst_vbroadcast(TB_Function* f, TB_DataType dt, TB_Node* src);
+//   indices < lanes pick from a, the rest pick from b (minus lanes)
+TB_API TB_Node* tb_inst_vshuffle(TB_Function* f, TB_Node* a, TB_Node* b, size_t count, const uint8_t* indices);
+TB_API TB_Node* tb_inst_vextract(TB_Function* f, TB_Node* vec, int lane);
+TB_API TB_Node* tb_inst_vinsert(TB_Function* f, TB_Node* vec, TB_Node* val, int lane);
+TB_API TB_Node* tb_inst_vmaskload(TB_Function* f, TB_DataType dt, TB_Node* addr, TB_Node* mask, TB_CharUnits align);
+TB_API void tb_inst_vmaskstore(TB_Function* f, TB_Node* addr, TB_Node* val, TB_Node* mask, TB_CharUnits align);
+
 // x86 Intrinsics
 TB_API TB_Node* tb_inst_x86_ldmxcsr(TB_Function* f, TB_Node* a);
 TB_API TB_Node* tb_inst_x86_stmxcsr(TB_Function* f);
@@ -1276,14 +1329,59 @@ TB_API void tb_pass_exit(TB_Passes* opt);
 //
 //   SROA: splits LOCALs into multiple to allow for more dataflow
 //     analysis later on.
+//
+//   DSE: removes stores which get overwritten (or whose stack slot
+//     dies) before anything could read them.
 TB_API void tb_pass_peephole(TB_Passes* opt, TB_PeepholeFlags flags);
 TB_API void tb_pass_sroa(TB_Passes* opt);
 TB_API bool tb_pass_mem2reg(TB_Passes* opt);
 TB_API bool tb_pass_loop(TB_Passes* opt);
+TB_API bool tb_pass_dse(TB_Passes* opt);
 
 // this just runs the optimizer in the default configuration
 TB_API void tb_pass_optimize(TB_Passes* opt);
 
+// module-level passes, these touch several functions at once so they can't
+// run while anyone's in a TB_Passes on the same module:
+//   inline: clones callees with at most max_nodes nodes into their call
+//     sites, it works on unoptimized IR so it should be run before any
+//     tb_pass_enter (the peepholes will clean up after it). Functions are
+//     visited bottom-up so callees have already had their calls inlined.
+TB_API void tb_module_inline(TB_Module* m, int max_nodes);
+
+//   prune: removes private functions & globals which aren't referenced (even
+//     indirectly) by any public symbol, run it before tb_pass_enter so the dead
+//     functions don't get optimized or compiled.
+TB_API void tb_module_prune(TB_Module* m);
+
+// strongly connected components of the direct call graph (TB_CALL and TB_TAILCALL
+// which target a TB_SYMBOL), they're sorted bottom-up so each SCC comes after
+// every SCC it calls into. recursive functions end up sharing an SCC.
+typedef struct {
+    size_t func_count;
+    TB_Function** funcs;
+
+    // number of other SCCs this one calls into
+    size_t callee_count;
+
+    // indices of the SCCs which call into this one
+    size_t caller_count;
+    size_t* callers;
+} TB_CallGraphSCC;
+
+typedef struct {
+    size_t scc_count;
+    TB_CallGraphSCC* sccs;
+} TB_CallGraph;
+
+// every function is included but only the calls made by functions which still have IR
+// become edges. tb_pass_optimize leaves behind a
+// summary of each function (memory effects, escaping params, return value range) and
+// callers in other SCCs will use it, so if you want them to see it, optimize the SCCs
+// in order (callers can start as soon as all their callees are done).
+TB_API TB_CallGraph tb_module_call_graph(TB_Module* m);
+TB_API void tb_call_graph_free(TB_CallGraph* cg);
+
 // analysis
 //   print: prints IR in a flattened text form.
 TB_API bool tb_pass_print(TB_Passes* opt);
@@ -1291,7 +1389,16 @@ TB_API bool tb_pass_print(TB_Passes* opt);
 TB_API void tb_pass_print_dot(TB_Passes* opt, TB_PrintCallback callback, void* user_data);
 
 // codegen
-TB_API TB_FunctionOutput* tb_pass_codegen(TB_Passes* opt, bool emit_asm);
+typedef enum {
+    // fast and decent, good for unoptimized builds and JITs
+    TB_REGALLOC_LINEAR_SCAN,
+
+    // slower but it weighs spills by loop depth so it's better at keeping
+    // reloads out of hot loops.
+    TB_REGALLOC_GRAPH_COLOR,
+} TB_RegAlloc;
+
+TB_API TB_FunctionOutput* tb_pass_codegen(TB_Passes* opt, TB_RegAlloc regalloc, bool emit_asm);
 
 TB_API void tb_pass_kill_node(TB_Passes* opt, TB_Node* n);
 TB_API void tb_pass_mark(TB_Passes* opt, TB_Node* n);
@@ -33,6 +33,7 @@ static int debug_type_size(TB_ABI abi, TB_DebugType* t) {
         case TB_DEBUG_TYPE_FUNCTION: return 8;
         case TB_DEBUG_TYPE_ARRAY:    return 8;
         case TB_DEBUG_TYPE_POINTER:  return 8;
+        case TB_DEBUG_TYPE_VECTOR:   return debug_type_size(abi, t->array.base) * t->array.count;
 
         case TB_DEBUG_TYPE_FLOAT: {
             switch (t->float_fmt) {
@@ -79,6 +80,11 @@ static RegClass classify_reg(TB_ABI abi, TB_DebugType* t) {
 
         case TB_ABI_SYSTEMV: {
             int s = debug_type_size(abi, t);
+            if (t->tag == TB_DEBUG_TYPE_VECTOR) {
+                // __m128 and friends go in a single XMM register
+                return s == 16 ? RG_SSE : RG_MEMORY;
+            }
+
             if (s <= 8) {
                 return t->tag == TB_DEBUG_TYPE_FLOAT ? RG_SSE : RG_INTEGER;
             }
@@ -102,6 +108,7 @@ static TB_DataType debug_type_to_tb(TB_DebugType* t) {
         case TB_DEBUG_TYPE_POINTER:  return TB_TYPE_PTR;
 
         case TB_DEBUG_TYPE_FLOAT: return (TB_DataType){ { TB_FLOAT, t->float_fmt } };
+        case TB_DEBUG_TYPE_VECTOR: return tb_vector_type(debug_type_to_tb(t->array.base), t->array.count);
 
         default: tb_assert(0, "todo"); return TB_TYPE_VOID;
     }
@@ -116,6 +123,10 @@ static TB_DataType reg_class_to_tb(TB_ABI abi, RegClass rg, TB_DebugType* type)
         }
 
         case RG_SSE: {
+            if (type->tag == TB_DEBUG_TYPE_VECTOR) {
+                return debug_type_to_tb(type);
+            }
+
             assert(type->tag == TB_DEBUG_TYPE_FLOAT);
             return (TB_DataType){ { TB_FLOAT, type->float_fmt } };
         }
@@ -97,7 +97,9 @@ static uint16_t convert_to_codeview_type(CV_Builder* builder, TB_DebugType* type
             }
         }
 
+        // codeview has vector types but arrays are close enough for the debugger
         case TB_DEBUG_TYPE_ARRAY:
+        case TB_DEBUG_TYPE_VECTOR:
         return (type->cv_type_id = tb_codeview_builder_add_array(builder, convert_to_codeview_type(builder, type->array.base), debug_type_size(TB_ABI_WIN64, type->array.base) * type->array.count));
 
         case TB_DEBUG_TYPE_POINTER:
@@ -61,6 +61,10 @@ TB_API TB_DebugType* tb_debug_create_array(TB_Module* m, TB_DebugType* base, siz
     return NEW(TB_DEBUG_TYPE_ARRAY, .array = { base, count });
 }
 
+TB_API TB_DebugType* tb_debug_create_vector(TB_Module* m, TB_DebugType* base, size_t count) {
+    return NEW(TB_DEBUG_TYPE_VECTOR, .array = { base, count });
+}
+
 TB_API TB_DebugType* tb_debug_create_struct(TB_Module* m, ptrdiff_t len, const char* tag) {
     TB_DebugType* t = NEW(TB_DEBUG_TYPE_STRUCT);
     t->record.tag = tb__arena_strdup(m, len, tag);
@@ -102,6 +102,10 @@ ExportList tb_module_layout_sections(TB_Module* m) {
     TB_ThreadInfo* info = atomic_load_explicit(&m->first_info_in_module, memory_order_relaxed);
     while (info != NULL) {
         TB_ThreadInfo* next = info->next_in_module;
+        if (info->symbols.data == NULL) {
+            info = next;
+            continue;
+        }
 
         // unpack symbols
         TB_Symbol** syms = (TB_Symbol**) info->symbols.data;
@@ -133,12 +133,14 @@ static void init_regalloc(Ctx* restrict ctx);
 static TB_X86_DataType legalize(TB_DataType dt);
 static bool is_terminator(int type);
 static bool wont_spill_around(int type);
+static bool is_commutative_inst(int type);
 static int classify_reg_class(TB_DataType dt);
 static void isel(Ctx* restrict ctx, TB_Node* n, int dst);
 static void disassemble(TB_CGEmitter* e, Disasm* restrict d, int bb, size_t pos, size_t end);
 static bool should_rematerialize(TB_Node* n);
 
 static void emit_code(Ctx* restrict ctx, TB_FunctionOutput* restrict func_out);
+static DynArray(int) liveness(Ctx* restrict ctx, TB_Function* f);
 static void mark_callee_saved_constraints(Ctx* restrict ctx, uint64_t callee_saved[CG_REGISTER_CLASSES]);
 
 static void add_debug_local(Ctx* restrict ctx, TB_Node* n, int pos) {
@@ -428,6 +430,7 @@ static Inst* inst_op_zero(TB_DataType dt, RegIndex dst) {
 // Register allocation
 ////////////////////////////////
 #include "reg_alloc.h"
+#include "reg_alloc_color.h"
 
 #define DEF(n, dt) alloc_vreg(ctx, n, dt)
 static int alloc_vreg(Ctx* restrict ctx, TB_Node* n, TB_DataType dt) {
@@ -896,7 +899,7 @@ static void isel_region(Ctx* restrict ctx, TB_Node* bb_start, TB_Node* end, size
 }
 
 // Codegen through here is done in phases
-static void compile_function(TB_Passes* restrict p, TB_FunctionOutput* restrict func_out, const TB_FeatureSet* features, uint8_t* out, size_t out_capacity, bool emit_asm) {
+static void compile_function(TB_Passes* restrict p, TB_FunctionOutput* restrict func_out, const TB_FeatureSet* features, TB_RegAlloc regalloc, uint8_t* out, size_t out_capacity, bool emit_asm) {
     verify_tmp_arena(p);
 
     TB_Function* restrict f = p->f;
@@ -1019,9 +1022,13 @@ static void compile_function(TB_Passes* restrict p, TB_FunctionOutput* restrict
             end = liveness(&ctx, f);
         }
 
-        // we can in theory have other regalloc solutions and eventually will put
-        // graph coloring here.
-        ctx.stack_usage = linear_scan(&ctx, f, ctx.stack_usage, end);
+        // linear scan is the fast path, graph coloring takes longer but it's
+        // better at keeping spills out of loops.
+        if (regalloc == TB_REGALLOC_GRAPH_COLOR) {
+            ctx.stack_usage = graph_color(&ctx, f, ctx.stack_usage, end);
+        } else {
+            ctx.stack_usage = linear_scan(&ctx, f, ctx.stack_usage, end);
+        }
 
         // Arch-specific: convert instruction buffer into actual instructions
         CUIK_TIMED_BLOCK("emit code") {
@@ -1108,6 +1115,14 @@ static void get_data_type_size(TB_DataType dt, size_t* out_size, size_t* out_ali
             *out_align = 8;
             break;
         }
+        case TB_VECTOR: {
+            size_t elem_size, elem_align;
+            get_data_type_size(TB_GET_VECTOR_ELEM(dt), &elem_size, &elem_align);
+
+            *out_size = elem_size * TB_GET_VECTOR_LANES(dt);
+            *out_align = *out_size;
+            break;
+        }
         default: tb_unreachable();
     }
 }
@@ -102,6 +102,13 @@ TB_API const char* tb_node_get_name(TB_Node* n) {
         case TB_FMIN: return "fmin";
 
         case TB_MULPAIR: return "mulpair";
+
+        case TB_VBROADCAST: return "vbroadcast";
+        case TB_VSHUFFLE: return "vshuffle";
+        case TB_VEXTRACT: return "vextract";
+        case TB_VINSERT: return "vinsert";
+        case TB_VMASKLOAD: return "vmaskload";
+        case TB_VMASKSTORE: return "vmaskstore";
         case TB_LOAD: return "load";
         case TB_STORE: return "store";
         case TB_MERGEMEM: return "merge";
@@ -149,6 +156,11 @@ static void tb_print_type(TB_DataType dt, TB_PrintCallback callback, void* user_
             P("cont");
             break;
         }
+        case TB_VECTOR: {
+            P("v%d", TB_GET_VECTOR_LANES(dt));
+            tb_print_type(TB_GET_VECTOR_ELEM(dt), callback, user_data);
+            break;
+        }
         default: tb_todo();
     }
 }
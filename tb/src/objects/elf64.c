@@ -35,7 +35,7 @@ static void put_section_symbols(DynArray(TB_ModuleSection) sections, TB_Emitter*
             TB_FunctionOutput* out_f = funcs[i];
             const char* name_str = out_f->parent->super.name;
 
-            uint32_t name = name_str ? tb_outstr_nul_UNSAFE(strtbl, name_str) : 0;
+            uint32_t name = name_str ? tb_outstr_nul(strtbl, name_str) : 0;
             out_f->parent->super.symbol_id = put_symbol(stab, name, TB_ELF64_ST_INFO(t, TB_ELF64_STT_FUNC), sec_num, out_f->code_pos, out_f->code_size);
         }
 
@@ -48,11 +48,11 @@ static void put_section_symbols(DynArray(TB_ModuleSection) sections, TB_Emitter*
 
             uint32_t name = 0;
             if (g->super.name) {
-                name = tb_outstr_nul_UNSAFE(strtbl, g->super.name);
+                name = tb_outstr_nul(strtbl, g->super.name);
             } else {
                 char buf[8];
                 snprintf(buf, 8, "$%d_%td", sec_num, i);
-                name = tb_outstr_nul_UNSAFE(strtbl, buf);
+                name = tb_outstr_nul(strtbl, buf);
             }
 
             g->super.symbol_id = put_symbol(stab, name, TB_ELF64_ST_INFO(t, TB_ELF64_STT_OBJECT), sec_num, g->pos, 0);
@@ -130,7 +130,7 @@ TB_ExportBuffer tb_elf64obj_write_output(TB_Module* m, const IDebugFormat* dbg)
             tb_outs(&strtbl, 5, ".rela");
         }
 
-        sections[i].name_pos = tb_outstr_nul_UNSAFE(&strtbl, sections[i].name);
+        sections[i].name_pos = tb_outstr_nul(&strtbl, sections[i].name);
     }
 
     // calculate symbol IDs
@@ -152,15 +152,15 @@ TB_ExportBuffer tb_elf64obj_write_output(TB_Module* m, const IDebugFormat* dbg)
 
     FOREACH_N(i, 0, exports.count) {
         TB_External* ext = exports.data[i];
-        uint32_t name = tb_outstr_nul_UNSAFE(&strtbl, ext->super.name);
+        uint32_t name = tb_outstr_nul(&strtbl, ext->super.name);
         ext->super.symbol_id = global_symtab.count / sizeof(TB_Elf64_Sym);
 
         put_symbol(&global_symtab, name, TB_ELF64_ST_INFO(TB_ELF64_STB_GLOBAL, 0), 0, 0, 0);
     }
 
-    uint32_t symtab_name = tb_outstr_nul_UNSAFE(&strtbl, ".symtab");
+    uint32_t symtab_name = tb_outstr_nul(&strtbl, ".symtab");
     TB_Elf64_Shdr strtab = {
-        .name = tb_outstr_nul_UNSAFE(&strtbl, ".strtab"),
+        .name = tb_outstr_nul(&strtbl, ".strtab"),
         .type = TB_SHT_STRTAB,
         .flags = 0,
         .addralign = 1,
@@ -222,12 +222,17 @@ TB_ExportBuffer tb_elf64obj_write_output(TB_Module* m, const IDebugFormat* dbg)
                 }
                 assert(symbol_id != 0);
 
+                // RELA ignores whatever is stored in the field so the emitter's adjustments
+                // (symbol offsets, immediates after the displacement) have to go in the addend.
+                int32_t disp;
+                memcpy(&disp, &output[sections[i].raw_data_pos + actual_pos], sizeof(disp));
+
                 TB_ELF_RelocType type = p->target->tag == TB_SYMBOL_GLOBAL ? TB_ELF_X86_64_PC32 : TB_ELF_X86_64_PLT32;
                 *rels++ = (TB_Elf64_Rela){
                     .offset = actual_pos,
                     // check when we should prefer R_X86_64_GOTPCREL
                     .info   = TB_ELF64_R_INFO(symbol_id, type),
-                    .addend = -4
+                    .addend = disp - 4
                 };
             }
         }
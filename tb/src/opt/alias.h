@@ -0,0 +1,199 @@
+// Alias analysis, it's all based on where the pointers come from (provenance) since TB
+// doesn't know what C types were behind the loads & stores. Every address is broken
+// into a root object plus a known offset and some array indices, two accesses can only
+// overlap if they're in the same object or one of the objects is unknown.
+//
+// Distinct objects:
+//   * different LOCALs, or different global symbols.
+//   * a LOCAL which never escapes and anything not derived from it.
+//   * a restrict param and anything not derived from it.
+typedef enum {
+    ALIAS_NO,
+    ALIAS_MAY,
+    ALIAS_MUST,
+} AliasResult;
+
+typedef struct {
+    TB_Node* base;
+    int64_t offset;
+
+    // if we walked through array accesses we only know the offset modulo the gcd of
+    // their strides, unless both addresses went through the same single index. index
+    // is only set when levels == 1, with more levels no single index says where we are.
+    TB_Node* index;
+    int64_t stride;
+    int levels;
+} AliasAddr;
+
+static int64_t alias_gcd(int64_t a, int64_t b) {
+    while (b != 0) {
+        int64_t r = a % b;
+        a = b, b = r;
+    }
+    return a;
+}
+
+// walks all the way down to the root object, m[i][j] and s[i].a[j] have to end up
+// on the LOCAL otherwise we'd compare the inner array access against the local itself.
+static AliasAddr alias_decompose(TB_Node* n) {
+    AliasAddr a = { 0 };
+    for (;;) {
+        if (n->type == TB_MEMBER_ACCESS) {
+            a.offset += TB_NODE_GET_EXTRA_T(n, TB_NodeMember)->offset;
+        } else if (n->type == TB_ARRAY_ACCESS) {
+            int64_t stride = TB_NODE_GET_EXTRA_T(n, TB_NodeArray)->stride;
+            if (stride != 0) {
+                a.index  = a.levels == 0 ? n->inputs[2] : NULL;
+                a.stride = alias_gcd(a.stride, stride < 0 ? -stride : stride);
+                a.levels += 1;
+            }
+        } else {
+            break;
+        }
+        n = n->inputs[1];
+    }
+
+    a.base = n;
+    return a;
+}
+
+static const TB_FunctionSummary* get_callee_summary(TB_Function* f, TB_Node* call);
+
+// pointers which are only used to address memory (or compared) don't escape, neither
+// do the ones passed to a callee whose summary says it doesn't let them escape.
+static bool pointer_escapes(TB_Function* f, TB_Node* n, int depth) {
+    if (depth > 8) {
+        return true;
+    }
+
+    for (User* u = n->users; u; u = u->next) {
+        switch (u->n->type) {
+            case TB_LOAD:
+            case TB_STORE:
+            if (u->slot != 2) return true;
+            break;
+
+            case TB_MEMBER_ACCESS:
+            case TB_ARRAY_ACCESS:
+            if (u->slot != 1 || pointer_escapes(f, u->n, depth + 1)) return true;
+            break;
+
+            case TB_CALL: {
+                int i = u->slot - 3;
+                const TB_FunctionSummary* s = i >= 0 && i < 64 ? get_callee_summary(f, u->n) : NULL;
+                if (s == NULL || (s->no_escape & (1ull << i)) == 0) return true;
+                break;
+            }
+
+            case TB_CMP_EQ:
+            case TB_CMP_NE:
+            break;
+
+            default:
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool alias_is_restrict_param(TB_Function* f, TB_Node* n) {
+    if (n->type != TB_PROJ || n->inputs[0]->type != TB_START) {
+        return false;
+    }
+
+    int i = TB_NODE_GET_EXTRA_T(n, TB_NodeProj)->index - 3;
+    return i >= 0 && i < f->prototype->param_count && f->prototype->params[i].is_restrict;
+}
+
+// are these two bases known to be different objects
+static bool alias_distinct_bases(TB_Function* f, TB_Node* a, TB_Node* b) {
+    assert(a != b);
+
+    // two stack slots or globals never overlap
+    bool a_obj = a->type == TB_LOCAL || a->type == TB_SYMBOL;
+    bool b_obj = b->type == TB_LOCAL || b->type == TB_SYMBOL;
+    if (a_obj && b_obj) {
+        return a->type != TB_SYMBOL || b->type != TB_SYMBOL ||
+            TB_NODE_GET_EXTRA_T(a, TB_NodeSymbol)->sym != TB_NODE_GET_EXTRA_T(b, TB_NodeSymbol)->sym;
+    }
+
+    // if no one else saw the address of the local, no other pointer can reach it
+    if ((a->type == TB_LOCAL && !pointer_escapes(f, a, 0)) || (b->type == TB_LOCAL && !pointer_escapes(f, b, 0))) {
+        return true;
+    }
+
+    // restrict means anything not derived from the param is a different object, if the
+    // param went through memory or a phi we can't tell what got derived from it so only
+    // the pointers we can name (other params, locals and globals) are known to be distinct.
+    bool a_restrict = alias_is_restrict_param(f, a);
+    bool b_restrict = alias_is_restrict_param(f, b);
+    if (a_restrict || b_restrict) {
+        TB_Node* param = a_restrict ? a : b;
+        TB_Node* other = a_restrict ? b : a;
+        return !pointer_escapes(f, param, 0) || other->type == TB_LOCAL || other->type == TB_SYMBOL ||
+            (other->type == TB_PROJ && other->inputs[0]->type == TB_START);
+    }
+
+    return false;
+}
+
+static bool alias_ranges_overlap(int64_t a, int64_t a_size, int64_t b, int64_t b_size) {
+    return a < b + b_size && b < a + a_size;
+}
+
+// can a_size bytes at address a overlap with b_size bytes at b
+static AliasResult alias_query(TB_Function* f, TB_Node* a, int a_size, TB_Node* b, int b_size) {
+    if (a_size <= 0 || b_size <= 0) {
+        return ALIAS_MAY;
+    }
+
+    AliasAddr x = alias_decompose(a);
+    AliasAddr y = alias_decompose(b);
+
+    if (x.base != y.base) {
+        return alias_distinct_bases(f, x.base, y.base) ? ALIAS_NO : ALIAS_MAY;
+    }
+
+    // same element of the same array (or no array at all), we know the exact distance
+    if (x.levels <= 1 && y.levels <= 1 && x.stride == y.stride && x.index == y.index) {
+        if (x.offset == y.offset && a_size == b_size) {
+            return ALIAS_MUST;
+        }
+
+        return alias_ranges_overlap(x.offset, a_size, y.offset, b_size) ? ALIAS_MAY : ALIAS_NO;
+    }
+
+    // both are somewhere in the same array, the distance between them is some multiple
+    // of the gcd of the strides plus the difference in offsets. If the bytes they touch
+    // within that period are disjoint (different fields) they can't overlap.
+    int64_t s = alias_gcd(x.stride, y.stride);
+    if (s == 0) {
+        return ALIAS_MAY;
+    }
+
+    int64_t xo = ((x.offset % s) + s) % s;
+    int64_t yo = ((y.offset % s) + s) % s;
+    if (xo + a_size > s || yo + b_size > s) {
+        return ALIAS_MAY;
+    }
+
+    return alias_ranges_overlap(xo, a_size, yo, b_size) ? ALIAS_MAY : ALIAS_NO;
+}
+
+// number of bytes touched by a LOAD or STORE (0 if we don't know)
+static int alias_access_size(TB_Node* n) {
+    assert(n->type == TB_LOAD || n->type == TB_STORE);
+    TB_DataType dt = n->type == TB_STORE ? n->inputs[3]->dt : n->dt;
+    return (bits_in_data_type(64, dt) + 7) / 8;
+}
+
+// can the LOAD or STORE a touch the same bytes as the LOAD or STORE b
+static AliasResult alias_query_access(TB_Function* f, TB_Node* a, TB_Node* b) {
+    return alias_query(f, a->inputs[2], alias_access_size(a), b->inputs[2], alias_access_size(b));
+}
+
+// only things in the function's frame, writes to these die with the function
+static bool alias_is_local(TB_Node* n) {
+    return alias_decompose(n).base->type == TB_LOCAL;
+}
@@ -258,6 +258,22 @@ static TB_Node* ideal_phi(TB_Passes* restrict opt, TB_Function* f, TB_Node* n) {
 static TB_Node* ideal_branch(TB_Passes* restrict opt, TB_Function* f, TB_Node* n) {
     TB_NodeBranch* br = TB_NODE_GET_EXTRA(n);
 
+    // unreachable branch, every successor loses this edge
+    TB_Node* dead = n->inputs[0];
+    if (dead->type == TB_DEAD) {
+        User* u = n->users;
+        while (u != NULL) {
+            // subsume_node recycles the user
+            User* next = u->next;
+            if (u->n->type == TB_PROJ) {
+                tb_pass_mark_users(opt, u->n);
+                subsume_node(opt, f, u->n, dead);
+            }
+            u = next;
+        }
+        return dead;
+    }
+
     if (br->succ_count == 2) {
         if (n->input_count == 2 && br->keys[0] == 0) {
             TB_Node* cmp_node = n->inputs[1];
@@ -0,0 +1,397 @@
+// Call graph & function summaries, everything interprocedural is built on these. The
+// graph has every function in the module but it only knows about direct calls
+// (TB_CALL/TB_TAILCALL on a TB_SYMBOL) made by functions which still have IR, Tarjan's algorithm hands us the SCCs in reverse
+// topological order which happens to be the bottom-up order we want.
+//
+// Summaries are written at the end of tb_pass_optimize and published with has_summary,
+// a caller only trusts them if the callee is in a different SCC since anything in the
+// same SCC might still be getting optimized.
+typedef struct {
+    TB_Function* f;
+    DynArray(int) callees;
+
+    int index, low_link, scc;
+    bool on_stack;
+} CallGraphNode;
+
+typedef struct {
+    int v;
+    size_t edge;
+} CallGraphFrame;
+
+static bool walk_test_n_set(uint64_t* visited, TB_Node* n) {
+    uint64_t bit = 1ull << (n->gvn % 64);
+    if (visited[n->gvn / 64] & bit) {
+        return true;
+    }
+
+    visited[n->gvn / 64] |= bit;
+    return false;
+}
+
+static void walk_push(DynArray(TB_Node*)* nodes, uint64_t* visited, TB_Node* n) {
+    if (n != NULL && !walk_test_n_set(visited, n)) {
+        dyn_array_put(*nodes, n);
+    }
+}
+
+// every node reachable from the terminators (same roots as push_all_nodes), this
+// doesn't need a TB_Passes. calls and atomics also drag their projections along
+// since their extra data points at them.
+static DynArray(TB_Node*) walk_all_nodes(TB_Function* f) {
+    size_t words = (f->node_count + 63) / 64;
+    uint64_t* visited = tb_platform_heap_alloc(words * sizeof(uint64_t));
+    memset(visited, 0, words * sizeof(uint64_t));
+
+    DynArray(TB_Node*) nodes = NULL;
+    dyn_array_for(i, f->terminators) {
+        walk_push(&nodes, visited, f->terminators[i]);
+    }
+
+    for (size_t i = 0; i < dyn_array_length(nodes); i++) {
+        TB_Node* n = nodes[i];
+        FOREACH_N(j, 0, n->input_count) {
+            walk_push(&nodes, visited, n->inputs[j]);
+        }
+
+        if (n->type == TB_CALL || n->type == TB_SYSCALL) {
+            TB_NodeCall* c = TB_NODE_GET_EXTRA(n);
+            FOREACH_N(j, 0, c->proj_count) {
+                walk_push(&nodes, visited, c->projs[j]);
+            }
+        } else if (n->type >= TB_ATOMIC_LOAD && n->type <= TB_ATOMIC_CAS) {
+            TB_NodeAtomic* a = TB_NODE_GET_EXTRA(n);
+            walk_push(&nodes, visited, a->proj0);
+            walk_push(&nodes, visited, a->proj1);
+        }
+    }
+
+    tb_platform_heap_free(visited);
+    return nodes;
+}
+
+static bool func_has_ir(TB_Function* f) {
+    // functions which have already gone through the passes don't have terminators anymore
+    return f->prototype != NULL && f->start_node != NULL && f->terminators != NULL;
+}
+
+// NULL if it's not a call to a known function
+static TB_Function* call_direct_target(TB_Node* call) {
+    if ((call->type != TB_CALL && call->type != TB_TAILCALL) || call->inputs[2]->type != TB_SYMBOL) {
+        return NULL;
+    }
+
+    TB_Symbol* sym = TB_NODE_GET_EXTRA_T(call->inputs[2], TB_NodeSymbol)->sym;
+    return sym->tag == TB_SYMBOL_FUNCTION ? (TB_Function*) sym : NULL;
+}
+
+// K&R style calls might not agree with the definition
+static bool same_proto(TB_FunctionPrototype* a, TB_FunctionPrototype* b) {
+    if (a == b) return true;
+    if (a->has_varargs || b->has_varargs) return false;
+    if (a->param_count != b->param_count || a->return_count != b->return_count) return false;
+
+    FOREACH_N(i, 0, a->param_count + a->return_count) {
+        if (a->params[i].dt.raw != b->params[i].dt.raw) return false;
+    }
+
+    return true;
+}
+
+TB_CallGraph tb_module_call_graph(TB_Module* m) {
+    DynArray(CallGraphNode) nodes = NULL;
+    NL_Map(TB_Function*, int) lookup = NULL;
+
+    TB_CallGraph cg = { 0 };
+
+    CUIK_TIMED_BLOCK("call graph") {
+        TB_Symbol* sym;
+        for (TB_SymbolIter it = tb_symbol_iter(m); sym = tb_symbol_iter_next(&it), sym;) {
+            TB_Function* f = tb_symbol_as_function(sym);
+            if (f == NULL) continue;
+
+            int index = dyn_array_length(nodes);
+            nl_map_put(lookup, f, index);
+            dyn_array_put(nodes, (CallGraphNode){ .f = f, .index = -1, .scc = -1 });
+        }
+
+        // find edges
+        dyn_array_for(i, nodes) {
+            if (!func_has_ir(nodes[i].f)) continue;
+
+            DynArray(TB_Node*) ir = walk_all_nodes(nodes[i].f);
+            dyn_array_for(j, ir) {
+                TB_Function* target = call_direct_target(ir[j]);
+                ptrdiff_t search = target ? nl_map_get(lookup, target) : -1;
+                if (search >= 0) {
+                    dyn_array_put(nodes[i].callees, lookup[search].v);
+                }
+            }
+            dyn_array_destroy(ir);
+        }
+
+        // Tarjan's SCC, done iteratively since call chains can get deep. order holds
+        // the functions grouped by SCC and scc_first is where each group starts.
+        DynArray(int) stack = NULL;
+        DynArray(CallGraphFrame) frames = NULL;
+        DynArray(int) order = NULL;
+        DynArray(size_t) scc_first = NULL;
+
+        int next_index = 0;
+        dyn_array_for(root, nodes) {
+            if (nodes[root].index >= 0) continue;
+
+            nodes[root].index = nodes[root].low_link = next_index++;
+            nodes[root].on_stack = true;
+            dyn_array_put(stack, root);
+            dyn_array_put(frames, (CallGraphFrame){ root, 0 });
+
+            while (dyn_array_length(frames)) {
+                CallGraphFrame* top = &frames[dyn_array_length(frames) - 1];
+                CallGraphNode* v = &nodes[top->v];
+
+                if (top->edge < dyn_array_length(v->callees)) {
+                    int w = v->callees[top->edge++];
+                    if (nodes[w].index < 0) {
+                        nodes[w].index = nodes[w].low_link = next_index++;
+                        nodes[w].on_stack = true;
+                        dyn_array_put(stack, w);
+                        dyn_array_put(frames, (CallGraphFrame){ w, 0 });
+                    } else if (nodes[w].on_stack && nodes[w].index < v->low_link) {
+                        v->low_link = nodes[w].index;
+                    }
+                    continue;
+                }
+
+                // v is done, if it's the root of an SCC pop the whole thing
+                int vi = top->v;
+                dyn_array_pop(frames);
+
+                if (v->low_link == v->index) {
+                    size_t scc = dyn_array_length(scc_first);
+                    dyn_array_put(scc_first, dyn_array_length(order));
+
+                    int w;
+                    do {
+                        w = dyn_array_pop(stack);
+                        nodes[w].on_stack = false;
+                        nodes[w].scc = scc;
+                        dyn_array_put(order, w);
+                    } while (w != vi);
+                }
+
+                if (dyn_array_length(frames)) {
+                    CallGraphNode* parent = &nodes[frames[dyn_array_length(frames) - 1].v];
+                    if (v->low_link < parent->low_link) {
+                        parent->low_link = v->low_link;
+                    }
+                }
+            }
+        }
+
+        size_t scc_count = dyn_array_length(scc_first);
+        size_t func_count = dyn_array_length(order);
+
+        // count the distinct edges between SCCs
+        int* mark = tb_platform_heap_alloc(scc_count * sizeof(int));
+        size_t* callee_counts = tb_platform_heap_alloc(scc_count * sizeof(size_t));
+        size_t* caller_counts = tb_platform_heap_alloc(scc_count * sizeof(size_t));
+        FOREACH_N(i, 0, scc_count) {
+            mark[i] = -1, callee_counts[i] = 0, caller_counts[i] = 0;
+        }
+
+        size_t edge_count = 0;
+        FOREACH_N(s, 0, scc_count) {
+            size_t end = s + 1 < scc_count ? scc_first[s + 1] : func_count;
+            FOREACH_N(i, scc_first[s], end) {
+                CallGraphNode* v = &nodes[order[i]];
+                dyn_array_for(j, v->callees) {
+                    int t = nodes[v->callees[j]].scc;
+                    if (t != s && mark[t] != s) {
+                        mark[t] = s;
+                        callee_counts[s] += 1;
+                        caller_counts[t] += 1;
+                        edge_count += 1;
+                    }
+                }
+            }
+        }
+
+        // everything lives in one block so it's easy to free
+        size_t size = (scc_count * sizeof(TB_CallGraphSCC)) + (func_count * sizeof(TB_Function*)) + (edge_count * sizeof(size_t));
+        TB_CallGraphSCC* sccs = tb_platform_heap_alloc(size);
+        TB_Function** funcs = (TB_Function**) &sccs[scc_count];
+        size_t* callers = (size_t*) &funcs[func_count];
+
+        FOREACH_N(s, 0, scc_count) {
+            size_t end = s + 1 < scc_count ? scc_first[s + 1] : func_count;
+            sccs[s] = (TB_CallGraphSCC){
+                .func_count = end - scc_first[s],
+                .funcs = &funcs[scc_first[s]],
+                .callee_count = callee_counts[s],
+                .callers = callers,
+            };
+            callers += caller_counts[s];
+
+            FOREACH_N(i, scc_first[s], end) {
+                funcs[i] = nodes[order[i]].f;
+                funcs[i]->scc = s + 1;
+            }
+            mark[s] = -1;
+        }
+
+        // fill in the callers
+        FOREACH_N(s, 0, scc_count) {
+            size_t end = s + 1 < scc_count ? scc_first[s + 1] : func_count;
+            FOREACH_N(i, scc_first[s], end) {
+                CallGraphNode* v = &nodes[order[i]];
+                dyn_array_for(j, v->callees) {
+                    int t = nodes[v->callees[j]].scc;
+                    if (t != s && mark[t] != s) {
+                        mark[t] = s;
+                        sccs[t].callers[sccs[t].caller_count++] = s;
+                    }
+                }
+            }
+        }
+
+        tb_platform_heap_free(mark);
+        tb_platform_heap_free(callee_counts);
+        tb_platform_heap_free(caller_counts);
+
+        dyn_array_for(i, nodes) {
+            dyn_array_destroy(nodes[i].callees);
+        }
+        dyn_array_destroy(nodes);
+        dyn_array_destroy(stack);
+        dyn_array_destroy(frames);
+        dyn_array_destroy(order);
+        dyn_array_destroy(scc_first);
+        nl_map_free(lookup);
+
+        cg = (TB_CallGraph){ scc_count, sccs };
+    }
+
+    return cg;
+}
+
+void tb_call_graph_free(TB_CallGraph* cg) {
+    tb_platform_heap_free(cg->sccs);
+    *cg = (TB_CallGraph){ 0 };
+}
+
+////////////////////////////////
+// Summaries
+////////////////////////////////
+static void summarize(TB_Passes* restrict p) {
+    TB_Function* f = p->f;
+    TB_Node* end = f->stop_node;
+    if (end == NULL || end->type != TB_END) {
+        return;
+    }
+
+    TB_FunctionSummary s = { .no_writes = end->inputs[1] == f->params[1] };
+    FOREACH_N(i, 0, f->param_count < 64 ? f->param_count : 64) {
+        TB_Node* param = f->params[3 + i];
+        if (param->dt.type == TB_PTR && !pointer_escapes(f, param, 0)) {
+            s.no_escape |= 1ull << i;
+        }
+    }
+
+    if (f->prototype->return_count == 1 && end->input_count == 4) {
+        TB_Node* ret = end->inputs[3];
+        if (ret->dt.type == TB_INT) {
+            Lattice* l = lattice_universe_get(&p->universe, ret);
+            if (l != lattice_top(&p->universe, ret->dt)) {
+                s.has_ret_range = true;
+                s.ret_min = l->_int.min;
+                s.ret_max = l->_int.max;
+                s.ret_known_zeros = l->_int.known_zeros;
+                s.ret_known_ones = l->_int.known_ones;
+            }
+        } else if (ret->dt.type == TB_PTR) {
+            Lattice* l = lattice_universe_get(&p->universe, ret);
+            s.ret_not_null = l->_ptr.trifecta == LATTICE_KNOWN_NOT_NULL;
+        }
+    }
+
+    f->summary = s;
+    atomic_store_explicit(&f->has_summary, true, memory_order_release);
+}
+
+// NULL if we can't trust what we know about the callee (yet)
+static const TB_FunctionSummary* get_callee_summary(TB_Function* f, TB_Node* call) {
+    TB_Function* callee = call->type == TB_CALL ? call_direct_target(call) : NULL;
+    if (callee == NULL || callee->scc == 0 || callee->scc == f->scc) {
+        return NULL;
+    }
+
+    if (!atomic_load_explicit(&callee->has_summary, memory_order_acquire)) {
+        return NULL;
+    }
+
+    TB_NodeCall* c = TB_NODE_GET_EXTRA(call);
+    return same_proto(c->proto, callee->prototype) ? &callee->summary : NULL;
+}
+
+static TB_Node* ideal_call(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
+    // the branch leading here folded away, control stays dead, memory passes
+    // through and nobody's around to look at the results.
+    if (n->inputs[0]->type == TB_DEAD) {
+        TB_NodeCall* c = TB_NODE_GET_EXTRA(n);
+        FOREACH_N(i, 0, c->proj_count) {
+            TB_Node* proj = c->projs[i];
+            if (proj != NULL) {
+                TB_Node* k = i == 0 ? n->inputs[0] : i == 1 ? n->inputs[1] : make_poison(f, p, proj->dt);
+                tb_pass_mark_users(p, proj);
+                subsume_node(p, f, proj, k);
+            }
+        }
+        return n->inputs[0];
+    }
+
+    TB_Node* k = ideal_libcall(p, f, n);
+    if (k != NULL) {
+        return k;
+    }
+
+    // callee doesn't write to memory, anyone after the call can use the memory
+    // from before it.
+    const TB_FunctionSummary* s = get_callee_summary(f, n);
+    TB_Node* mem = TB_NODE_GET_EXTRA_T(n, TB_NodeCall)->projs[1];
+    if (s != NULL && s->no_writes && mem != NULL && mem->type == TB_PROJ && mem->users != NULL) {
+        tb_pass_mark_users(p, mem);
+
+        User* use = mem->users;
+        while (use != NULL) {
+            // set_input will recycle 'use'
+            User* next = use->next;
+            set_input(p, use->n, n->inputs[1], use->slot);
+            use = next;
+        }
+
+        return n;
+    }
+
+    return NULL;
+}
+
+static Lattice* dataflow_proj(TB_Passes* restrict p, LatticeUniverse* uni, TB_Node* n) {
+    TB_Node* call = n->inputs[0];
+    if (call->type != TB_CALL || TB_NODE_GET_EXTRA_T(n, TB_NodeProj)->index != 2) {
+        return NULL;
+    }
+
+    const TB_FunctionSummary* s = get_callee_summary(p->f, call);
+    if (s == NULL) {
+        return NULL;
+    }
+
+    if (n->dt.type == TB_INT && s->has_ret_range) {
+        return lattice_intern(uni, (Lattice){ LATTICE_INT, ._int = { s->ret_min, s->ret_max, s->ret_known_zeros, s->ret_known_ones } });
+    } else if (n->dt.type == TB_PTR && s->ret_not_null) {
+        return lattice_intern(uni, (Lattice){ LATTICE_POINTER, ._ptr = { LATTICE_KNOWN_NOT_NULL } });
+    }
+
+    return NULL;
+}
@@ -121,8 +121,8 @@ static Lattice* dataflow_arith(TB_Passes* restrict opt, LatticeUniverse* uni, TB
         break;
 
         case TB_SUB:
-        min = wrapped_int_sub(a->_int.min, b->_int.min);
-        max = wrapped_int_sub(a->_int.max, b->_int.max);
+        min = wrapped_int_sub(a->_int.min, b->_int.max);
+        max = wrapped_int_sub(a->_int.max, b->_int.min);
         break;
 
         case TB_MUL:
@@ -143,8 +143,8 @@ static Lattice* dataflow_arith(TB_Passes* restrict opt, LatticeUniverse* uni, TB
         // if we overflow, default to the full range
         if (n->type == TB_SUB) {
             // subtraction does overflow check different from add or mul
-            if (sub_overflow(a->_int.min, b->_int.min, min, n->dt.data) ||
-                sub_overflow(a->_int.max, b->_int.max, max, n->dt.data)
+            if (sub_overflow(a->_int.min, b->_int.max, min, n->dt.data) ||
+                sub_overflow(a->_int.max, b->_int.min, max, n->dt.data)
             ) {
                 min = lattice_int_min(n->dt.data);
                 max = lattice_int_max(n->dt.data);
@@ -537,8 +537,8 @@ static TB_Node* ideal_int_binop(TB_Passes* restrict opt, TB_Function* f, TB_Node
         if (get_int_const(n->inputs[2], &rhs) && rhs == 0) {
             // !(a <  b) is (b <= a)
             switch (cmp->type) {
-                case TB_CMP_EQ: n->type = TB_CMP_EQ; break;
-                case TB_CMP_NE: n->type = TB_CMP_NE; break;
+                case TB_CMP_EQ: n->type = TB_CMP_NE; break;
+                case TB_CMP_NE: n->type = TB_CMP_EQ; break;
                 case TB_CMP_SLT: n->type = TB_CMP_SLE; break;
                 case TB_CMP_SLE: n->type = TB_CMP_SLT; break;
                 case TB_CMP_ULT: n->type = TB_CMP_ULE; break;
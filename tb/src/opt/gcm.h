@@ -23,6 +23,7 @@ static float node_cost(TB_Node* n) {
         case TB_MEMBER_ACCESS:
         case TB_ARRAY_ACCESS:
         case TB_LOAD:
+        case TB_VBROADCAST:
         return 2.0f;
 
         // we don't wanna just hoist things we haven't thought about
@@ -31,6 +32,74 @@ static float node_cost(TB_Node* n) {
     }
 }
 
+////////////////////////////////
+// Loop frequencies
+////////////////////////////////
+// every loop a block is in scales its frequency by 10, late scheduling uses this to
+// keep cheap nodes out of loops. Loops are found as the natural loops of the backedges
+// (a pred which the header dominates).
+static bool bb_dominates(TB_BasicBlock* expected_dom, TB_BasicBlock* bb) {
+    for (;;) {
+        if (bb == expected_dom) return true;
+        if (bb->dom == bb) return false;
+        bb = bb->dom;
+    }
+}
+
+static void schedule_loop_freq(TB_Passes* p, TB_CFG cfg) {
+    TB_Node** blocks = p->worklist.items;
+    bool* in_loop = tb_platform_heap_alloc(cfg.block_count * sizeof(bool));
+    DynArray(TB_Node*) stack = NULL;
+
+    // the loop pass tags headers with a frequency too, we'd count those loops twice
+    FOREACH_N(i, 0, cfg.block_count) {
+        nl_map_get_checked(cfg.node_to_block, blocks[i]).freq = 1.0f;
+    }
+
+    FOREACH_N(i, 0, cfg.block_count) {
+        TB_Node* header = blocks[i];
+        if (header->type != TB_REGION) continue;
+
+        TB_BasicBlock* header_bb = &nl_map_get_checked(cfg.node_to_block, header);
+        memset(in_loop, 0, cfg.block_count * sizeof(bool));
+        in_loop[header_bb->id] = true;
+
+        // walk backwards from each backedge until we hit the header
+        bool is_loop = false;
+        FOREACH_N(j, 0, header->input_count) {
+            TB_Node* pred = get_pred(header, j);
+            ptrdiff_t search = nl_map_get(cfg.node_to_block, pred);
+            if (search >= 0 && bb_dominates(header_bb, &cfg.node_to_block[search].v)) {
+                is_loop = true;
+                dyn_array_put(stack, cfg.node_to_block[search].k);
+            }
+        }
+
+        if (!is_loop) continue;
+        header_bb->freq *= 10.0f;
+
+        while (dyn_array_length(stack)) {
+            TB_Node* bb_node = dyn_array_pop(stack);
+            TB_BasicBlock* bb = &nl_map_get_checked(cfg.node_to_block, bb_node);
+            if (in_loop[bb->id]) continue;
+
+            in_loop[bb->id] = true;
+            bb->freq *= 10.0f;
+
+            size_t pred_count = bb_node->type == TB_REGION ? bb_node->input_count : 1;
+            FOREACH_N(j, 0, pred_count) {
+                TB_Node* pred = get_pred(bb_node, j);
+                if (nl_map_get(cfg.node_to_block, pred) >= 0) {
+                    dyn_array_put(stack, pred);
+                }
+            }
+        }
+    }
+
+    dyn_array_destroy(stack);
+    tb_platform_heap_free(in_loop);
+}
+
 ////////////////////////////////
 // Early scheduling
 ////////////////////////////////
@@ -43,9 +112,16 @@ static void schedule_early(TB_Passes* p, TB_Node* n) {
     // push node, late scheduling will process this list
     dyn_array_put(p->worklist.items, n);
 
-    // schedule inputs first
+    // schedule inputs first. Anything with a block (pinned or not) is pushed onto
+    // p->stack and walked once we're out of this recursion, walking through a pinned
+    // node now could loop back around a phi to a node which is still waiting on its
+    // inputs, it'd find them without a block.
     FOREACH_N(i, 0, n->input_count) if (n->inputs[i]) {
-        schedule_early(p, n->inputs[i]);
+        if (nl_map_get(p->scheduled, n->inputs[i]) >= 0) {
+            dyn_array_put(p->stack, n->inputs[i]);
+        } else {
+            schedule_early(p, n->inputs[i]);
+        }
     }
 
     // schedule unpinned nodes
@@ -96,6 +172,47 @@ static TB_BasicBlock* find_lca(TB_Passes* p, TB_BasicBlock* a, TB_BasicBlock* b)
     return a;
 }
 
+// a load has to happen before anything that might overwrite what it read, those are
+// the memory effects which come after the load's memory state (walking past stores
+// which can't alias it). Returns the new LCA.
+static TB_BasicBlock* schedule_anti_deps(TB_Passes* p, TB_Node* n, TB_BasicBlock* lca) {
+    TB_BasicBlock* early = nl_map_get_checked(p->scheduled, n);
+    DynArray(TB_Node*) stack = p->stack;
+    dyn_array_clear(stack);
+    dyn_array_put(stack, n->inputs[1]);
+
+    int budget = 64;
+    while (dyn_array_length(stack)) {
+        TB_Node* mem = dyn_array_pop(stack);
+        for (User* u = mem->users; u; u = u->next) {
+            TB_Node* use = u->n;
+            if (!is_mem_out_op(use)) continue;
+
+            TB_Node* at = use;
+            if (use->type == TB_PHI) {
+                // the clobber happens at the end of the predecessor
+                at = use->inputs[0]->inputs[u->slot - 1];
+            } else if (use->type == TB_STORE && u->slot == 1 && budget > 0 && alias_query_access(p->f, n, use) == ALIAS_NO) {
+                budget -= 1;
+                dyn_array_put(stack, use);
+                continue;
+            }
+
+            ptrdiff_t search = nl_map_get(p->scheduled, at);
+            if (search < 0) continue;
+
+            // effects we can't reach from the load's placement don't matter
+            TB_BasicBlock* bb = p->scheduled[search].v;
+            if (bb_dominates(early, bb)) {
+                lca = find_lca(p, lca, bb);
+            }
+        }
+    }
+
+    p->stack = stack;
+    return lca;
+}
+
 static void schedule_late(TB_Passes* p, TB_Node* n) {
     // pinned nodes can't be rescheduled
     if (!is_pinned(n)) {
@@ -133,7 +250,23 @@ static void schedule_late(TB_Passes* p, TB_Node* n) {
             lca = find_lca(p, lca, use_block);
         }
 
+        if (lca != NULL && n->type == TB_LOAD) {
+            lca = schedule_anti_deps(p, n, lca);
+        }
+
         // tb_assert(lca, "missing least common ancestor");
+        if (lca != NULL && node_cost(n) > 0.0f) {
+            // anywhere between the early and late placements is fine, cheap nodes go
+            // wherever runs the least (which is how they get out of loops).
+            TB_BasicBlock* early = nl_map_get_checked(p->scheduled, n);
+            TB_BasicBlock* best = lca;
+            for (TB_BasicBlock* bb = lca; bb != early && bb->dom != bb;) {
+                bb = bb->dom;
+                if (bb->freq < best->freq) best = bb;
+            }
+            lca = best;
+        }
+
         if (lca != NULL) {
             TB_OPTDEBUG(GCM)(
                 printf("  LATE  v%u into .bb%d: ", n->gvn, lca->id),
@@ -175,6 +308,8 @@ void tb_pass_schedule(TB_Passes* p, TB_CFG cfg) {
                 TB_BasicBlock* best = &nl_map_get_checked(cfg.node_to_block, ws->items[i]);
                 best->items = nl_hashset_alloc(32);
             }
+
+            schedule_loop_freq(p, cfg);
         }
 
         CUIK_TIMED_BLOCK("pinned schedule") {
@@ -214,9 +349,14 @@ void tb_pass_schedule(TB_Passes* p, TB_CFG cfg) {
         }
 
         CUIK_TIMED_BLOCK("early schedule") {
+            dyn_array_clear(p->stack);
             FOREACH_REVERSE_N(i, 0, cfg.block_count) {
                 TB_Node* end = nl_map_get_checked(cfg.node_to_block, ws->items[i]).end;
                 schedule_early(p, end);
+
+                while (dyn_array_length(p->stack)) {
+                    schedule_early(p, dyn_array_pop(p->stack));
+                }
             }
         }
 
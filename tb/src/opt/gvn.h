@@ -65,7 +65,6 @@ static size_t extra_bytes(TB_Node* n) {
         case TB_NEG:
         case TB_NOT:
         case TB_END:
-        case TB_PROJ:
         case TB_PHI:
         case TB_CLZ:
         case TB_CTZ:
@@ -79,8 +78,29 @@ static size_t extra_bytes(TB_Node* n) {
         case TB_DEBUGBREAK:
         case TB_ADDPAIR:
         case TB_MULPAIR:
+        case TB_TRAP:
+        case TB_CYCLE_COUNTER:
+        case TB_BSWAP:
+        case TB_POPCNT:
+        case TB_X86INTRIN_LDMXCSR:
+        case TB_X86INTRIN_STMXCSR:
+        case TB_X86INTRIN_SQRT:
+        case TB_X86INTRIN_RSQRT:
+        case TB_VBROADCAST:
         return 0;
 
+        case TB_VSHUFFLE: {
+            TB_NodeShuffle* s = TB_NODE_GET_EXTRA(n);
+            return sizeof(TB_NodeShuffle) + s->count;
+        }
+
+        case TB_VEXTRACT:
+        case TB_VINSERT:
+        return sizeof(TB_NodeLane);
+
+        case TB_PROJ:
+        return sizeof(TB_NodeProj);
+
         case TB_START:
         case TB_REGION:
         return sizeof(TB_NodeRegion);
@@ -100,6 +120,8 @@ static size_t extra_bytes(TB_Node* n) {
         case TB_MEMSET:
         case TB_READ:
         case TB_WRITE:
+        case TB_VMASKLOAD:
+        case TB_VMASKSTORE:
         return sizeof(TB_NodeMemAccess);
 
         case TB_ATOMIC_LOAD:
@@ -191,7 +213,8 @@ bool gvn_compare(void* a, void* b) {
             return ai->ab == bi->ab;
         }
 
-        case TB_LOAD: {
+        case TB_LOAD:
+        case TB_VMASKLOAD: {
             TB_NodeMemAccess* am = TB_NODE_GET_EXTRA(x);
             TB_NodeMemAccess* bm = TB_NODE_GET_EXTRA(y);
             return am->align == bm->align;
@@ -221,6 +244,19 @@ bool gvn_compare(void* a, void* b) {
             return aa->level == bb->level;
         }
 
+        case TB_VSHUFFLE: {
+            TB_NodeShuffle* aa = TB_NODE_GET_EXTRA(x);
+            TB_NodeShuffle* bb = TB_NODE_GET_EXTRA(y);
+            return aa->count == bb->count && memcmp(aa->indices, bb->indices, aa->count) == 0;
+        }
+
+        case TB_VEXTRACT:
+        case TB_VINSERT: {
+            TB_NodeLane* aa = TB_NODE_GET_EXTRA(x);
+            TB_NodeLane* bb = TB_NODE_GET_EXTRA(y);
+            return aa->lane == bb->lane;
+        }
+
         case TB_CMP_EQ:
         case TB_CMP_NE:
         case TB_CMP_ULT:
@@ -253,6 +289,7 @@ bool gvn_compare(void* a, void* b) {
         case TB_MERGEMEM:
         case TB_UNREACHABLE:
         case TB_DEBUGBREAK:
+        case TB_VBROADCAST:
         return true;
 
         default: return false;
@@ -0,0 +1,251 @@
+// Inliner, unlike the rest of the passes this one works on the whole module since it
+// reads the callee's graph while rewriting the caller. It runs on the unoptimized IR
+// before anyone's called tb_pass_enter so there's no use lists to maintain, we clone
+// the callee's nodes the same way loop_clone_node does, splice them in place of the
+// call's projections and let the per function peepholes clean up the result.
+//
+// Functions are visited bottom-up over the call graph so by the time we get to a caller
+// its callees are done changing, anything we clone already has its own calls inlined.
+// Calls within an SCC are left alone.
+typedef struct {
+    // reachable nodes, START and its projections included (only kept for candidates)
+    DynArray(TB_Node*) nodes;
+    bool is_candidate;
+} InlineInfo;
+
+typedef struct {
+    NL_Map(TB_Function*, InlineInfo) infos;
+
+    // call projections -> what they've been replaced with
+    NL_Map(TB_Node*, TB_Node*) replaced;
+
+    // callee node (by gvn) -> clone
+    size_t map_cap;
+    TB_Node** map;
+} InlineCtx;
+
+static bool inline_is_start_proj(TB_Node* n, int index) {
+    return n->type == TB_PROJ && n->inputs[0]->type == TB_START && TB_NODE_GET_EXTRA_T(n, TB_NodeProj)->index == index;
+}
+
+static void inline_analyze(TB_Function* f, InlineInfo* info, int max_nodes) {
+    info->nodes = walk_all_nodes(f);
+
+    TB_Node* end = f->stop_node;
+    if (end == NULL || f->prototype->has_varargs || end->input_count != 3 + f->prototype->return_count) {
+        return;
+    }
+
+    int cost = 0;
+    dyn_array_for(i, info->nodes) {
+        TB_Node* n = info->nodes[i];
+        switch (n->type) {
+            // these can't be moved into another frame
+            case TB_TAILCALL:
+            case TB_VA_START:
+            case TB_MACHINE_OP:
+            return;
+
+            case TB_START:
+            continue;
+
+            case TB_PROJ:
+            if (n->inputs[0]->type == TB_START) continue;
+            break;
+
+            default: break;
+        }
+
+        // the return PC only makes sense when it goes to END
+        FOREACH_N(j, 0, n->input_count) {
+            if (n != end && n->inputs[j] && inline_is_start_proj(n->inputs[j], 2)) {
+                return;
+            }
+        }
+
+        cost += 1;
+    }
+
+    info->is_candidate = cost <= max_nodes;
+}
+
+// clones the callee into the caller and records what the call's projections turn into
+static void inline_call_site(InlineCtx* ctx, TB_Function* f, TB_Node* call, TB_Function* callee, InlineInfo* info) {
+    if (ctx->map_cap < callee->node_count) {
+        tb_platform_heap_free(ctx->map);
+        ctx->map_cap = callee->node_count;
+        ctx->map = tb_platform_heap_alloc(ctx->map_cap * sizeof(TB_Node*));
+    }
+
+    TB_Node** map = ctx->map;
+    memset(map, 0, callee->node_count * sizeof(TB_Node*));
+
+    // clone nodes, START gets substituted with the call's inputs
+    dyn_array_for(i, info->nodes) {
+        TB_Node* n = info->nodes[i];
+        TB_Node* cloned;
+        if (n->type == TB_START) {
+            cloned = f->start_node;
+        } else if (n->type == TB_PROJ && n->inputs[0]->type == TB_START) {
+            int index = TB_NODE_GET_EXTRA_T(n, TB_NodeProj)->index;
+            cloned = index == 2 ? f->params[2] : call->inputs[index];
+        } else if (n == callee->stop_node) {
+            continue;
+        } else {
+            size_t extra = extra_bytes(n);
+            cloned = tb_alloc_node(f, n->type, n->dt, n->input_count, extra);
+
+            // clone extra data
+            memcpy(cloned->extra, n->extra, extra);
+        }
+
+        map[n->gvn] = cloned;
+    }
+
+    // fill cloned edges
+    dyn_array_for(i, info->nodes) {
+        TB_Node* n = info->nodes[i];
+        TB_Node* cloned = map[n->gvn];
+        if (cloned == NULL || n->type == TB_START || (n->type == TB_PROJ && n->inputs[0]->type == TB_START)) {
+            continue;
+        }
+
+        FOREACH_N(j, 0, n->input_count) {
+            cloned->inputs[j] = n->inputs[j] ? map[n->inputs[j]->gvn] : NULL;
+        }
+
+        if (n->type == TB_CALL || n->type == TB_SYSCALL) {
+            TB_NodeCall* c = TB_NODE_GET_EXTRA(cloned);
+            FOREACH_N(j, 0, c->proj_count) {
+                if (c->projs[j]) c->projs[j] = map[c->projs[j]->gvn];
+            }
+        } else if (n->type >= TB_ATOMIC_LOAD && n->type <= TB_ATOMIC_CAS) {
+            TB_NodeAtomic* a = TB_NODE_GET_EXTRA(cloned);
+            if (a->proj0) a->proj0 = map[a->proj0->gvn];
+            if (a->proj1) a->proj1 = map[a->proj1->gvn];
+        }
+    }
+
+    // the other exits (traps, unreachables, infinite loops) are roots now
+    dyn_array_for(i, callee->terminators) {
+        TB_Node* t = callee->terminators[i];
+        if (t != callee->stop_node) {
+            dyn_array_put(f->terminators, map[t->gvn]);
+        }
+    }
+
+    // call's control & memory continue from the callee's return, the data
+    // projections are the returned values.
+    TB_Node* end = callee->stop_node;
+    TB_NodeCall* c = TB_NODE_GET_EXTRA(call);
+    FOREACH_N(i, 0, c->proj_count) {
+        TB_Node* proj = c->projs[i];
+        if (proj != NULL) {
+            TB_Node* in = end->inputs[i < 2 ? i : 1 + i];
+            nl_map_put(ctx->replaced, proj, map[in->gvn]);
+        }
+    }
+}
+
+static TB_Node* inline_resolve(InlineCtx* ctx, TB_Node* n) {
+    // an argument might've been the result of another inlined call
+    ptrdiff_t search;
+    while (n != NULL && (search = nl_map_get(ctx->replaced, n)) >= 0) {
+        n = ctx->replaced[search].v;
+    }
+    return n;
+}
+
+// returns the number of call sites inlined into f
+static int inline_function(InlineCtx* ctx, TB_Function* f, InlineInfo* info) {
+    // the walk only covers the original nodes so the new ones won't get revisited
+    int count = 0;
+    size_t node_count = dyn_array_length(info->nodes);
+    FOREACH_N(i, 0, node_count) {
+        TB_Node* call = info->nodes[i];
+        TB_Function* callee = call->type == TB_CALL ? call_direct_target(call) : NULL;
+        if (callee == NULL || callee->scc == f->scc) {
+            continue;
+        }
+
+        // callees which haven't been visited yet aren't in the IR call graph
+        ptrdiff_t search = nl_map_get(ctx->infos, callee);
+        if (search < 0) {
+            continue;
+        }
+
+        InlineInfo* callee_info = &ctx->infos[search].v;
+        if (!callee_info->is_candidate || call->input_count != 3 + callee->param_count || !same_proto(TB_NODE_GET_EXTRA_T(call, TB_NodeCall)->proto, callee->prototype)) {
+            continue;
+        }
+
+        inline_call_site(ctx, f, call, callee, callee_info);
+        count += 1;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // rewire everyone who used the call projections, the calls themselves
+    // aren't reachable after this. we resolve edges before following them
+    // so the inlined bodies get visited too.
+    size_t words = (f->node_count + 63) / 64;
+    uint64_t* visited = tb_platform_heap_alloc(words * sizeof(uint64_t));
+    memset(visited, 0, words * sizeof(uint64_t));
+
+    DynArray(TB_Node*) nodes = NULL;
+    dyn_array_for(i, f->terminators) {
+        f->terminators[i] = inline_resolve(ctx, f->terminators[i]);
+        walk_push(&nodes, visited, f->terminators[i]);
+    }
+
+    for (size_t i = 0; i < dyn_array_length(nodes); i++) {
+        TB_Node* n = nodes[i];
+        FOREACH_N(j, 0, n->input_count) {
+            n->inputs[j] = inline_resolve(ctx, n->inputs[j]);
+            walk_push(&nodes, visited, n->inputs[j]);
+        }
+    }
+
+    tb_platform_heap_free(visited);
+    dyn_array_destroy(nodes);
+    nl_map_free(ctx->replaced);
+    return count;
+}
+
+void tb_module_inline(TB_Module* m, int max_nodes) {
+    CUIK_TIMED_BLOCK("inline") {
+        InlineCtx ctx = { 0 };
+        TB_CallGraph cg = tb_module_call_graph(m);
+
+        FOREACH_N(i, 0, cg.scc_count) {
+            TB_CallGraphSCC* scc = &cg.sccs[i];
+            FOREACH_N(j, 0, scc->func_count) {
+                TB_Function* f = scc->funcs[j];
+                if (!func_has_ir(f)) continue;
+
+                InlineInfo info = { 0 };
+                inline_analyze(f, &info, max_nodes);
+                if (inline_function(&ctx, f, &info) > 0) {
+                    // it's grown, measure it again for the callers
+                    dyn_array_destroy(info.nodes);
+                    info = (InlineInfo){ 0 };
+                    inline_analyze(f, &info, max_nodes);
+                }
+
+                if (!info.is_candidate) {
+                    dyn_array_destroy(info.nodes);
+                }
+                nl_map_put(ctx.infos, f, info);
+            }
+        }
+
+        nl_map_for(i, ctx.infos) {
+            dyn_array_destroy(ctx.infos[i].v.nodes);
+        }
+        nl_map_free(ctx.infos);
+        tb_platform_heap_free(ctx.map);
+        tb_call_graph_free(&cg);
+    }
+}
@@ -39,6 +39,1028 @@ static TB_Node* loop_clone_node(TB_Passes* restrict p, TB_Function* f, TB_Node*
     return cloned;
 }
 
+////////////////////////////////
+// Loop analysis
+////////////////////////////////
+// we only analyze loops in this canonical form, anything else is left alone:
+//
+//   header:
+//     i = phi(init, i + step)
+//     if (i < limit) body else exit
+//   body:
+//     ...straight line code...
+//     goto header
+//
+// the header has a single entry and a single backedge, the only thing it does is test
+// the induction variable and the body doesn't branch.
+typedef struct {
+    TB_Node* header;
+    TB_Node* latch; // branch at the end of the header
+    TB_Node* body;  // BB entry of the body (the backedge comes out of it)
+    int entry, backedge;
+
+    // induction var
+    TB_Node* iv;
+    TB_Node* init;
+    TB_Node* limit;
+    int64_t step;
+    TB_NodeTypeEnum cmp;
+
+    // -1 if it's not known at compile time
+    int64_t trip_count;
+
+    // memory phi on the header, NULL if the loop doesn't write to memory
+    TB_Node* mem;
+
+    // memoized loop_variant results, they're dropped with loop_forget whenever
+    // a transform moves things in or out of the loop.
+    NL_Map(TB_Node*, bool) variant;
+} LoopInfo;
+
+static bool loop_is_header_phi(LoopInfo* loop, TB_Node* n) {
+    return n->type == TB_PHI && n->inputs[0] == loop->header;
+}
+
+static TB_Node* loop_find_latch(TB_Node* header) {
+    for (User* u = header->users; u; u = u->next) {
+        if (u->n->type == TB_BRANCH && u->slot == 0) {
+            return u->n;
+        }
+    }
+
+    return NULL;
+}
+
+static TB_Node* loop_find_proj(TB_Node* n, int index) {
+    for (User* u = n->users; u; u = u->next) {
+        if (u->n->type == TB_PROJ && TB_NODE_GET_EXTRA_T(u->n, TB_NodeProj)->index == index) {
+            return u->n;
+        }
+    }
+
+    return NULL;
+}
+
+static bool loop_variant(LoopInfo* loop, TB_Node* n) {
+    ptrdiff_t search = nl_map_get(loop->variant, n);
+    if (search >= 0) {
+        return loop->variant[search].v;
+    }
+
+    // anything outside the loop is defined before the header, we don't need to walk
+    // through any other phis to know that.
+    bool result = false;
+    if (n->type == TB_PHI) {
+        result = loop_is_header_phi(loop, n);
+    } else if (n->type != TB_REGION && !cfg_is_control(n)) {
+        if (n->inputs[0] == loop->body || n->inputs[0] == loop->header) {
+            result = true;
+        } else {
+            FOREACH_N(i, 1, n->input_count) {
+                if (n->inputs[i] && loop_variant(loop, n->inputs[i])) {
+                    result = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    nl_map_put(loop->variant, n, result);
+    return result;
+}
+
+static void loop_forget(LoopInfo* loop) {
+    nl_map_free(loop->variant);
+}
+
+static bool loop_analyze(TB_Passes* restrict p, TB_Node* header, int backedge, LoopInfo* restrict loop) {
+    *loop = (LoopInfo){ .header = header, .entry = 1 - backedge, .backedge = backedge, .trip_count = -1 };
+
+    // the header can't have any control flow other than the exit test
+    TB_Node* latch = loop_find_latch(header);
+    if (latch == NULL || TB_NODE_GET_EXTRA_T(latch, TB_NodeBranch)->succ_count != 2) {
+        return false;
+    }
+
+    for (User* u = header->users; u; u = u->next) {
+        if (u->n != latch && cfg_is_control(u->n)) {
+            return false;
+        }
+    }
+
+    // the true path must be the body and it has to jump straight back to the header
+    TB_Node* body_proj = loop_find_proj(latch, 0);
+    if (body_proj == NULL || loop_find_proj(latch, 1) == NULL) {
+        return false;
+    }
+
+    TB_Node* body = cfg_next_bb_after_cproj(body_proj);
+    if (header->inputs[backedge] != body) {
+        return false;
+    }
+
+    loop->latch = latch;
+    loop->body = body;
+
+    // exit test is (i < limit)
+    TB_Node* cond = latch->inputs[1];
+    if (cond->type != TB_CMP_SLT && cond->type != TB_CMP_ULT) {
+        return false;
+    }
+
+    TB_Node* iv = cond->inputs[1];
+    if (!loop_is_header_phi(loop, iv) || iv->dt.type != TB_INT) {
+        return false;
+    }
+
+    // induction vars are i = phi(init, i + step)
+    TB_Node* next = iv->inputs[1 + backedge];
+    if (next->type != TB_ADD || next->inputs[1] != iv || next->inputs[2]->type != TB_INTEGER_CONST) {
+        return false;
+    }
+
+    int64_t step = tb__sxt(TB_NODE_GET_EXTRA_T(next->inputs[2], TB_NodeInt)->value, iv->dt.data, 64);
+    if (step <= 0) {
+        return false;
+    }
+
+    TB_Node* limit = cond->inputs[2];
+    if (loop_is_header_phi(loop, limit)) {
+        return false;
+    }
+
+    loop->iv = iv;
+    loop->init = iv->inputs[1 + loop->entry];
+    loop->limit = limit;
+    loop->step = step;
+    loop->cmp = cond->type;
+
+    for (User* u = header->users; u; u = u->next) {
+        if (u->n->type == TB_PHI && u->n->dt.type == TB_MEMORY) {
+            loop->mem = u->n;
+        }
+    }
+
+    // trip count for constant bounds
+    if (loop->init->type == TB_INTEGER_CONST && limit->type == TB_INTEGER_CONST) {
+        uint64_t a = TB_NODE_GET_EXTRA_T(loop->init, TB_NodeInt)->value;
+        uint64_t b = TB_NODE_GET_EXTRA_T(limit, TB_NodeInt)->value;
+
+        bool empty;
+        if (loop->cmp == TB_CMP_SLT) {
+            empty = tb__sxt(a, iv->dt.data, 64) >= tb__sxt(b, iv->dt.data, 64);
+        } else {
+            empty = a >= b;
+        }
+
+        loop->trip_count = empty ? 0 : (((b - a) & tb__mask(iv->dt.data)) + step - 1) / step;
+    }
+
+    return true;
+}
+
+////////////////////////////////
+// Loop vectorizer
+////////////////////////////////
+// Counted loops over consecutive array elements get a vector loop in front of them
+// which does as many iterations as it can in 128bit chunks, the original loop runs
+// the leftovers:
+//
+//   vend = init + ((limit - init) & -lanes)
+//   vheader:
+//     vi = phi(init, vi + lanes)
+//     if (vi < vend) vbody else scalar header (with i = vi)
+//
+// loads and stores must be indexed by the induction var plus a constant, the only
+// loop carried values we handle are the induction var, memory and integer reductions.
+// If the stores might overlap with the other accesses within a vector's width we test
+// that before going into the vector loop.
+typedef struct {
+    TB_Node* n;
+    TB_Node* base;
+    int64_t offset; // in elements
+} LoopAccess;
+
+typedef struct {
+    TB_Passes* p;
+    LoopInfo* loop;
+
+    DynArray(TB_Node*) reductions;
+    DynArray(LoopAccess) accesses;
+
+    TB_DataType elem_dt;
+    int elem_bytes, lanes;
+
+    // scalar -> vector
+    NL_Map(TB_Node*, TB_Node*) widened;
+    TB_Node* vheader;
+    TB_Node* vbody;
+    TB_Node* viv;
+} LoopVectorizer;
+
+static int loop_elem_bytes(TB_DataType dt) {
+    if (dt.type == TB_FLOAT) {
+        return dt.data == TB_FLT_64 ? 8 : 4;
+    } else if (dt.type == TB_INT && (dt.data == 8 || dt.data == 16 || dt.data == 32 || dt.data == 64)) {
+        return dt.data / 8;
+    } else {
+        return 0;
+    }
+}
+
+static bool loop_vec_elem(LoopVectorizer* restrict ctx, TB_DataType dt) {
+    int bytes = loop_elem_bytes(dt);
+    if (bytes == 0) {
+        return false;
+    }
+
+    // every lane in the loop has to be the same width so we've got one vector length
+    if (ctx->elem_bytes == 0) {
+        ctx->elem_dt = dt;
+        ctx->elem_bytes = bytes;
+        ctx->lanes = 16 / bytes;
+        return true;
+    }
+
+    return ctx->elem_bytes == bytes;
+}
+
+// matches iv, iv + C and extensions of them (which must agree with the compare's signedness),
+// ext is set to the extension we walked through (TB_NULL if there wasn't one).
+static bool loop_affine_index(LoopInfo* loop, TB_Node* n, int64_t* offset, TB_NodeTypeEnum* ext) {
+    if (n == loop->iv) {
+        return true;
+    } else if (n->type == TB_SIGN_EXT || n->type == TB_ZERO_EXT) {
+        if ((n->type == TB_SIGN_EXT) != (loop->cmp == TB_CMP_SLT)) {
+            return false;
+        }
+
+        *ext = n->type;
+        return loop_affine_index(loop, n->inputs[1], offset, ext);
+    } else if ((n->type == TB_ADD || n->type == TB_SUB) && n->inputs[2]->type == TB_INTEGER_CONST) {
+        // the index can't wrap around within the vector
+        if (loop->cmp != TB_CMP_SLT || !(TB_NODE_GET_EXTRA_T(n, TB_NodeBinopInt)->ab & TB_ARITHMATIC_NSW)) {
+            return false;
+        }
+
+        int64_t x = tb__sxt(TB_NODE_GET_EXTRA_T(n->inputs[2], TB_NodeInt)->value, n->dt.data, 64);
+        *offset += n->type == TB_ADD ? x : -x;
+        return loop_affine_index(loop, n->inputs[1], offset, ext);
+    } else {
+        return false;
+    }
+}
+
+static bool loop_vec_check_addr(LoopVectorizer* restrict ctx, TB_Node* n, TB_Node* addr) {
+    if (addr->type != TB_ARRAY_ACCESS || loop_variant(ctx->loop, addr->inputs[1])) {
+        return false;
+    }
+
+    // consecutive lanes only
+    if (TB_NODE_GET_EXTRA_T(addr, TB_NodeArray)->stride != ctx->elem_bytes) {
+        return false;
+    }
+
+    int64_t offset = 0;
+    TB_NodeTypeEnum ext = TB_NULL;
+    if (!loop_affine_index(ctx->loop, addr->inputs[2], &offset, &ext)) {
+        return false;
+    }
+
+    LoopAccess a = { n, addr->inputs[1], offset };
+    dyn_array_put(ctx->accesses, a);
+    return true;
+}
+
+// doesn't modify the graph, tells us if loop_vec_widen will work on the node
+static bool loop_vec_check(LoopVectorizer* restrict ctx, TB_Node* n) {
+    if (nl_map_get(ctx->widened, n) >= 0) {
+        return true;
+    }
+
+    if (!loop_variant(ctx->loop, n)) {
+        // invariant values are broadcast
+        if (n->dt.type != TB_MEMORY && !loop_vec_elem(ctx, n->dt)) {
+            return false;
+        }
+    } else if (n == ctx->loop->mem) {
+        // vector loop has its own
+    } else if (n->type == TB_PHI) {
+        // the induction var can only be used to index, reductions only by their own op
+        return false;
+    } else {
+        switch (n->type) {
+            case TB_LOAD:
+            if (!loop_vec_elem(ctx, n->dt) || !loop_vec_check_addr(ctx, n, n->inputs[2])) {
+                return false;
+            }
+
+            if (!loop_vec_check(ctx, n->inputs[1])) {
+                return false;
+            }
+            break;
+
+            case TB_STORE:
+            if (!loop_vec_elem(ctx, n->inputs[3]->dt) || !loop_vec_check_addr(ctx, n, n->inputs[2])) {
+                return false;
+            }
+
+            if (!loop_vec_check(ctx, n->inputs[1]) || !loop_vec_check(ctx, n->inputs[3])) {
+                return false;
+            }
+            break;
+
+            // x86 doesn't have packed 8bit or 64bit multiplies
+            case TB_MUL:
+            if (n->dt.data != 16 && n->dt.data != 32) {
+                return false;
+            }
+            // fallthrough
+            case TB_AND:
+            case TB_OR:
+            case TB_XOR:
+            case TB_ADD:
+            case TB_SUB:
+            case TB_FADD:
+            case TB_FSUB:
+            case TB_FMUL:
+            case TB_FDIV:
+            if (!loop_vec_elem(ctx, n->dt) || !loop_vec_check(ctx, n->inputs[1]) || !loop_vec_check(ctx, n->inputs[2])) {
+                return false;
+            }
+            break;
+
+            case TB_NEG:
+            case TB_NOT:
+            if (!loop_vec_elem(ctx, n->dt) || !loop_vec_check(ctx, n->inputs[1])) {
+                return false;
+            }
+            break;
+
+            default:
+            return false;
+        }
+    }
+
+    // mark as visited, we'll fill in the real node later
+    nl_map_put(ctx->widened, n, NULL);
+    return true;
+}
+
+static TB_Node* loop_new_node(TB_Passes* restrict p, int type, TB_DataType dt, int input_count, size_t extra) {
+    TB_Node* n = tb_alloc_node(p->f, type, dt, input_count, extra);
+    tb_pass_mark(p, n);
+    return n;
+}
+
+static TB_Node* loop_new_binop(TB_Passes* restrict p, int type, TB_Node* a, TB_Node* b, TB_ArithmeticBehavior ab) {
+    TB_Node* n = loop_new_node(p, type, a->dt, 3, sizeof(TB_NodeBinopInt));
+    set_input(p, n, a, 1);
+    set_input(p, n, b, 2);
+    TB_NODE_SET_EXTRA(n, TB_NodeBinopInt, .ab = ab);
+    return n;
+}
+
+static TB_Node* loop_new_cmp(TB_Passes* restrict p, int type, TB_Node* a, TB_Node* b) {
+    TB_Node* n = loop_new_node(p, type, TB_TYPE_BOOL, 3, sizeof(TB_NodeCompare));
+    set_input(p, n, a, 1);
+    set_input(p, n, b, 2);
+    TB_NODE_SET_EXTRA(n, TB_NodeCompare, .cmp_dt = a->dt);
+    return n;
+}
+
+static TB_Node* loop_new_region(TB_Passes* restrict p, int input_count, float freq) {
+    TB_Node* n = loop_new_node(p, TB_REGION, TB_TYPE_CONTROL, input_count, sizeof(TB_NodeRegion));
+    TB_NODE_GET_EXTRA_T(n, TB_NodeRegion)->freq = freq;
+    return n;
+}
+
+static TB_Node* loop_new_phi(TB_Passes* restrict p, TB_Node* region, TB_Node* a, TB_Node* b) {
+    TB_Node* n = loop_new_node(p, TB_PHI, a->dt, 3, 0);
+    set_input(p, n, region, 0);
+    set_input(p, n, a, 1);
+    set_input(p, n, b, 2);
+    return n;
+}
+
+static TB_Node* loop_new_if(TB_Passes* restrict p, TB_Node* ctrl, TB_Node* cond, TB_Node** if_true, TB_Node** if_false) {
+    TB_Node* n = loop_new_node(p, TB_BRANCH, TB_TYPE_TUPLE, 2, sizeof(TB_NodeBranch) + sizeof(int64_t));
+    set_input(p, n, ctrl, 0);
+    set_input(p, n, cond, 1);
+
+    TB_NodeBranch* br = TB_NODE_GET_EXTRA(n);
+    br->succ_count = 2;
+    br->keys[0] = 0;
+
+    *if_true  = make_proj_node(p->f, p, TB_TYPE_CONTROL, n, 0);
+    *if_false = make_proj_node(p->f, p, TB_TYPE_CONTROL, n, 1);
+    tb_pass_mark(p, *if_true);
+    tb_pass_mark(p, *if_false);
+    return n;
+}
+
+static TB_Node* loop_new_lane_op(TB_Passes* restrict p, int type, TB_DataType dt, TB_Node* vec, TB_Node* val, int lane) {
+    TB_Node* n = loop_new_node(p, type, dt, val ? 3 : 2, sizeof(TB_NodeLane));
+    set_input(p, n, vec, 1);
+    if (val) set_input(p, n, val, 2);
+    TB_NODE_SET_EXTRA(n, TB_NodeLane, .lane = lane);
+    return n;
+}
+
+// same as n but with the induction var replaced by the vector loop's
+static TB_Node* loop_vec_index(LoopVectorizer* restrict ctx, TB_Node* n) {
+    if (n == ctx->loop->iv) {
+        return ctx->viv;
+    } else if (!loop_variant(ctx->loop, n)) {
+        return n;
+    }
+
+    size_t extra = extra_bytes(n);
+    TB_Node* k = loop_new_node(ctx->p, n->type, n->dt, n->input_count, extra);
+    memcpy(k->extra, n->extra, extra);
+    FOREACH_N(i, 1, n->input_count) {
+        set_input(ctx->p, k, loop_vec_index(ctx, n->inputs[i]), i);
+    }
+    return k;
+}
+
+static TB_Node* loop_vec_addr(LoopVectorizer* restrict ctx, TB_Node* addr) {
+    TB_Node* k = loop_new_node(ctx->p, TB_ARRAY_ACCESS, TB_TYPE_PTR, 3, sizeof(TB_NodeArray));
+    set_input(ctx->p, k, addr->inputs[1], 1);
+    set_input(ctx->p, k, loop_vec_index(ctx, addr->inputs[2]), 2);
+    *TB_NODE_GET_EXTRA_T(k, TB_NodeArray) = *TB_NODE_GET_EXTRA_T(addr, TB_NodeArray);
+    return k;
+}
+
+static TB_Node* loop_vec_widen(LoopVectorizer* restrict ctx, TB_Node* n) {
+    TB_Passes* p = ctx->p;
+
+    ptrdiff_t search = nl_map_get(ctx->widened, n);
+    assert(search >= 0 && "we didn't check this node?");
+    if (ctx->widened[search].v != NULL) {
+        return ctx->widened[search].v;
+    }
+
+    TB_Node* k;
+    if (!loop_variant(ctx->loop, n)) {
+        if (n->dt.type == TB_MEMORY) {
+            k = n;
+        } else {
+            k = loop_new_node(p, TB_VBROADCAST, tb_vector_type(n->dt, ctx->lanes), 2, 0);
+            set_input(p, k, n, 1);
+        }
+    } else if (n->type == TB_LOAD) {
+        k = loop_new_node(p, TB_LOAD, tb_vector_type(n->dt, ctx->lanes), 3, sizeof(TB_NodeMemAccess));
+        set_input(p, k, ctx->vbody, 0);
+        set_input(p, k, loop_vec_widen(ctx, n->inputs[1]), 1);
+        set_input(p, k, loop_vec_addr(ctx, n->inputs[2]), 2);
+        *TB_NODE_GET_EXTRA_T(k, TB_NodeMemAccess) = *TB_NODE_GET_EXTRA_T(n, TB_NodeMemAccess);
+    } else if (n->type == TB_STORE) {
+        k = loop_new_node(p, TB_STORE, TB_TYPE_MEMORY, 4, sizeof(TB_NodeMemAccess));
+        set_input(p, k, ctx->vbody, 0);
+        set_input(p, k, loop_vec_widen(ctx, n->inputs[1]), 1);
+        set_input(p, k, loop_vec_addr(ctx, n->inputs[2]), 2);
+        set_input(p, k, loop_vec_widen(ctx, n->inputs[3]), 3);
+        *TB_NODE_GET_EXTRA_T(k, TB_NodeMemAccess) = *TB_NODE_GET_EXTRA_T(n, TB_NodeMemAccess);
+    } else {
+        // element-wise ops map directly
+        size_t extra = extra_bytes(n);
+        k = loop_new_node(p, n->type, tb_vector_type(n->dt, ctx->lanes), n->input_count, extra);
+        memcpy(k->extra, n->extra, extra);
+        FOREACH_N(i, 1, n->input_count) {
+            set_input(p, k, loop_vec_widen(ctx, n->inputs[i]), i);
+        }
+    }
+
+    nl_map_put(ctx->widened, n, k);
+    return k;
+}
+
+static uint64_t loop_reduction_identity(TB_Node* op) {
+    switch (op->type) {
+        case TB_MUL: return 1;
+        case TB_AND: return UINT64_MAX;
+        default:     return 0;
+    }
+}
+
+// is the memory op n after the store within the same iteration
+static bool loop_mem_after(LoopVectorizer* restrict ctx, TB_Node* n, TB_Node* store) {
+    TB_Node* mem = n->inputs[1];
+    while (mem->type == TB_STORE && loop_variant(ctx->loop, mem)) {
+        if (mem == store) return true;
+        mem = mem->inputs[1];
+    }
+    return false;
+}
+
+// distance checks between a store and some other access, d is how many bytes b is
+// ahead of the store (per iteration):
+//
+//   load before store: breaks if -W < d < 0, it'd read lanes we haven't written yet.
+//   load after store:  breaks if 0 < d < W, it'd read lanes we've written too early.
+//   store-store:       breaks if 0 < |d| < W, the last one to write a lane changes.
+//
+// returns the bias and range such that (d + bias) <u range means it's unsafe.
+static void loop_alias_range(LoopVectorizer* restrict ctx, LoopAccess* store, LoopAccess* b, int64_t* bias, int64_t* range) {
+    int64_t w = ctx->lanes * ctx->elem_bytes;
+    if (b->n->type == TB_STORE) {
+        *bias = w - 1, *range = 2*w - 1;
+    } else if (loop_mem_after(ctx, b->n, store->n)) {
+        *bias = -1, *range = w - 1;
+    } else {
+        *bias = w - 1, *range = w - 1;
+    }
+}
+
+// accesses off of different objects (distinct locals, globals or restrict params)
+// don't need a runtime check
+static bool loop_distinct_bases(TB_Function* f, LoopAccess* a, LoopAccess* b) {
+    TB_Node* x = alias_decompose(a->base).base;
+    TB_Node* y = alias_decompose(b->base).base;
+    return x != y && alias_distinct_bases(f, x, y);
+}
+
+static void loop_vec_free(LoopVectorizer* restrict ctx) {
+    nl_map_free(ctx->widened);
+    dyn_array_destroy(ctx->reductions);
+    dyn_array_destroy(ctx->accesses);
+}
+
+static bool loop_vectorize(TB_Passes* restrict p, LoopInfo* restrict loop) {
+    if (loop->step != 1) {
+        return false;
+    }
+
+    LoopVectorizer ctx = { .p = p, .loop = loop };
+    nl_map_create(ctx.widened, 32);
+
+    TB_Node* header = loop->header;
+    bool ok = !loop_variant(loop, loop->limit);
+    for (User* u = header->users; u && ok; u = u->next) {
+        TB_Node* phi = u->n;
+        if (phi->type != TB_PHI || phi == loop->iv) {
+            continue;
+        }
+
+        TB_Node* next = phi->inputs[1 + loop->backedge];
+        if (phi == loop->mem) {
+            ok = loop_vec_check(&ctx, next);
+            continue;
+        }
+
+        // integer reductions, float ones can't be reassociated
+        bool is_reduction = false;
+        if (phi->dt.type == TB_INT) {
+            switch (next->type) {
+                case TB_ADD: case TB_MUL: case TB_AND: case TB_OR: case TB_XOR:
+                is_reduction = next->inputs[1] == phi || next->inputs[2] == phi;
+                break;
+            }
+        }
+
+        if (!is_reduction || !loop_vec_elem(&ctx, phi->dt) || (next->type == TB_MUL && phi->dt.data != 16 && phi->dt.data != 32)) {
+            ok = false;
+            break;
+        }
+
+        // the phi can't be used by anything else in the loop, if it were then
+        // checking that other node would've failed on the phi.
+        TB_Node* other = next->inputs[next->inputs[1] == phi ? 2 : 1];
+        ok = loop_vec_check(&ctx, other);
+        dyn_array_put(ctx.reductions, phi);
+    }
+
+    // not worth it without any arrays to walk or with tiny trip counts
+    if (ok && (dyn_array_length(ctx.accesses) == 0 || (loop->trip_count >= 0 && loop->trip_count < 2*ctx.lanes))) {
+        ok = false;
+    }
+
+    // accesses off of the same base can be checked right now
+    bool needs_runtime_check = false;
+    dyn_array_for(i, ctx.accesses) if (ok) {
+        LoopAccess* a = &ctx.accesses[i];
+        if (a->n->type != TB_STORE) continue;
+
+        dyn_array_for(j, ctx.accesses) {
+            LoopAccess* b = &ctx.accesses[j];
+            if (i == j || (b->n->type == TB_STORE && j < i)) continue;
+
+            if (a->base != b->base) {
+                needs_runtime_check |= !loop_distinct_bases(p->f, a, b);
+                continue;
+            }
+
+            int64_t bias, range;
+            loop_alias_range(&ctx, a, b, &bias, &range);
+            if ((uint64_t) ((b->offset - a->offset) * ctx.elem_bytes + bias) < range) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (!ok) {
+        loop_vec_free(&ctx);
+        return false;
+    }
+
+    TB_OPTDEBUG(LOOP)(printf("vectorizing loop on v%u (%d lanes)\n", header->gvn, ctx.lanes));
+
+    TB_Function* f = p->f;
+    TB_Node* pre = header->inputs[loop->entry];
+    TB_Node* init = loop->init;
+    TB_DataType iv_dt = loop->iv->dt;
+    TB_DataType vec_dt = tb_vector_type(ctx.elem_dt, ctx.lanes);
+
+    // vend = init < limit ? init + ((limit - init) & -lanes) : init
+    TB_Node* vend;
+    {
+        TB_Node* diff = loop_new_binop(p, TB_SUB, loop->limit, init, 0);
+        TB_Node* mask = make_int_node(f, p, iv_dt, -ctx.lanes);
+        TB_Node* rounded = loop_new_binop(p, TB_ADD, init, loop_new_binop(p, TB_AND, diff, mask, 0), 0);
+
+        vend = loop_new_node(p, TB_SELECT, iv_dt, 4, 0);
+        set_input(p, vend, loop_new_cmp(p, loop->cmp, init, loop->limit), 1);
+        set_input(p, vend, rounded, 2);
+        set_input(p, vend, init, 3);
+    }
+
+    // runtime alias checks for accesses which don't share a base, if any of them
+    // are unsafe we go straight to the scalar loop.
+    TB_Node* skip = NULL;
+    if (needs_runtime_check) {
+        TB_Node* unsafe = NULL;
+        dyn_array_for(i, ctx.accesses) {
+            LoopAccess* a = &ctx.accesses[i];
+            if (a->n->type != TB_STORE) continue;
+
+            dyn_array_for(j, ctx.accesses) {
+                LoopAccess* b = &ctx.accesses[j];
+                if (i == j || (b->n->type == TB_STORE && j < i) || a->base == b->base) continue;
+                if (loop_distinct_bases(f, a, b)) continue;
+
+                int64_t bias, range;
+                loop_alias_range(&ctx, a, b, &bias, &range);
+
+                TB_Node* pa = loop_new_node(p, TB_PTR2INT, TB_TYPE_I64, 2, 0);
+                TB_Node* pb = loop_new_node(p, TB_PTR2INT, TB_TYPE_I64, 2, 0);
+                set_input(p, pa, a->base, 1);
+                set_input(p, pb, b->base, 1);
+
+                int64_t dist = (b->offset - a->offset) * ctx.elem_bytes;
+                TB_Node* d = loop_new_binop(p, TB_SUB, pb, pa, 0);
+                d = loop_new_binop(p, TB_ADD, d, make_int_node(f, p, TB_TYPE_I64, dist + bias), 0);
+
+                TB_Node* cond = loop_new_cmp(p, TB_CMP_ULT, d, make_int_node(f, p, TB_TYPE_I64, range));
+                unsafe = unsafe ? loop_new_binop(p, TB_OR, unsafe, cond, 0) : cond;
+            }
+        }
+
+        loop_new_if(p, pre, unsafe, &skip, &pre);
+    }
+
+    // vector loop header
+    TB_Node* vheader = ctx.vheader = loop_new_region(p, 2, 10.0f);
+    set_input(p, vheader, pre, 0);
+
+    TB_Node* iv_next = loop->iv->inputs[1 + loop->backedge];
+    TB_ArithmeticBehavior iv_ab = TB_NODE_GET_EXTRA_T(iv_next, TB_NodeBinopInt)->ab;
+
+    ctx.viv = loop_new_phi(p, vheader, init, init);
+    set_input(p, ctx.viv, loop_new_binop(p, TB_ADD, ctx.viv, make_int_node(f, p, iv_dt, ctx.lanes), iv_ab), 2);
+
+    TB_Node *vbody, *vexit;
+    loop_new_if(p, vheader, loop_new_cmp(p, loop->cmp, ctx.viv, vend), &vbody, &vexit);
+    set_input(p, vheader, vbody, 1);
+    ctx.vbody = vbody;
+
+    DO_IF(TB_OPTDEBUG_LOOP)(TB_NODE_GET_EXTRA_T(vheader, TB_NodeRegion)->tag = lil_name(f, "loop.vector.%u", header->gvn));
+
+    TB_Node* vmem = NULL;
+    if (loop->mem) {
+        TB_Node* mem_init = loop->mem->inputs[1 + loop->entry];
+        vmem = loop_new_phi(p, vheader, mem_init, mem_init);
+        nl_map_put(ctx.widened, loop->mem, vmem);
+        set_input(p, vmem, loop_vec_widen(&ctx, loop->mem->inputs[1 + loop->backedge]), 2);
+    }
+
+    // reductions start off as [init, identity, identity, ...] and get folded at the end
+    DynArray(TB_Node*) red_out = NULL;
+    dyn_array_for(i, ctx.reductions) {
+        TB_Node* phi = ctx.reductions[i];
+        TB_Node* next = phi->inputs[1 + loop->backedge];
+        TB_Node* other = next->inputs[next->inputs[1] == phi ? 2 : 1];
+        TB_ArithmeticBehavior ab = TB_NODE_GET_EXTRA_T(next, TB_NodeBinopInt)->ab;
+
+        TB_Node* identity = loop_new_node(p, TB_VBROADCAST, vec_dt, 2, 0);
+        set_input(p, identity, make_int_node(f, p, phi->dt, loop_reduction_identity(next)), 1);
+
+        TB_Node* red_init = loop_new_lane_op(p, TB_VINSERT, vec_dt, identity, phi->inputs[1 + loop->entry], 0);
+        TB_Node* vphi = loop_new_phi(p, vheader, red_init, red_init);
+        set_input(p, vphi, loop_new_binop(p, next->type, vphi, loop_vec_widen(&ctx, other), ab), 2);
+
+        // horizontal fold for the scalar loop
+        TB_Node* sum = loop_new_lane_op(p, TB_VEXTRACT, phi->dt, vphi, NULL, 0);
+        FOREACH_N(j, 1, ctx.lanes) {
+            TB_Node* lane = loop_new_lane_op(p, TB_VEXTRACT, phi->dt, vphi, NULL, j);
+            sum = loop_new_binop(p, next->type, sum, lane, ab);
+        }
+        dyn_array_put(red_out, sum);
+    }
+
+    // if we skipped the vector loop, the scalar loop starts with the original values
+    TB_Node* scalar_entry = vexit;
+    TB_Node* iv_out = ctx.viv;
+    TB_Node* mem_out = vmem;
+    if (skip != NULL) {
+        scalar_entry = loop_new_region(p, 2, 1.0f);
+        set_input(p, scalar_entry, vexit, 0);
+        set_input(p, scalar_entry, skip, 1);
+
+        iv_out = loop_new_phi(p, scalar_entry, ctx.viv, init);
+        if (vmem) {
+            mem_out = loop_new_phi(p, scalar_entry, vmem, loop->mem->inputs[1 + loop->entry]);
+        }
+
+        dyn_array_for(i, ctx.reductions) {
+            red_out[i] = loop_new_phi(p, scalar_entry, red_out[i], ctx.reductions[i]->inputs[1 + loop->entry]);
+        }
+    }
+
+    // the original loop does the leftovers
+    tb_pass_mark_users(p, header);
+    set_input(p, header, scalar_entry, loop->entry);
+    set_input(p, loop->iv, iv_out, 1 + loop->entry);
+    if (loop->mem) {
+        set_input(p, loop->mem, mem_out, 1 + loop->entry);
+    }
+
+    dyn_array_for(i, ctx.reductions) {
+        set_input(p, ctx.reductions[i], red_out[i], 1 + loop->entry);
+    }
+
+    dyn_array_destroy(red_out);
+    loop_vec_free(&ctx);
+    return true;
+}
+
+////////////////////////////////
+// Loop invariant code motion
+////////////////////////////////
+// GCM already hoists the floating nodes, loads are pinned to the loop so it won't touch
+// those. A load with an invariant address can move into the preheader if none of the
+// stores in the loop can write to it, we're also speculating it (the loop might not run
+// at all) so the address has to be safe to read either way.
+//
+// can we read size bytes at addr before the loop even if the loop wouldn't have
+static bool loop_can_speculate(TB_Passes* restrict p, LoopInfo* restrict loop, TB_Node* addr, int size) {
+    if (loop->trip_count > 0) {
+        return true;
+    }
+
+    // stack slots and globals are always there
+    AliasAddr a = alias_decompose(addr);
+    if (a.stride == 0 && a.offset >= 0) {
+        if (a.base->type == TB_LOCAL) {
+            return a.offset + size <= TB_NODE_GET_EXTRA_T(a.base, TB_NodeLocal)->size;
+        } else if (a.base->type == TB_SYMBOL) {
+            TB_Symbol* sym = TB_NODE_GET_EXTRA_T(a.base, TB_NodeSymbol)->sym;
+            return sym->tag == TB_SYMBOL_GLOBAL && a.offset + size <= ((TB_Global*) sym)->size;
+        }
+    }
+
+    // someone already accessed the same bytes on the way to the loop, loads without
+    // control were either in the entry block or they're always safe.
+    TB_Node* pre_bb = get_block_begin(loop->header->inputs[loop->entry]);
+    for (User* u = addr->users; u; u = u->next) {
+        TB_Node* use = u->n;
+        if ((use->type != TB_LOAD && use->type != TB_STORE) || u->slot != 2) {
+            continue;
+        }
+
+        TB_DataType dt = use->type == TB_STORE ? use->inputs[3]->dt : use->dt;
+        if (bits_in_data_type(64, dt) < size*8) {
+            continue;
+        } else if (use->inputs[0] == NULL) {
+            return true;
+        }
+
+        TB_Node* bb = get_block_begin(use->inputs[0]);
+        if (nl_map_get(p->cfg.node_to_block, bb) >= 0 && lattice_dommy(&p->universe, bb, pre_bb)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool loop_hoist_loads(TB_Passes* restrict p, LoopInfo* restrict loop) {
+    TB_Function* f = p->f;
+    int pointer_size = tb__find_code_generator(f->super.module)->pointer_size;
+
+    // a canonical loop only writes memory with a chain of stores, anything else
+    // and we don't try.
+    DynArray(TB_Node*) stores = NULL;
+    if (loop->mem) {
+        TB_Node* mem = loop->mem->inputs[1 + loop->backedge];
+        while (mem != loop->mem) {
+            if (mem->type != TB_STORE) {
+                dyn_array_destroy(stores);
+                return false;
+            }
+
+            dyn_array_put(stores, mem);
+            mem = mem->inputs[1];
+        }
+    }
+
+    // loads are either pinned to the loop or they're reading the loop's memory
+    DynArray(TB_Node*) loads = NULL;
+    TB_Node* roots[] = { loop->header, loop->body, loop->mem };
+    FOREACH_N(i, 0, 3) if (roots[i]) {
+        for (User* u = roots[i]->users; u; u = u->next) {
+            if (u->n->type == TB_LOAD) dyn_array_put(loads, u->n);
+        }
+    }
+
+    dyn_array_for(i, stores) {
+        for (User* u = stores[i]->users; u; u = u->next) {
+            if (u->n->type == TB_LOAD) dyn_array_put(loads, u->n);
+        }
+    }
+
+    // hoisting one load can make the address of another invariant, keep going until
+    // nothing moves.
+    bool progress = false, changes;
+    do {
+        changes = false;
+        dyn_array_for(i, loads) {
+            TB_Node* n = loads[i];
+            TB_Node* ctrl = n->inputs[0];
+            bool pinned = ctrl == loop->header || ctrl == loop->body;
+            if (!pinned && !loop_variant(loop, n->inputs[1])) {
+                continue;
+            }
+
+            int size = bits_in_data_type(pointer_size, n->dt) / 8;
+            if (size == 0 || loop_variant(loop, n->inputs[2])) {
+                continue;
+            }
+
+            bool clobbered = false;
+            dyn_array_for(j, stores) {
+                TB_Node* st = stores[j];
+                if (alias_query_access(f, n, st) != ALIAS_NO) {
+                    clobbered = true;
+                    break;
+                }
+            }
+
+            if (clobbered || (pinned && !loop_can_speculate(p, loop, n->inputs[2], size))) {
+                continue;
+            }
+
+            TB_OPTDEBUG(LOOP)(printf("hoisting load v%u out of loop on v%u\n", n->gvn, loop->header->gvn));
+
+            if (pinned) {
+                set_input(p, n, loop->header->inputs[loop->entry], 0);
+            }
+
+            if (loop->mem) {
+                set_input(p, n, loop->mem->inputs[1 + loop->entry], 1);
+            }
+
+            tb_pass_mark(p, n);
+            tb_pass_mark_users(p, n);
+
+            // the load and whatever used it might've become invariant
+            loop_forget(loop);
+            progress = changes = true;
+        }
+    } while (changes);
+
+    dyn_array_destroy(loads);
+    dyn_array_destroy(stores);
+    return progress;
+}
+
+////////////////////////////////
+// Strength reduction
+////////////////////////////////
+// array accesses indexed by the induction var become pointers which are bumped each
+// iteration:
+//
+//   i = phi(init, i + step)          i = phi(init, i + step)
+//   a[i + C]                   =>    ptr = phi(&a[init], ptr + step*stride)
+//                                    ptr + C*stride
+//
+// we only bother when the stride isn't one of the scales an addressing mode does for
+// free, otherwise it's just another register to keep alive.
+typedef struct {
+    TB_Node* base;
+    int64_t stride;
+    TB_NodeTypeEnum ext;
+
+    TB_Node* ptr;
+} LoopPointerIV;
+
+static bool loop_free_scale(int64_t stride) {
+    return stride == 1 || stride == 2 || stride == 4 || stride == 8;
+}
+
+static void loop_find_array_uses(LoopInfo* restrict loop, TB_Node* n, DynArray(TB_Node*)* out) {
+    for (User* u = n->users; u; u = u->next) {
+        TB_Node* use = u->n;
+        if (use->type == TB_ARRAY_ACCESS && u->slot == 2) {
+            dyn_array_put(*out, use);
+        } else if (use->type == TB_SIGN_EXT || use->type == TB_ZERO_EXT || ((use->type == TB_ADD || use->type == TB_SUB) && u->slot == 1)) {
+            loop_find_array_uses(loop, use, out);
+        }
+    }
+}
+
+static bool loop_strength_reduce(TB_Passes* restrict p, LoopInfo* restrict loop) {
+    TB_Function* f = p->f;
+
+    // the pointer has to keep up with the index, extending i + step is only the same
+    // as extending i then adding step if it doesn't wrap. With a step of 1 the exit
+    // test already tells us that.
+    TB_Node* iv_next = loop->iv->inputs[1 + loop->backedge];
+    bool no_wrap = loop->step == 1 || (loop->cmp == TB_CMP_SLT && (TB_NODE_GET_EXTRA_T(iv_next, TB_NodeBinopInt)->ab & TB_ARITHMATIC_NSW));
+
+    DynArray(TB_Node*) arrays = NULL;
+    loop_find_array_uses(loop, loop->iv, &arrays);
+
+    DynArray(LoopPointerIV) ptrs = NULL;
+    dyn_array_for(i, arrays) {
+        TB_Node* n = arrays[i];
+        int64_t stride = TB_NODE_GET_EXTRA_T(n, TB_NodeArray)->stride;
+        if (n->type != TB_ARRAY_ACCESS || loop_free_scale(stride) || n->inputs[2]->dt.data != 64 || loop_variant(loop, n->inputs[1])) {
+            continue;
+        }
+
+        int64_t offset = 0;
+        TB_NodeTypeEnum ext = TB_NULL;
+        if (!loop_affine_index(loop, n->inputs[2], &offset, &ext) || (ext != TB_NULL && !no_wrap)) {
+            continue;
+        }
+
+        // accesses off the same array share a pointer
+        LoopPointerIV* ptr = NULL;
+        dyn_array_for(j, ptrs) {
+            if (ptrs[j].base == n->inputs[1] && ptrs[j].stride == stride && ptrs[j].ext == ext) {
+                ptr = &ptrs[j];
+                break;
+            }
+        }
+
+        if (ptr == NULL) {
+            // ptr = phi(&base[ext(init)], ptr + step*stride)
+            TB_Node* start = loop->init;
+            if (ext != TB_NULL) {
+                start = loop_new_node(p, ext, TB_TYPE_I64, 2, 0);
+                set_input(p, start, loop->init, 1);
+            }
+
+            TB_Node* first = loop_new_node(p, TB_ARRAY_ACCESS, TB_TYPE_PTR, 3, sizeof(TB_NodeArray));
+            set_input(p, first, n->inputs[1], 1);
+            set_input(p, first, start, 2);
+            TB_NODE_SET_EXTRA(first, TB_NodeArray, .stride = stride);
+
+            TB_Node* phi = loop_new_node(p, TB_PHI, TB_TYPE_PTR, 3, 0);
+            TB_Node* bump = loop_new_node(p, TB_MEMBER_ACCESS, TB_TYPE_PTR, 2, sizeof(TB_NodeMember));
+            set_input(p, bump, phi, 1);
+            TB_NODE_SET_EXTRA(bump, TB_NodeMember, .offset = loop->step * stride);
+
+            set_input(p, phi, loop->header, 0);
+            set_input(p, phi, first, 1 + loop->entry);
+            set_input(p, phi, bump, 1 + loop->backedge);
+
+            LoopPointerIV new_ptr = { n->inputs[1], stride, ext, phi };
+            dyn_array_put(ptrs, new_ptr);
+            ptr = &ptrs[dyn_array_length(ptrs) - 1];
+        }
+
+        TB_OPTDEBUG(LOOP)(printf("strength reducing v%u into v%u\n", n->gvn, ptr->ptr->gvn));
+
+        TB_Node* k = ptr->ptr;
+        if (offset != 0) {
+            k = loop_new_node(p, TB_MEMBER_ACCESS, TB_TYPE_PTR, 2, sizeof(TB_NodeMember));
+            set_input(p, k, ptr->ptr, 1);
+            TB_NODE_SET_EXTRA(k, TB_NodeMember, .offset = offset * stride);
+        }
+
+        tb_pass_mark_users(p, n);
+        subsume_node(p, f, n, k);
+    }
+
+    bool progress = dyn_array_length(ptrs) > 0;
+    dyn_array_destroy(ptrs);
+    dyn_array_destroy(arrays);
+    return progress;
+}
+
 bool tb_pass_loop(TB_Passes* p) {
     cuikperf_region_start("loop rotate", NULL);
 
@@ -52,6 +1074,7 @@ bool tb_pass_loop(TB_Passes* p) {
 
     // find & canonicalize loops
     DynArray(ptrdiff_t) backedges = NULL;
+    DynArray(LoopInfo) loops = NULL;
     FOREACH_N(i, 0, block_count) {
         TB_Node* header = blocks[i];
         if (header->type != TB_REGION || header->input_count < 2) {
@@ -71,6 +1094,11 @@ bool tb_pass_loop(TB_Passes* p) {
         if (dyn_array_length(backedges) > 0) {
             TB_OPTDEBUG(LOOP)(printf("found loop on .bb%zu with %zu backedges\n", i, dyn_array_length(backedges)));
             TB_NODE_GET_EXTRA_T(header, TB_NodeRegion)->freq = 10.0f;
+
+            LoopInfo loop;
+            if (dyn_array_length(backedges) == 1 && header->input_count == 2 && loop_analyze(p, header, backedges[0], &loop)) {
+                dyn_array_put(loops, loop);
+            }
         }
 
         if (0) {
@@ -247,7 +1275,35 @@ bool tb_pass_loop(TB_Passes* p) {
         skip:;
     }
 
+    // the block list lives in the worklist so we can't be making nodes until we're done
+    // walking it, the loops don't share any nodes we'd modify so we can do them in any order.
+    //
+    // hoisting goes first since it'll turn some loads into broadcasts for the vectorizer,
+    // anything that got vectorized keeps its scalar loop for the last few iterations which
+    // isn't worth strength reducing.
+    dyn_array_for(i, loops) {
+        progress |= loop_hoist_loads(p, &loops[i]);
+        loop_forget(&loops[i]);
+    }
+
+    dyn_array_for(i, loops) {
+        bool vectorized = false;
+        if (f->super.module->target_arch == TB_ARCH_X86_64) {
+            vectorized = loop_vectorize(p, &loops[i]);
+            loop_forget(&loops[i]);
+        }
+
+        if (!vectorized) {
+            progress |= loop_strength_reduce(p, &loops[i]);
+            loop_forget(&loops[i]);
+        }
+
+        progress |= vectorized;
+    }
+
+    dyn_array_destroy(loops);
     dyn_array_destroy(backedges);
+    tb_free_cfg(&p->cfg);
     cuikperf_region_end();
     return progress;
 }
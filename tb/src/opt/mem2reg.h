@@ -25,6 +25,10 @@ typedef struct Mem2Reg_Ctx {
 
     // [to_promote_count]
     Mem2Reg_Def* defs;
+
+    // PHIs we've inserted, the defs also hold stored values and those can
+    // be PHIs of their own (a ?: stored to a local) which we shouldn't touch.
+    NL_HashSet new_phis;
 } Mem2Reg_Ctx;
 
 static int bits_in_data_type(int pointer_size, TB_DataType dt);
@@ -39,6 +43,11 @@ static int get_variable_id(Mem2Reg_Ctx* restrict c, TB_Node* r) {
     return -1;
 }
 
+static bool is_new_phi(Mem2Reg_Ctx* restrict c, TB_Node* n) {
+    size_t index = nl_hashset_lookup(&c->new_phis, n);
+    return index != SIZE_MAX && (index & NL_HASHSET_HIGH_BIT);
+}
+
 // This doesn't really generate a PHI node, it just produces a NULL node which will
 // be mutated into a PHI node by the rest of the code.
 static TB_Node* new_phi(Mem2Reg_Ctx* restrict c, TB_Function* f, int var, TB_Node* block, TB_DataType dt) {
@@ -46,6 +55,7 @@ static TB_Node* new_phi(Mem2Reg_Ctx* restrict c, TB_Function* f, int var, TB_Nod
     FOREACH_N(i, 0, 1 + block->input_count) n->inputs[i] = NULL;
 
     set_input(c->p, n, block, 0);
+    nl_hashset_put(&c->new_phis, n);
 
     // append variable attrib
     /*for (TB_Attrib* a = c->to_promote[var]->first_attrib; a; a = a->next) if (a->type == TB_ATTRIB_VARIABLE) {
@@ -99,7 +109,7 @@ static void ssa_replace_phi_arg(Mem2Reg_Ctx* c, TB_Function* f, TB_Node* bb, TB_
         if (search < 0) continue;
 
         TB_Node* phi_reg = c->defs[var][search].v;
-        if (phi_reg->type != TB_PHI) continue;
+        if (!is_new_phi(c, phi_reg)) continue;
 
         TB_Node* top;
         if (dyn_array_length(stack[var]) == 0) {
@@ -139,7 +149,7 @@ static void ssa_rename(Mem2Reg_Ctx* c, TB_Function* f, TB_Node* bb, DynArray(TB_
         old_len[var] = dyn_array_length(stack[var]);
 
         ptrdiff_t search = nl_map_get(c->defs[var], bb);
-        if (search >= 0 && c->defs[var][search].v->type == TB_PHI) {
+        if (search >= 0 && is_new_phi(c, c->defs[var][search].v)) {
             dyn_array_put(stack[var], c->defs[var][search].v);
         }
     }
@@ -357,6 +367,7 @@ bool tb_pass_mem2reg(TB_Passes* p) {
 
     c.defs = tb_tls_push(c.tls, to_promote_count * sizeof(Mem2Reg_Def));
     memset(c.defs, 0, to_promote_count * sizeof(Mem2Reg_Def));
+    c.new_phis = nl_hashset_alloc(16);
 
     tb_pass_update_cfg(p, &p->worklist, true);
     c.blocks = &p->worklist.items[0];
@@ -461,7 +472,7 @@ bool tb_pass_mem2reg(TB_Passes* p) {
                     } else {
                         phi_reg = c.defs[var][search].v;
 
-                        if (phi_reg->type != TB_PHI) {
+                        if (!is_new_phi(&c, phi_reg)) {
                             TB_Node* old_reg = phi_reg;
                             phi_reg = new_phi(&c, f, var, l, dt);
                             add_phi_operand(&c, f, phi_reg, l, old_reg);
@@ -491,6 +502,7 @@ bool tb_pass_mem2reg(TB_Passes* p) {
     }
 
     ssa_rename(&c, f, c.blocks[0], stack);
+    nl_hashset_free(c.new_phis);
 
     // don't need these anymore
     FOREACH_N(var, 0, c.to_promote_count) {
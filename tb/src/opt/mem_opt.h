@@ -1,28 +1,7 @@
 // Certain aliasing optimizations technically count as peepholes lmao, these can get fancy
 // so the sliding window notion starts to break down but there's no global analysis and
-// i can make them incremental technically so we'll go wit it.
-typedef struct {
-    TB_Node* base;
-    int64_t offset;
-} KnownPointer;
-
-static bool is_local_ptr(TB_Node* n) {
-    // skip past ptr arith
-    while (n->type == TB_MEMBER_ACCESS || n->type == TB_ARRAY_ACCESS) {
-        n = n->inputs[1];
-    }
-
-    return n->type == TB_LOCAL;
-}
-
-static KnownPointer known_pointer(TB_Node* n) {
-    if (n->type == TB_MEMBER_ACCESS) {
-        return (KnownPointer){ n->inputs[1], TB_NODE_GET_EXTRA_T(n, TB_NodeMember)->offset };
-    } else {
-        return (KnownPointer){ n, 0 };
-    }
-}
-
+// i can make them incremental technically so we'll go wit it. The actual aliasing
+// questions are answered in alias.h.
 static TB_Node* data_phi_from_memory_phi(TB_Passes* restrict p, TB_Function* f, TB_DataType dt, TB_Node* n, TB_Node* addr, TB_CharUnits* out_align) {
     assert(n->type == TB_PHI);
     assert(n->dt.type == TB_MEMORY && "memory input should be memory");
@@ -84,20 +63,20 @@ static TB_Node* ideal_load(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
         if (n->inputs[0]->type == TB_PROJ && n->inputs[0]->inputs[0]->type == TB_START) {
             set_input(p, n, NULL, 0);
             return n;
-        } else {
-            TB_Node* base = addr;
-            while (base->type == TB_MEMBER_ACCESS || base->type == TB_ARRAY_ACCESS) {
-                base = base->inputs[1];
-            }
-
+        } else if (alias_is_local(addr)) {
             // loads based on LOCALs don't need control-dependence, it's actually kinda annoying
-            if (base->type == TB_LOCAL) {
-                set_input(p, n, NULL, 0);
-                return n;
-            }
+            set_input(p, n, NULL, 0);
+            return n;
         }
     }
 
+    // stores which can't touch the bytes we're reading don't matter, skipping them
+    // exposes older stores to identity_load.
+    if (mem->type == TB_STORE && alias_query_access(f, n, mem) == ALIAS_NO) {
+        set_input(p, n, mem->inputs[1], 1);
+        return n;
+    }
+
     // if LOAD has already been safely accessed we can relax our control dependency
     /*if (n->inputs[0] != NULL && n->inputs[0]->type != TB_DEAD) {
         TB_Node* parent_bb = get_block_begin(n->inputs[0]);
@@ -129,9 +108,9 @@ static TB_Node* ideal_load(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
 static TB_Node* identity_load(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
     // god i need a pattern matcher
     //   (load (store X A Y) A) => Y
-    TB_Node *mem = n->inputs[1], *addr = n->inputs[2];
-    if (mem->type == TB_STORE && mem->inputs[2] == addr &&
-        n->dt.raw == mem->inputs[3]->dt.raw && is_same_align(n, mem)) {
+    TB_Node *mem = n->inputs[1];
+    if (mem->type == TB_STORE && n->dt.raw == mem->inputs[3]->dt.raw &&
+        is_same_align(n, mem) && alias_query_access(f, n, mem) == ALIAS_MUST) {
         return mem->inputs[3];
     }
 
@@ -139,13 +118,18 @@ static TB_Node* identity_load(TB_Passes* restrict p, TB_Function* f, TB_Node* n)
 }
 
 static TB_Node* ideal_store(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
-    TB_Node *mem = n->inputs[1], *addr = n->inputs[2], *val = n->inputs[3];
-    TB_DataType dt = val->dt;
+    TB_Node* mem = n->inputs[1];
+    TB_DataType dt = n->inputs[3]->dt;
+
+    // unreachable store, the memory chain goes on as if it never happened
+    if (n->inputs[0] != NULL && n->inputs[0]->type == TB_DEAD) {
+        return mem;
+    }
 
     // if a store has only one user in this chain it means it's only job was
     // to facilitate the creation of that user store... if we can detect that
     // user store is itself dead, everything in the middle is too.
-    if (mem->type == TB_STORE && single_use(p, mem) && mem->inputs[2] == addr && mem->inputs[3]->dt.raw == dt.raw) {
+    if (mem->type == TB_STORE && single_use(p, mem) && mem->inputs[3]->dt.raw == dt.raw && alias_query_access(f, n, mem) == ALIAS_MUST) {
         // choose the bigger alignment (we wanna keep this sort of info)
         TB_NodeMemAccess* a = TB_NODE_GET_EXTRA(mem);
         TB_NodeMemAccess* b = TB_NODE_GET_EXTRA(n);
@@ -164,7 +148,7 @@ static TB_Node* ideal_store(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
 
 static TB_Node* ideal_end(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
     // remove dead local store
-    if (n->inputs[1]->type == TB_STORE && is_local_ptr(n->inputs[1]->inputs[2])) {
+    if (n->inputs[1]->type == TB_STORE && alias_is_local(n->inputs[1]->inputs[2])) {
         set_input(p, n, n->inputs[1]->inputs[1], 1);
         return n;
     }
@@ -196,3 +180,88 @@ static TB_Node* ideal_memset(TB_Passes* restrict p, TB_Function* f, TB_Node* n)
 static TB_Node* ideal_memcpy(TB_Passes* restrict p, TB_Function* f, TB_Node* n) {
     return NULL;
 }
+
+////////////////////////////////
+// Dead store elimination
+////////////////////////////////
+// a store is dead if it gets overwritten (or its stack slot dies) before anyone could
+// read it. We follow the memory chain after the store: loads which can't alias it are
+// fine and stores don't read anything so we keep walking, anything else (phis, calls,
+// memcpy...) might observe it.
+static bool dse_is_dead(TB_Function* f, TB_Node* st) {
+    TB_Node* mem = st;
+    FOREACH_N(steps, 0, 32) {
+        TB_Node* next = NULL;
+        for (User* u = mem->users; u; u = u->next) {
+            TB_Node* use = u->n;
+            if (use->type == TB_LOAD && u->slot == 1) {
+                if (alias_query_access(f, use, st) != ALIAS_NO) return false;
+            } else if (next == NULL && u->slot == 1 && (use->type == TB_STORE || use->type == TB_END)) {
+                next = use;
+            } else {
+                return false;
+            }
+        }
+
+        if (next == NULL) {
+            return false;
+        } else if (next->type == TB_END) {
+            return alias_is_local(st->inputs[2]);
+        } else if (alias_query_access(f, next, st) == ALIAS_MUST) {
+            return true;
+        }
+
+        mem = next;
+    }
+
+    return false;
+}
+
+bool tb_pass_dse(TB_Passes* p) {
+    cuikperf_region_start("dse", NULL);
+    verify_tmp_arena(p);
+
+    TB_Function* f = p->f;
+    Worklist ws = { 0 };
+    worklist_alloc(&ws, f->node_count);
+
+    // every store is somewhere down the memory edges from START
+    DynArray(TB_Node*) stores = NULL;
+    worklist_test_n_set(&ws, f->params[1]);
+    dyn_array_put(ws.items, f->params[1]);
+    for (size_t i = 0; i < dyn_array_length(ws.items); i++) {
+        TB_Node* n = ws.items[i];
+        if (n->type == TB_STORE) {
+            dyn_array_put(stores, n);
+        }
+
+        for (User* u = n->users; u; u = u->next) {
+            if (is_mem_out_op(u->n) && !worklist_test_n_set(&ws, u->n)) {
+                dyn_array_put(ws.items, u->n);
+            }
+        }
+    }
+
+    bool progress = false;
+    dyn_array_for(i, stores) {
+        TB_Node* st = stores[i];
+        if (st->type != TB_STORE || !dse_is_dead(f, st)) {
+            continue;
+        }
+
+        TB_OPTDEBUG(DSE)(printf("%s: killing dead store v%u\n", f->super.name, st->gvn));
+
+        // the address & value might be dead now
+        tb_pass_mark(p, st->inputs[2]);
+        tb_pass_mark(p, st->inputs[3]);
+        tb_pass_mark_users(p, st);
+        subsume_node(p, f, st, st->inputs[1]);
+        progress = true;
+    }
+
+    dyn_array_destroy(stores);
+    worklist_free(&ws);
+
+    cuikperf_region_end();
+    return progress;
+}
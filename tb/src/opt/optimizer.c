@@ -164,6 +164,8 @@ static int bits_in_data_type(int pointer_size, TB_DataType dt) {
         if (dt.data == TB_FLT_32) return 32;
         if (dt.data == TB_FLT_64) return 64;
         return 0;
+        case TB_VECTOR:
+        return TB_GET_VECTOR_LANES(dt) * bits_in_data_type(pointer_size, TB_GET_VECTOR_ELEM(dt));
         default: return 0;
     }
 }
@@ -234,6 +236,7 @@ static bool is_if_branch(TB_Node* n, uint64_t* falsey) {
 #include "cfg.h"
 #include "gvn.h"
 #include "fold.h"
+#include "alias.h"
 #include "mem_opt.h"
 #include "sroa.h"
 #include "loop.h"
@@ -242,6 +245,9 @@ static bool is_if_branch(TB_Node* n, uint64_t* falsey) {
 #include "mem2reg.h"
 #include "gcm.h"
 #include "libcalls.h"
+#include "callgraph.h"
+#include "inline.h"
+#include "prune.h"
 #include "scheduler.h"
 
 static bool lattice_dommy(LatticeUniverse* uni, TB_Node* expected_dom, TB_Node* bb) {
@@ -538,7 +544,8 @@ static TB_Node* idealize(TB_Passes* restrict p, TB_Function* f, TB_Node* n, TB_P
         case TB_CMP_SLE:
         case TB_CMP_ULT:
         case TB_CMP_ULE:
-        return ideal_int_binop(p, f, n);
+        // element-wise vector ops don't get any of the scalar rewrites
+        return n->dt.type == TB_VECTOR ? NULL : ideal_int_binop(p, f, n);
 
         // pointer
         case TB_ARRAY_ACCESS:
@@ -580,7 +587,7 @@ static TB_Node* idealize(TB_Passes* restrict p, TB_Function* f, TB_Node* n, TB_P
         return ideal_truncate(p, f, n);
 
         case TB_CALL:
-        return ideal_libcall(p, f, n);
+        return ideal_call(p, f, n);
 
         case TB_SELECT:
         return ideal_select(p, f, n);
@@ -679,6 +686,9 @@ static Lattice* dataflow(TB_Passes* restrict p, LatticeUniverse* uni, TB_Node* n
         case TB_SYMBOL:
         return lattice_intern(uni, (Lattice){ LATTICE_POINTER, ._ptr = { LATTICE_KNOWN_NOT_NULL } });
 
+        case TB_PROJ:
+        return dataflow_proj(p, uni, n);
+
         case TB_INT2PTR:
         return dataflow_int2ptr(p, uni, n);
 
@@ -975,6 +985,12 @@ void tb_pass_optimize(TB_Passes* p) {
     tb_pass_peephole(p, TB_PEEPHOLE_ALL);
     tb_pass_loop(p);
     tb_pass_peephole(p, TB_PEEPHOLE_ALL);
+    if (tb_pass_dse(p)) {
+        tb_pass_peephole(p, TB_PEEPHOLE_ALL);
+    }
+
+    // callers which get optimized after us can use what we've learned
+    summarize(p);
 }
 
 static size_t tb_pass_update_cfg(TB_Passes* p, Worklist* ws, bool preserve) {
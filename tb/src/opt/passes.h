@@ -8,6 +8,7 @@
 #define TB_OPTDEBUG_SROA    0
 #define TB_OPTDEBUG_GCM     0
 #define TB_OPTDEBUG_MEM2REG 0
+#define TB_OPTDEBUG_DSE     0
 #define TB_OPTDEBUG_CODEGEN 0
 
 #define TB_OPTDEBUG(cond) CONCAT(DO_IF_, CONCAT(TB_OPTDEBUG_, cond))
@@ -46,7 +47,8 @@ typedef struct {
     LatticeTrifecta trifecta;
 } LatticeFloat;
 
-// TODO(NeGate): we might wanna store more info like aliasing, ownership and alignment.
+// TODO(NeGate): we might wanna store more info like ownership and alignment, aliasing
+// is figured out from the address nodes themselves (alias.h).
 typedef struct {
     LatticeTrifecta trifecta;
 } LatticePointer;
@@ -239,7 +241,7 @@ static bool is_pinned(TB_Node* n) {
 }
 
 static bool is_mem_in_op(TB_Node* n) {
-    return is_mem_out_op(n) || n->type == TB_SAFEPOINT_POLL || n->type == TB_LOAD || n->type == TB_SAFEPOINT_NOP;
+    return is_mem_out_op(n) || n->type == TB_SAFEPOINT_POLL || n->type == TB_LOAD || n->type == TB_VMASKLOAD || n->type == TB_SAFEPOINT_NOP;
 }
 
 static bool cfg_critical_edge(TB_Node* proj, TB_Node* n) {
@@ -39,6 +39,11 @@ static void print_type(TB_DataType dt) {
             printf("cont");
             break;
         }
+        case TB_VECTOR: {
+            printf("v%d", TB_GET_VECTOR_LANES(dt));
+            print_type(TB_GET_VECTOR_ELEM(dt));
+            break;
+        }
         default: tb_todo();
     }
 }
@@ -412,12 +417,32 @@ static void print_bb(PrinterCtx* ctx, TB_Node* bb_start) {
                     case TB_LOAD:
                     case TB_STORE:
                     case TB_MEMSET:
-                    case TB_MEMCPY: {
+                    case TB_MEMCPY:
+                    case TB_VMASKLOAD:
+                    case TB_VMASKSTORE: {
                         TB_NodeMemAccess* mem = TB_NODE_GET_EXTRA(n);
                         printf(" !align(%d)", mem->align);
                         break;
                     }
 
+                    case TB_VSHUFFLE: {
+                        TB_NodeShuffle* s = TB_NODE_GET_EXTRA(n);
+                        printf(" !lanes(");
+                        FOREACH_N(i, 0, s->count) {
+                            if (i) printf(", ");
+                            printf("%d", s->indices[i]);
+                        }
+                        printf(")");
+                        break;
+                    }
+
+                    case TB_VEXTRACT:
+                    case TB_VINSERT: {
+                        TB_NodeLane* l = TB_NODE_GET_EXTRA(n);
+                        printf(" !lane(%d)", l->lane);
+                        break;
+                    }
+
                     case TB_ATOMIC_LOAD:
                     case TB_ATOMIC_XCHG:
                     case TB_ATOMIC_ADD:
@@ -0,0 +1,79 @@
+// Dead symbol elimination, private functions & globals which can't be reached from any
+// public symbol are dropped from the module before anyone optimizes or compiles them.
+// The references come from TB_SYMBOL nodes in the IR, relocations in the globals and
+// the patches of functions which were already compiled.
+static void prune_mark(NL_HashSet* live, DynArray(TB_Symbol*)* ws, const TB_Symbol* sym) {
+    if (sym != NULL && nl_hashset_put(live, (void*) sym)) {
+        dyn_array_put(*ws, (TB_Symbol*) sym);
+    }
+}
+
+static bool prune_is_root(TB_Symbol* sym) {
+    switch (sym->tag) {
+        case TB_SYMBOL_FUNCTION: return ((TB_Function*) sym)->linkage != TB_LINKAGE_PRIVATE;
+        case TB_SYMBOL_GLOBAL:   return ((TB_Global*) sym)->linkage != TB_LINKAGE_PRIVATE;
+        default:                 return true;
+    }
+}
+
+void tb_module_prune(TB_Module* m) {
+    CUIK_TIMED_BLOCK("prune") {
+        NL_HashSet live = nl_hashset_alloc(m->symbol_count[TB_SYMBOL_FUNCTION] + m->symbol_count[TB_SYMBOL_GLOBAL]);
+        DynArray(TB_Symbol*) ws = NULL;
+
+        TB_Symbol* sym;
+        for (TB_SymbolIter it = tb_symbol_iter(m); sym = tb_symbol_iter_next(&it), sym;) {
+            if (prune_is_root(sym)) prune_mark(&live, &ws, sym);
+        }
+
+        // the codegen might reuse interned constants later so they stay around
+        FOREACH_N(i, 0, nl_map_get_capacity(m->global_interns)) {
+            if (m->global_interns[i].v != NULL) {
+                prune_mark(&live, &ws, &m->global_interns[i].v->super);
+            }
+        }
+
+        while (dyn_array_length(ws)) {
+            sym = dyn_array_pop(ws);
+
+            if (sym->tag == TB_SYMBOL_FUNCTION) {
+                TB_Function* f = (TB_Function*) sym;
+                if (func_has_ir(f)) {
+                    DynArray(TB_Node*) nodes = walk_all_nodes(f);
+                    dyn_array_for(i, nodes) {
+                        if (nodes[i]->type == TB_SYMBOL) {
+                            prune_mark(&live, &ws, TB_NODE_GET_EXTRA_T(nodes[i], TB_NodeSymbol)->sym);
+                        }
+                    }
+                    dyn_array_destroy(nodes);
+                } else if (f->output != NULL) {
+                    for (TB_SymbolPatch* p = f->output->first_patch; p; p = p->next) {
+                        prune_mark(&live, &ws, p->target);
+                    }
+                }
+            } else if (sym->tag == TB_SYMBOL_GLOBAL) {
+                TB_Global* g = (TB_Global*) sym;
+                FOREACH_N(i, 0, g->obj_count) {
+                    if (g->objects[i].type == TB_INIT_OBJ_RELOC) {
+                        prune_mark(&live, &ws, g->objects[i].reloc);
+                    }
+                }
+            }
+        }
+
+        // we can't remove while iterating the symbol tables
+        for (TB_SymbolIter it = tb_symbol_iter(m); sym = tb_symbol_iter_next(&it), sym;) {
+            size_t index = nl_hashset_lookup(&live, sym);
+            if (index == SIZE_MAX || (index & NL_HASHSET_HIGH_BIT) == 0) {
+                dyn_array_put(ws, sym);
+            }
+        }
+
+        dyn_array_for(i, ws) {
+            tb_module_kill_symbol(m, ws[i]);
+        }
+
+        dyn_array_destroy(ws);
+        nl_hashset_free(live);
+    }
+}
@@ -25,7 +25,7 @@ static ptrdiff_t compatible_with_configs(size_t config_count, AggregateConfig* c
     FOREACH_N(i, 0, config_count) {
         int64_t max2 = configs[i].offset + configs[i].size;
 
-        if (offset >= configs[i].offset && max <= max2) {
+        if (offset < max2 && configs[i].offset < max) {
             // they overlap... but is it a clean overlap?
             if (offset == configs[i].offset && max == max2 && TB_DATA_TYPE_EQUALS(dt, configs[i].dt)) {
                 return i;
@@ -272,6 +272,20 @@ static void insert_split_move(LSRA* restrict ra, int t, int old_reg, int new_reg
     prev->next = new_inst;
 }
 
+// last spot in a goto's block before the jump
+static int goto_edge_pos(MachineBB* mbb) {
+    Inst* last = NULL;
+    for (Inst* inst = mbb->first; inst && inst->type != INST_LABEL; inst = inst->next) {
+        last = inst;
+    }
+
+    if (last == NULL) {
+        return mbb->terminator - 1;
+    }
+
+    return last->type == JMP ? last->time - 1 : last->time;
+}
+
 static int interval_start(LiveInterval* interval) { return interval->ranges[interval->range_count - 1].start; }
 static int interval_end(LiveInterval* interval)   { return interval->ranges[1].end; }
 
@@ -290,12 +304,45 @@ static void allocate_spill_slot(LSRA* restrict ra, LiveInterval* interval) {
     assert(spill && "how do we not have a spill slot... we a fixed interval?");
 
     if (spill->pos == 0) {
-        // allocate stack slot
-        int size = 8;
+        // allocate stack slot, vectors need the whole XMM register
+        TB_X86_DataType dt = interval->dt;
+        bool is_vector = (dt >= TB_X86_TYPE_PBYTE && dt <= TB_X86_TYPE_PQWORD) || dt >= TB_X86_TYPE_SSE_PS;
+        int size = is_vector ? 16 : 8;
         spill->pos = ra->stack_usage = align_up(ra->stack_usage + size, size);
     }
 }
 
+// the first time we use a callee saved register we need to save it in the prologue
+// and restore it before every epilogue.
+static void spill_callee_saved(LSRA* restrict ra, int rc, int reg) {
+    REG_ALLOC_LOG printf("  #   spill callee saved register %s\n", reg_name(rc, reg));
+
+    int size = rc ? 16 : 8;
+    int vreg = (rc ? FIRST_XMM : FIRST_GPR) + reg;
+    ra->stack_usage = align_up(ra->stack_usage + size, size);
+
+    SpillSlot* s = TB_ARENA_ALLOC(tmp_arena, SpillSlot);
+    s->pos = ra->stack_usage;
+
+    LiveInterval it = {
+        .is_spill = true,
+        .spill = s,
+        .dt = ra->intervals[vreg].dt,
+        .assigned = -1,
+        .reg = -1,
+        .split_kid = -1,
+    };
+
+    int spill_slot = dyn_array_length(ra->intervals);
+    dyn_array_put(ra->intervals, it);
+
+    // insert spill and reload
+    insert_split_move(ra, 0, vreg, spill_slot);
+    dyn_array_for(i, ra->epilogues) {
+        insert_split_move(ra, ra->epilogues[i] - 1, spill_slot, vreg);
+    }
+}
+
 // any uses after `pos` after put into the new interval
 static int split_intersecting(LSRA* restrict ra, int pos, LiveInterval* interval, bool is_spill) {
     assert(interval->reg < 0);
@@ -497,33 +544,8 @@ static ptrdiff_t allocate_free_reg(LSRA* restrict ra, LiveInterval* interval) {
         if (UNLIKELY(ra->callee_saved[rc] & (1ull << highest))) {
             ra->callee_saved[rc] &= ~(1ull << highest);
 
-            REG_ALLOC_LOG printf("  #   spill callee saved register %s\n", reg_name(rc, highest));
-
-            int size = rc ? 16 : 8;
-            int vreg = (rc ? FIRST_XMM : FIRST_GPR) + highest;
-            ra->stack_usage = align_up(ra->stack_usage + size, size);
-
-            SpillSlot* s = TB_ARENA_ALLOC(tmp_arena, SpillSlot);
-            s->pos = ra->stack_usage;
-
-            LiveInterval it = {
-                .is_spill = true,
-                .spill = s,
-                .dt = ra->intervals[vreg].dt,
-                .assigned = -1,
-                .reg = -1,
-                .split_kid = -1,
-            };
-
             int old_reg = interval - ra->intervals;
-            int spill_slot = dyn_array_length(ra->intervals);
-            dyn_array_put(ra->intervals, it);
-
-            // insert spill and reload
-            insert_split_move(ra, 0, vreg, spill_slot);
-            dyn_array_for(i, ra->epilogues) {
-                insert_split_move(ra, ra->epilogues[i] - 1, spill_slot, vreg);
-            }
+            spill_callee_saved(ra, rc, highest);
 
             // adding to intervals might resized this
             interval = &ra->intervals[old_reg];
@@ -884,10 +906,19 @@ static int linear_scan(Ctx* restrict ctx, TB_Function* f, int stack_usage, DynAr
             MachineBB* mbb = &nl_map_get_checked(mbbs, bb);
             TB_Node* end_node = mbb->end_node;
 
+            // gotos write their phis back after the terminator, the edge moves have to
+            // come after those (right before the jump). Putting them in the successor
+            // isn't an option either since it might have other preds (loop headers).
+            int goto_pos = end_node->type != TB_BRANCH ? goto_edge_pos(mbb) : -1;
+
             for (User* u = end_node->users; u; u = u->next) {
                 if (cfg_is_control(u->n)) {
                     TB_Node* succ = end_node->type == TB_BRANCH ? cfg_next_bb_after_cproj(u->n) : u->n;
-                    MachineBB* target = &nl_map_get_checked(mbbs, succ);
+                    // dead edges don't have a machine block, nothing to resolve
+                    ptrdiff_t search = nl_map_get(mbbs, succ);
+                    if (search < 0) continue;
+
+                    MachineBB* target = &mbbs[search].v;
 
                     // for all live-ins, we should check if we need to insert a move
                     FOREACH_SET(k, target->live_in) {
@@ -898,7 +929,9 @@ static int linear_scan(Ctx* restrict ctx, TB_Function* f, int stack_usage, DynAr
                         LiveInterval* end = split_interval_at(&ra, interval, target->start);
 
                         if (start != end) {
-                            if (start->spill > 0) {
+                            if (goto_pos >= 0) {
+                                insert_split_move(&ra, goto_pos, start - ra.intervals, end - ra.intervals);
+                            } else if (start->spill > 0) {
                                 assert(end->spill == start->spill && "TODO: both can't be spills yet");
                                 insert_split_move(&ra, target->start + 1, start - ra.intervals, end - ra.intervals);
                             } else {
@@ -0,0 +1,994 @@
+// This is a Chaitin-Briggs graph coloring allocator (with optimistic coloring) mostly inspired by:
+//   Briggs, Cooper, Torczon - Improvements to Graph Coloring Register Allocation (1994)
+//
+// Linear scan only sees one interval at a time so it'll happily spill in the middle of a
+// loop, here we see the whole interference graph and weigh every def & use by the block's
+// frequency (see schedule_loop_freq) so the values we pick to live in memory are the ones
+// which are cheap to reload. Spilled values are rewritten to go through tiny temporaries
+// around each def & use and then we try again until everything gets a color.
+//
+// Each round goes:
+//   build     interference graph + moves, spill costs.
+//   pressure  spill until no more than K values are live at any point.
+//   coalesce  merge move related nodes (conservatively, Briggs' test).
+//   simplify  & select, if that gets stuck we try again in program order.
+//
+// It's a good bit slower than linear scan so it's only worth it on optimized builds.
+
+// the interference matrix is N^2 bits, past this we just use linear scan
+#define GC_MAX_VREGS 8192
+
+// if spilling doesn't converge after this many rounds we give up and use linear scan
+#define GC_MAX_ROUNDS 16
+
+#define GC_FIXED_COUNT 32
+
+typedef struct {
+    Ctx* ctx;
+    size_t count;
+
+    // interference graph, the matrix is for queries and the lists for walking
+    uint64_t* matrix;
+    DynArray(RegIndex)* adj;
+    int* degree;
+
+    // reg<->reg moves, we try to give both sides the same color so the move goes away
+    DynArray(RegIndex)* moves;
+
+    // coalesced nodes point at the node which stands in for them
+    RegIndex* alias;
+
+    // sum of the block frequencies for every def & use
+    float* cost;
+    int* color;
+
+    // earliest timestamp the vreg shows up at
+    int* start;
+
+    // these are carried across rounds:
+    //   in_mem   is spilled, only ever touched by a MOV now.
+    //   no_spill is a temporary made by spilling, it's as short as it gets.
+    bool* in_mem;
+    bool* no_spill;
+
+    // registers we're allowed to hand out, k is how many of them there are
+    uint64_t allowed[CG_REGISTER_CLASSES];
+    int k[CG_REGISTER_CLASSES];
+
+    uint64_t callee_saved[CG_REGISTER_CLASSES];
+} GraphColor;
+
+static bool gc_is_reg_move(Inst* inst) {
+    return (inst->type == MOV || inst->type == FP_MOV) && (inst->flags & ~INST_SPILL) == 0 &&
+        inst->out_count == 1 && inst->in_count == 1 && inst->tmp_count == 0 && inst->save_count == 0;
+}
+
+// the two address forms get emitted as "mov dst, lhs; op dst, rhs" so unless lhs is
+// already in dst, the destination is written before the rest of the inputs are read.
+// Commutative ops can flip the operands if dst ends up on the rhs.
+static int gc_two_address_rhs(Inst* inst, RegIndex out) {
+    if (inst->in_count == 0 || inst->operands[inst->out_count] == out) {
+        return inst->in_count;
+    }
+
+    if (inst->in_count == 2 && is_commutative_inst(inst->type) && (inst->flags & (INST_MEM | INST_GLOBAL | INST_IMM | INST_ABS)) == 0) {
+        return inst->in_count;
+    }
+
+    // an indexed memory operand takes up two inputs
+    if ((inst->flags & INST_MEM) && (inst->flags & INST_INDEXED) && inst->mem_slot == inst->out_count) {
+        return 2;
+    }
+
+    return 1;
+}
+
+static bool gc_is_operand(Inst* inst, RegIndex v) {
+    size_t total = inst->out_count + inst->in_count + inst->tmp_count + inst->save_count;
+    FOREACH_N(i, 0, total) {
+        if (inst->operands[i] == v) return true;
+    }
+    return false;
+}
+
+// the instructions in a machine block (the entry block starts with its label)
+static void gc_block_insts(MachineBB* mbb, DynArray(Inst*)* insts) {
+    dyn_array_clear(*insts);
+    for (Inst* inst = mbb->first; inst; inst = inst->next) {
+        dyn_array_put(*insts, inst);
+        if (inst->next && inst->next->type == INST_LABEL) break;
+    }
+}
+
+static RegIndex gc_find(GraphColor* gc, RegIndex n) {
+    while (gc->alias[n] != n) n = gc->alias[n];
+    return n;
+}
+
+static bool gc_interferes(GraphColor* gc, RegIndex a, RegIndex b) {
+    size_t i = (size_t) a * gc->count + b;
+    return gc->matrix[i / 64] & (1ull << (i % 64));
+}
+
+static void gc_add_edge(GraphColor* gc, RegIndex a, RegIndex b) {
+    LiveInterval* intervals = gc->ctx->intervals;
+    if (a == b || (a < GC_FIXED_COUNT && b < GC_FIXED_COUNT) || intervals[a].reg_class != intervals[b].reg_class) {
+        return;
+    }
+
+    if (gc->in_mem[a] || gc->in_mem[b] || gc_interferes(gc, a, b)) {
+        return;
+    }
+
+    size_t i = (size_t) a * gc->count + b;
+    size_t j = (size_t) b * gc->count + a;
+    gc->matrix[i / 64] |= 1ull << (i % 64);
+    gc->matrix[j / 64] |= 1ull << (j % 64);
+
+    dyn_array_put(gc->adj[a], b);
+    dyn_array_put(gc->adj[b], a);
+    gc->degree[a] += 1;
+    gc->degree[b] += 1;
+}
+
+static void gc_add_move(GraphColor* gc, RegIndex a, RegIndex b) {
+    LiveInterval* intervals = gc->ctx->intervals;
+    if (a == b || intervals[a].reg_class != intervals[b].reg_class || gc->in_mem[a] || gc->in_mem[b]) {
+        return;
+    }
+
+    if (a >= GC_FIXED_COUNT) dyn_array_put(gc->moves[a], b);
+    if (b >= GC_FIXED_COUNT) dyn_array_put(gc->moves[b], a);
+}
+
+static void gc_build(GraphColor* gc) {
+    Ctx* restrict ctx = gc->ctx;
+
+    TB_ArenaSavepoint sp = tb_arena_save(tmp_arena);
+    Set live = set_create_in_arena(tmp_arena, gc->count);
+    DynArray(Inst*) insts = NULL;
+
+    FOREACH_N(i, 0, ctx->bb_count) {
+        TB_Node* bb = ctx->worklist.items[ctx->bb_order[i]];
+        MachineBB* mbb = &nl_map_get_checked(ctx->machine_bbs, bb);
+        float freq = nl_map_get_checked(ctx->cfg.node_to_block, bb).freq;
+
+        gc_block_insts(mbb, &insts);
+
+        // walk backwards from the live-outs
+        set_copy(&live, &mbb->live_out);
+        FOREACH_REVERSE_N(j, 0, dyn_array_length(insts)) {
+            Inst* inst = insts[j];
+
+            RegIndex* outs  = inst->operands;
+            RegIndex* ins   = outs + inst->out_count;
+            RegIndex* tmps  = ins + inst->in_count;
+            RegIndex* saves = tmps + inst->tmp_count;
+
+            size_t total = inst->out_count + inst->in_count + inst->tmp_count + inst->save_count;
+            FOREACH_N(k, 0, total) {
+                RegIndex x = inst->operands[k];
+                gc->cost[x] += freq;
+                gc->start[x] = TB_MIN(gc->start[x], inst->time);
+            }
+
+            // the source and destination of a move hold the same value so they
+            // don't interfere (unless something else says so)
+            if (gc_is_reg_move(inst)) {
+                set_remove(&live, ins[0]);
+                gc_add_move(gc, outs[0], ins[0]);
+            } else {
+                FOREACH_N(k, 0, inst->out_count) {
+                    FOREACH_N(l, gc_two_address_rhs(inst, outs[k]), inst->in_count) {
+                        gc_add_edge(gc, outs[k], ins[l]);
+                    }
+                }
+            }
+
+            FOREACH_N(k, 0, inst->out_count) {
+                FOREACH_SET(x, live) {
+                    gc_add_edge(gc, outs[k], x);
+                }
+
+                // all outputs are written at once
+                FOREACH_N(l, 0, k) {
+                    gc_add_edge(gc, outs[k], outs[l]);
+                }
+            }
+
+            // calls use the temporaries for clobbers so they only matter to the things
+            // which live past it, other temporaries can't overlap with any operands.
+            bool is_call = (inst->type == CALL || inst->type == SYSCALL);
+            FOREACH_N(k, 0, inst->tmp_count) {
+                FOREACH_SET(x, live) {
+                    gc_add_edge(gc, tmps[k], x);
+                }
+
+                FOREACH_N(l, 0, inst->out_count) {
+                    gc_add_edge(gc, tmps[k], outs[l]);
+                }
+
+                FOREACH_N(l, 0, inst->save_count) {
+                    gc_add_edge(gc, tmps[k], saves[l]);
+                }
+
+                if (!is_call) {
+                    FOREACH_N(l, 0, inst->in_count) {
+                        gc_add_edge(gc, tmps[k], ins[l]);
+                    }
+
+                    FOREACH_N(l, 0, k) {
+                        gc_add_edge(gc, tmps[k], tmps[l]);
+                    }
+                }
+            }
+
+            FOREACH_N(k, 0, inst->out_count) {
+                set_remove(&live, outs[k]);
+            }
+
+            FOREACH_N(k, 0, inst->in_count) {
+                set_put(&live, ins[k]);
+            }
+
+            FOREACH_N(k, 0, inst->save_count) {
+                set_put(&live, saves[k]);
+            }
+        }
+    }
+
+    dyn_array_destroy(insts);
+    tb_arena_restore(tmp_arena, sp);
+}
+
+static bool gc_has_move(DynArray(RegIndex)* moves, RegIndex a, RegIndex b) {
+    dyn_array_for(i, moves[a]) {
+        if (moves[a][i] == b) return true;
+    }
+    return false;
+}
+
+// Cleans up a few things isel leaves behind which get in the way of coloring:
+//
+// * isel lowers "a + b" into "mov d, a; add d, d, b" which means d and b interfere, if
+//   b was a phi and d is what gets written back to it then they can't share a register
+//   and every loop carried value needs two. Commutative ops can take the operands either
+//   way so we flip them, then d gets b's register and the writeback move goes away.
+//
+// * copies nobody reads (phis copied at the top of the block which aren't used there),
+//   these are free with linear scan but here they'd turn into reloads once spilled. We
+//   leave it alone if something later in the block writes the same register since some
+//   instructions still read their destination without saying so.
+//
+// returns true if it changed anything.
+static bool gc_peephole(Ctx* restrict ctx) {
+    size_t count = dyn_array_length(ctx->intervals);
+
+    TB_ArenaSavepoint sp = tb_arena_save(tmp_arena);
+    Set live = set_create_in_arena(tmp_arena, count);
+    Set written = set_create_in_arena(tmp_arena, count);
+    DynArray(Inst*) insts = NULL;
+    bool progress = false;
+
+    // who gets copied into who
+    DynArray(RegIndex)* moves = tb_platform_heap_alloc(count * sizeof(DynArray(RegIndex)));
+    FOREACH_N(i, 0, count) {
+        moves[i] = NULL;
+    }
+
+    for (Inst* inst = ctx->first; inst; inst = inst->next) {
+        if (gc_is_reg_move(inst) && inst->operands[0] >= GC_FIXED_COUNT) {
+            dyn_array_put(moves[inst->operands[0]], inst->operands[1]);
+        }
+    }
+
+    FOREACH_N(i, 0, ctx->bb_count) {
+        TB_Node* bb = ctx->worklist.items[ctx->bb_order[i]];
+        MachineBB* mbb = &nl_map_get_checked(ctx->machine_bbs, bb);
+        gc_block_insts(mbb, &insts);
+
+        set_copy(&live, &mbb->live_out);
+        set_clear(&written);
+        FOREACH_REVERSE_N(j, 0, dyn_array_length(insts)) {
+            Inst* inst = insts[j];
+            RegIndex* outs = inst->operands;
+            RegIndex* ins  = outs + inst->out_count;
+
+            // the first instruction is always the label so there's a previous one
+            if (j > 0 && gc_is_reg_move(inst) && outs[0] >= GC_FIXED_COUNT && !set_get(&live, outs[0]) && !set_get(&written, outs[0])) {
+                insts[j - 1]->next = inst->next;
+                progress = true;
+                continue;
+            }
+
+            if (j > 0 && inst->out_count == 1 && inst->in_count == 2 && inst->tmp_count == 0 && inst->save_count == 0 &&
+                is_commutative_inst(inst->type) && (inst->flags & (INST_MEM | INST_GLOBAL | INST_IMM | INST_ABS)) == 0 &&
+                ins[0] == outs[0] && ins[1] >= GC_FIXED_COUNT && !set_get(&live, ins[1])) {
+                Inst* mov = insts[j - 1];
+                RegIndex d = outs[0], b = ins[1];
+                if (gc_is_reg_move(mov) && mov->operands[0] == d && mov->operands[1] != b && gc_has_move(moves, b, d)) {
+                    ins[1] = mov->operands[1];
+                    mov->operands[1] = b;
+                    progress = true;
+                }
+            }
+
+            RegIndex* saves = ins + inst->in_count + inst->tmp_count;
+            FOREACH_N(k, 0, inst->out_count) {
+                set_remove(&live, outs[k]);
+                set_put(&written, outs[k]);
+            }
+
+            FOREACH_N(k, 0, inst->in_count) {
+                set_put(&live, ins[k]);
+            }
+
+            FOREACH_N(k, 0, inst->save_count) {
+                set_put(&live, saves[k]);
+            }
+        }
+    }
+
+    FOREACH_N(i, 0, count) {
+        dyn_array_destroy(moves[i]);
+    }
+    tb_platform_heap_free(moves);
+    dyn_array_destroy(insts);
+    tb_arena_restore(tmp_arena, sp);
+    return progress;
+}
+
+// Before coloring we make sure there's never more than K values live at once (the SSA
+// allocators do this too, there it's enough to guarantee a coloring, here it's just
+// very likely). The victims are values live across the instruction that it doesn't
+// use, preferring ones which aren't touched much in hot blocks and aren't needed again
+// for a while.
+//
+// returns true if it spilled anything.
+static bool gc_limit_pressure(GraphColor* gc) {
+    Ctx* restrict ctx = gc->ctx;
+    LiveInterval* intervals = ctx->intervals;
+
+    TB_ArenaSavepoint sp = tb_arena_save(tmp_arena);
+    Set live = set_create_in_arena(tmp_arena, gc->count);
+    Set point = set_create_in_arena(tmp_arena, gc->count);
+    int* next_use = tb_arena_alloc(tmp_arena, gc->count * sizeof(int));
+    DynArray(Inst*) insts = NULL;
+
+    bool progress = false;
+    FOREACH_N(i, 0, ctx->bb_count) {
+        TB_Node* bb = ctx->worklist.items[ctx->bb_order[i]];
+        MachineBB* mbb = &nl_map_get_checked(ctx->machine_bbs, bb);
+        gc_block_insts(mbb, &insts);
+
+        // anything live-out isn't needed until some point after the block
+        set_copy(&live, &mbb->live_out);
+        FOREACH_SET(x, live) {
+            next_use[x] = mbb->end + 64;
+        }
+
+        FOREACH_REVERSE_N(j, 0, dyn_array_length(insts)) {
+            Inst* inst = insts[j];
+
+            RegIndex* outs  = inst->operands;
+            RegIndex* ins   = outs + inst->out_count;
+            RegIndex* tmps  = ins + inst->in_count;
+            RegIndex* saves = tmps + inst->tmp_count;
+
+            // everything which needs a register while the instruction runs, this
+            // matches the edges gc_build makes.
+            set_copy(&point, &live);
+            FOREACH_N(k, 0, inst->out_count) {
+                set_put(&point, outs[k]);
+            }
+
+            FOREACH_N(k, 0, inst->tmp_count) {
+                set_put(&point, tmps[k]);
+            }
+
+            if (!gc_is_reg_move(inst)) {
+                FOREACH_N(k, 0, inst->out_count) {
+                    FOREACH_N(l, gc_two_address_rhs(inst, outs[k]), inst->in_count) {
+                        set_put(&point, ins[l]);
+                    }
+                }
+            }
+
+            int pressure[CG_REGISTER_CLASSES] = { 0 };
+            FOREACH_SET(x, point) {
+                int rc = intervals[x].reg_class;
+                if (x < GC_FIXED_COUNT ? (gc->allowed[rc] & (1ull << (x % 16))) != 0 : !gc->in_mem[x]) {
+                    pressure[rc] += 1;
+                }
+            }
+
+            FOREACH_N(rc, 0, CG_REGISTER_CLASSES) {
+                while (pressure[rc] > gc->k[rc]) {
+                    RegIndex best = -1;
+                    FOREACH_SET(x, live) {
+                        if (x < GC_FIXED_COUNT || gc->in_mem[x] || gc->no_spill[x] || intervals[x].reg_class != rc || gc_is_operand(inst, x)) {
+                            continue;
+                        }
+
+                        if (best < 0 || gc->cost[x] < gc->cost[best] || (gc->cost[x] == gc->cost[best] && next_use[x] > next_use[best])) {
+                            best = x;
+                        }
+                    }
+
+                    // nothing we can do here, coloring will sort it out
+                    if (best < 0) break;
+
+                    REG_ALLOC_LOG printf("  #   v%d: spill to relieve pressure (cost=%f)\n", best, gc->cost[best]);
+                    gc->in_mem[best] = true;
+                    pressure[rc] -= 1;
+                    progress = true;
+                }
+            }
+
+            FOREACH_N(k, 0, inst->out_count) {
+                set_remove(&live, outs[k]);
+            }
+
+            FOREACH_N(k, 0, inst->in_count) {
+                set_put(&live, ins[k]);
+                next_use[ins[k]] = inst->time;
+            }
+
+            FOREACH_N(k, 0, inst->save_count) {
+                set_put(&live, saves[k]);
+                next_use[saves[k]] = inst->time;
+            }
+        }
+    }
+
+    dyn_array_destroy(insts);
+    tb_arena_restore(tmp_arena, sp);
+    return progress;
+}
+
+static int gc_pick_color(GraphColor* gc, RegIndex n, uint64_t avail, uint64_t* used) {
+    LiveInterval* interval = &gc->ctx->intervals[n];
+
+    // try to land on the same register as our copies
+    if (interval->hint >= 0 && interval->hint < gc->count) {
+        int c = gc->color[interval->hint];
+        if (c >= 0 && (avail & (1ull << c))) {
+            return c;
+        }
+    }
+
+    dyn_array_for(i, gc->moves[n]) {
+        int c = gc->color[gc_find(gc, gc->moves[n][i])];
+        if (c >= 0 && (avail & (1ull << c))) {
+            return c;
+        }
+    }
+
+    // caller saved registers are free, callee saved ones cost a save & restore the
+    // first time we touch them.
+    int rc = interval->reg_class;
+    uint64_t cheap = avail & (~gc->callee_saved[rc] | used[rc]);
+    return tb_ffs64(cheap ? cheap : avail) - 1;
+}
+
+typedef struct {
+    int start;
+    RegIndex n;
+} GCOrder;
+
+static int gc_order_cmp(const void* a, const void* b) {
+    const GCOrder* aa = a;
+    const GCOrder* bb = b;
+    return aa->start != bb->start ? (aa->start > bb->start) - (aa->start < bb->start) : aa->n - bb->n;
+}
+
+static uint64_t gc_avail(GraphColor* gc, RegIndex n) {
+    uint64_t avail = gc->allowed[gc->ctx->intervals[n].reg_class];
+    dyn_array_for(j, gc->adj[n]) {
+        int c = gc->color[gc_find(gc, gc->adj[n][j])];
+        if (c >= 0) avail &= ~(1ull << c);
+    }
+    return avail;
+}
+
+// when n is out of colors it's usually because a single neighbor took the one it
+// needed while it could've gone elsewhere, we move that neighbor and take its color.
+static int gc_recolor(GraphColor* gc, RegIndex n) {
+    uint64_t allowed = gc->allowed[gc->ctx->intervals[n].reg_class];
+    for (uint64_t bits = allowed; bits; bits &= bits - 1) {
+        int c = tb_ffs64(bits) - 1;
+
+        RegIndex only = -1;
+        bool ok = true;
+        dyn_array_for(j, gc->adj[n]) {
+            RegIndex m = gc_find(gc, gc->adj[n][j]);
+            if (gc->color[m] != c || m == only) continue;
+
+            if (only >= 0 || m < GC_FIXED_COUNT) {
+                ok = false;
+                break;
+            }
+            only = m;
+        }
+
+        if (!ok || only < 0) continue;
+
+        uint64_t other = gc_avail(gc, only) & ~(1ull << c);
+        if (other) {
+            gc->color[only] = tb_ffs64(other) - 1;
+            return c;
+        }
+    }
+
+    return -1;
+}
+
+// pops the stack and picks colors which none of the neighbors have, anything that
+// doesn't fit goes into spills.
+static void gc_select(GraphColor* gc, size_t top, RegIndex* stack, DynArray(RegIndex)* spills) {
+    LiveInterval* intervals = gc->ctx->intervals;
+
+    uint64_t used[CG_REGISTER_CLASSES] = { 0 };
+    FOREACH_REVERSE_N(i, 0, top) {
+        RegIndex n = stack[i];
+        int rc = intervals[n].reg_class;
+
+        uint64_t avail = gc_avail(gc, n);
+        int c = avail ? gc_pick_color(gc, n, avail, used) : gc_recolor(gc, n);
+        if (c < 0) {
+            dyn_array_put(*spills, n);
+            continue;
+        }
+
+        used[rc] |= 1ull << c;
+        gc->color[n] = c;
+    }
+}
+
+// Briggs' conservative test, merging is fine as long as the combined node has less
+// than K neighbors which are hard to color (so it's still gonna simplify).
+static bool gc_can_coalesce(GraphColor* gc, RegIndex a, RegIndex b) {
+    int rc = gc->ctx->intervals[a].reg_class;
+    int k = gc->k[rc], significant = 0;
+
+    RegIndex pair[2] = { a, b };
+    FOREACH_N(i, 0, 2) {
+        dyn_array_for(j, gc->adj[pair[i]]) {
+            RegIndex t = gc->adj[pair[i]][j];
+            if (gc->alias[t] != t || (i == 1 && gc_interferes(gc, a, t))) {
+                continue;
+            }
+
+            // precolored nodes never simplify
+            if (t < GC_FIXED_COUNT || gc->degree[t] >= k) {
+                if (++significant >= k) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void gc_coalesce(GraphColor* gc) {
+    FOREACH_N(i, GC_FIXED_COUNT, gc->count) {
+        dyn_array_for(j, gc->moves[i]) {
+            RegIndex a = gc_find(gc, i);
+            RegIndex b = gc_find(gc, gc->moves[i][j]);
+            if (a == b || b < GC_FIXED_COUNT || gc->cost[b] == 0.0f || gc->no_spill[a] || gc->no_spill[b]) {
+                continue;
+            }
+
+            if (gc_interferes(gc, a, b) || !gc_can_coalesce(gc, a, b)) {
+                continue;
+            }
+
+            // b's edges move over to a
+            gc->alias[b] = a;
+            dyn_array_for(l, gc->adj[b]) {
+                RegIndex t = gc->adj[b][l];
+                if (gc->alias[t] != t) continue;
+
+                gc_add_edge(gc, a, t);
+                gc->degree[t] -= 1;
+            }
+
+            dyn_array_for(l, gc->moves[b]) {
+                dyn_array_put(gc->moves[a], gc->moves[b][l]);
+            }
+
+            gc->cost[a] += gc->cost[b];
+            gc->start[a] = TB_MIN(gc->start[a], gc->start[b]);
+        }
+    }
+}
+
+// returns false if a temporary couldn't get a register
+static bool gc_color(GraphColor* gc, DynArray(RegIndex)* spills) {
+    size_t count = gc->count;
+    LiveInterval* intervals = gc->ctx->intervals;
+
+    int* k = gc->k;
+    bool* removed = tb_platform_heap_alloc(count * sizeof(bool));
+    RegIndex* stack = tb_platform_heap_alloc(count * sizeof(RegIndex));
+    DynArray(RegIndex) nodes = NULL;
+    DynArray(RegIndex) low = NULL;
+
+    FOREACH_N(i, 0, count) {
+        gc->alias[i] = i;
+    }
+    gc_coalesce(gc);
+
+    FOREACH_N(i, 0, count) {
+        removed[i] = true;
+        if (i < GC_FIXED_COUNT || gc->cost[i] == 0.0f || gc->in_mem[i] || gc->alias[i] != i) {
+            continue;
+        }
+
+        removed[i] = false;
+        dyn_array_put(nodes, i);
+        if (gc->degree[i] < k[intervals[i].reg_class]) {
+            dyn_array_put(low, i);
+        }
+    }
+
+    // simplify: anything with less than K neighbors is guaranteed a color so we can
+    // pull it out of the graph and color it last.
+    size_t top = 0;
+    while (top < dyn_array_length(nodes)) {
+        RegIndex n = -1;
+        while (dyn_array_length(low)) {
+            RegIndex m = dyn_array_pop(low);
+            if (!removed[m]) {
+                n = m;
+                break;
+            }
+        }
+
+        // everything left is significant, pull out the cheapest thing to spill and hope
+        // it colors anyways (that's the optimistic part of Briggs)
+        if (n < 0) {
+            float best = 0.0f;
+            dyn_array_for(i, nodes) {
+                RegIndex m = nodes[i];
+                if (removed[m]) continue;
+
+                float metric = gc->cost[m] / gc->degree[m];
+                if (n < 0 || (gc->no_spill[n] && !gc->no_spill[m]) || (gc->no_spill[n] == gc->no_spill[m] && metric < best)) {
+                    n = m, best = metric;
+                }
+            }
+        }
+
+        removed[n] = true;
+        stack[top++] = n;
+
+        int rc = intervals[n].reg_class;
+        dyn_array_for(i, gc->adj[n]) {
+            RegIndex m = gc->adj[n][i];
+            if (!removed[m] && --gc->degree[m] == k[rc] - 1) {
+                dyn_array_put(low, m);
+            }
+        }
+    }
+
+    gc_select(gc, top, stack, spills);
+
+    // the graph is mostly made up of live ranges on a straight line, coloring those
+    // in program order never needs more than the max pressure (which we've limited)
+    // so if the optimistic order got stuck we give that a shot.
+    if (dyn_array_length(*spills)) {
+        GCOrder* order = tb_platform_heap_alloc(top * sizeof(GCOrder));
+        FOREACH_N(i, 0, top) {
+            RegIndex n = stack[i];
+            order[i] = (GCOrder){ gc->start[n], n };
+        }
+        qsort(order, top, sizeof(GCOrder), gc_order_cmp);
+
+        // the stack is popped from the top
+        int* old_color = tb_platform_heap_alloc(top * sizeof(int));
+        FOREACH_N(i, 0, top) {
+            stack[top - i - 1] = order[i].n;
+            old_color[i] = gc->color[order[i].n];
+            gc->color[order[i].n] = -1;
+        }
+
+        DynArray(RegIndex) retry = NULL;
+        gc_select(gc, top, stack, &retry);
+        if (dyn_array_length(retry) < dyn_array_length(*spills)) {
+            dyn_array_destroy(*spills);
+            *spills = retry;
+        } else {
+            FOREACH_N(i, 0, top) {
+                gc->color[order[i].n] = old_color[i];
+            }
+            dyn_array_destroy(retry);
+        }
+
+        tb_platform_heap_free(old_color);
+        tb_platform_heap_free(order);
+    }
+
+    // coalesced nodes share the fate of the node they got merged into
+    FOREACH_N(i, GC_FIXED_COUNT, count) {
+        RegIndex root = gc_find(gc, i);
+        if (root == i || gc->cost[i] == 0.0f || gc->in_mem[i]) {
+            continue;
+        }
+
+        if (gc->color[root] >= 0) {
+            gc->color[i] = gc->color[root];
+        } else {
+            dyn_array_put(*spills, i);
+        }
+    }
+
+    bool success = true;
+    dyn_array_for(i, *spills) {
+        RegIndex n = (*spills)[i];
+        REG_ALLOC_LOG printf("  #   v%d: spill (cost=%f)\n", n, gc->cost[n]);
+        if (gc->no_spill[n]) {
+            success = false;
+        }
+    }
+
+    tb_platform_heap_free(removed);
+    tb_platform_heap_free(stack);
+    dyn_array_destroy(nodes);
+    dyn_array_destroy(low);
+    return success;
+}
+
+static RegIndex gc_new_temp(Ctx* restrict ctx, RegIndex v) {
+    LiveInterval* interval = &ctx->intervals[v];
+    LiveInterval it = {
+        .reg_class = interval->reg_class,
+        .n = interval->n, .dt = interval->dt,
+        .reg = -1, .hint = -1, .assigned = -1, .split_kid = -1,
+    };
+
+    // linear scan might still need to take over
+    it.ranges = tb_platform_heap_alloc(4 * sizeof(LiveRange));
+    it.range_count = 1;
+    it.range_cap = 4;
+    it.ranges[0] = (LiveRange){ INT_MAX, INT_MAX };
+
+    RegIndex i = dyn_array_length(ctx->intervals);
+    dyn_array_put(ctx->intervals, it);
+    return i;
+}
+
+static Inst* gc_spill_move(Ctx* restrict ctx, RegIndex dst, RegIndex src, RegIndex spilled) {
+    Inst* inst = tb_arena_alloc(tmp_arena, sizeof(Inst) + (2 * sizeof(RegIndex)));
+    *inst = (Inst){ .type = MOV, .flags = INST_SPILL, .dt = ctx->intervals[spilled].dt, .out_count = 1, 1 };
+    inst->operands[0] = dst;
+    inst->operands[1] = src;
+    return inst;
+}
+
+// every instruction which touches a spilled value (besides a move which can just
+// use the stack slot) gets a reload before it and a store after it.
+static void gc_rewrite(Ctx* restrict ctx, bool* in_mem, size_t mem_count) {
+    Inst* prev = NULL;
+    for (Inst* inst = ctx->first; inst; prev = inst, inst = inst->next) {
+        if (gc_is_reg_move(inst)) {
+            RegIndex dst = inst->operands[0], src = inst->operands[1];
+            if (dst != src && dst < mem_count && in_mem[dst] && src < mem_count && in_mem[src]) {
+                // can't do memory to memory
+                RegIndex t = gc_new_temp(ctx, src);
+                Inst* reload = gc_spill_move(ctx, t, src, src);
+                reload->next = inst;
+                prev->next = reload;
+
+                inst->operands[1] = t;
+            }
+            continue;
+        }
+
+        // saves don't care if it's memory
+        size_t in_base = inst->out_count;
+        size_t total = inst->out_count + inst->in_count + inst->tmp_count;
+        FOREACH_N(j, 0, total) {
+            RegIndex v = inst->operands[j];
+            if (v >= mem_count || !in_mem[v]) continue;
+
+            RegIndex t = gc_new_temp(ctx, v);
+            bool is_use = false, is_def = false;
+            FOREACH_N(k, j, total) {
+                if (inst->operands[k] == v) {
+                    inst->operands[k] = t;
+                    is_def |= k < in_base;
+                    is_use |= k >= in_base && k < in_base + inst->in_count;
+                }
+            }
+
+            if (is_use) {
+                Inst* reload = gc_spill_move(ctx, t, v, v);
+                reload->next = inst;
+                prev->next = reload;
+                prev = reload;
+            }
+
+            if (is_def) {
+                Inst* store = gc_spill_move(ctx, v, t, v);
+                store->next = inst->next;
+                inst->next = store;
+            }
+        }
+    }
+}
+
+static int graph_color(Ctx* restrict ctx, TB_Function* f, int stack_usage, DynArray(int) epilogues) {
+    // RSP & RBP are reserved
+    GraphColor gc = {
+        .ctx = ctx,
+        .allowed = { 0xFFFF & ~((1ull << RSP) | (1ull << RBP)), 0xFFFF },
+    };
+
+    FOREACH_N(rc, 0, CG_REGISTER_CLASSES) {
+        gc.k[rc] = tb_popcount64(gc.allowed[rc]);
+    }
+    mark_callee_saved_constraints(ctx, gc.callee_saved);
+
+    // the live ranges changed so linear scan needs fresh ones if we fall back
+    if (gc_peephole(ctx)) {
+        nl_map_free(ctx->machine_bbs);
+        dyn_array_destroy(epilogues);
+        epilogues = liveness(ctx, f);
+    }
+
+    size_t old_count = 0;
+    for (int round = 0;; round++) {
+        size_t count = dyn_array_length(ctx->intervals);
+        if (count > GC_MAX_VREGS || round >= GC_MAX_ROUNDS) {
+            REG_ALLOC_LOG printf("  # graph coloring gave up, falling back to linear scan\n");
+            goto fallback;
+        }
+
+        // anything made since the last round is a spill temporary
+        gc.in_mem = tb_platform_heap_realloc(gc.in_mem, count * sizeof(bool));
+        gc.no_spill = tb_platform_heap_realloc(gc.no_spill, count * sizeof(bool));
+        FOREACH_N(i, old_count, count) {
+            gc.in_mem[i] = false;
+            gc.no_spill[i] = round > 0;
+        }
+
+        size_t matrix_size = ((count * count) + 63) / 64;
+        gc.count = count;
+        gc.matrix = tb_platform_heap_alloc(matrix_size * sizeof(uint64_t));
+        gc.adj = tb_platform_heap_alloc(count * sizeof(DynArray(RegIndex)));
+        gc.moves = tb_platform_heap_alloc(count * sizeof(DynArray(RegIndex)));
+        gc.degree = tb_platform_heap_alloc(count * sizeof(int));
+        gc.cost = tb_platform_heap_alloc(count * sizeof(float));
+        gc.start = tb_platform_heap_alloc(count * sizeof(int));
+        gc.alias = tb_platform_heap_alloc(count * sizeof(RegIndex));
+        gc.color = tb_platform_heap_realloc(gc.color, count * sizeof(int));
+        memset(gc.matrix, 0, matrix_size * sizeof(uint64_t));
+        FOREACH_N(i, 0, count) {
+            gc.adj[i] = NULL;
+            gc.moves[i] = NULL;
+            gc.degree[i] = 0;
+            gc.cost[i] = 0.0f;
+            gc.start[i] = INT_MAX;
+            gc.alias[i] = i;
+            gc.color[i] = i < GC_FIXED_COUNT ? ctx->intervals[i].reg : -1;
+        }
+
+        REG_ALLOC_LOG printf("  # graph coloring round %d (%zu vregs)\n", round, count);
+
+        DynArray(RegIndex) spills = NULL;
+        CUIK_TIMED_BLOCK("build graph") {
+            gc_build(&gc);
+        }
+
+        // if we had to spill just to get the pressure down there's no point in coloring
+        // yet, the graph is gonna change anyways.
+        bool spilled, success = true;
+        CUIK_TIMED_BLOCK("pressure") {
+            spilled = gc_limit_pressure(&gc);
+        }
+
+        if (!spilled) CUIK_TIMED_BLOCK("color") {
+            success = gc_color(&gc, &spills);
+        }
+
+        // only spill the cheapest of what failed, the rest might color once it's out of
+        // the way. Later rounds spill everything that failed so we're sure to finish.
+        if (dyn_array_length(spills) && round < GC_MAX_ROUNDS / 2) {
+            RegIndex best = gc_find(&gc, spills[0]);
+            dyn_array_for(i, spills) {
+                RegIndex root = gc_find(&gc, spills[i]);
+                if (gc.cost[root] < gc.cost[best]) best = root;
+            }
+
+            // anything coalesced into it goes too
+            size_t j = 0;
+            dyn_array_for(i, spills) {
+                if (gc_find(&gc, spills[i]) == best) spills[j++] = spills[i];
+            }
+            dyn_array_set_length(spills, j);
+        }
+
+        FOREACH_N(i, 0, count) {
+            dyn_array_destroy(gc.adj[i]);
+            dyn_array_destroy(gc.moves[i]);
+        }
+        tb_platform_heap_free(gc.matrix);
+        tb_platform_heap_free(gc.adj);
+        tb_platform_heap_free(gc.moves);
+        tb_platform_heap_free(gc.degree);
+        tb_platform_heap_free(gc.cost);
+        tb_platform_heap_free(gc.start);
+        tb_platform_heap_free(gc.alias);
+
+        if (!success) {
+            dyn_array_destroy(spills);
+            goto fallback;
+        }
+
+        // put the spills into memory, rewrite and try again
+        dyn_array_for(i, spills) {
+            gc.in_mem[spills[i]] = true;
+        }
+
+        spilled |= dyn_array_length(spills) > 0;
+        dyn_array_destroy(spills);
+
+        if (!spilled) {
+            break;
+        }
+
+        CUIK_TIMED_BLOCK("spill") {
+            gc_rewrite(ctx, gc.in_mem, count);
+        }
+
+        nl_map_free(ctx->machine_bbs);
+        dyn_array_destroy(epilogues);
+        CUIK_TIMED_BLOCK("data flow") {
+            epilogues = liveness(ctx, f);
+        }
+        old_count = count;
+    }
+
+    LSRA ra = { .first = ctx->first, .cache = ctx->first, .intervals = ctx->intervals, .epilogues = epilogues, .stack_usage = stack_usage };
+
+    // write back the results
+    uint64_t used[CG_REGISTER_CLASSES] = { 0 };
+    size_t count = dyn_array_length(ra.intervals);
+    FOREACH_N(i, GC_FIXED_COUNT, count) {
+        LiveInterval* interval = &ra.intervals[i];
+        if (gc.in_mem[i]) {
+            interval->spill = TB_ARENA_ALLOC(tmp_arena, SpillSlot);
+            interval->spill->pos = 0;
+            interval->is_spill = true;
+            allocate_spill_slot(&ra, interval);
+        } else if (gc.color[i] >= 0) {
+            interval->assigned = gc.color[i];
+            used[interval->reg_class] |= 1ull << gc.color[i];
+        }
+    }
+
+    FOREACH_N(rc, 0, CG_REGISTER_CLASSES) {
+        uint64_t saved = used[rc] & gc.callee_saved[rc];
+        FOREACH_N(reg, 0, 16) if (saved & (1ull << reg)) {
+            spill_callee_saved(&ra, rc, reg);
+        }
+    }
+
+    dyn_array_for(i, ra.intervals) {
+        tb_platform_heap_free(ra.intervals[i].ranges);
+        dyn_array_destroy(ra.intervals[i].uses);
+    }
+
+    tb_platform_heap_free(gc.in_mem);
+    tb_platform_heap_free(gc.no_spill);
+    tb_platform_heap_free(gc.color);
+
+    ctx->intervals = ra.intervals;
+    return ra.stack_usage;
+
+    fallback:
+    tb_platform_heap_free(gc.in_mem);
+    tb_platform_heap_free(gc.no_spill);
+    tb_platform_heap_free(gc.color);
+    return linear_scan(ctx, f, stack_usage, epilogues);
+}
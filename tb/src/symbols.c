@@ -6,7 +6,10 @@ TB_SymbolIter tb_symbol_iter(TB_Module* mod) {
 }
 
 TB_Symbol* tb_symbol_iter_next(TB_SymbolIter* iter) {
-    for (TB_ThreadInfo* info = iter->info; info != NULL; info = info->next_in_module) {
+    for (TB_ThreadInfo* info = iter->info; info != NULL; info = info->next_in_module, iter->i = 0) {
+        // threads which never made symbols don't have a table
+        if (info->symbols.data == NULL) continue;
+
         size_t cap = 1ull << info->symbols.exp;
         for (size_t i = iter->i; i < cap; i++) {
             void* ptr = info->symbols.data[i];
@@ -23,6 +26,20 @@ TB_Symbol* tb_symbol_iter_next(TB_SymbolIter* iter) {
 }
 
 void tb_module_kill_symbol(TB_Module* m, TB_Symbol* sym) {
+    TB_ThreadInfo* info = sym->info;
+    mtx_lock(&info->symbol_lock);
+    bool removed = nl_hashset_remove(&info->symbols, sym);
+    mtx_unlock(&info->symbol_lock);
+
+    if (removed) {
+        atomic_fetch_sub(&m->symbol_count[sym->tag], 1);
+
+        // the symbol itself stays allocated (just like every other symbol) but
+        // it shouldn't look like it's got IR anymore.
+        if (sym->tag == TB_SYMBOL_FUNCTION) {
+            dyn_array_destroy(((TB_Function*) sym)->terminators);
+        }
+    }
 }
 
 void tb_symbol_append(TB_Module* m, TB_Symbol* s) {
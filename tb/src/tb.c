@@ -167,7 +167,7 @@ TB_Module* tb_module_create(TB_Arch arch, TB_System sys, const TB_FeatureSet* fe
     return m;
 }
 
-TB_FunctionOutput* tb_pass_codegen(TB_Passes* p, bool emit_asm) {
+TB_FunctionOutput* tb_pass_codegen(TB_Passes* p, TB_RegAlloc regalloc, bool emit_asm) {
     TB_Function* f = p->f;
     TB_Module* m = f->super.module;
     ICodeGen* restrict code_gen = tb__find_code_generator(m);
@@ -199,7 +199,7 @@ TB_FunctionOutput* tb_pass_codegen(TB_Passes* p, bool emit_asm) {
         uint8_t* local_buffer = &region->data[region->size];
         size_t local_capacity = region->capacity - region->size;
 
-        code_gen->compile_function(p, func_out, &m->features, local_buffer, local_capacity, emit_asm);
+        code_gen->compile_function(p, func_out, &m->features, regalloc, local_buffer, local_capacity, emit_asm);
 
         // if the func_out is placed into a different region, let's abide by that
         if (func_out->code_region != region) {
@@ -619,8 +619,10 @@ void* tb_out_reserve(TB_Emitter* o, size_t count) {
     if (o->count + count >= o->capacity) {
         if (o->capacity == 0) {
             o->capacity = 64;
-        } else {
-            o->capacity += count;
+        }
+
+        // the first reservation might already be bigger than the default
+        while (o->count + count >= o->capacity) {
             o->capacity *= 2;
         }
 
@@ -753,6 +755,7 @@ size_t tb_outstr_nul(TB_Emitter* o, const char* str) {
     tb_out_reserve(o, len);
 
     memcpy(&o->data[o->count], str, len);
+    o->count += len;
     return start;
 }
 
@@ -733,6 +733,83 @@ TB_Node* tb_inst_prefetch(TB_Function* f, TB_Node* addr, int level) {
     return n;
 }
 
+TB_DataType tb_vector_type(TB_DataType elem, int lanes) {
+    assert(elem.type == TB_INT || elem.type == TB_FLOAT);
+    assert(lanes > 1 && (lanes & (lanes - 1)) == 0 && "lane count must be a power of two");
+
+    int log2_lanes = tb_ffs(lanes) - 1;
+    int is_float = elem.type == TB_FLOAT;
+    return (TB_DataType){ { TB_VECTOR, log2_lanes | (elem.data << 4) | (is_float << 11) } };
+}
+
+TB_Node* tb_inst_vbroadcast(TB_Function* f, TB_DataType dt, TB_Node* src) {
+    assert(dt.type == TB_VECTOR && TB_DATA_TYPE_EQUALS(TB_GET_VECTOR_ELEM(dt), src->dt));
+    return tb_unary(f, TB_VBROADCAST, dt, src);
+}
+
+TB_Node* tb_inst_vshuffle(TB_Function* f, TB_Node* a, TB_Node* b, size_t count, const uint8_t* indices) {
+    assert(a->dt.type == TB_VECTOR && TB_DATA_TYPE_EQUALS(a->dt, b->dt));
+    assert(count == TB_GET_VECTOR_LANES(a->dt));
+
+    TB_Node* n = tb_alloc_node(f, TB_VSHUFFLE, a->dt, 3, sizeof(TB_NodeShuffle) + count);
+    n->inputs[1] = a;
+    n->inputs[2] = b;
+
+    TB_NodeShuffle* s = TB_NODE_GET_EXTRA(n);
+    s->count = count;
+    FOREACH_N(i, 0, count) {
+        assert(indices[i] < 2*count);
+        s->indices[i] = indices[i];
+    }
+    return n;
+}
+
+TB_Node* tb_inst_vextract(TB_Function* f, TB_Node* vec, int lane) {
+    assert(vec->dt.type == TB_VECTOR && lane >= 0 && lane < TB_GET_VECTOR_LANES(vec->dt));
+
+    TB_Node* n = tb_alloc_node(f, TB_VEXTRACT, TB_GET_VECTOR_ELEM(vec->dt), 2, sizeof(TB_NodeLane));
+    n->inputs[1] = vec;
+    TB_NODE_SET_EXTRA(n, TB_NodeLane, .lane = lane);
+    return n;
+}
+
+TB_Node* tb_inst_vinsert(TB_Function* f, TB_Node* vec, TB_Node* val, int lane) {
+    assert(vec->dt.type == TB_VECTOR && lane >= 0 && lane < TB_GET_VECTOR_LANES(vec->dt));
+    assert(TB_DATA_TYPE_EQUALS(TB_GET_VECTOR_ELEM(vec->dt), val->dt));
+
+    TB_Node* n = tb_alloc_node(f, TB_VINSERT, vec->dt, 3, sizeof(TB_NodeLane));
+    n->inputs[1] = vec;
+    n->inputs[2] = val;
+    TB_NODE_SET_EXTRA(n, TB_NodeLane, .lane = lane);
+    return n;
+}
+
+TB_Node* tb_inst_vmaskload(TB_Function* f, TB_DataType dt, TB_Node* addr, TB_Node* mask, TB_CharUnits alignment) {
+    assert(dt.type == TB_VECTOR && mask->dt.type == TB_VECTOR);
+    assert(TB_GET_VECTOR_LANES(dt) == TB_GET_VECTOR_LANES(mask->dt));
+
+    TB_Node* n = tb_alloc_node(f, TB_VMASKLOAD, dt, 4, sizeof(TB_NodeMemAccess));
+    n->inputs[0] = f->active_control_node;
+    n->inputs[1] = peek_mem(f, f->active_control_node);
+    n->inputs[2] = addr;
+    n->inputs[3] = mask;
+    TB_NODE_SET_EXTRA(n, TB_NodeMemAccess, .align = alignment);
+    return n;
+}
+
+void tb_inst_vmaskstore(TB_Function* f, TB_Node* addr, TB_Node* val, TB_Node* mask, TB_CharUnits alignment) {
+    assert(val->dt.type == TB_VECTOR && mask->dt.type == TB_VECTOR);
+    assert(TB_GET_VECTOR_LANES(val->dt) == TB_GET_VECTOR_LANES(mask->dt));
+
+    TB_Node* n = tb_alloc_node(f, TB_VMASKSTORE, TB_TYPE_MEMORY, 5, sizeof(TB_NodeMemAccess));
+    n->inputs[0] = f->active_control_node;
+    n->inputs[1] = append_mem(f, n);
+    n->inputs[2] = addr;
+    n->inputs[3] = val;
+    n->inputs[4] = mask;
+    TB_NODE_SET_EXTRA(n, TB_NodeMemAccess, .align = alignment);
+}
+
 TB_Node* tb_inst_x86_stmxcsr(TB_Function* f) {
     return tb_alloc_node(f, TB_X86INTRIN_STMXCSR, TB_TYPE_I32, 1, 0);
 }
@@ -145,6 +145,8 @@ struct TB_DebugType {
 
         TB_DEBUG_TYPE_ARRAY,
         TB_DEBUG_TYPE_POINTER,
+        // uses the array layout but it's passed around by value
+        TB_DEBUG_TYPE_VECTOR,
 
         // special types
         TB_DEBUG_TYPE_ALIAS,
@@ -272,6 +274,24 @@ typedef struct TB_FunctionOutput {
     TB_SymbolPatch* last_patch;
 } TB_FunctionOutput;
 
+// what the optimizer learned about a function by the end of tb_pass_optimize,
+// callers can use it as long as they're not in the same SCC.
+typedef struct {
+    // doesn't write to memory, it might still read it
+    bool no_writes;
+
+    // bit i is set if pointer param i is only used as the address of loads & stores (or
+    // passed to callees which say the same about it)
+    uint64_t no_escape;
+
+    // lattice of the return value (if there's exactly one)
+    bool has_ret_range;
+    int64_t ret_min, ret_max;
+    uint64_t ret_known_zeros, ret_known_ones;
+
+    bool ret_not_null;
+} TB_FunctionSummary;
+
 struct TB_Function {
     TB_Symbol super;
     TB_ModuleSectionHandle section;
@@ -296,6 +316,12 @@ struct TB_Function {
     // used for CFG walk in TB_Passes
     DynArray(TB_Node*) terminators;
 
+    // interprocedural info, scc is 0 until a call graph is built and the
+    // summary is published once has_summary is set.
+    uint32_t scc;
+    _Atomic bool has_summary;
+    TB_FunctionSummary summary;
+
     // IR building
     TB_Node* active_control_node;
     TB_NodeSafepoint exit_attrib;
@@ -439,7 +465,7 @@ typedef struct {
     // NULLable if doesn't apply
     void (*emit_win64eh_unwind_info)(TB_Emitter* e, TB_FunctionOutput* out_f, uint64_t stack_usage);
 
-    void (*compile_function)(TB_Passes* p, TB_FunctionOutput* restrict func_out, const TB_FeatureSet* features, uint8_t* out, size_t out_capacity, bool emit_asm);
+    void (*compile_function)(TB_Passes* p, TB_FunctionOutput* restrict func_out, const TB_FeatureSet* features, TB_RegAlloc regalloc, uint8_t* out, size_t out_capacity, bool emit_asm);
 } ICodeGen;
 
 // All debug formats i know of boil down to adding some extra sections to the object file
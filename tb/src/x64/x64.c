@@ -109,6 +109,14 @@ static TB_X86_DataType legalize_float(TB_DataType dt) {
 static TB_X86_DataType legalize(TB_DataType dt) {
     if (dt.type == TB_FLOAT) {
         return legalize_float(dt);
+    } else if (dt.type == TB_VECTOR) {
+        // we only do 128bit vectors for now
+        TB_DataType elem = TB_GET_VECTOR_ELEM(dt);
+        if (elem.type == TB_FLOAT) {
+            return elem.data == TB_FLT_64 ? TB_X86_TYPE_SSE_PD : TB_X86_TYPE_SSE_PS;
+        }
+
+        return TB_X86_TYPE_XMMWORD;
     } else {
         uint64_t m;
         return legalize_int(dt, &m);
@@ -116,7 +124,7 @@ static TB_X86_DataType legalize(TB_DataType dt) {
 }
 
 static int classify_reg_class(TB_DataType dt) {
-    return dt.type == TB_FLOAT ? REG_CLASS_XMM : REG_CLASS_GPR;
+    return dt.type == TB_FLOAT || dt.type == TB_VECTOR ? REG_CLASS_XMM : REG_CLASS_GPR;
 }
 
 static bool wont_spill_around(int t) {
@@ -127,6 +135,11 @@ static bool is_terminator(int t) {
     return t == INST_TERMINATOR || t == INT3 || t == UD2;
 }
 
+static bool is_commutative_inst(int t) {
+    return t == ADD || t == OR || t == AND || t == XOR || t == IMUL ||
+        t == FP_ADD || t == FP_MUL || t == FP_AND || t == FP_OR || t == FP_XOR;
+}
+
 static bool try_for_imm32(Ctx* restrict ctx, int bits, TB_Node* n, int32_t* out_x) {
     if (n->type != TB_INTEGER_CONST) {
         return false;
@@ -184,6 +197,10 @@ static Inst* inst_jcc(int target, Cond cc) {
 
 // store(binop(load(a), b))
 static int can_folded_store(Ctx* restrict ctx, TB_Node* mem, TB_Node* addr, TB_Node* src) {
+    if (src->dt.type == TB_VECTOR) {
+        return -1;
+    }
+
     switch (src->type) {
         default: return -1;
 
@@ -350,6 +367,310 @@ static Inst* isel_addr2(Ctx* restrict ctx, TB_Node* n, int dst, int store_op, in
     }
 }
 
+static int vector_elem_bits(TB_DataType dt) {
+    assert(dt.type == TB_VECTOR);
+    int bits = (dt.data >> 4) & 127;
+    if (TB_GET_VECTOR_ELEM(dt).type == TB_FLOAT) {
+        bits = bits == TB_FLT_64 ? 64 : 32;
+    }
+
+    if (bits * TB_GET_VECTOR_LANES(dt) != 128) {
+        tb_todo(); // TODO(NeGate): we only do XMM sized vectors right now
+    }
+
+    return bits;
+}
+
+// the only two address form with an immediate we've got is for the packed ops
+static Inst* inst_op_rrri(int type, TB_DataType dt, RegIndex dst, RegIndex lhs, RegIndex rhs, int32_t imm) {
+    Inst* i = inst_op_rrr(type, dt, dst, lhs, rhs);
+    i->flags = INST_IMM;
+    i->imm = imm;
+    return i;
+}
+
+static void isel_vector(Ctx* restrict ctx, TB_Node* n, const int dst) {
+    TB_DataType dt = n->type == TB_VEXTRACT || n->type == TB_VMASKSTORE ? n->inputs[n->type == TB_VEXTRACT ? 1 : 3]->dt : n->dt;
+    int bits = vector_elem_bits(dt);
+    int lanes = TB_GET_VECTOR_LANES(dt);
+    bool is_float = TB_GET_VECTOR_ELEM(dt).type == TB_FLOAT;
+    int log2_bytes = tb_ffs(bits / 8) - 1;
+
+    switch (n->type) {
+        case TB_AND:
+        case TB_OR:
+        case TB_XOR:
+        case TB_ADD:
+        case TB_SUB:
+        case TB_MUL: {
+            const static InstType fp_ops[] = { FP_AND, FP_OR, FP_XOR };
+            const static InstType int_ops[][4] = {
+                { PAND,  PAND,   PAND,   PAND  },
+                { POR,   POR,    POR,    POR   },
+                { PXOR,  PXOR,   PXOR,   PXOR  },
+                { PADDB, PADDW,  PADDD,  PADDQ },
+                { PSUBB, PSUBW,  PSUBD,  PSUBQ },
+                { -1,    PMULLW, PMULLD, -1    },
+            };
+
+            InstType op = is_float ? fp_ops[n->type - TB_AND] : int_ops[n->type - TB_AND][log2_bytes];
+
+            int lhs = input_reg(ctx, n->inputs[1]);
+            hint_reg(ctx, dst, lhs);
+
+            int rhs = input_reg(ctx, n->inputs[2]);
+            if (op != (InstType) -1) {
+                SUBMIT(inst_move(dt, dst, lhs));
+                SUBMIT(inst_op_rrr(op, dt, dst, dst, rhs));
+            } else if (bits == 8) {
+                // there's no 8bit lane multiply in SSE4.1, we do the even and odd bytes
+                // as words and splice them back together:
+                //   even = (a * b) & 0x00FF
+                //   odd  = (a & 0xFF00) * (b >> 8)
+                uint8_t masks[3][16];
+                FOREACH_N(i, 0, 16) {
+                    masks[0][i] = i & 1 ? 0x00 : 0xFF;
+                    masks[1][i] = i & 1 ? 0xFF : 0x00;
+                    masks[2][i] = i & 1 ? 0x80 : i + 1;
+                }
+
+                TB_Global* even_mask = tb__small_data_intern(ctx->module, 16, masks[0]);
+                TB_Global* odd_mask  = tb__small_data_intern(ctx->module, 16, masks[1]);
+                TB_Global* odd_shuf  = tb__small_data_intern(ctx->module, 16, masks[2]);
+
+                int even = DEF(NULL, dt), odd = DEF(NULL, dt), tmp = DEF(NULL, dt);
+                SUBMIT(inst_move(dt, even, lhs));
+                SUBMIT(inst_op_rrr(PMULLW, dt, even, even, rhs));
+                SUBMIT(inst_op_global(PAND, dt, even, (TB_Symbol*) even_mask));
+
+                SUBMIT(inst_move(dt, tmp, rhs));
+                SUBMIT(inst_op_global(PSHUFB, dt, tmp, (TB_Symbol*) odd_shuf));
+                SUBMIT(inst_move(dt, odd, lhs));
+                SUBMIT(inst_op_global(PAND, dt, odd, (TB_Symbol*) odd_mask));
+                SUBMIT(inst_op_rrr(PMULLW, dt, odd, odd, tmp));
+
+                SUBMIT(inst_move(dt, dst, even));
+                SUBMIT(inst_op_rrr(POR, dt, dst, dst, odd));
+            } else {
+                // no 64bit lane multiply either (pmullq is AVX-512), it's just two IMULs
+                assert(bits == 64);
+                int prods[2];
+                FOREACH_N(i, 0, 2) {
+                    int a = lhs, b = rhs;
+                    if (i == 1) {
+                        a = DEF(NULL, dt), b = DEF(NULL, dt);
+                        SUBMIT(inst_op_rri(PSHUFD, dt, a, lhs, 0xEE));
+                        SUBMIT(inst_op_rri(PSHUFD, dt, b, rhs, 0xEE));
+                    }
+
+                    int x = DEF(NULL, TB_TYPE_I64), y = DEF(NULL, TB_TYPE_I64);
+                    SUBMIT(inst_op_rr(MOV_F2I, TB_TYPE_I64, x, a));
+                    SUBMIT(inst_op_rr(MOV_F2I, TB_TYPE_I64, y, b));
+                    SUBMIT(inst_op_rrr(IMUL, TB_TYPE_I64, x, x, y));
+                    prods[i] = x;
+                }
+
+                SUBMIT(inst_op_rr(MOV_I2F, TB_TYPE_I64, dst, prods[0]));
+                SUBMIT(inst_op_rrri(PINSRQ, dt, dst, dst, prods[1], 1));
+            }
+            break;
+        }
+
+        case TB_NEG:
+        case TB_NOT: {
+            int src = input_reg(ctx, n->inputs[1]);
+
+            if (n->type == TB_NEG && !is_float) {
+                // 0 - src
+                const static InstType ops[] = { PSUBB, PSUBW, PSUBD, PSUBQ };
+                SUBMIT(inst_op_zero(dt, dst));
+                SUBMIT(inst_op_rrr(ops[log2_bytes], dt, dst, dst, src));
+            } else {
+                // flip the sign bits for floats, all the bits for NOT
+                uint8_t buffer[16];
+                if (n->type == TB_NOT) {
+                    memset(buffer, 0xFF, 16);
+                } else {
+                    memset(buffer, 0, 16);
+                    for (int i = (bits / 8) - 1; i < 16; i += bits / 8) buffer[i] = 0x80;
+                }
+
+                TB_Global* g = tb__small_data_intern(ctx->module, 16, buffer);
+                SUBMIT(inst_move(dt, dst, src));
+                SUBMIT(inst_op_global(is_float ? FP_XOR : PXOR, dt, dst, (TB_Symbol*) g));
+            }
+            break;
+        }
+
+        case TB_VBROADCAST: {
+            TB_DataType elem_dt = n->inputs[1]->dt;
+            int src = input_reg(ctx, n->inputs[1]);
+
+            if (!is_float) {
+                // replicate the small ints across a dword first
+                if (bits < 32) {
+                    int tmp = DEF(NULL, TB_TYPE_I32);
+                    SUBMIT(inst_op_rr(bits == 8 ? MOVZXB : MOVZXW, TB_TYPE_I32, tmp, src));
+                    SUBMIT(inst_op_rri(IMUL, TB_TYPE_I32, tmp, tmp, bits == 8 ? 0x01010101 : 0x00010001));
+                    src = tmp, elem_dt = TB_TYPE_I32;
+                }
+
+                int tmp = DEF(NULL, dt);
+                SUBMIT(inst_op_rr(MOV_I2F, elem_dt, tmp, src));
+                src = tmp;
+            }
+
+            SUBMIT(inst_op_rri(PSHUFD, dt, dst, src, bits == 64 ? 0x44 : 0x00));
+            break;
+        }
+
+        case TB_VEXTRACT: {
+            int lane = TB_NODE_GET_EXTRA_T(n, TB_NodeLane)->lane;
+            int byte_pos = lane * (bits / 8);
+            int dword = byte_pos / 4;
+
+            // move the dword (or qword) with our lane down into the bottom
+            int src = input_reg(ctx, n->inputs[1]);
+            if (dword != 0) {
+                int imm = bits == 64 ? 0xEE : dword;
+                int tmp = is_float ? dst : DEF(NULL, dt);
+
+                SUBMIT(inst_op_rri(PSHUFD, dt, tmp, src, imm));
+                src = tmp;
+            } else if (is_float) {
+                SUBMIT(inst_move(dt, dst, src));
+            }
+
+            if (!is_float) {
+                SUBMIT(inst_op_rr(MOV_F2I, bits == 64 ? TB_TYPE_I64 : TB_TYPE_I32, dst, src));
+                if (byte_pos % 4) {
+                    SUBMIT(inst_op_rri(SHR, TB_TYPE_I32, dst, dst, (byte_pos % 4) * 8));
+                }
+            }
+            break;
+        }
+
+        case TB_VINSERT: {
+            int lane = TB_NODE_GET_EXTRA_T(n, TB_NodeLane)->lane;
+
+            int vec = input_reg(ctx, n->inputs[1]);
+            int val = input_reg(ctx, n->inputs[2]);
+            hint_reg(ctx, dst, vec);
+            SUBMIT(inst_move(dt, dst, vec));
+
+            if (!is_float) {
+                const static InstType ops[] = { PINSRB, PINSRW, PINSRD, PINSRQ };
+                SUBMIT(inst_op_rrri(ops[log2_bytes], dt, dst, dst, val, lane));
+            } else if (bits == 32) {
+                SUBMIT(inst_op_rrri(INSERTPS, dt, dst, dst, val, lane << 4));
+            } else if (lane == 0) {
+                // movsd only writes the bottom half
+                SUBMIT(inst_op_rrr(FP_MOV, TB_TYPE_F64, dst, dst, val));
+            } else {
+                SUBMIT(inst_op_rrr(UNPCKLPD, dt, dst, dst, val));
+            }
+            break;
+        }
+
+        case TB_VSHUFFLE: {
+            TB_NodeShuffle* shuf = TB_NODE_GET_EXTRA(n);
+            TB_Node* a = n->inputs[1];
+            TB_Node* b = n->inputs[2];
+
+            // if both sides are the same value we just fold the indices together
+            bool uses_a = false, uses_b = false;
+            FOREACH_N(i, 0, lanes) {
+                if (shuf->indices[i] >= lanes && a != b) uses_b = true;
+                else uses_a = true;
+            }
+
+            if (bits >= 32 && uses_a != uses_b) {
+                // single source shuffle of dwords or qwords is just a PSHUFD
+                int imm = 0;
+                FOREACH_N(i, 0, lanes) {
+                    int j = shuf->indices[i] & (lanes - 1);
+                    if (bits == 64) {
+                        imm |= ((j*2) << (i*4)) | ((j*2 + 1) << (i*4 + 2));
+                    } else {
+                        imm |= j << (i*2);
+                    }
+                }
+
+                int src = input_reg(ctx, uses_a ? a : b);
+                SUBMIT(inst_op_rri(PSHUFD, dt, dst, src, imm));
+                break;
+            }
+
+            // general case is a PSHUFB per source, the lanes which come
+            // from the other side are zeroed (top bit set) and then ORed together
+            uint8_t masks[2][16];
+            memset(masks, 0x80, sizeof(masks));
+
+            int elem_bytes = bits / 8;
+            FOREACH_N(i, 0, lanes) {
+                int j = shuf->indices[i];
+                int side = j >= lanes && a != b;
+                j &= lanes - 1;
+
+                FOREACH_N(k, 0, elem_bytes) {
+                    masks[side][i*elem_bytes + k] = j*elem_bytes + k;
+                }
+            }
+
+            int srcs[2] = { uses_a ? input_reg(ctx, a) : -1, uses_b ? input_reg(ctx, b) : -1 };
+            int outs[2] = { dst, uses_a && uses_b ? DEF(NULL, dt) : dst };
+            FOREACH_N(side, 0, 2) {
+                if (srcs[side] >= 0) {
+                    TB_Global* g = tb__small_data_intern(ctx->module, 16, masks[side]);
+                    SUBMIT(inst_move(dt, outs[side], srcs[side]));
+                    SUBMIT(inst_op_global(PSHUFB, dt, outs[side], (TB_Symbol*) g));
+                }
+            }
+
+            if (uses_a && uses_b) {
+                SUBMIT(inst_op_rrr(POR, dt, dst, dst, outs[1]));
+            }
+            break;
+        }
+
+        case TB_VMASKLOAD:
+        case TB_VMASKSTORE: {
+            if (bits < 32) {
+                tb_todo(); // TODO(NeGate): AVX can only mask dwords and qwords
+            }
+
+            // vmaskmov only takes a plain memory operand so we compute the address first
+            int addr = DEF(NULL, TB_TYPE_PTR);
+            SUBMIT(isel_addr2(ctx, n->inputs[2], addr, -1, -1));
+
+            Inst* inst;
+            if (n->type == TB_VMASKLOAD) {
+                int mask = input_reg(ctx, n->inputs[3]);
+
+                inst = alloc_inst(bits == 64 ? VMASKMOVPD_LD : VMASKMOVPS_LD, dt, 1, 2, 0);
+                inst->mem_slot = 2;
+                inst->operands[0] = dst;
+                inst->operands[1] = mask;
+                inst->operands[2] = addr;
+            } else {
+                int src = input_reg(ctx, n->inputs[3]);
+                int mask = input_reg(ctx, n->inputs[4]);
+
+                inst = alloc_inst(bits == 64 ? VMASKMOVPD_ST : VMASKMOVPS_ST, dt, 0, 3, 0);
+                inst->mem_slot = 0;
+                inst->operands[0] = addr;
+                inst->operands[1] = src;
+                inst->operands[2] = mask;
+            }
+            inst->flags = INST_MEM;
+            SUBMIT(inst);
+            break;
+        }
+
+        default: tb_todo();
+    }
+}
+
 static Cond isel_cmp(Ctx* restrict ctx, TB_Node* n) {
     bool invert = false;
     if (n->type == TB_CMP_EQ && n->dt.type == TB_INT && n->dt.data == 1 && n->inputs[2]->type == TB_INTEGER_CONST) {
@@ -446,6 +767,15 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
         case TB_PHI: break;
         case TB_REGION: break;
 
+        case TB_VBROADCAST:
+        case TB_VSHUFFLE:
+        case TB_VEXTRACT:
+        case TB_VINSERT:
+        case TB_VMASKLOAD:
+        case TB_VMASKSTORE:
+        isel_vector(ctx, n, dst);
+        break;
+
         case TB_POISON: {
             Inst* inst = alloc_inst(INST_INLINE, TB_TYPE_VOID, 1, 0, 0);
             inst->operands[0] = dst;
@@ -472,7 +802,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             TB_Node** params = ctx->f->params;
             FOREACH_N(i, 0, ctx->f->param_count) {
                 TB_Node* proj = params[3 + i];
-                bool is_float = proj->dt.type == TB_FLOAT;
+                bool is_float = classify_reg_class(proj->dt) == REG_CLASS_XMM;
 
                 // copy from parameter
                 int reg_class = (is_float ? REG_CLASS_XMM : REG_CLASS_GPR);
@@ -523,6 +853,11 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
                     continue;
                 }
 
+                // the home slots are only 8 bytes wide, vectors get a normal local
+                if (proj->dt.type == TB_VECTOR) {
+                    continue;
+                }
+
                 TB_Node* store_op = use->n;
                 if (store_op->type != TB_STORE || tb_get_parent_region(store_op->inputs[0]) != n) {
                     continue;
@@ -604,7 +939,8 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
 
             Cond cc = isel_cmp(ctx, n->inputs[1]);
             SUBMIT(inst_move(n->dt, dst, rhs));
-            SUBMIT(inst_op_rr(CMOVO + cc, n->dt, dst, lhs));
+            // CMOV reads the destination, if it's not taken that's the result
+            SUBMIT(inst_op_rrr(CMOVO + cc, n->dt, dst, dst, lhs));
             break;
         }
 
@@ -613,6 +949,11 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
         case TB_XOR:
         case TB_ADD:
         case TB_SUB: {
+            if (n->dt.type == TB_VECTOR) {
+                isel_vector(ctx, n, dst);
+                break;
+            }
+
             const static InstType ops[] = { AND, OR, XOR, ADD, SUB };
             InstType op = ops[type - TB_AND];
 
@@ -648,6 +989,11 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
         }
 
         case TB_MUL: {
+            if (n->dt.type == TB_VECTOR) {
+                isel_vector(ctx, n, dst);
+                break;
+            }
+
             int lhs = input_reg(ctx, n->inputs[1]);
             hint_reg(ctx, dst, lhs);
 
@@ -852,7 +1198,9 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
         }
         case TB_NEG:
         case TB_NOT: {
-            if (n->dt.type != TB_FLOAT) {
+            if (n->dt.type == TB_VECTOR) {
+                isel_vector(ctx, n, dst);
+            } else if (n->dt.type != TB_FLOAT) {
                 int src = input_reg(ctx, n->inputs[1]);
 
                 SUBMIT(inst_move(n->dt, dst, src));
@@ -889,7 +1237,8 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             hint_reg(ctx, dst, lhs);
             SUBMIT(inst_move(n->dt, dst, lhs));
 
-            if (n->inputs[2]->type == TB_LOAD && on_last_use(ctx, n->inputs[2])) {
+            // packed ops want aligned memory operands which our vectors don't promise
+            if (n->dt.type != TB_VECTOR && n->inputs[2]->type == TB_LOAD && on_last_use(ctx, n->inputs[2])) {
                 use(ctx, n->inputs[2]);
 
                 Inst* inst = isel_addr2(ctx, n->inputs[2]->inputs[2], dst, -1, dst);
@@ -946,10 +1295,13 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             TB_DataType src_dt = n->inputs[1]->dt;
             int src = input_reg(ctx, n->inputs[1]);
 
-            if (src_dt.type == TB_FLOAT && n->dt.type == TB_INT) {
+            // vectors live in the XMM regs just like floats
+            bool src_xmm = src_dt.type == TB_FLOAT || src_dt.type == TB_VECTOR;
+            bool dst_xmm = n->dt.type == TB_FLOAT || n->dt.type == TB_VECTOR;
+            if (src_xmm && n->dt.type == TB_INT) {
                 // float -> int
                 SUBMIT(inst_op_rr(MOV_F2I, n->dt, dst, src));
-            } else if (src_dt.type == TB_INT && n->dt.type == TB_FLOAT) {
+            } else if (src_dt.type == TB_INT && dst_xmm) {
                 // int -> float
                 SUBMIT(inst_op_rr(MOV_I2F, src_dt, dst, src));
             } else {
@@ -1039,8 +1391,10 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             int proj_base = type == TB_TAILCALL ? 3 : 2;
 
             if (n->type != TB_TAILCALL) {
-                assert(proto->return_count <= 2);
-                FOREACH_N(i, 0, proto->return_count) {
+                // syscalls don't have a prototype, they just return one value
+                int return_count = proto ? proto->return_count : 1;
+                assert(return_count <= 2);
+                FOREACH_N(i, 0, return_count) {
                     TB_Node* ret_node = TB_NODE_GET_EXTRA_T(n, TB_NodeCall)->projs[proj_base + i];
                     if (!has_users(ctx, ret_node)) {
                         ret_node = NULL;
@@ -1051,7 +1405,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
                         rets[i] = input_reg(ctx, ret_node);
                         ret_count++;
 
-                        bool use_xmm_ret = TB_IS_FLOAT_TYPE(ret_node->dt);
+                        bool use_xmm_ret = classify_reg_class(ret_node->dt) == REG_CLASS_XMM;
                         if (use_xmm_ret) {
                             caller_saved_xmms &= ~(1ull << (XMM0 + i));
                         } else {
@@ -1079,14 +1433,13 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
                 TB_Node* param = n->inputs[i];
                 TB_DataType param_dt = param->dt;
 
-                bool use_xmm = TB_IS_FLOAT_TYPE(param_dt);
+                bool use_xmm = classify_reg_class(param_dt) == REG_CLASS_XMM;
                 int reg = use_xmm ? xmms_used : gprs_used;
                 if (is_sysv) {
                     if (use_xmm) {
                         xmms_used++;
                     } else {
                         gprs_used++;
-                        caller_saved_gprs &= ~(1u << gprs_used);
                     }
                 } else {
                     // win64 will always expend a register
@@ -1121,7 +1474,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             FOREACH_N(i, 0, in_count) {
                 TB_DataType dt = n->inputs[3 + i]->dt;
 
-                bool use_xmm = TB_IS_FLOAT_TYPE(dt);
+                bool use_xmm = classify_reg_class(dt) == REG_CLASS_XMM;
                 SUBMIT(inst_move(dt, ins[i], param_srcs[i]));
 
                 // in win64, float params past the vararg cutoff are
@@ -1184,7 +1537,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
             // return value (either XMM0 or RAX)
             RegIndex* dst_ins = call_inst->operands;
             FOREACH_N(i, 0, 2) if (ret_nodes[i] != NULL) {
-                bool use_xmm_ret = TB_IS_FLOAT_TYPE(ret_nodes[i]->dt);
+                bool use_xmm_ret = classify_reg_class(ret_nodes[i]->dt) == REG_CLASS_XMM;
                 if (use_xmm_ret) {
                     *dst_ins++ = FIRST_XMM + i;
                 } else {
@@ -1214,7 +1567,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
                 FOREACH_N(i, 0, 2) if (ret_nodes[i] != NULL) {
                     assert(rets[i] >= 0);
                     TB_DataType dt = ret_nodes[i]->dt;
-                    bool use_xmm_ret = TB_IS_FLOAT_TYPE(dt);
+                    bool use_xmm_ret = classify_reg_class(dt) == REG_CLASS_XMM;
                     if (use_xmm_ret) {
                         hint_reg(ctx, rets[i], FIRST_XMM + i);
                         SUBMIT(inst_move(dt, rets[i], FIRST_XMM + i));
@@ -1317,7 +1670,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
                     SUBMIT(inst_op_rri(SUB, dt, index, index, min->key - 1));
                 }
                 SUBMIT(inst_op_ri(CMP, dt, index, range));
-                SUBMIT(inst_op_rr(CMOVA, n->dt, index, zero));
+                SUBMIT(inst_op_rrr(CMOVA, n->dt, index, index, zero));
             }
             //   lea table, [rip + TABLE]
             int table = DEF(NULL, TB_TYPE_I64);
@@ -1549,7 +1902,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
         }
         case TB_LOAD:
         case TB_ATOMIC_LOAD: {
-            int mov_op = TB_IS_FLOAT_TYPE(n->dt) ? FP_MOV : MOV;
+            int mov_op = classify_reg_class(n->dt) == REG_CLASS_XMM ? FP_MOV : MOV;
             TB_Node* addr = n->inputs[2];
 
             Inst* ld_inst = isel_addr2(ctx, addr, dst, -1, -1);
@@ -1602,7 +1955,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
 
                 src = src->inputs[2];
             } else {
-                store_op = TB_IS_FLOAT_TYPE(store_dt) ? FP_MOV : MOV;
+                store_op = classify_reg_class(store_dt) == REG_CLASS_XMM ? FP_MOV : MOV;
             }
 
             int32_t imm;
@@ -1681,7 +2034,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
 
                 // copy to return register
                 TB_DataType dt = n->inputs[3+i]->dt;
-                if (dt.type == TB_FLOAT) {
+                if (classify_reg_class(dt) == REG_CLASS_XMM) {
                     hint_reg(ctx, src, FIRST_XMM + i);
                     SUBMIT(inst_move(dt, FIRST_XMM + i, src));
                 } else {
@@ -1791,7 +2144,7 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
 
                 // past the first register parameters, it's all stack
                 if (index >= param_gpr_count) {
-                    InstType i = n->dt.type == TB_FLOAT ? FP_MOV : MOV;
+                    InstType i = classify_reg_class(n->dt) == REG_CLASS_XMM ? FP_MOV : MOV;
                     SUBMIT(inst_op_rm(i, n->dt, dst, RBP, GPR_NONE, SCALE_X1, 16 + index*8));
                 }
             }
@@ -1803,6 +2156,10 @@ static void isel(Ctx* restrict ctx, TB_Node* n, const int dst) {
 }
 
 static void inst2_print(TB_CGEmitter* restrict e, InstType type, Val* dst, Val* src, TB_X86_DataType dt) {
+    if (dt == TB_X86_TYPE_XMMWORD) {
+        dt = TB_X86_TYPE_SSE_PD;
+    }
+
     if (dt >= TB_X86_TYPE_SSE_SS && dt <= TB_X86_TYPE_SSE_PD) {
         inst2sse(e, type, dst, src, dt);
     } else {
@@ -1962,6 +2319,36 @@ static void emit_code(Ctx* restrict ctx, TB_FunctionOutput* restrict func_out) {
             Val target;
             size_t i = resolve_interval(ctx, inst, in_base, &target);
             inst1(e, CALL, &target, TB_X86_TYPE_QWORD);
+        } else if (cat == INST_BINOP_PACKED) {
+            Val out, lhs, rhs;
+            int i = resolve_interval(ctx, inst, 0, &out);
+            i += resolve_interval(ctx, inst, i, &lhs);
+
+            if (i < in_base + inst->in_count) {
+                // two address form, lhs is also the destination
+                resolve_interval(ctx, inst, i, &rhs);
+                if (!is_value_match(&out, &lhs)) {
+                    inst2sse(e, FP_MOV, &out, &lhs, TB_X86_TYPE_SSE_PD);
+                }
+            } else {
+                rhs = lhs;
+            }
+
+            inst2packed(e, inst->type, &out, &rhs, inst->flags & INST_IMM ? (uint8_t) inst->imm : -1);
+        } else if (cat == INST_BINOP_VEX) {
+            // loads are (dst, mask, [addr]) while stores are ([addr], src, mask)
+            Val reg, mask, mem;
+            if (inst->out_count) {
+                int i = resolve_interval(ctx, inst, 0, &reg);
+                i += resolve_interval(ctx, inst, i, &mask);
+                resolve_interval(ctx, inst, i, &mem);
+            } else {
+                int i = resolve_interval(ctx, inst, 0, &mem);
+                i += resolve_interval(ctx, inst, i, &reg);
+                resolve_interval(ctx, inst, i, &mask);
+            }
+
+            inst2vex(e, inst->type, &reg, &mask, &mem);
         } else {
             int mov_op = inst->dt >= TB_X86_TYPE_PBYTE && inst->dt <= TB_X86_TYPE_XMMWORD ? FP_MOV : MOV;
 
@@ -2017,6 +2404,14 @@ static void emit_code(Ctx* restrict ctx, TB_FunctionOutput* restrict func_out) {
                         inst2_print(e, MOV, &out, &lhs, dt);
                     }
                 } else {
+                    Val rhs;
+                    if (ternary && is_commutative_inst(inst->type) && !(inst->flags & (INST_IMM | INST_ABS)) && out.type != VAL_MEM &&
+                        resolve_interval(ctx, inst, i, &rhs) && is_value_match(&out, &rhs)) {
+                        // the destination already holds the rhs, just flip the operands
+                        inst2_print(e, inst->type, &out, &lhs, dt);
+                        continue;
+                    }
+
                     if (ternary || inst->type == MOV || inst->type == FP_MOV) {
                         if (!is_value_match(&out, &lhs)) {
                             inst2_print(e, mov_op, &out, &lhs, dt);
@@ -100,6 +100,8 @@ typedef enum {
 
     // SSE
     INST_BINOP_SSE,
+    INST_BINOP_PACKED, // 66 0F [38/3A] op, optionally followed by imm8
+    INST_BINOP_VEX,    // VEX.128.66.0F38 op, the mask goes into vvvv
 } InstCategory;
 
 typedef struct InstDesc {
@@ -29,7 +29,7 @@ static void emit_memory_operand(TB_CGEmitter* restrict e, uint8_t rx, const Val*
 
         EMIT1(e, mod_rx_rm(mod, rx, needs_index ? RSP : base));
         if (needs_index) {
-            EMIT1(e, mod_rx_rm(scale, (base & 7) == RSP ? RSP : index, base));
+            EMIT1(e, mod_rx_rm(scale, index != GPR_NONE ? index : RSP, base));
         }
 
         if (mod == MOD_INDIRECT_DISP8) {
@@ -100,7 +100,7 @@ static void inst1(TB_CGEmitter* restrict e, InstType type, const Val* r, TB_X86_
 
         EMIT1(e, mod_rx_rm(mod, rx, needs_index ? RSP : base));
         if (needs_index) {
-            EMIT1(e, mod_rx_rm(scale, (base & 7) == RSP ? RSP : index, base));
+            EMIT1(e, mod_rx_rm(scale, index != GPR_NONE ? index : RSP, base));
         }
 
         if (mod == MOD_INDIRECT_DISP8) EMIT1(e, (int8_t)disp);
@@ -204,7 +204,7 @@ static void inst2(TB_CGEmitter* restrict e, InstType type, const Val* a, const V
 
     // if the REX stays as 0x40 then it's default and doesn't need
     // to be here.
-    if (rex_prefix != 0x40 || dt == TB_X86_TYPE_BYTE || type == MOVZXB) {
+    if (rex_prefix != 0x40 || dt == TB_X86_TYPE_BYTE || type == MOVZXB || type == MOVSXB) {
         EMIT1(e, rex_prefix);
     }
 
@@ -307,3 +307,68 @@ static void inst2sse(TB_CGEmitter* restrict e, InstType type, const Val* a, cons
     EMIT1(e, inst->op + (supports_mem_dst ? dir : 0));
     emit_memory_operand(e, rx, b);
 }
+
+// a is the register operand, b is r/m and imm is only emitted if it's non-negative
+static void inst2packed(TB_CGEmitter* restrict e, InstType type, const Val* a, const Val* b, int imm) {
+    assert(type < COUNTOF(inst_table));
+    const InstDesc* restrict inst = &inst_table[type];
+    assert(inst->cat == INST_BINOP_PACKED && a->type == VAL_XMM);
+
+    uint8_t rx = a->reg;
+    uint8_t base = 0, index = 0;
+    if (b->type == VAL_MEM) {
+        base  = b->reg;
+        index = b->index != GPR_NONE ? b->index : 0;
+    } else if (b->type == VAL_XMM || b->type == VAL_GPR) {
+        base  = b->reg;
+    } else if (b->type != VAL_GLOBAL) {
+        tb_todo();
+    }
+
+    if (inst->rx_i) {
+        EMIT1(e, inst->rx_i);
+    }
+
+    if (type == PINSRQ || rx >= 8 || base >= 8 || index >= 8) {
+        EMIT1(e, rex(type == PINSRQ, rx, base, index));
+    }
+
+    EMIT1(e, 0x0F);
+    if (inst->op_i) {
+        EMIT1(e, inst->op_i);
+    }
+    EMIT1(e, inst->op);
+    emit_memory_operand(e, rx, b);
+
+    ptrdiff_t disp_patch = e->count - 4;
+    if (imm >= 0) {
+        EMIT1(e, imm);
+    }
+
+    if (b->type == VAL_GLOBAL && disp_patch + 4 != e->count) {
+        RELOC4(e, disp_patch, (disp_patch + 4) - e->count);
+    }
+}
+
+// VEX.128.66.0F38.W0 op a, vvvv, b (for the stores the r/m is the destination)
+static void inst2vex(TB_CGEmitter* restrict e, InstType type, const Val* a, const Val* vvvv, const Val* b) {
+    assert(type < COUNTOF(inst_table));
+    const InstDesc* restrict inst = &inst_table[type];
+    assert(inst->cat == INST_BINOP_VEX && a->type == VAL_XMM && vvvv->type == VAL_XMM);
+
+    uint8_t rx = a->reg;
+    uint8_t base = 0, index = 0;
+    if (b->type == VAL_MEM) {
+        base  = b->reg;
+        index = b->index != GPR_NONE ? b->index : 0;
+    } else if (b->type != VAL_GLOBAL) {
+        tb_todo();
+    }
+
+    // 3 byte VEX, the R, X, B and vvvv fields are stored inverted
+    EMIT1(e, 0xC4);
+    EMIT1(e, ((~rx >> 3) & 1) << 7 | ((~index >> 3) & 1) << 6 | ((~base >> 3) & 1) << 5 | 0x02);
+    EMIT1(e, (~vvvv->reg & 15) << 3 | 0x01);
+    EMIT1(e, inst->op);
+    emit_memory_operand(e, rx, b);
+}
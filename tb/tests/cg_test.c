@@ -17,7 +17,7 @@ int main() {
     tb_inst_ret(f, 1, &v);
 
     TB_Passes* passes = tb_pass_enter(f, NULL);
-    TB_FunctionOutput* asm_out = tb_pass_codegen(passes, true);
+    TB_FunctionOutput* asm_out = tb_pass_codegen(passes, TB_REGALLOC_LINEAR_SCAN, true);
     if (asm_out) {
         printf("\n");
         tb_output_print_asm(asm_out, stdout);
@@ -1,11 +1,14 @@
 #include <dyn_array.h>
+#include "util.inc"
+
+#include <string.h>
 
 typedef struct {
     TB_Module* m;
     TB_JIT* jit;
 } RunTest;
 
-RunTest create_jit() {
+static RunTest create_jit(void) {
     TB_FeatureSet features = { 0 };
     TB_Module* mod = tb_module_create_for_host(&features, true);
     TB_JIT* jit = tb_jit_begin(mod, 0);
@@ -16,6 +19,7 @@ RunTest create_jit() {
 #include "tb_test_regressions.inc"
 #include "tb_test_exit_status.inc"
 #include "tb_test_int_arith.inc"
+#include "tb_test_regalloc.inc"
 
 typedef int (*TestFn)(void);
 
@@ -25,16 +29,16 @@ static void run_test(const char* name, TestFn fn) {
     size_t len = strlen(name);
 
     fflush(stdout);
-    printf("%s\r", #proc_);
+    printf("%s\r", name);
     fflush(stdout);
-    int status_ = test_##proc_();
+    int status = fn();
     fflush(stdout);
 
-    printf("%s%.*s ", #proc_, (int) (41 - sizeof(#proc_)),
+    printf("%s%.*s ", name, (int) (len < 40 ? 40 - len : 0),
         " ........................................"
     );
 
-    if (status_) {
+    if (status) {
         printf("OK\n");
     } else {
         printf("FAILED\n");
@@ -42,9 +46,10 @@ static void run_test(const char* name, TestFn fn) {
     }
     total++;
     fflush(stdout);
-
 }
 
+#define TEST(proc_) run_test(#proc_, test_##proc_)
+
 int main(int argc, char **argv) {
     TEST(regression_module_arena);
     TEST(regression_link_global);
@@ -98,6 +103,11 @@ int main(int argc, char **argv) {
     TEST(u64_div);
     TEST(u64_mod);
 
+    TEST(regalloc_linear_scan_pressure);
+    TEST(regalloc_graph_color_pressure);
+    TEST(regalloc_graph_color_spills);
+    TEST(regalloc_graph_color_r12_base);
+
     fflush(stdout);
     if (failed > 0) {
         printf("\n%d of %d tests failed.\n", failed, total);
@@ -52,6 +52,181 @@ function test(file)
 	end
 end
 
+-- runs a command and hands back the lines it printed and whether it succeeded
+function run(cmd)
+	print(cmd)
+
+	local p = io.popen(cmd.." 2>&1")
+	local lines = {}
+	for l in p:lines() do
+		lines[#lines + 1] = l
+	end
+
+	return lines, p:close()
+end
+
+function write_file(path, text)
+	local f = io.open(path, "wb")
+	f:write(text)
+	f:close()
+end
+
+function check(name, cond)
+	if not cond then
+		print(name.." failed")
+		os.exit(1)
+	end
+end
+
+-- builds the sources into one program and expects it to report no failures
+function test_run(files, flags)
+	local out, ok = run("cuik "..(flags or "").." "..files.." -o test/a.out && test/a.out")
+	check(files, ok and out[#out] == "0 failed")
+end
+
+-- the cache is written on the first build, read back on the second and thrown
+-- out once the header changes (or the cache file gets mangled).
+function test_token_cache()
+	os.execute("mkdir -p test/cache && rm -f test/cache/*.tkn")
+	write_file("test/cache/value.h", "#define VALUE 1\n")
+
+	local build = "cuik -token-cache test/cache -I test/cache tests/token_cache.c -o test/a.out && test/a.out"
+	local listing = "ls -l --time-style=full-iso test/cache/*.tkn"
+
+	local out, ok = run(build)
+	check("token cache miss", ok and out[#out] == "1")
+	local before = table.concat(run(listing), "\n")
+
+	out, ok = run(build)
+	check("token cache hit", ok and out[#out] == "1" and table.concat(run(listing), "\n") == before)
+
+	-- the size changes too so coarse mtimes can't hide it
+	write_file("test/cache/value.h", "#define VALUE 22\n")
+	out, ok = run(build)
+	check("token cache invalidate", ok and out[#out] == "22")
+
+	for _, path in ipairs(run("ls test/cache/*.tkn")) do
+		write_file(path, "not a token cache")
+	end
+	out, ok = run(build)
+	check("token cache corrupt", ok and out[#out] == "22")
+end
+
+-- private symbols nothing public can reach shouldn't make it into the object file
+function test_prune()
+	local out, ok = run("cuik -O1 tests/prune.c -c -o test/prune.o && nm test/prune.o")
+	local symbols = table.concat(out, "\n")
+	check("prune build", ok)
+	check("prune dropped", not symbols:find("_dropped"))
+	check("prune kept", symbols:find("table_kept"))
+
+	test_run("tests/prune.c", "-O1")
+end
+
+-- enough defines to grow the macro table a few times, the #undefs leave tombstones
+function test_many_macros()
+	local lines = {}
+	for i = 0, 9999 do
+		lines[#lines + 1] = "#define MANY_"..i.." "..i
+	end
+	for i = 0, 9999, 2 do
+		lines[#lines + 1] = "#undef MANY_"..i
+	end
+	for i = 0, 9999, 4 do
+		lines[#lines + 1] = "#define MANY_"..i.." "..(i * 2)
+	end
+
+	write_file("test/many_macros.h", table.concat(lines, "\n").."\n")
+	test_run("tests/many_macros.c", "-I test -O1")
+end
+
+-- the parser reads the stream while the preprocessor is still writing it, neither
+-- the program nor the diagnostics should notice.
+function test_pipe()
+	test_run("tests/atoms.c", "-pipe -O1")
+
+	local plain = table.concat(run("cuik tests/diag.c -c -o test/diag.o"), "\n")
+	local piped = table.concat(run("cuik -pipe tests/diag.c -c -o test/diag.o"), "\n")
+	check("pipe diagnostics", plain == piped)
+end
+
+-- the file lists what it expects in //# comments, each of those has to show up
+-- somewhere in the compiler's output.
+function test_diag(file, flags)
+	local out = table.concat(run("cuik "..(flags or "").." "..file.." -c -o test/diag.o"), "\n")
+	for l in io.lines(file) do
+		local expected = l:match('//#%s*(.*)')
+		if expected ~= nil then
+			check(file.." expecting '"..expected.."'", out:find(expected, 1, true))
+		end
+	end
+end
+
+-- sources are mapped copy-on-write, the lexer still needs its padding after a file
+-- which ends on a page boundary and its in-place writes can't reach the disk.
+function test_mapped_files()
+	local page = "static int page_value = 7;"
+	local splice = "static int spli\\\nced_value = 5;\n#define SPLICED_MACRO \\\n 6\n"
+	write_file("test/empty.h", "")
+	write_file("test/page.h", "//"..string.rep("x", 4096 - 3 - #page).."\n"..page)
+	write_file("test/whitespace.h", "static\tint\vws_value\f=\t3;\n")
+	write_file("test/splice.h", splice)
+
+	test_run("tests/mapped.c", "-I test -O1")
+
+	local f = io.open("test/splice.h", "rb")
+	check("mapped file untouched", f:read("*a") == splice)
+	f:close()
+end
+
+-- headers stay cached in the server between builds, rewriting one has to get it
+-- thrown out even when the size doesn't change.
+function test_server()
+	os.execute("rm -f test/cuik.sock")
+	write_file("test/server_value.h", "#define VALUE 1\n")
+	os.execute("cuik --server test/cuik.sock > test/server.log 2>&1 & echo $! > test/server.pid")
+	os.execute("for i in 1 2 3 4 5 6 7 8 9 10; do [ -S test/cuik.sock ] && break; sleep 0.1; done")
+
+	local build = "CUIK_SOCKET=test/cuik.sock cuik --connect -I test tests/server.c -o test/a.out && test/a.out"
+	local out, ok = run(build)
+	check("server first build", ok and out[#out] == "1")
+
+	out, ok = run(build)
+	check("server cached build", ok and out[#out] == "1")
+
+	write_file("test/server_value.h", "#define VALUE 2\n")
+	out, ok = run(build)
+	check("server invalidate", ok and out[#out] == "2")
+
+	-- diagnostics come out on the client's side
+	write_file("test/server_value.h", "int bad = missing_server;\n")
+	out, ok = run(build)
+	check("server error", not ok and table.concat(out, "\n"):find("unknown symbol: missing_server", 1, true))
+
+	os.execute("kill $(cat test/server.pid)")
+end
+
 test("tests/hello_world.c")
+test_token_cache()
+
+-- both sources go through one shared file cache
+test_run("tests/include_guard.c tests/include_guard2.c")
+test_run("tests/lazy.c", "-lazy -O1")
+test_run("tests/atoms.c", "-j 8 -O1")
+test_run("tests/inline.c", "-O1")
+test_prune()
+test_run("tests/macros.c", "-O1")
+test_many_macros()
+test_run("tests/tokens.c", "-O1")
+test_pipe()
+
+write_file("test/crlf.h", "int ok_one;\r\nint ok_two;\r\nint bad = missing_crlf;\r\n")
+test_diag("tests/diag_lines.c", "-I test")
+test_mapped_files()
+test_run("tests/types.c", "-O1")
+test_diag("tests/diag_types.c")
+test_diag("tests/diag_sarif.c", "-diag-sarif")
+test_diag("tests/diag_sarif_escape.c", "-diag-sarif")
+test_server()
 
 print("Hello")
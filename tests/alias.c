@@ -0,0 +1,76 @@
+#include <stdio.h>
+
+// regressions for the provenance alias analysis, every address here goes through more
+// than one MEMBER/ARRAY level so the root object is a few nodes down.
+static int multi_dim(int i, int j) {
+    int m[4][4];
+    m[0][0] = 5;
+    m[i][j] = 7;
+    return m[0][0];
+}
+
+struct S { int a[4]; int b; };
+
+static int struct_array(int i, int j) {
+    struct S s[4];
+    s[0].a[0] = 1;
+    s[i].a[j] = 9;
+    return s[0].a[0];
+}
+
+static int dead_store(int i, int j) {
+    int m[4][4];
+    m[i][j] = 3;
+    m[0][0] = 1;
+    return m[i][j];
+}
+
+// the callees are too big to get inlined so the callers only know them by their
+// summaries, a pointer passed to one which stashes it has escaped while one which
+// just reads & writes through it hasn't.
+static int* stash;
+
+static void keep(int* p, int n) {
+    for (int i = 0; i < n; i++) {
+        p[i] = (p[i] * 7 + i) % 5;
+        if (p[i] == 3) p[i] += n;
+    }
+    stash = p;
+}
+
+static void scramble(int* p, int n) {
+    for (int i = 0; i < n; i++) {
+        p[i] = (p[i] * 7 + i) % 5;
+        if (p[i] == 3) p[i] += n;
+    }
+}
+
+static int escaped_by_call(int n) {
+    int x[4];
+    x[0] = x[1] = x[2] = x[3] = n;
+    keep(x, 4);
+    *stash = 42;
+    return x[0];
+}
+
+static int kept_by_call(int* q, int n) {
+    int x[4];
+    x[0] = n, x[1] = n + 1, x[2] = n + 2, x[3] = n + 3;
+    scramble(x, 4);
+    *q = 42;
+    return x[0] + x[1] + x[2] + x[3];
+}
+
+int main(int argc, char** argv) {
+    int zero = argc - 1;
+    int failed = 0;
+    if (multi_dim(zero, zero) != 7)    { printf("multi_dim failed\n");    failed++; }
+    if (struct_array(zero, zero) != 9) { printf("struct_array failed\n"); failed++; }
+    if (dead_store(zero, zero) != 1)   { printf("dead_store failed\n");   failed++; }
+
+    int q = 0;
+    if (escaped_by_call(argc) != 42)   { printf("escaped_by_call failed\n"); failed++; }
+    if (kept_by_call(&q, zero + 1) != 10 || q != 42) { printf("kept_by_call failed\n"); failed++; }
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,32 @@
+#include <stdio.h>
+
+// built with -j so the function bodies get parsed and type checked on several
+// threads at once. They all intern the same member and function names, if two
+// threads ever ended up with different atoms for one of them the lookups fail.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+struct Counter { int hits, misses; };
+
+static int shared_step(int x) { return x + 1; }
+
+#define F(i) static int step##i(struct Counter* c, int x) { c->hits += x; c->misses += shared_step(x); return x + i; }
+#define F8(i) F(i##0) F(i##1) F(i##2) F(i##3) F(i##4) F(i##5) F(i##6) F(i##7)
+#define F64(i) F8(i##1) F8(i##2) F8(i##3) F8(i##4) F8(i##5) F8(i##6) F8(i##7) F8(i##8)
+F64(1) F64(2) F64(3) F64(4)
+#undef F
+
+int main(int argc, char** argv) {
+    struct Counter c = { 0, 0 };
+    int total = 0;
+
+    #define F(i) total += step##i(&c, argc) - i;
+    F64(1) F64(2) F64(3) F64(4)
+    #undef F
+
+    CHECK("steps", total == 256*argc);
+    CHECK("members", c.hits == 256*argc && c.misses == 256*(argc + 1));
+    printf("%d failed\n", failed);
+    return failed;
+}
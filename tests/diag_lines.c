@@ -0,0 +1,16 @@
+// line maps are only built once a diagnostic needs one. These errors are spread over
+// this file, a header and a header with CRLF line endings (tests.lua writes that
+// one), and all their locations have to come out right.
+#include "diag_lines.h"
+#include "crlf.h"
+
+int a(void) { return missing_a; }
+
+
+
+        int b(void) { return missing_b; }
+
+//# tests/diag_lines.c:7:22
+//# tests/diag_lines.c:11:30
+//# tests/diag_lines.h:4:12
+//# test/crlf.h:3:11
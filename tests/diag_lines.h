@@ -0,0 +1,5 @@
+// included by diag_lines.c
+
+int in_header(void) {
+    return missing_in_header;
+}
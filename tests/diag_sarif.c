@@ -0,0 +1,9 @@
+// -diag-sarif holds the diagnostics until the build is done and prints them as one
+// SARIF log on stderr.
+int value(void) {
+    return missing_value;
+}
+
+//# {"version":"2.1.0","$schema":"https://json.schemastore.org/sarif-2.1.0.json","runs":[{"tool":{"driver":{"name":"cuik"}},"results":[{
+//# "level":"error","message":{"text":"unknown symbol: missing_value"},"locations":[{"physicalLocation":{"artifactLocation":{"uri":"
+//# tests/diag_sarif.c"},"region":{"startLine":4,"startColumn":12,"endColumn":25}}}]}]}]}
@@ -0,0 +1,5 @@
+// the message has to come out JSON escaped in the SARIF log
+#error "a \\ and a	tab"
+
+//# "message":{"text":"\"a \\\\ and a\u0009tab\""}
+//# tests/diag_sarif_escape.c"},"region":{"startLine":2,"startColumn":8,
@@ -0,0 +1,15 @@
+// types the type table must not merge, each of these is an error.
+struct Tag { int a; };
+
+void f(struct Tag* outer, int* p) {
+    struct Tag { int a, b; } inner;
+    struct Tag* bad = outer;
+
+    const int* c = p;
+    *c = 1;
+}
+
+//# could not implicitly convert type struct Tag* into struct Tag*
+//# tests/diag_types.c:6:15
+//# cannot assign to const value
+//# tests/diag_types.c:9:5
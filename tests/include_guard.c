@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+// built together with include_guard2.c in one invocation so both translation
+// units go through the shared file cache, the guard one of them records can't
+// skip the header in the other since it was never defined over there.
+#include "include_guard.h"
+#include "include_guard.h"
+
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+int other_value(void);
+int other_line(void);
+
+int main(int argc, char** argv) {
+    CHECK("value", GUARDED_VALUE == 7);
+    CHECK("guarded", sizeof(struct GuardedPair) == 2*sizeof(int));
+    CHECK("other unit", other_value() == 7);
+    CHECK("line", GUARDED_LINE == 9 && other_line() == 9);
+    printf("%d failed\n", failed);
+    return failed;
+}
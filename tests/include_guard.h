@@ -0,0 +1,11 @@
+#ifndef INCLUDE_GUARD_H
+#define INCLUDE_GUARD_H
+
+struct GuardedPair { int a, b; };
+
+#define GUARDED_VALUE 7
+
+// line 9, both translation units should agree since they share the tokens
+enum { GUARDED_LINE = __LINE__ };
+
+#endif
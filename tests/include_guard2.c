@@ -0,0 +1,12 @@
+// the other half of include_guard.c, by the time we get here the header's guard
+// is known but it was never defined in this translation unit.
+#include "include_guard.h"
+
+int other_value(void) {
+    struct GuardedPair p = { GUARDED_VALUE, 0 };
+    return p.a;
+}
+
+int other_line(void) {
+    return GUARDED_LINE;
+}
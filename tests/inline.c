@@ -0,0 +1,55 @@
+#include <stdio.h>
+
+// small callees get cloned into their callers at -O1, these cover the shapes the
+// inliner has to splice in: several returns, locals, loops, calls which were already
+// inlined into the callee and recursion (which has to stay a call).
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+static int clamp(int x, int lo, int hi) {
+    if (x < lo) return lo;
+    if (x > hi) return hi;
+    return x;
+}
+
+static int sum_to(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; i++) total += i;
+    return total;
+}
+
+static int first_of(int a, int b) {
+    int arr[2];
+    arr[0] = a, arr[1] = b;
+    return arr[0];
+}
+
+static int nested(int x) { return clamp(sum_to(x), 0, 20) + first_of(x, -x); }
+
+static void bump(int* p, int by) { *p += by; }
+
+static int fact(int n) { return n <= 1 ? 1 : n * fact(n - 1); }
+
+static int is_even(int n);
+static int is_odd(int n) { return n == 0 ? 0 : is_even(n - 1); }
+static int is_even(int n) { return n == 0 ? 1 : is_odd(n - 1); }
+
+int main(int argc, char** argv) {
+    int zero = argc - 1;
+
+    CHECK("clamp", clamp(zero - 5, 0, 10) == 0 && clamp(zero + 50, 0, 10) == 10 && clamp(zero + 3, 0, 10) == 3);
+    CHECK("loop", sum_to(zero + 10) == 55);
+    CHECK("local", first_of(zero + 4, 9) == 4);
+    CHECK("nested", nested(zero + 4) == 14 && nested(zero + 7) == 27);
+
+    int x = zero;
+    bump(&x, 3);
+    bump(&x, 4);
+    CHECK("side effect", x == 7);
+
+    CHECK("recursive", fact(zero + 5) == 120);
+    CHECK("mutual", is_even(zero + 10) && is_odd(zero + 7));
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,36 @@
+#include <stdio.h>
+
+// built with -lazy, where a static function body is only parsed once
+// something reachable refers to it. Each of these gets there a different way.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+static int leaf(int x) { return x * 2; }
+static int through_call(int x) { return leaf(x) + 1; }
+
+static int by_table(int x) { return x + 100; }
+static int by_pointer(int x) { return x - 1; }
+
+static inline int inlined(int x) { return x * 3; }
+static int through_inline(int x) { return inlined(x) + inlined(1); }
+
+// nothing reaches this one, -lazy never parses it
+static int unreachable(int x) { return through_call(x); }
+
+static int defined_later(int x);
+
+int main(int argc, char** argv) {
+    int (*table[])(int) = { by_table, by_pointer };
+    CHECK("call chain", through_call(argc + 2) == 7);
+    CHECK("table", table[0](1) == 101 && table[1](5) == 4);
+    CHECK("inline", through_inline(argc) == 6);
+    CHECK("defined later", defined_later(2) == 8);
+    printf("%d failed\n", failed);
+    return failed;
+}
+
+static int defined_later(int x) {
+    int (*fn)(int) = leaf;
+    return fn(x) * 2;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+
+// regressions for loop invariant load hoisting and strength reduction, both
+// run at -O1. Every case has a twin which must not be touched (the store
+// might hit the load, the loop might not run) and all of them get checked
+// against what the plain loop would've done.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+static int global_scale = 3, global_other;
+
+// loads get hoisted when the loop is known to run...
+static void scale_by(int* restrict dst, int* restrict src, int* restrict scale) {
+    for (int i = 0; i < 20; i++) {
+        dst[i] = src[i] * *scale;
+    }
+}
+
+// ...or when the same bytes were read on the way in
+static int first_plus_rest(int* p, int n) {
+    int s = *p;
+    for (int i = 0; i < n; i++) {
+        s += *p;
+    }
+    return s;
+}
+
+// the store might be writing to *p so it has to be reloaded every time
+static void fill_from(int* a, int* p, int n) {
+    for (int i = 0; i < n; i++) {
+        a[i] = *p + 1;
+    }
+}
+
+// hoisting *pp makes **pp invariant too
+static int sum_through(int** pp) {
+    int s = 0;
+    for (int i = 0; i < 6; i++) {
+        s += **pp + i;
+    }
+    return s;
+}
+
+// the loop doesn't run when n is 0 and nobody else touched *p, loading it
+// ahead of time would crash.
+static int sum_deref(int* p, int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s += *p;
+    }
+    return s;
+}
+
+static int globals(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        global_other = i;
+        s += global_scale;
+    }
+    return s;
+}
+
+static int globals_aliased(int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s += global_scale;
+        global_scale = i;
+    }
+    return s;
+}
+
+static void licm(int k) {
+    int src[20], dst[20], scale = k + 1;
+    for (int i = 0; i < 20; i++) src[i] = i - 5;
+
+    scale_by(dst, src, &scale);
+    for (int i = 0; i < 20; i++) {
+        CHECK("invariant load", dst[i] == (i - 5) * (k + 1));
+    }
+
+    int a[10];
+    for (int i = 0; i < 10; i++) a[i] = 10*i + k;
+    fill_from(a, &a[3], 10);
+    for (int i = 0; i < 10; i++) {
+        CHECK("aliased load", a[i] == (i <= 3 ? 31 + k : 32 + k));
+    }
+
+    int x = 7 * k, *px = &x;
+    CHECK("load chain", sum_through(&px) == 42*k + 15);
+    CHECK("read before loop", first_plus_rest(&x, 5) == 42*k);
+
+    CHECK("zero trip speculation", sum_deref(NULL, k > 1 ? 0 : k - 1) == 0);
+    CHECK("deref", sum_deref(&x, 4) == 28*k);
+
+    global_scale = 3;
+    CHECK("global", globals(5 + k) == 3*(5 + k) && global_other == 4 + k);
+    CHECK("global store", globals_aliased(4) == 3 + 0 + 1 + 2 && global_scale == 3);
+}
+
+// 12 and 20 byte strides aren't addressing mode scales, these get pointer bumps
+typedef struct { int x, y, z; } Vec3;
+typedef struct { int id; short pad[8]; } Item;
+
+static int sum_y(Vec3* v, int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s += v[i].y;
+    }
+    return s;
+}
+
+static void add_fields(Vec3* v, int n) {
+    for (int i = 0; i < n; i++) {
+        v[i].z = v[i].x + v[i].y;
+    }
+}
+
+// v[i] and v[i+1] share the pointer, just at different offsets
+static int diff_next(Vec3* v, int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s += v[i + 1].x - v[i].x;
+    }
+    return s;
+}
+
+static int sum_stepped(Item* items, int start, int n) {
+    int s = 0;
+    for (int i = start; i < n; i += 3) {
+        s += items[i].id;
+    }
+    return s;
+}
+
+static int sum_unsigned(Item* items, unsigned n) {
+    int s = 0;
+    for (unsigned i = 0; i < n; i++) {
+        s += items[i].id;
+    }
+    return s;
+}
+
+static long long sum_long(Vec3* v, long long n) {
+    long long s = 0;
+    for (long long i = 0; i < n; i++) {
+        s += v[i].x;
+    }
+    return s;
+}
+
+static void strength_reduce(int k) {
+    Vec3 v[17];
+    Item items[23];
+    for (int i = 0; i < 17; i++) v[i].x = i*i, v[i].y = i + k, v[i].z = -1;
+    for (int i = 0; i < 23; i++) items[i].id = 100 + i*k;
+
+    for (int n = 0; n <= 16; n++) {
+        int expect_y = 0;
+        for (int i = n - 1; i >= 0; i--) expect_y += i + k;
+
+        CHECK("sum y", sum_y(v, n) == expect_y);
+        CHECK("diff next", diff_next(v, n) == n*n);
+        CHECK("sum long", sum_long(v, n) == (long long) (n - 1) * n * (2*n - 1) / 6);
+    }
+
+    add_fields(v, 16);
+    for (int i = 0; i < 17; i++) {
+        CHECK("add fields", v[i].z == (i < 16 ? i*i + i + k : -1));
+    }
+
+    int expect = 0;
+    for (int i = 22; i >= 2; i--) {
+        if ((i - 2) % 3 == 0) expect += 100 + i*k;
+    }
+    CHECK("stepped", sum_stepped(items, 2, 23) == expect);
+    CHECK("stepped empty", sum_stepped(items, 23, 23) == 0);
+    CHECK("unsigned", sum_unsigned(items, 23) == 2300 + 253*k);
+}
+
+int main(int argc, char** argv) {
+    licm(argc);
+    strength_reduce(argc);
+    printf("%d failed\n", failed);
+    return failed;
+}
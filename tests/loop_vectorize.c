@@ -0,0 +1,172 @@
+#include <stdio.h>
+
+// regressions for the loop vectorizer, every loop here is simple enough to get
+// a vector loop at -O1 so the answers have to agree with the scalar ones at
+// every trip count (the scalar tail does the leftovers). The loops doing the
+// checking have branches in them so they stay scalar.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+static void map_add(int* restrict dst, int* restrict a, int* restrict b, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = a[i] + b[i] * 3;
+    }
+}
+
+static void map_float(float* restrict dst, float* restrict a, float k, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = a[i] * k - 1.0f;
+    }
+}
+
+static void copy_bytes(char* restrict dst, char* restrict src, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = src[i];
+    }
+}
+
+static int sum(int* a, int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        s += a[i];
+    }
+    return s;
+}
+
+static unsigned xor_all(unsigned* a, int n) {
+    unsigned x = 0x1234;
+    for (int i = 0; i < n; i++) {
+        x ^= a[i];
+    }
+    return x;
+}
+
+static short mul_all(short* a, int n) {
+    short p = 1;
+    for (int i = 0; i < n; i++) {
+        p *= a[i];
+    }
+    return p;
+}
+
+// trip counts on both sides of 2*lanes (4 ints or floats, 16 bytes, 8 shorts)
+static void maps(int k, int n) {
+    int a[40], b[40], dst[41];
+    float fa[40], fdst[40];
+    char src8[40], dst8[41];
+    for (int i = 0; i < 40; i++) {
+        a[i] = i*7 + k, b[i] = 40 - i;
+        fa[i] = i + 0.5f;
+        src8[i] = i*11 + k;
+    }
+
+    // one past the end must not be written
+    dst[n] = -12345, dst8[n] = 99;
+    map_add(dst, a, b, n);
+    map_float(fdst, fa, 2.0f, n);
+    copy_bytes(dst8, src8, n);
+
+    for (int i = 0; i < n; i++) {
+        CHECK("map add", dst[i] == a[i] + b[i]*3);
+        CHECK("map float", fdst[i] == fa[i]*2.0f - 1.0f);
+        CHECK("copy bytes", dst8[i] == src8[i]);
+    }
+    CHECK("map tail", dst[n] == -12345 && dst8[n] == 99);
+}
+
+static void reductions(int k, int n) {
+    int a[40];
+    unsigned u[40];
+    short s[40];
+    for (int i = 0; i < 40; i++) {
+        a[i] = i*7 + k;
+        u[i] = i*0x01010101u + k;
+        s[i] = i & 1 ? 3 : -1;
+    }
+
+    int expect_sum = 0;
+    unsigned expect_xor = 0x1234;
+    short expect_mul = 1;
+    // backwards loops aren't counted loops, this one stays scalar
+    for (int i = n - 1; i >= 0; i--) {
+        expect_sum += a[i], expect_xor ^= u[i], expect_mul *= s[i];
+    }
+
+    CHECK("sum reduction", sum(a, n) == expect_sum);
+    CHECK("xor reduction", xor_all(u, n) == expect_xor);
+    CHECK("mul reduction", mul_all(s, n) == expect_mul);
+}
+
+static void trip_counts(int k) {
+    for (int n = 0; n <= 37; n++) {
+        maps(k, n);
+        reductions(k, n);
+    }
+}
+
+// constant trip counts below 2*lanes are left alone, above it the vector
+// loop runs once or twice and the tail picks up the rest.
+static void constant_trips(int k) {
+    int a[19];
+    for (int i = 0; i < 19; i++) a[i] = i + k;
+
+    int s7 = 0, s8 = 0, s19 = 0;
+    for (int i = 0; i < 7; i++) s7 += a[i];
+    for (int i = 0; i < 8; i++) s8 += a[i];
+    for (int i = 0; i < 19; i++) s19 += a[i];
+
+    CHECK("7 trips", s7 == 21 + 7*k);
+    CHECK("8 trips", s8 == 28 + 8*k);
+    CHECK("19 trips", s19 == 171 + 19*k);
+}
+
+// dst and src can point into the same buffer, whenever they're closer than a
+// vector's width the runtime check has to send us to the scalar loop.
+static void add_one(int* dst, int* src, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = src[i] + 1;
+    }
+}
+
+static void overlap(int k) {
+    int buf[64];
+    for (int dist = -9; dist <= 9; dist++) {
+        int lo = dist < 0 ? -dist : 0;
+        for (int i = 0; i < 64; i++) buf[i] = i*100 + k;
+
+        // what the scalar loop would've done
+        int expect[64];
+        for (int i = 0; i < 64; i++) expect[i] = buf[i];
+        for (int i = 0; i < 40; i++) expect[lo + dist + i] = expect[lo + i] + 1;
+
+        add_one(&buf[lo + dist], &buf[lo], 40);
+        for (int i = 0; i < 64; i++) {
+            CHECK("runtime overlap", buf[i] == expect[i]);
+        }
+    }
+}
+
+// same base with a constant distance, a[i+1] = a[i] can't be vectorized at all
+// while a[i] = a[i+1] is fine.
+static void same_base(int k) {
+    int a[33], b[33];
+    for (int i = 0; i < 33; i++) a[i] = b[i] = i + k;
+
+    for (int i = 0; i < 32; i++) a[i + 1] = a[i];
+    for (int i = 0; i < 32; i++) b[i] = b[i + 1];
+
+    for (int i = 0; i < 33; i++) {
+        CHECK("forward carry", a[i] == k);
+        CHECK("backward read", b[i] == (i < 32 ? i + 1 + k : 32 + k));
+    }
+}
+
+int main(int argc, char** argv) {
+    trip_counts(argc);
+    constant_trips(argc);
+    overlap(argc);
+    same_base(argc);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+
+// macro bodies are lexed once when they're defined and every expansion works off a
+// copy of those tokens, none of these should ever leak into the next expansion.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+#define CAT(a, b) a##b
+#define TWICE(x) ((x) + (x))
+#define SUM(...) sum_of(__VA_ARGS__)
+#define FORWARD TWICE
+#define LINE_HERE __LINE__
+
+static int sum_of(int n, int a, int b) { return n + a + b; }
+
+int main(int argc, char** argv) {
+    int zero = argc - 1;
+    int value = 7, self = 2;
+
+    // rescanning doesn't expand a macro inside its own expansion
+    #define self (self * 3)
+
+    CHECK("stringify", sizeof(STR(hello)) == 6 && STR(hello)[4] == 'o');
+    CHECK("stringify expanded", sizeof(STR(CAT(1, 2))) == 3 && STR(CAT(1, 2))[1] == '2');
+    CHECK("paste", CAT(va, lue) == 7 && CAT(1, 2) == 12);
+    CHECK("nested", TWICE(TWICE(zero + 3)) == 12);
+    CHECK("again", TWICE(zero + 1) == 2 && TWICE(zero + 1) == 2);
+    CHECK("variadic", SUM(zero, 4, 5) == 9);
+    CHECK("forward", FORWARD(zero + 5) == 10);
+    CHECK("self", self == 6);
+
+    int line = LINE_HERE; CHECK("line", line == __LINE__);
+
+    #define V 1
+    int before = TWICE(V);
+    #undef V
+    #define V 20
+    CHECK("redefined", before == 2 && TWICE(V) == 40);
+
+    printf("%d failed\n", failed);
+    return failed;
+}
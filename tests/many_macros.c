@@ -0,0 +1,20 @@
+#include <stdio.h>
+#include "many_macros.h"
+
+// tests.lua writes many_macros.h, it defines 10000 macros, #undefs every other one
+// and defines every fourth one again. That's enough to grow the macro table a few
+// times and leave tombstones all over it.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+#if defined(MANY_2) || defined(MANY_9998) || !defined(MANY_4)
+#error "the macro table lost track of an #undef"
+#endif
+
+int main(int argc, char** argv) {
+    CHECK("kept", MANY_1 == 1 && MANY_5001 == 5001 && MANY_9999 == 9999);
+    CHECK("redefined", MANY_0 == 0 && MANY_4 == 8 && MANY_9996 == 19992);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,20 @@
+#include <stdio.h>
+#include "empty.h"
+#include "page.h"
+#include "whitespace.h"
+#include "splice.h"
+
+// tests.lua writes the headers for this one. There's an empty one, one which ends
+// right on a page boundary without a newline, one using \t \v \f as whitespace and
+// one with backslash-newlines which the lexer joins in place.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+int main(int argc, char** argv) {
+    CHECK("page", page_value == 7);
+    CHECK("whitespace", ws_value == 3);
+    CHECK("splice", spliced_value == 5 && SPLICED_MACRO == 6);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,33 @@
+#include <stdio.h>
+
+// built at -O1, where private symbols nothing public can reach are dropped before
+// codegen. tests.lua also checks the object file, nothing named *_dropped should
+// be in there while the *_kept ones are.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+// never called, neither is the helper and global only it refers to
+static int counter_dropped;
+static int helper_dropped(int x) { counter_dropped += x; return x; }
+static int chain_dropped(int x) { return helper_dropped(x) * 2; }
+
+// called but inlined everywhere
+static int inlined_dropped(int x) { return x + 1; }
+
+// only reached through another private function
+static int table_kept[4] = { 1, 2, 3, 4 };
+
+static int sum_table(int i) {
+    int sum = 0;
+    for (int j = 0; j <= i; j++) sum += table_kept[j & 3];
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    int zero = argc - 1;
+    CHECK("table", sum_table(zero + 3) == 10);
+    CHECK("inlined", inlined_dropped(zero) == 1);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+
+// regressions for the local symbol table, inner scopes can shadow names
+// (including struct and enum tags) and closing the scope brings the outer
+// ones back.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+static void tags(void) {
+    struct Pair { int a; } outer = { 5 };
+    enum Color { RED, GREEN } c = GREEN;
+    {
+        // a complete tag from an outer scope can be redefined in here
+        struct Pair { int a, b; } inner = { 1, 2 };
+        enum Color { BLUE, CYAN, MAGENTA } d = MAGENTA;
+        CHECK("shadowed struct", sizeof(inner) == 2*sizeof(int) && inner.b == 2);
+        CHECK("shadowed enum", d == 2);
+    }
+
+    struct Pair after = { 7 };
+    CHECK("struct after scope", sizeof(after) == sizeof(int) && after.a + outer.a == 12);
+    CHECK("enum after scope", c == 1);
+}
+
+static void locals(int k) {
+    int x = k, y = 2;
+    {
+        int x = 100;
+        {
+            int y = x + 1;
+            CHECK("nested shadow", x == 100 && y == 101);
+        }
+        CHECK("inner restored", y == 2);
+        x += y;
+        CHECK("inner x", x == 102);
+    }
+    CHECK("outer restored", x == k && y == 2);
+
+    // lots of names in one scope to grow the index
+    #define L(i) int v##i = i;
+    #define L8(i) L(i##0) L(i##1) L(i##2) L(i##3) L(i##4) L(i##5) L(i##6) L(i##7)
+    L8(1) L8(2) L8(3) L8(4) L8(5) L8(6) L8(7)
+    L8(11) L8(12) L8(13) L8(14) L8(15) L8(16) L8(17)
+    L8(21) L8(22) L8(23) L8(24) L8(25) L8(26) L8(27)
+    L8(31) L8(32) L8(33) L8(34) L8(35) L8(36) L8(37)
+    L8(41) L8(42) L8(43) L8(44) L8(45) L8(46) L8(47)
+    #undef L8
+    #undef L
+    CHECK("many locals", v10 + v377 + v475 == 10 + 377 + 475 && x == k);
+}
+
+int main(int argc, char** argv) {
+    tags();
+    locals(argc);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,9 @@
+#include <stdio.h>
+#include "server_value.h"
+
+// built by tests.lua through cuik --connect, server_value.h gets rewritten between
+// builds so the server has to notice and drop the copy it kept around.
+int main(void) {
+    printf("%d\n", VALUE);
+    return 0;
+}
@@ -0,0 +1,9 @@
+#include <stdio.h>
+#include "value.h"
+
+// built by tests.lua with -token-cache, value.h gets written by the test so it can
+// change it between builds and make sure the cached tokens are thrown out.
+int main(void) {
+    printf("%d\n", VALUE);
+    return 0;
+}
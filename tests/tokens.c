@@ -0,0 +1,27 @@
+#include <stdio.h>
+
+// the preprocessor's output keeps every token's text in one buffer and refers to it
+// by offset, these make sure the contents still read the same on the parser's side.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+#define CAT(a, b) a##b
+#define STR(x) #x
+
+static int long_name = 3;
+static int identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_end = 4;
+
+int main(int argc, char** argv) {
+    const char* s = "tab\there" " and " "more";
+
+    CHECK("concat", sizeof("tab\there" " and " "more") == 18 && s[3] == '\t' && s[13] == 'm');
+    CHECK("char", 'a' + '\n' == 107 && '\x41' == 65);
+    CHECK("wide", sizeof(L"ab") / sizeof(L"ab"[0]) == 3);
+    CHECK("numbers", 0x1F == 31 && 017 == 15 && 1.5e1f == 15.0f && 10ull == 10);
+    CHECK("pasted", CAT(long_, name) == 3 && CAT(0x, 10) == 16);
+    CHECK("stringized", sizeof(STR(long_name)) == 10 && STR(long_name)[5] == 'n');
+    CHECK("long identifier", identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_identifier_end == 4);
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,48 @@
+#include <stdio.h>
+
+// pointer and array types are hash-consed, spelling a type twice has to give back
+// one which behaves the same while anything that differs (qualifiers, lengths,
+// element types, a shadowed tag) keeps its own layout. diag_types.c has the cases
+// which have to be rejected.
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+typedef int* IntPtr;
+typedef int Row[4];
+
+struct Tag { int a; };
+
+int main(int argc, char** argv) {
+    int arr4[4], arr5[5];
+    int* p = arr4;
+    IntPtr q = p;
+    int** pp = &q;
+    IntPtr* pq = &p;
+    CHECK("same pointer", *pp == p && *pq == q);
+
+    // the const one can't leak into the plain pointer we write through
+    const int* c = p;
+    *p = argc;
+    CHECK("qualified", *c == argc);
+
+    Row* rows = &arr4;
+    int (*r4)[4] = rows;
+    int (*r5)[5] = &arr5;
+    double (*d4)[4] = 0;
+    int (*m)[4][5] = 0;
+    CHECK("array sizes", sizeof(*r4) == 4*sizeof(int) && sizeof(*r5) == 5*sizeof(int) && sizeof(*d4) == 4*sizeof(double));
+    CHECK("nested array", sizeof(*m) == 20*sizeof(int) && sizeof(**m) == 5*sizeof(int));
+    CHECK("strides", (char*) (r4 + 1) - (char*) r4 == 4*sizeof(int) && (char*) (r5 + 1) - (char*) r5 == 5*sizeof(int));
+
+    struct Tag outer;
+    struct Tag* po = &outer;
+    {
+        struct Tag { int a, b; } inner;
+        struct Tag* pi = &inner;
+        CHECK("shadowed tag", sizeof(*pi) == 2*sizeof(int) && sizeof(*po) == sizeof(int));
+    }
+
+    printf("%d failed\n", failed);
+    return failed;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+
+// regressions for _Vector lowering, the lanes are filled at runtime (argc) so
+// none of this constant folds away and every op has to go through isel.
+typedef _Vector(long long, 2) i64x2;
+typedef _Vector(int, 4) i32x4;
+typedef _Vector(short, 8) i16x8;
+typedef _Vector(char, 16) i8x16;
+typedef _Vector(unsigned char, 16) u8x16;
+typedef _Vector(float, 4) f32x4;
+typedef _Vector(double, 2) f64x2;
+
+static int failed;
+
+#define CHECK(name, cond) if (!(cond)) { printf(name " failed\n"); failed++; }
+
+// there's no qword or byte multiply in SSE4.1 so these get emulated
+static void mul(int k) {
+    i64x2 a = { 123456789012LL + k, -7 - k };
+    i64x2 b = { 3, 1000000007LL * k };
+    i64x2 c = a * b;
+    CHECK("i64x2 mul", c[0] == a[0] * b[0] && c[1] == a[1] * b[1]);
+
+    i8x16 x, y;
+    u8x16 ux, uy;
+    for (int i = 0; i < 16; i++) {
+        x[i] = i*7 - 50 + k, y[i] = 3 - i*5;
+        ux[i] = i*17 + k, uy[i] = 255 - i*3;
+    }
+
+    i8x16 z = x * y;
+    u8x16 uz = ux * uy;
+    for (int i = 0; i < 16; i++) {
+        CHECK("i8x16 mul", z[i] == (char) (x[i] * y[i]));
+        CHECK("u8x16 mul", uz[i] == (unsigned char) (ux[i] * uy[i]));
+    }
+
+    i16x8 s = { k, -2, 300, 4, 5, -6, 7, 8 };
+    i16x8 t = s * s;
+    for (int i = 0; i < 8; i++) {
+        CHECK("i16x8 mul", t[i] == (short) (s[i] * s[i]));
+    }
+}
+
+// float vectors only get the bitwise ops (that's what _mm_and_ps needs)
+static void float_bits(int k) {
+    f32x4 a = { 1.0f, -2.0f, 3.0f, k };
+    f32x4 b = a & a;
+    f32x4 c = a ^ a;
+    CHECK("f32x4 and", b[1] == -2.0f && b[3] == k);
+    CHECK("f32x4 xor", c[0] == 0.0f && c[3] == 0.0f);
+
+    f64x2 d = { 0.5, -k };
+    f64x2 e = d | d;
+    CHECK("f64x2 or", e[0] == 0.5 && e[1] == -k);
+}
+
+// braces fill lanes in order, the rest are zero
+static i32x4 global_vec = { 1, 2, 3 };
+
+static void initializers(int k) {
+    i32x4 a = { k, 2 };
+    i32x4 b = { [3] = 9, [1] = k };
+    f32x4 c = { 1.5f, 2.5f, 3.5f, 4.5f };
+    CHECK("init list", a[0] == k && a[1] == 2 && a[2] == 0 && a[3] == 0);
+    CHECK("init designator", b[0] == 0 && b[1] == k && b[2] == 0 && b[3] == 9);
+    CHECK("init float", c[0] == 1.5f && c[3] == 4.5f);
+    CHECK("init global", global_vec[0] == 1 && global_vec[2] == 3 && global_vec[3] == 0);
+}
+
+// 128bit vectors go in XMM registers on SysV, two of them means the
+// parameter home slots can't be used.
+static i32x4 add_scaled(i32x4 a, int k, i32x4 b) {
+    i32x4 r = a + b;
+    r[0] += k;
+    return r;
+}
+
+static void by_value(int k) {
+    i32x4 a = { k, 2, 3, 4 };
+    i32x4 b = { 10, 20, 30, 40 };
+    i32x4 c = add_scaled(a, 5, b);
+    CHECK("by value", c[0] == k + 15 && c[1] == 22 && c[2] == 33 && c[3] == 44);
+}
+
+static void shuffles(int k) {
+    i32x4 a = { k, 1, 2, 3 };
+    i32x4 b = { 4, 5, 6, 7 };
+    i32x4 c = __builtin_shufflevector(a, b, 3, 4, 0, 7);
+    CHECK("shufflevector", c[0] == 3 && c[1] == 4 && c[2] == k && c[3] == 7);
+}
+
+int main(int argc, char** argv) {
+    mul(argc);
+    float_bits(argc);
+    initializers(argc);
+    by_value(argc);
+    shuffles(argc);
+    printf("%d failed\n", failed);
+    return failed;
+}